@@ -0,0 +1,167 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <cmath>
+#include <random>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+namespace compressed_halo_exchange {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    using gridtools::ghex::compression;
+
+    inline const char* codec_name(compression c)
+    {
+        switch (c)
+        {
+            case compression::none:        return "none";
+            case compression::shuffle_rle: return "shuffle+rle";
+            default:                       return "xor+rle";
+        }
+    }
+
+    /** @brief exchange one double field on a 3D cartesian decomposition with cubic local domains of size n and halo
+      * width h. The field is updated between exchanges like a slowly evolving (smooth) or random (noisy) state.
+      * Prints the exchange time and the compression ratio. Returns false if the halos are not correct. */
+    bool run(context_type& context, const std::array<int,3>& dims, const std::array<int,3>& coords, int n, int h,
+        bool smooth, compression codec)
+    {
+        const std::array<int,3> g_first{0,0,0};
+        const std::array<int,3> g_last{dims[0]*n-1, dims[1]*n-1, dims[2]*n-1};
+        const std::array<bool,3> periodic{true,true,true};
+        const std::array<int,6> halos{h,h,h,h,h,h};
+        const std::array<int,3> offsets{h,h,h};
+        const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            context.rank(),
+            std::array<int,3>{coords[0]*n, coords[1]*n, coords[2]*n},
+            std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, (coords[2]+1)*n-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+        auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+
+        // state at time step t (noisy fields are drawn from a generator seeded with the global index and t)
+        auto value = [&g_last,smooth](int x, int y, int z, int t)
+        {
+            const int gx = g_last[0]+1, gy = g_last[1]+1, gz = g_last[2]+1;
+            x = (x+gx)%gx; y = (y+gy)%gy; z = (z+gz)%gz;
+            if (smooth)
+            {
+                const double pi = std::acos(-1.0);
+                return 280.0 + 10.0*std::sin(2*pi*x/gx)*std::cos(2*pi*y/gy) + 5.0*std::sin(2*pi*z/gz)
+                    + 1.0e-3*std::sin(0.1*t + 2*pi*x/gx);
+            }
+            std::mt19937 gen(static_cast<unsigned>(x + gx*(y + gy*z)) + 7919u*t);
+            return std::uniform_real_distribution<double>(-1.0, 1.0)(gen);
+        };
+
+        std::vector<double> data(extents[0]*extents[1]*extents[2], 0.0);
+        auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(local_domains[0].domain_id(), data.data(), offsets, extents);
+        auto update = [&](int t)
+        {
+            for (int z=0; z<n; ++z)
+                for (int y=0; y<n; ++y)
+                    for (int x=0; x<n; ++x)
+                        field(x,y,z) = value(coords[0]*n+x, coords[1]*n+y, coords[2]*n+z, t);
+        };
+
+        auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+        co.set_compression(codec);
+
+        gridtools::ghex::timer t;
+        int step = 0;
+        for (int i=0; i<num_warmup+num_iterations; ++i, ++step)
+        {
+            update(step);
+            if (i == num_warmup) co.reset_compression_statistics();
+            MPI_Barrier(context.mpi_comm());
+            t.tic();
+            co.exchange(pattern(field)).wait();
+            if (i >= num_warmup) t.toc();
+        }
+        auto t_all = gridtools::ghex::reduce(t, context.mpi_comm());
+
+        unsigned long long bytes[2] = {co.get_compression_statistics().raw_bytes, co.get_compression_statistics().sent_bytes};
+        unsigned long long bytes_all[2];
+        MPI_Reduce(bytes, bytes_all, 2, MPI_UNSIGNED_LONG_LONG, MPI_SUM, 0, context.mpi_comm());
+
+        if (context.rank() == 0)
+        {
+            const double ratio = bytes_all[1] ? static_cast<double>(bytes_all[0])/bytes_all[1] : 1.0;
+            std::cout << std::setw(8) << n
+                      << std::setw(8) << (smooth ? "smooth" : "noisy")
+                      << std::setw(14) << codec_name(codec)
+                      << std::setw(10) << std::setprecision(3) << ratio << std::setprecision(6)
+                      << std::setw(14) << t_all.mean()
+                      << std::setw(14) << t_all.stddev() << "\n";
+        }
+
+        // check halos against the last state
+        bool passed = true;
+        for (int z=-h; z<n+h; ++z)
+            for (int y=-h; y<n+h; ++y)
+                for (int x=-h; x<n+h; ++x)
+                    if (field(x,y,z) != value(coords[0]*n+x, coords[1]*n+y, coords[2]*n+z, step-1))
+                        passed = false;
+        return passed;
+    }
+
+} // namespace compressed_halo_exchange
+
+TEST(Communication, comm_2_compressed_halo_exchange)
+{
+    using compressed_halo_exchange::compression;
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[3] = {0,0,0};
+    MPI_Dims_create(context.size(), 3, dims_);
+    const std::array<int,3> dims{dims_[0], dims_[1], dims_[2]};
+    const std::array<int,3> coords{
+        context.rank()%dims[0], (context.rank()/dims[0])%dims[1], context.rank()/(dims[0]*dims[1])};
+
+    const int halo = 2;
+    const std::vector<int> domain_sizes{32, 64, 128};
+
+    if (context.rank() == 0)
+    {
+        std::cout << "compressed halo exchange, " << context.size() << " ranks, halo " << halo << ", times in us\n";
+        std::cout << std::setw(8) << "n" << std::setw(8) << "data" << std::setw(14) << "codec"
+                  << std::setw(10) << "ratio" << std::setw(14) << "exchange" << std::setw(14) << "std" << "\n";
+    }
+
+    bool passed = true;
+    for (auto n : domain_sizes)
+        for (bool smooth : {true, false})
+            for (auto codec : {compression::none, compression::shuffle_rle, compression::xor_delta_rle})
+                passed = compressed_halo_exchange::run(context, dims, coords, n, halo, smooth, codec) && passed;
+
+    EXPECT_TRUE(passed);
+}
@@ -0,0 +1,195 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <string>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+namespace fused_halo_exchange {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    enum class mode { per_field, field_major, interleaved };
+
+    inline const char* mode_name(mode m)
+    {
+        switch (m)
+        {
+            case mode::per_field:   return "per field";
+            case mode::field_major: return "field major";
+            default:                return "interleaved";
+        }
+    }
+
+    /** @brief exchange num_fields double fields on a 3D cartesian decomposition with cubic local domains of size n
+      * and halo width h, either field by field or fused. Prints the exchange time and the time spent in packing
+      * alone (all send halos of this rank). Returns false if the halos are not correct. */
+    bool run(context_type& context, const std::array<int,3>& dims, const std::array<int,3>& coords, int n, int h,
+        int num_fields, mode m)
+    {
+        const std::array<int,3> g_first{0,0,0};
+        const std::array<int,3> g_last{dims[0]*n-1, dims[1]*n-1, dims[2]*n-1};
+        const std::array<bool,3> periodic{true,true,true};
+        const std::array<int,6> halos{h,h,h,h,h,h};
+        const std::array<int,3> offsets{h,h,h};
+        const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            context.rank(),
+            std::array<int,3>{coords[0]*n, coords[1]*n, coords[2]*n},
+            std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, (coords[2]+1)*n-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+        auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+
+        auto global_index = [&g_last](int f, int x, int y, int z)
+        {
+            const int gx = g_last[0]+1, gy = g_last[1]+1, gz = g_last[2]+1;
+            x = (x+gx)%gx; y = (y+gy)%gy; z = (z+gz)%gz;
+            return static_cast<double>(x + gx*(y + gy*z)) + 0.125*f;
+        };
+
+        using field_type = decltype(gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(0, (double*)nullptr, offsets, extents));
+        std::vector<std::vector<double>> data(num_fields, std::vector<double>(extents[0]*extents[1]*extents[2], -1.0));
+        std::vector<field_type> fields;
+        for (int f=0; f<num_fields; ++f)
+        {
+            fields.push_back(gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(local_domains[0].domain_id(), data[f].data(), offsets, extents));
+            for (int z=0; z<n; ++z)
+                for (int y=0; y<n; ++y)
+                    for (int x=0; x<n; ++x)
+                        fields[f](x,y,z) = global_index(f, coords[0]*n+x, coords[1]*n+y, coords[2]*n+z);
+        }
+
+        std::vector<std::remove_reference_t<decltype(pattern(fields[0]))>> bis;
+        for (auto& f : fields) bis.push_back(pattern(f));
+
+        auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+        if (m == mode::interleaved) co.set_fused_layout(gridtools::ghex::fused_layout::interleaved);
+
+        gridtools::ghex::timer t;
+        for (int i=0; i<num_warmup+num_iterations; ++i)
+        {
+            MPI_Barrier(context.mpi_comm());
+            t.tic();
+            if (m == mode::per_field)
+                co.exchange(bis.data(), bis.size()).wait();
+            else
+                co.exchange_fused(bis.data(), bis.size()).wait();
+            if (i >= num_warmup) t.toc();
+        }
+        auto t_all = gridtools::ghex::reduce(t, context.mpi_comm());
+
+        // packing alone
+        std::size_t num_elements = 0;
+        for (const auto& p_id_c : pattern[0].send_halos())
+            num_elements += decltype(pattern)::value_type::num_elements(p_id_c.second);
+        std::vector<double> buffer(num_elements*num_fields);
+        std::vector<double*> ptrs;
+        for (auto& f : fields) ptrs.push_back(f.data());
+        gridtools::ghex::timer t_pack;
+        for (int i=0; i<num_warmup+num_iterations; ++i)
+        {
+            t_pack.tic();
+            double* b = buffer.data();
+            for (const auto& p_id_c : pattern[0].send_halos())
+            {
+                const std::size_t s = decltype(pattern)::value_type::num_elements(p_id_c.second);
+                if (m == mode::per_field)
+                {
+                    for (auto& f : fields)
+                    {
+                        f.pack(b, p_id_c.second, nullptr);
+                        b += s;
+                    }
+                }
+                else
+                {
+                    fields[0].pack_fused(b, p_id_c.second, ptrs.data(), ptrs.size(), m == mode::interleaved, nullptr);
+                    b += s*num_fields;
+                }
+            }
+            if (i >= num_warmup) t_pack.toc();
+        }
+        auto t_pack_all = gridtools::ghex::reduce(t_pack, context.mpi_comm());
+
+        if (context.rank() == 0)
+        {
+            std::cout << std::setw(8) << n
+                      << std::setw(8) << num_fields
+                      << std::setw(14) << mode_name(m)
+                      << std::setw(14) << t_all.mean()
+                      << std::setw(14) << t_all.stddev()
+                      << std::setw(14) << t_pack_all.mean()
+                      << std::setw(14) << t_pack_all.stddev() << "\n";
+        }
+
+        // check halos
+        bool passed = true;
+        for (int f=0; f<num_fields; ++f)
+            for (int z=-h; z<n+h; ++z)
+                for (int y=-h; y<n+h; ++y)
+                    for (int x=-h; x<n+h; ++x)
+                        if (fields[f](x,y,z) != global_index(f, coords[0]*n+x, coords[1]*n+y, coords[2]*n+z))
+                            passed = false;
+        return passed;
+    }
+
+} // namespace fused_halo_exchange
+
+TEST(Communication, comm_2_fused_halo_exchange)
+{
+    using fused_halo_exchange::mode;
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[3] = {0,0,0};
+    MPI_Dims_create(context.size(), 3, dims_);
+    const std::array<int,3> dims{dims_[0], dims_[1], dims_[2]};
+    const std::array<int,3> coords{
+        context.rank()%dims[0], (context.rank()/dims[0])%dims[1], context.rank()/(dims[0]*dims[1])};
+
+    const int halo = 2;
+    const std::vector<int> domain_sizes{32, 64, 128};
+    const std::vector<int> num_fields{1, 2, 4, 8};
+
+    if (context.rank() == 0)
+    {
+        std::cout << "fused halo exchange, " << context.size() << " ranks, halo " << halo << ", times in us\n";
+        std::cout << std::setw(8) << "n" << std::setw(8) << "fields" << std::setw(14) << "mode"
+                  << std::setw(14) << "exchange" << std::setw(14) << "std"
+                  << std::setw(14) << "pack" << std::setw(14) << "std" << "\n";
+    }
+
+    bool passed = true;
+    for (auto n : domain_sizes)
+        for (auto nf : num_fields)
+            for (auto m : {mode::per_field, mode::field_major, mode::interleaved})
+                passed = passed && fused_halo_exchange::run(context, dims, coords, n, halo, nf, m);
+
+    EXPECT_TRUE(passed);
+}
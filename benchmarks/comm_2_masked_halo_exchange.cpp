@@ -0,0 +1,153 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <cmath>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+namespace masked_halo_exchange {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    /** @brief exchange one double field on a horizontal 2D decomposition (local domains of n x n x nz points, halo
+      * width h) with a dense and with a masked pattern. The synthetic land mask covers half of the horizontal
+      * plane with irregularly shaped continents. Prints halo volume, number of iteration spaces and exchange time.
+      * Returns false if the active halo points are not correct. */
+    bool run(context_type& context, const std::array<int,2>& dims, const std::array<int,2>& coords, int n, int nz,
+        int h)
+    {
+        const std::array<int,3> g_first{0,0,0};
+        const std::array<int,3> g_last{dims[0]*n-1, dims[1]*n-1, nz-1};
+        const std::array<bool,3> periodic{true,true,false};
+        const std::array<int,6> halos{h,h,h,h,0,0};
+        const std::array<int,3> offsets{h,h,0};
+        const std::array<int,3> extents{n+2*h,n+2*h,nz};
+        const int gx = g_last[0]+1, gy = g_last[1]+1;
+
+        // 50% land: sign of a product of (shifted) sines, i.e. a checkerboard of smooth continents
+        auto wet = [gx,gy](int x, int y)
+        {
+            const double pi = std::acos(-1.0);
+            return std::sin(2*pi*3*(x+0.5)/gx + 0.7*std::sin(2*pi*y/gy)) * std::sin(2*pi*2*(y+0.5)/gy) > 0.0;
+        };
+        auto mask = [&wet](const domain_descriptor_type&, const auto& x) { return wet(x[0], x[1]); };
+
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            context.rank(),
+            std::array<int,3>{coords[0]*n, coords[1]*n, 0},
+            std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, nz-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+        auto dense  = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+        auto masked = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains, mask);
+        using pattern_type = std::remove_reference_t<decltype(dense[0])>;
+
+        auto value = [gx,gy](int x, int y, int z) { return static_cast<double>((x+gx)%gx + gx*((y+gy)%gy + gy*z)); };
+        std::vector<double> data(extents[0]*extents[1]*extents[2], -1.0);
+        auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(local_domains[0].domain_id(), data.data(), offsets, extents);
+        for (int z=0; z<nz; ++z)
+            for (int y=0; y<n; ++y)
+                for (int x=0; x<n; ++x)
+                    field(x,y,z) = value(coords[0]*n+x, coords[1]*n+y, z);
+
+        auto co = gridtools::ghex::make_communication_object<decltype(dense)>(context.get_communicator(context.get_token()));
+
+        bool passed = true;
+        for (int m=0; m<2; ++m)
+        {
+            const auto& pattern = (m == 0) ? dense : masked;
+            gridtools::ghex::timer t;
+            for (int i=0; i<num_warmup+num_iterations; ++i)
+            {
+                MPI_Barrier(context.mpi_comm());
+                t.tic();
+                co.exchange(pattern(field)).wait();
+                if (i >= num_warmup) t.toc();
+            }
+            auto t_all = gridtools::ghex::reduce(t, context.mpi_comm());
+
+            long long counts[2] = {0, 0};
+            for (const auto& p : pattern[0].send_halos())
+            {
+                counts[0] += pattern_type::num_elements(p.second);
+                counts[1] += p.second.size();
+            }
+            long long counts_all[2];
+            MPI_Reduce(counts, counts_all, 2, MPI_LONG_LONG, MPI_SUM, 0, context.mpi_comm());
+
+            if (context.rank() == 0)
+            {
+                std::cout << std::setw(8) << n
+                          << std::setw(8) << (m == 0 ? "dense" : "masked")
+                          << std::setw(14) << counts_all[0]
+                          << std::setw(14) << counts_all[1]
+                          << std::setw(14) << t_all.mean()
+                          << std::setw(14) << t_all.stddev() << "\n";
+            }
+
+            // wet halo points must be correct (dry ones are either untouched or hold the dense result)
+            for (int z=0; z<nz; ++z)
+                for (int y=-h; y<n+h; ++y)
+                    for (int x=-h; x<n+h; ++x)
+                    {
+                        const int X = coords[0]*n+x, Y = coords[1]*n+y;
+                        if (wet((X+gx)%gx, (Y+gy)%gy) && field(x,y,z) != value(X,Y,z)) passed = false;
+                    }
+        }
+        return passed;
+    }
+
+} // namespace masked_halo_exchange
+
+TEST(Communication, comm_2_masked_halo_exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[2] = {0,0};
+    MPI_Dims_create(context.size(), 2, dims_);
+    const std::array<int,2> dims{dims_[0], dims_[1]};
+    const std::array<int,2> coords{context.rank()%dims[0], context.rank()/dims[0]};
+
+    const int halo = 2;
+    const int nz = 32;
+    const std::vector<int> domain_sizes{64, 128, 256};
+
+    if (context.rank() == 0)
+    {
+        std::cout << "masked halo exchange (50% land), " << context.size() << " ranks, " << nz << " levels, halo "
+                  << halo << ", times in us\n";
+        std::cout << std::setw(8) << "n" << std::setw(8) << "pattern" << std::setw(14) << "halo points"
+                  << std::setw(14) << "boxes" << std::setw(14) << "exchange" << std::setw(14) << "std" << "\n";
+    }
+
+    bool passed = true;
+    for (auto n : domain_sizes)
+        passed = masked_halo_exchange::run(context, dims, coords, n, nz, halo) && passed;
+
+    EXPECT_TRUE(passed);
+}
@@ -0,0 +1,143 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <cmath>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/common/bfloat16.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+namespace reduced_precision_halo_exchange {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    template<typename WireType> struct wire_name;
+    template<> struct wire_name<double> { static const char* value() { return "double"; } };
+    template<> struct wire_name<float> { static const char* value() { return "float"; } };
+    template<> struct wire_name<gridtools::ghex::bfloat16> { static const char* value() { return "bfloat16"; } };
+
+    /** @brief exchange one double field with the given wire type on a 3D cartesian decomposition with cubic local
+      * domains of size n and halo width h. Prints the exchange time and the maximum relative error in the halos
+      * (over all ranks). */
+    template<typename WireType>
+    void run(context_type& context, const std::array<int,3>& dims, const std::array<int,3>& coords, int n, int h)
+    {
+        const std::array<int,3> g_first{0,0,0};
+        const std::array<int,3> g_last{dims[0]*n-1, dims[1]*n-1, dims[2]*n-1};
+        const std::array<bool,3> periodic{true,true,true};
+        const std::array<int,6> halos{h,h,h,h,h,h};
+        const std::array<int,3> offsets{h,h,h};
+        const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            context.rank(),
+            std::array<int,3>{coords[0]*n, coords[1]*n, coords[2]*n},
+            std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, (coords[2]+1)*n-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+        auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+
+        // smooth periodic data
+        auto value = [&g_last](int x, int y, int z)
+        {
+            const double pi = std::acos(-1.0);
+            return 2.0 + std::sin(2*pi*x/(g_last[0]+1)) * std::cos(2*pi*y/(g_last[1]+1)) + 0.5*std::sin(2*pi*z/(g_last[2]+1));
+        };
+
+        std::vector<double> data(extents[0]*extents[1]*extents[2], 0.0);
+        auto field = gridtools::ghex::with_wire_type<WireType>(
+            gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(local_domains[0].domain_id(), data.data(), offsets, extents));
+        for (int z=0; z<n; ++z)
+            for (int y=0; y<n; ++y)
+                for (int x=0; x<n; ++x)
+                    field(x,y,z) = value(coords[0]*n+x, coords[1]*n+y, coords[2]*n+z);
+
+        auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+
+        gridtools::ghex::timer t;
+        for (int i=0; i<num_warmup+num_iterations; ++i)
+        {
+            MPI_Barrier(context.mpi_comm());
+            t.tic();
+            co.exchange(pattern(field)).wait();
+            if (i >= num_warmup) t.toc();
+        }
+        auto t_all = gridtools::ghex::reduce(t, context.mpi_comm());
+
+        double err = 0.0;
+        for (int z=-h; z<n+h; ++z)
+            for (int y=-h; y<n+h; ++y)
+                for (int x=-h; x<n+h; ++x)
+                {
+                    const double ref = value(coords[0]*n+x, coords[1]*n+y, coords[2]*n+z);
+                    err = std::max(err, std::abs(field(x,y,z)-ref)/std::abs(ref));
+                }
+        double max_err;
+        MPI_Reduce(&err, &max_err, 1, MPI_DOUBLE, MPI_MAX, 0, context.mpi_comm());
+
+        // largest message: one face
+        const std::size_t face_bytes = static_cast<std::size_t>(n)*n*h*sizeof(WireType);
+        if (context.rank() == 0)
+        {
+            std::cout << std::setw(8) << n
+                      << std::setw(10) << wire_name<WireType>::value()
+                      << std::setw(14) << face_bytes
+                      << std::setw(14) << t_all.mean()
+                      << std::setw(14) << t_all.stddev()
+                      << std::setw(14) << max_err << "\n";
+        }
+    }
+
+} // namespace reduced_precision_halo_exchange
+
+TEST(Communication, comm_2_reduced_precision_halo_exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[3] = {0,0,0};
+    MPI_Dims_create(context.size(), 3, dims_);
+    const std::array<int,3> dims{dims_[0], dims_[1], dims_[2]};
+    const std::array<int,3> coords{
+        context.rank()%dims[0], (context.rank()/dims[0])%dims[1], context.rank()/(dims[0]*dims[1])};
+
+    const int halo = 2;
+    const std::vector<int> domain_sizes{32, 64, 128, 192};
+
+    if (context.rank() == 0)
+    {
+        std::cout << "reduced precision halo exchange, " << context.size() << " ranks, halo " << halo << ", times in us\n";
+        std::cout << std::setw(8) << "n" << std::setw(10) << "wire" << std::setw(14) << "face bytes"
+                  << std::setw(14) << "mean" << std::setw(14) << "std" << std::setw(14) << "max rel err" << "\n";
+    }
+
+    for (auto n : domain_sizes)
+    {
+        reduced_precision_halo_exchange::run<double>(context, dims, coords, n, halo);
+        reduced_precision_halo_exchange::run<float>(context, dims, coords, n, halo);
+        reduced_precision_halo_exchange::run<gridtools::ghex::bfloat16>(context, dims, coords, n, halo);
+    }
+}
@@ -0,0 +1,146 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/staged_pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+namespace staged_halo_exchange {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    // number of messages and halo points sent by this rank
+    template<typename PatternContainer>
+    void count(const PatternContainer& pc, long long* counts)
+    {
+        using pattern_type = std::remove_const_t<std::remove_reference_t<decltype(pc[0])>>;
+        for (const auto& p : pc[0].send_halos())
+        {
+            counts[0] += 1;
+            counts[1] += pattern_type::num_elements(p.second);
+        }
+    }
+
+    /** @brief exchange one double field on a periodic 3D decomposition (local domains of n^3 points, halo width h)
+      * with the direct pattern, which talks to all 26 neighbors, and with the dimension-ordered 3-stage pattern,
+      * which only talks to the 6 face neighbors. Prints messages, halo points and exchange time per variant.
+      * Returns false if the staged result differs from the direct one. */
+    bool run(context_type& context, const std::array<int,3>& dims, const std::array<int,3>& coords, int n, int h)
+    {
+        const std::array<int,3> g_first{0,0,0};
+        const std::array<int,3> g_last{dims[0]*n-1, dims[1]*n-1, dims[2]*n-1};
+        const std::array<bool,3> periodic{true,true,true};
+        const std::array<int,6> halos{h,h,h,h,h,h};
+        const std::array<int,3> offsets{h,h,h};
+        const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            context.rank(),
+            std::array<int,3>{coords[0]*n, coords[1]*n, coords[2]*n},
+            std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, (coords[2]+1)*n-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+        auto direct = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+        auto staged = gridtools::ghex::structured::make_staged_pattern(context, g_first, g_last, halos, periodic,
+            local_domains);
+
+        std::vector<std::vector<double>> data(2, std::vector<double>(extents[0]*extents[1]*extents[2], -1.0));
+        auto f_direct = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), data[0].data(), offsets, extents);
+        auto f_staged = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), data[1].data(), offsets, extents);
+        for (int z=0; z<n; ++z)
+            for (int y=0; y<n; ++y)
+                for (int x=0; x<n; ++x)
+                    f_direct(x,y,z) = f_staged(x,y,z) = context.rank() + 1.0e-3*(x + n*(y + n*z));
+
+        auto co = gridtools::ghex::make_communication_object<decltype(direct)>(context.get_communicator(context.get_token()));
+
+        for (int m=0; m<2; ++m)
+        {
+            gridtools::ghex::timer t;
+            for (int i=0; i<num_warmup+num_iterations; ++i)
+            {
+                MPI_Barrier(context.mpi_comm());
+                t.tic();
+                if (m == 0)
+                    co.exchange(direct(f_direct)).wait();
+                else
+                    co.exchange_staged(staged, f_staged).wait();
+                if (i >= num_warmup) t.toc();
+            }
+            auto t_all = gridtools::ghex::reduce(t, context.mpi_comm());
+
+            long long counts[2] = {0, 0};
+            if (m == 0)
+                count(direct, counts);
+            else
+                for (const auto& stage : staged) count(stage, counts);
+            long long counts_all[2];
+            MPI_Reduce(counts, counts_all, 2, MPI_LONG_LONG, MPI_SUM, 0, context.mpi_comm());
+
+            if (context.rank() == 0)
+            {
+                std::cout << std::setw(8) << n
+                          << std::setw(8) << (m == 0 ? "direct" : "staged")
+                          << std::setw(14) << counts_all[0]/context.size()
+                          << std::setw(14) << counts_all[1]/context.size()
+                          << std::setw(14) << t_all.mean()
+                          << std::setw(14) << t_all.stddev() << "\n";
+            }
+        }
+        return data[0] == data[1];
+    }
+
+} // namespace staged_halo_exchange
+
+TEST(Communication, comm_2_staged_halo_exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[3] = {0,0,0};
+    MPI_Dims_create(context.size(), 3, dims_);
+    const std::array<int,3> dims{dims_[0], dims_[1], dims_[2]};
+    const std::array<int,3> coords{context.rank()%dims[0], (context.rank()/dims[0])%dims[1],
+        context.rank()/(dims[0]*dims[1])};
+
+    const int halo = 1;
+    const std::vector<int> domain_sizes{8, 16, 32, 64};
+
+    if (context.rank() == 0)
+    {
+        std::cout << "direct vs dimension-ordered halo exchange, " << context.size() << " ranks, halo " << halo
+                  << ", per rank messages and halo points, times in us\n";
+        std::cout << std::setw(8) << "n" << std::setw(8) << "pattern" << std::setw(14) << "messages"
+                  << std::setw(14) << "halo points" << std::setw(14) << "exchange" << std::setw(14) << "std" << "\n";
+    }
+
+    bool passed = true;
+    for (auto n : domain_sizes)
+        passed = staged_halo_exchange::run(context, dims, coords, n, halo) && passed;
+
+    EXPECT_TRUE(passed);
+}
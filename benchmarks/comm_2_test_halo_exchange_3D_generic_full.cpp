@@ -61,6 +61,16 @@ namespace halo_exchange_3D_generic_full {
 #endif
 
     using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+#ifdef GHEX_STAR_STENCIL_BENCHMARK
+    // only face halos are exchanged (6 neighbors instead of 26)
+    const auto stencil = gridtools::ghex::structured::stencil_shape::star;
+#else
+    const auto stencil = gridtools::ghex::structured::stencil_shape::box;
+#endif
+
+    // 1 if index i (into an extent with halo hm and interior size dim) lies in the halo of this dimension; summed
+    // over the dimensions, edge and corner points (more than one) are not exchanged with the star stencil
+    inline int num_outside(int i, int hm, int dim) { return (i < hm || i >= dim + hm) ? 1 : 0; }
     template<typename T, typename Arch, int... Is>
     using field_descriptor_type  = gridtools::ghex::structured::simple_field_wrapper<T,Arch,domain_descriptor_type, Is...>;
 
@@ -150,10 +160,10 @@ namespace halo_exchange_3D_generic_full {
             std::array<int,3>{(DIM1 + H1m3 + H1p3), (DIM2 + H2m3 + H2p3), (DIM3 + H3m3 + H3p3)});
 
         // make halo generators
-        auto halo_gen_1 = domain_descriptor_type::halo_generator_type(g_first, g_last, halo_1, periodic);
+        auto halo_gen_1 = domain_descriptor_type::halo_generator_type(g_first, g_last, halo_1, periodic, stencil);
 #ifndef GHEX_1_PATTERN_BENCHMARK
-        auto halo_gen_2 = domain_descriptor_type::halo_generator_type(g_first, g_last, halo_2, periodic);
-        auto halo_gen_3 = domain_descriptor_type::halo_generator_type(g_first, g_last, halo_3, periodic);
+        auto halo_gen_2 = domain_descriptor_type::halo_generator_type(g_first, g_last, halo_2, periodic, stencil);
+        auto halo_gen_3 = domain_descriptor_type::halo_generator_type(g_first, g_last, halo_3, periodic, stencil);
 #endif
 
         // make patterns
@@ -568,6 +578,10 @@ namespace halo_exchange_3D_generic_full {
 
                     ta = triple_t<USE_DOUBLE, T1>(tax, tay, taz).floor();
 
+                    if (stencil == gridtools::ghex::structured::stencil_shape::star &&
+                        num_outside(ii, H1m1, DIM1) + num_outside(jj, H2m1, DIM2) + num_outside(kk, H3m1, DIM3) > 1)
+                        ta = triple_t<USE_DOUBLE, T1>();
+
                     if (a(ii-H1m1, jj-H2m1, kk-H3m1) != ta) {
                         passed = false;
                         file << ii << ", " << jj << ", " << kk << " values found != expected: "
@@ -608,6 +622,10 @@ namespace halo_exchange_3D_generic_full {
 
                     tb = triple_t<USE_DOUBLE, T2>(tbx, tby, tbz).floor();
 
+                    if (stencil == gridtools::ghex::structured::stencil_shape::star &&
+                        num_outside(ii, H1m2, DIM1) + num_outside(jj, H2m2, DIM2) + num_outside(kk, H3m2, DIM3) > 1)
+                        tb = triple_t<USE_DOUBLE, T2>();
+
                     if (b(ii-H1m2, jj-H2m2, kk-H3m2) != tb) {
                         passed = false;
                         file << ii << ", " << jj << ", " << kk << " values found != expected: "
@@ -648,6 +666,10 @@ namespace halo_exchange_3D_generic_full {
 
                     tc = triple_t<USE_DOUBLE, T3>(tcx, tcy, tcz).floor();
 
+                    if (stencil == gridtools::ghex::structured::stencil_shape::star &&
+                        num_outside(ii, H1m3, DIM1) + num_outside(jj, H2m3, DIM2) + num_outside(kk, H3m3, DIM3) > 1)
+                        tc = triple_t<USE_DOUBLE, T3>();
+
                     if (c(ii-H1m3, jj-H2m3, kk-H3m3) != tc) {
                         passed = false;
                         file << ii << ", " << jj << ", " << kk << " values found != expected: "
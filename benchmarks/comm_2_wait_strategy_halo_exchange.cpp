@@ -0,0 +1,150 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <chrono>
+#include <thread>
+#include <time.h>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using gridtools::ghex::wait_strategy;
+
+namespace wait_strategy_halo_exchange {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    // cpu time consumed by the calling thread in us
+    double thread_cpu_time()
+    {
+        timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec*1.0e6 + ts.tv_nsec*1.0e-3;
+    }
+
+    const char* name(wait_strategy ws)
+    {
+        switch (ws)
+        {
+            case wait_strategy::spin:     return "spin";
+            case wait_strategy::backoff:  return "backoff";
+            case wait_strategy::yield:    return "yield";
+            case wait_strategy::waitany:  return "waitany";
+            case wait_strategy::waitsome: return "waitsome";
+        }
+        return "";
+    }
+
+    /** @brief exchange one double field on a periodic 3D decomposition (local domains of n^3 points, halo width 1)
+      * with every wait strategy. Rank 0 starts its exchanges late by delay us, such that the other ranks wait for
+      * its messages. Prints the exchange time (latency) and the cpu time spent by the waiting ranks, and the ratio
+      * of the two: 1 means a core is fully occupied while waiting. */
+    void run(context_type& context, const std::array<int,3>& dims, const std::array<int,3>& coords, int n, int delay)
+    {
+        const int h = 1;
+        const std::array<int,3> g_first{0,0,0};
+        const std::array<int,3> g_last{dims[0]*n-1, dims[1]*n-1, dims[2]*n-1};
+        const std::array<int,3> offsets{h,h,h};
+        const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            context.rank(),
+            std::array<int,3>{coords[0]*n, coords[1]*n, coords[2]*n},
+            std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, (coords[2]+1)*n-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last,
+            std::array<int,6>{h,h,h,h,h,h}, std::array<bool,3>{true,true,true});
+        auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+
+        std::vector<double> data(extents[0]*extents[1]*extents[2], -1.0);
+        auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), data.data(), offsets, extents);
+
+        auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+
+        for (auto ws : {wait_strategy::spin, wait_strategy::backoff, wait_strategy::yield, wait_strategy::waitany,
+                        wait_strategy::waitsome})
+        {
+            co.set_wait_strategy(ws);
+            gridtools::ghex::timer t;
+            double cpu = 0.0;
+            for (int i=0; i<num_warmup+num_iterations; ++i)
+            {
+                MPI_Barrier(context.mpi_comm());
+                if (context.rank() == 0 && delay > 0) std::this_thread::sleep_for(std::chrono::microseconds(delay));
+                t.tic();
+                const double c0 = thread_cpu_time();
+                co.exchange(pattern(field)).wait();
+                const double c1 = thread_cpu_time();
+                if (i >= num_warmup)
+                {
+                    t.toc();
+                    cpu += c1-c0;
+                }
+            }
+            // exclude rank 0, which does not wait for late messages
+            MPI_Comm waiting;
+            MPI_Comm_split(context.mpi_comm(), context.rank() == 0 ? 0 : 1, context.rank(), &waiting);
+            auto t_all = gridtools::ghex::reduce(t, waiting);
+            double cpu_all = 0.0;
+            MPI_Reduce(&cpu, &cpu_all, 1, MPI_DOUBLE, MPI_SUM, 0, waiting);
+            int num_waiting;
+            MPI_Comm_size(waiting, &num_waiting);
+            MPI_Comm_free(&waiting);
+            if (context.rank() == 1)
+            {
+                const double cpu_mean = cpu_all/(num_waiting*num_iterations);
+                std::cout << std::setw(8) << n << std::setw(8) << delay << std::setw(10) << name(ws)
+                          << std::setw(14) << t_all.mean() << std::setw(14) << t_all.stddev()
+                          << std::setw(14) << cpu_mean << std::setw(10) << cpu_mean/t_all.mean() << "\n";
+            }
+        }
+    }
+
+} // namespace wait_strategy_halo_exchange
+
+TEST(Communication, comm_2_wait_strategy_halo_exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    if (context.size() < 2) return;
+
+    int dims_[3] = {0,0,0};
+    MPI_Dims_create(context.size(), 3, dims_);
+    const std::array<int,3> dims{dims_[0], dims_[1], dims_[2]};
+    const std::array<int,3> coords{context.rank()%dims[0], (context.rank()/dims[0])%dims[1],
+        context.rank()/(dims[0]*dims[1])};
+
+    if (context.rank() == 1)
+    {
+        std::cout << "wait strategies, " << context.size() << " ranks, rank 0 delayed, times in us (ranks other than 0)\n";
+        std::cout << std::setw(8) << "n" << std::setw(8) << "delay" << std::setw(10) << "strategy"
+                  << std::setw(14) << "exchange" << std::setw(14) << "std" << std::setw(14) << "cpu time"
+                  << std::setw(10) << "cpu/wall" << "\n";
+    }
+
+    for (int n : {16, 64})
+        for (int delay : {0, 1000})
+            wait_strategy_halo_exchange::run(context, dims, coords, n, delay);
+}
@@ -0,0 +1,118 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <numeric>
+#include <vector>
+#include <array>
+
+#include <gridtools/common/layout_map.hpp>
+#include <ghex/glue/gridtools/processor_grid.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+
+namespace processor_grid_setup {
+
+    const int num_iterations = 20;
+
+    /** @brief reference: the former scan, which broadcasts the extent of each process along the first line of
+      * every dimension over the whole communicator (dims[0]+dims[1]+dims[2] collectives) */
+    std::array<int,3> bcast_scan(MPI_Comm comm, const std::array<int,3>& local_extents, std::array<int,3>& first)
+    {
+        int dims[3], periods[3], coords[3];
+        MPI_Cart_get(comm, 3, dims, periods, coords);
+        std::array<int,3> global_extents;
+        for (int d=0; d<3; ++d)
+        {
+            std::vector<int> extents(dims[d]);
+            for (int i=0; i<dims[d]; ++i)
+            {
+                int coords_i[3] = {0,0,0};
+                coords_i[d] = i;
+                int rank_i;
+                MPI_Cart_rank(comm, coords_i, &rank_i);
+                int lext = local_extents[d];
+                const bool root = coords[d]==i && coords[(d+1)%3]==0 && coords[(d+2)%3]==0;
+                MPI_Bcast(root ? &lext : &extents[i], 1, MPI_INT, rank_i, comm);
+                if (root) extents[i] = lext;
+            }
+            std::partial_sum(extents.begin(), extents.end(), extents.begin());
+            global_extents[d] = extents.back();
+            first[d] = coords[d]==0 ? 0 : extents[coords[d]-1];
+        }
+        return global_extents;
+    }
+
+} // namespace processor_grid_setup
+
+TEST(Setup, gt_processor_grid_setup)
+{
+    int np;
+    MPI_Comm_size(MPI_COMM_WORLD, &np);
+    std::array<int,3> dims{0,0,0};
+    int periods[3] = {1,1,0};
+    MPI_Dims_create(np, 3, dims.data());
+    MPI_Comm cart_comm;
+    MPI_Cart_create(MPI_COMM_WORLD, 3, dims.data(), periods, false, &cart_comm);
+
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, cart_comm);
+    auto& context = *context_ptr;
+
+    int coords[3];
+    MPI_Cart_coords(context.mpi_comm(), context.rank(), 3, coords);
+    // extents which vary along each line of the processor grid
+    const std::array<int,3> local_extents{10+coords[0]%3, 12+coords[1]%2, 8+coords[2]%4};
+    const std::array<bool,3> periodicity{true,true,false};
+
+    gridtools::ghex::timer t_bcast, t_line;
+    std::array<int,3> first;
+    std::array<int,3> global_extents;
+    bool passed = true;
+    for (int i=0; i<processor_grid_setup::num_iterations; ++i)
+    {
+        MPI_Barrier(context.mpi_comm());
+        t_bcast.tic();
+        global_extents = processor_grid_setup::bcast_scan(context.mpi_comm(), local_extents, first);
+        t_bcast.toc();
+
+        MPI_Barrier(context.mpi_comm());
+        t_line.tic();
+        auto grid = gridtools::ghex::make_gt_processor_grid(context, local_extents, periodicity);
+        t_line.toc();
+
+        passed = passed && grid.m_global_extents == global_extents;
+        for (int d=0; d<3; ++d)
+            passed = passed && grid.m_domains[0].first()[d] == first[d];
+    }
+    auto t_bcast_all = gridtools::ghex::reduce(t_bcast, context.mpi_comm());
+    auto t_line_all = gridtools::ghex::reduce(t_line, context.mpi_comm());
+
+    if (context.rank() == 0)
+    {
+        std::cout << "processor grid setup, " << np << " ranks (" << dims[0] << "x" << dims[1] << "x" << dims[2]
+                  << "), times in us\n";
+        std::cout << std::setw(14) << "scan" << std::setw(14) << "collectives" << std::setw(14) << "mean"
+                  << std::setw(14) << "std" << "\n";
+        std::cout << std::setw(14) << "bcast" << std::setw(14) << dims[0]+dims[1]+dims[2]
+                  << std::setw(14) << t_bcast_all.mean() << std::setw(14) << t_bcast_all.stddev() << "\n";
+        std::cout << std::setw(14) << "allgather" << std::setw(14) << 1
+                  << std::setw(14) << t_line_all.mean() << std::setw(14) << t_line_all.stddev() << "\n";
+    }
+    EXPECT_TRUE(passed);
+    MPI_Comm_free(&cart_comm);
+}
@@ -0,0 +1,723 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include <mpi.h>
+
+#include <ghex/communication_object_2.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+#include <ghex/common/traffic_capture.hpp>
+
+#ifdef GHEX_HALO_BENCHMARK_GCL
+#include <gridtools/common/boollist.hpp>
+#include <gridtools/communication/halo_exchange.hpp>
+#endif
+
+#include "./options.hpp"
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using timer_type = gridtools::ghex::timer;
+
+/* Halo exchange benchmark driver: exchanges a number of 3D fields on a cartesian decomposition of the ranks with
+ * one of the backends
+ * - ghex: communication object, one concurrent exchange per value type
+ * - mpi:  non-blocking point to point messages with MPI subarray datatypes, one message per field and neighbor
+ * - gcl:  GridTools halo_exchange_generic (only when compiled with GHEX_HALO_BENCHMARK_GCL, i.e. the target
+ *         halo_exchange_driver_gcl, which is built with GHEX_BUILD_GCL_BENCHMARKS)
+ * and writes the time per exchange (min/mean/max per rank) and the achieved bandwidth as JSON or CSV. */
+namespace halo_exchange_driver {
+
+    struct config
+    {
+        std::string backend;
+        std::array<int,3> grid;     // interior points of a domain
+        std::array<int,6> halo;     // x-, x+, y-, y+, z-, z+
+        int num_fields;
+        std::vector<std::string> types;
+        std::array<int,3> layout;   // layout map: the dimension with the highest value is contiguous in memory
+        std::array<bool,3> periodic;
+        bool star;
+        int num_domains;            // domains per rank, stacked along x
+        int iterations;
+        int warmup;
+    };
+
+    struct decomposition
+    {
+        MPI_Comm comm;
+        std::array<int,3> dims;
+        std::array<int,3> coords;
+    };
+
+    const std::array<std::string,4> type_names{"double", "float", "int", "int64"};
+
+    template<typename T>
+    struct field_group
+    {
+        using value_type = T;
+        std::vector<int> ids;               // indices of the fields of this value type
+        std::vector<std::vector<T>> data;   // one buffer per field and domain: data[i*num_domains + d]
+    };
+
+    using groups_type = std::tuple<field_group<double>, field_group<float>, field_group<int>,
+        field_group<std::int64_t>>;
+
+    template<typename Tuple, typename F, std::size_t... Is>
+    void for_each_group(Tuple& t, F&& f, std::index_sequence<Is...>)
+    {
+        using expand = int[];
+        (void)expand{0, (f(std::get<Is>(t)), 0)...};
+    }
+
+    template<typename F>
+    void for_each_group(groups_type& groups, F&& f)
+    {
+        for_each_group(groups, std::forward<F>(f), std::make_index_sequence<std::tuple_size<groups_type>::value>{});
+    }
+
+    // value of a field at an interior point with global coordinates g
+    template<typename T>
+    T value(int f, const std::array<int,3>& g)
+    {
+        return static_cast<T>((7*f + g[0] + 37*g[1] + 1361*g[2]) % 65536);
+    }
+
+    std::array<int,3> extents(const config& cfg)
+    {
+        return {cfg.grid[0]+cfg.halo[0]+cfg.halo[1], cfg.grid[1]+cfg.halo[2]+cfg.halo[3],
+            cfg.grid[2]+cfg.halo[4]+cfg.halo[5]};
+    }
+
+    std::array<int,3> offsets(const config& cfg) { return {cfg.halo[0], cfg.halo[2], cfg.halo[4]}; }
+
+    // global coordinates of the first interior point of a local domain
+    std::array<int,3> first(const config& cfg, const decomposition& dec, int d)
+    {
+        return {(dec.coords[0]*cfg.num_domains+d)*cfg.grid[0], dec.coords[1]*cfg.grid[1], dec.coords[2]*cfg.grid[2]};
+    }
+
+    std::array<int,3> global_extents(const config& cfg, const decomposition& dec)
+    {
+        return {dec.dims[0]*cfg.num_domains*cfg.grid[0], dec.dims[1]*cfg.grid[1], dec.dims[2]*cfg.grid[2]};
+    }
+
+    // linear index of a point (relative to the first halo point) in a buffer with the given layout
+    std::size_t index(const config& cfg, const std::array<int,3>& i)
+    {
+        const auto e = extents(cfg);
+        std::size_t idx = 0u;
+        for (int l=0; l<3; ++l)
+            for (int d=0; d<3; ++d)
+                if (cfg.layout[d] == l) idx = idx*e[d] + i[d];
+        return idx;
+    }
+
+    /** @brief allocate the fields, fill the interior and mark the halos */
+    groups_type make_fields(const config& cfg, const decomposition& dec)
+    {
+        groups_type groups;
+        const auto e = extents(cfg);
+        const auto o = offsets(cfg);
+        int type_index = 0;
+        for_each_group(groups, [&](auto& g)
+        {
+            using T = typename std::remove_reference_t<decltype(g)>::value_type;
+            const int t = type_index++;
+            for (int i=0; i<cfg.num_fields; ++i)
+            {
+                if (cfg.types[i%cfg.types.size()] != type_names[t]) continue;
+                g.ids.push_back(i);
+                for (int d=0; d<cfg.num_domains; ++d)
+                {
+                    g.data.emplace_back(e[0]*e[1]*e[2], static_cast<T>(-1));
+                    auto& buffer = g.data.back();
+                    const auto fst = first(cfg, dec, d);
+                    for (int z=0; z<cfg.grid[2]; ++z)
+                        for (int y=0; y<cfg.grid[1]; ++y)
+                            for (int x=0; x<cfg.grid[0]; ++x)
+                                buffer[index(cfg, {x+o[0], y+o[1], z+o[2]})] =
+                                    value<T>(i, {fst[0]+x, fst[1]+y, fst[2]+z});
+                }
+            }
+        });
+        return groups;
+    }
+
+    /** @return number of wrong halo points: every halo point which lies inside the (periodic) global domain is
+      * checked, except for edges and corners with the star stencil */
+    long verify(const config& cfg, const decomposition& dec, groups_type& groups)
+    {
+        const auto e = extents(cfg);
+        const auto o = offsets(cfg);
+        const auto ge = global_extents(cfg, dec);
+        long errors = 0;
+        for_each_group(groups, [&](auto& g)
+        {
+            using T = typename std::remove_reference_t<decltype(g)>::value_type;
+            for (std::size_t i=0; i<g.ids.size(); ++i)
+                for (int d=0; d<cfg.num_domains; ++d)
+                {
+                    const auto& buffer = g.data[i*cfg.num_domains+d];
+                    const auto fst = first(cfg, dec, d);
+                    for (int z=0; z<e[2]; ++z)
+                        for (int y=0; y<e[1]; ++y)
+                            for (int x=0; x<e[0]; ++x)
+                            {
+                                const std::array<int,3> l{x, y, z};
+                                std::array<int,3> p;
+                                int num_outside = 0;
+                                bool valid = true;
+                                for (int k=0; k<3; ++k)
+                                {
+                                    if (l[k] < o[k] || l[k] >= o[k]+cfg.grid[k]) ++num_outside;
+                                    p[k] = fst[k] + l[k] - o[k];
+                                    if (p[k] < 0 || p[k] >= ge[k])
+                                    {
+                                        if (cfg.periodic[k]) p[k] = (p[k]+ge[k])%ge[k];
+                                        else valid = false;
+                                    }
+                                }
+                                if (num_outside == 0 || !valid || (cfg.star && num_outside > 1)) continue;
+                                if (buffer[index(cfg, l)] != value<T>(g.ids[i], p)) ++errors;
+                            }
+                }
+        });
+        return errors;
+    }
+
+    /** @return halo payload received by this rank per exchange */
+    std::size_t halo_bytes(const config& cfg, const decomposition& dec, groups_type& groups)
+    {
+        const auto ge = global_extents(cfg, dec);
+        std::size_t bytes_per_value = 0u;
+        for_each_group(groups, [&](auto& g)
+        {
+            using T = typename std::remove_reference_t<decltype(g)>::value_type;
+            bytes_per_value += g.ids.size()*sizeof(T);
+        });
+        std::size_t points = 0u;
+        for (int d=0; d<cfg.num_domains; ++d)
+        {
+            const auto fst = first(cfg, dec, d);
+            for (int dz=-1; dz<=1; ++dz)
+                for (int dy=-1; dy<=1; ++dy)
+                    for (int dx=-1; dx<=1; ++dx)
+                    {
+                        const std::array<int,3> off{dx, dy, dz};
+                        const int num_outside = (dx != 0) + (dy != 0) + (dz != 0);
+                        if (num_outside == 0 || (cfg.star && num_outside > 1)) continue;
+                        std::size_t n = 1u;
+                        for (int k=0; k<3; ++k)
+                        {
+                            if (off[k] == 0) { n *= cfg.grid[k]; continue; }
+                            const bool at_boundary = (off[k] < 0) ? fst[k] == 0 : fst[k]+cfg.grid[k] == ge[k];
+                            if (at_boundary && !cfg.periodic[k]) n = 0u;
+                            n *= (off[k] < 0) ? cfg.halo[2*k] : cfg.halo[2*k+1];
+                        }
+                        points += n;
+                    }
+        }
+        return points*bytes_per_value;
+    }
+
+    /** @brief time an exchange function
+      * @return timer holding one sample per iteration after the warmup */
+    template<typename Exchange>
+    timer_type time_exchanges(const config& cfg, MPI_Comm comm, Exchange&& exchange)
+    {
+        timer_type t;
+        for (int i=0; i<cfg.warmup+cfg.iterations; ++i)
+        {
+            MPI_Barrier(comm);
+            t.tic();
+            exchange();
+            if (i >= cfg.warmup) t.toc();
+        }
+        return t;
+    }
+
+    /** @brief call f with the layout map as an integer sequence */
+    template<typename F>
+    timer_type dispatch_layout(const std::array<int,3>& l, F&& f)
+    {
+        if (l == std::array<int,3>{2,1,0}) return f(std::integer_sequence<int,2,1,0>{});
+        if (l == std::array<int,3>{2,0,1}) return f(std::integer_sequence<int,2,0,1>{});
+        if (l == std::array<int,3>{1,2,0}) return f(std::integer_sequence<int,1,2,0>{});
+        if (l == std::array<int,3>{1,0,2}) return f(std::integer_sequence<int,1,0,2>{});
+        if (l == std::array<int,3>{0,2,1}) return f(std::integer_sequence<int,0,2,1>{});
+        if (l == std::array<int,3>{0,1,2}) return f(std::integer_sequence<int,0,1,2>{});
+        throw std::runtime_error("layout must be a permutation of 0,1,2");
+    }
+
+    // ghex backend
+    // ------------
+
+    template<typename T, typename Pattern, int... Order>
+    struct ghex_group
+    {
+        using field_type = decltype(gridtools::ghex::wrap_field<gridtools::ghex::cpu,Order...>(0,
+            std::declval<T*>(), std::declval<std::array<int,3>>(), std::declval<std::array<int,3>>()));
+        using buffer_info_type = decltype(std::declval<const Pattern&>()(std::declval<field_type&>()));
+        std::vector<field_type> fields;
+        std::vector<buffer_info_type> buffer_infos;
+    };
+
+    template<int... Order>
+    timer_type run_ghex(const config& cfg, const decomposition& dec, groups_type& groups)
+    {
+        auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, dec.comm);
+        auto& context = *context_ptr;
+        const auto ge = global_extents(cfg, dec);
+        std::vector<domain_descriptor_type> local_domains;
+        for (int d=0; d<cfg.num_domains; ++d)
+        {
+            const auto fst = first(cfg, dec, d);
+            local_domains.push_back(domain_descriptor_type{context.rank()*cfg.num_domains+d, fst,
+                std::array<int,3>{fst[0]+cfg.grid[0]-1, fst[1]+cfg.grid[1]-1, fst[2]+cfg.grid[2]-1}});
+        }
+        auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+            std::array<int,3>{ge[0]-1, ge[1]-1, ge[2]-1}, cfg.halo, cfg.periodic,
+            cfg.star ? gridtools::ghex::structured::stencil_shape::star : gridtools::ghex::structured::stencil_shape::box);
+        auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+        using pattern_type = decltype(pattern);
+        auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+
+        std::tuple<ghex_group<double,pattern_type,Order...>, ghex_group<float,pattern_type,Order...>,
+            ghex_group<int,pattern_type,Order...>, ghex_group<std::int64_t,pattern_type,Order...>> ghex_groups;
+        // the buffer infos refer to the fields: all fields are created first
+        auto init = [&](auto& g, auto& gg)
+        {
+            gg.fields.reserve(g.data.size());
+            for (std::size_t i=0; i<g.data.size(); ++i)
+                gg.fields.push_back(gridtools::ghex::wrap_field<gridtools::ghex::cpu,Order...>(
+                    local_domains[i%cfg.num_domains].domain_id(), g.data[i].data(), offsets(cfg), extents(cfg)));
+            for (auto& f : gg.fields) gg.buffer_infos.push_back(pattern(f));
+        };
+        init(std::get<0>(groups), std::get<0>(ghex_groups));
+        init(std::get<1>(groups), std::get<1>(ghex_groups));
+        init(std::get<2>(groups), std::get<2>(ghex_groups));
+        init(std::get<3>(groups), std::get<3>(ghex_groups));
+
+        using handle_type = typename decltype(co)::handle_type;
+        std::vector<handle_type> handles;
+        handles.reserve(std::tuple_size<groups_type>::value);
+        return time_exchanges(cfg, dec.comm, [&]()
+        {
+            // value types are exchanged concurrently
+            for_each_group(ghex_groups, [&](auto& gg)
+            {
+                if (!gg.buffer_infos.empty())
+                    handles.push_back(co.exchange(gg.buffer_infos.data(), gg.buffer_infos.size()));
+            }, std::make_index_sequence<std::tuple_size<groups_type>::value>{});
+            for (auto& h : handles) h.wait();
+            handles.clear();
+        });
+    }
+
+    template<int... Order>
+    timer_type run_ghex(std::integer_sequence<int,Order...>, const config& cfg, const decomposition& dec,
+        groups_type& groups)
+    {
+        return run_ghex<Order...>(cfg, dec, groups);
+    }
+
+    // mpi backend
+    // -----------
+
+    /** @brief one message per field and neighbor, described by an MPI subarray datatype */
+    class mpi_exchange
+    {
+    private: // member types
+        struct message
+        {
+            void* ptr;
+            MPI_Datatype type;
+            int peer;
+            int tag;
+        };
+
+    private: // members
+        MPI_Comm m_comm;
+        std::vector<message> m_sends;
+        std::vector<message> m_recvs;
+        std::vector<MPI_Datatype> m_types;
+        std::vector<MPI_Request> m_requests;
+
+    public: // ctors
+        mpi_exchange(const config& cfg, const decomposition& dec, groups_type& groups)
+        : m_comm{dec.comm}
+        {
+            const auto e = extents(cfg);
+            for_each_group(groups, [&](auto& g)
+            {
+                using T = typename std::remove_reference_t<decltype(g)>::value_type;
+                MPI_Datatype element;
+                MPI_Type_contiguous(sizeof(T), MPI_BYTE, &element);
+                for (std::size_t i=0; i<g.ids.size(); ++i)
+                    for (int dz=-1; dz<=1; ++dz)
+                        for (int dy=-1; dy<=1; ++dy)
+                            for (int dx=-1; dx<=1; ++dx)
+                            {
+                                const std::array<int,3> off{dx, dy, dz};
+                                const int num_outside = (dx != 0) + (dy != 0) + (dz != 0);
+                                if (num_outside == 0 || (cfg.star && num_outside > 1)) continue;
+                                std::array<int,3> nc;
+                                bool valid = true;
+                                // regions in the order of the layout, from the slowest to the fastest dimension
+                                int sizes[3], send_sizes[3], send_starts[3], recv_sizes[3], recv_starts[3];
+                                for (int k=0; k<3; ++k)
+                                {
+                                    nc[k] = dec.coords[k]+off[k];
+                                    if (nc[k] < 0 || nc[k] >= dec.dims[k])
+                                    {
+                                        if (cfg.periodic[k]) nc[k] = (nc[k]+dec.dims[k])%dec.dims[k];
+                                        else valid = false;
+                                    }
+                                    const int hm = cfg.halo[2*k], hp = cfg.halo[2*k+1], n = cfg.grid[k];
+                                    const int l = cfg.layout[k];
+                                    sizes[l] = e[k];
+                                    send_starts[l] = (off[k] > 0) ? n : hm;
+                                    send_sizes[l]  = (off[k] < 0) ? hp : ((off[k] > 0) ? hm : n);
+                                    recv_starts[l] = (off[k] < 0) ? 0 : hm + ((off[k] > 0) ? n : 0);
+                                    recv_sizes[l]  = (off[k] < 0) ? hm : ((off[k] > 0) ? hp : n);
+                                }
+                                if (!valid) continue;
+                                int peer;
+                                MPI_Cart_rank(m_comm, nc.data(), &peer);
+                                const int dir = (dx+1) + 3*(dy+1) + 9*(dz+1);
+                                auto add = [&](std::vector<message>& msgs, int* sub, int* starts, int tag)
+                                {
+                                    for (int k=0; k<3; ++k) if (sub[k] == 0) return;
+                                    MPI_Datatype t;
+                                    MPI_Type_create_subarray(3, sizes, sub, starts, MPI_ORDER_C, element, &t);
+                                    MPI_Type_commit(&t);
+                                    m_types.push_back(t);
+                                    msgs.push_back(message{g.data[i].data(), t, peer, tag});
+                                };
+                                // the neighbor receives the message sent in direction off from direction -off
+                                add(m_sends, send_sizes, send_starts, 27*g.ids[i] + dir);
+                                add(m_recvs, recv_sizes, recv_starts, 27*g.ids[i] + 26 - dir);
+                            }
+                MPI_Type_free(&element);
+            });
+            m_requests.resize(m_sends.size() + m_recvs.size());
+        }
+
+        mpi_exchange(const mpi_exchange&) = delete;
+        mpi_exchange& operator=(const mpi_exchange&) = delete;
+
+        ~mpi_exchange()
+        {
+            for (auto& t : m_types) MPI_Type_free(&t);
+        }
+
+    public: // member functions
+        void operator()()
+        {
+            std::size_t r = 0u;
+            for (const auto& m : m_recvs) MPI_Irecv(m.ptr, 1, m.type, m.peer, m.tag, m_comm, &m_requests[r++]);
+            for (const auto& m : m_sends) MPI_Isend(m.ptr, 1, m.type, m.peer, m.tag, m_comm, &m_requests[r++]);
+            MPI_Waitall(m_requests.size(), m_requests.data(), MPI_STATUSES_IGNORE);
+        }
+    };
+
+    timer_type run_mpi(const config& cfg, const decomposition& dec, groups_type& groups)
+    {
+        if (cfg.num_domains != 1) throw std::runtime_error("the mpi backend supports one domain per rank");
+        mpi_exchange exchange(cfg, dec, groups);
+        return time_exchanges(cfg, dec.comm, exchange);
+    }
+
+    // gcl backend
+    // -----------
+
+#ifdef GHEX_HALO_BENCHMARK_GCL
+    template<typename T, int I1, int I2, int I3>
+    timer_type run_gcl(const config& cfg, const decomposition& dec, field_group<T>& g)
+    {
+        using layoutmap = gridtools::layout_map<I1, I2, I3>;
+        using pattern_type = gridtools::halo_exchange_generic<gridtools::layout_map<0, 1, 2>, gridtools::gcl_cpu>;
+        using field_type = gridtools::field_on_the_fly<T, layoutmap, typename pattern_type::traits>;
+
+        pattern_type he(typename pattern_type::grid_type::period_type(cfg.periodic[0], cfg.periodic[1],
+            cfg.periodic[2]), dec.comm);
+        gridtools::array<gridtools::halo_descriptor, 3> halo_dsc;
+        for (int k=0; k<3; ++k)
+            halo_dsc[k] = gridtools::halo_descriptor(cfg.halo[2*k], cfg.halo[2*k+1], cfg.halo[2*k],
+                cfg.grid[k] + cfg.halo[2*k] - 1, cfg.grid[k] + cfg.halo[2*k] + cfg.halo[2*k+1]);
+        he.setup(g.data.size(), field_type(nullptr, halo_dsc), sizeof(T));
+        std::vector<field_type> fields;
+        for (auto& d : g.data) fields.push_back(field_type(d.data(), halo_dsc));
+
+        return time_exchanges(cfg, dec.comm, [&]()
+        {
+            he.pack(fields);
+            he.exchange();
+            he.unpack(fields);
+        });
+    }
+
+    template<int... Order>
+    timer_type run_gcl(const config& cfg, const decomposition& dec, groups_type& groups)
+    {
+        if (cfg.num_domains != 1) throw std::runtime_error("the gcl backend supports one domain per rank");
+        if (cfg.star) throw std::runtime_error("the gcl backend supports the box stencil only");
+        for (std::size_t t=1; t<cfg.types.size(); ++t)
+            if (cfg.types[t] != cfg.types[0])
+                throw std::runtime_error("the gcl backend supports one value type only");
+        if (cfg.types[0] == "double") return run_gcl<double,Order...>(cfg, dec, std::get<0>(groups));
+        if (cfg.types[0] == "float")  return run_gcl<float,Order...>(cfg, dec, std::get<1>(groups));
+        if (cfg.types[0] == "int")    return run_gcl<int,Order...>(cfg, dec, std::get<2>(groups));
+        return run_gcl<std::int64_t,Order...>(cfg, dec, std::get<3>(groups));
+    }
+
+    template<int... Order>
+    timer_type run_gcl(std::integer_sequence<int,Order...>, const config& cfg, const decomposition& dec,
+        groups_type& groups)
+    {
+        return run_gcl<Order...>(cfg, dec, groups);
+    }
+#endif
+
+    // output
+    // ------
+
+    struct rank_result
+    {
+        double min_us;
+        double mean_us;
+        double max_us;
+        double bytes;
+    };
+
+    // bandwidth in GB/s of bytes transferred in t us
+    double bandwidth(double bytes, double t) { return t > 0.0 ? bytes/(t*1.0e3) : 0.0; }
+
+    std::string quote_csv(const std::string& s)
+    {
+        return (s.find(',') == std::string::npos) ? s : "\"" + s + "\"";
+    }
+
+    void write_json(std::ostream& os, const bench::options& opts, const decomposition& dec,
+        const std::vector<rank_result>& results, const timer_type& all, bool verified)
+    {
+        double bytes = 0.0, max_mean = 0.0;
+        for (const auto& r : results)
+        {
+            bytes += r.bytes;
+            max_mean = std::max(max_mean, r.mean_us);
+        }
+        os << "{\n  \"benchmark\": \"halo_exchange\",\n  \"options\": {\n";
+        opts.write_json(os, "    ");
+        os << "\n  },\n  \"ranks\": " << results.size()
+           << ",\n  \"process_grid\": [" << dec.dims[0] << ", " << dec.dims[1] << ", " << dec.dims[2] << "]"
+           << ",\n  \"verified\": " << (verified ? "true" : "false")
+           << ",\n  \"bytes_per_exchange\": " << static_cast<std::size_t>(bytes)
+           << ",\n  \"time_us\": {\"samples\": " << all.num_samples() << ", \"min\": " << all.min()
+           << ", \"mean\": " << all.mean() << ", \"max\": " << all.max() << ", \"stddev\": " << all.stddev() << "}"
+           << ",\n  \"bandwidth_GBps\": " << bandwidth(bytes, max_mean)
+           << ",\n  \"per_rank\": [";
+        for (std::size_t r=0; r<results.size(); ++r)
+            os << (r ? ",\n" : "\n") << "    {\"rank\": " << r << ", \"min_us\": " << results[r].min_us
+               << ", \"mean_us\": " << results[r].mean_us << ", \"max_us\": " << results[r].max_us
+               << ", \"bytes\": " << static_cast<std::size_t>(results[r].bytes)
+               << ", \"bandwidth_GBps\": " << bandwidth(results[r].bytes, results[r].mean_us) << "}";
+        os << "\n  ]\n}\n";
+    }
+
+    void write_csv(std::ostream& os, const bench::options& opts, const std::vector<rank_result>& results,
+        const timer_type& all, bool verified)
+    {
+        const std::vector<std::string> columns{"backend", "grid", "halo", "fields", "types", "layout", "periodic",
+            "stencil", "domains", "iterations"};
+        for (const auto& c : columns) os << c << ",";
+        os << "verified,rank,bytes,min_us,mean_us,max_us,bandwidth_GBps\n";
+        auto line = [&](const std::string& rank, double bytes, double min, double mean, double max)
+        {
+            for (const auto& c : columns) os << quote_csv(opts.get(c)) << ",";
+            os << (verified ? 1 : 0) << "," << rank << "," << static_cast<std::size_t>(bytes) << "," << min << ","
+               << mean << "," << max << "," << bandwidth(bytes, mean) << "\n";
+        };
+        double bytes = 0.0, max_mean = 0.0;
+        for (std::size_t r=0; r<results.size(); ++r)
+        {
+            line(std::to_string(r), results[r].bytes, results[r].min_us, results[r].mean_us, results[r].max_us);
+            bytes += results[r].bytes;
+            max_mean = std::max(max_mean, results[r].mean_us);
+        }
+        // the aggregated bandwidth is limited by the slowest rank
+        for (const auto& c : columns) os << quote_csv(opts.get(c)) << ",";
+        os << (verified ? 1 : 0) << ",all," << static_cast<std::size_t>(bytes) << "," << all.min() << ","
+           << all.mean() << "," << all.max() << "," << bandwidth(bytes, max_mean) << "\n";
+    }
+
+    config make_config(const bench::options& opts)
+    {
+        config cfg;
+        cfg.backend = opts.get("backend");
+        const auto grid = opts.get_list<int>("grid", 3);
+        const auto halo = opts.get_list<int>("halo", 6);
+        const auto layout = opts.get_list<int>("layout", 3);
+        const auto periodic = opts.get_list<int>("periodic", 3);
+        for (int k=0; k<3; ++k)
+        {
+            cfg.grid[k] = grid[k];
+            cfg.layout[k] = layout[k];
+            cfg.periodic[k] = periodic[k] != 0;
+        }
+        for (int k=0; k<6; ++k) cfg.halo[k] = halo[k];
+        cfg.num_fields = opts.get<int>("fields");
+        cfg.types = opts.get_list<std::string>("types");
+        cfg.star = opts.get("stencil") == "star";
+        cfg.num_domains = opts.get<int>("domains");
+        cfg.iterations = opts.get<int>("iterations");
+        cfg.warmup = opts.get<int>("warmup");
+
+        if (cfg.backend != "ghex" && cfg.backend != "mpi" && cfg.backend != "gcl")
+            throw std::runtime_error("unknown backend " + cfg.backend);
+#ifndef GHEX_HALO_BENCHMARK_GCL
+        if (cfg.backend == "gcl") throw std::runtime_error("the gcl backend is not available in this build");
+#endif
+        if (!cfg.star && opts.get("stencil") != "box") throw std::runtime_error("stencil must be box or star");
+        for (const auto& t : cfg.types)
+            if (std::find(type_names.begin(), type_names.end(), t) == type_names.end())
+                throw std::runtime_error("unknown value type " + t);
+        for (int k=0; k<3; ++k)
+            if (cfg.grid[k] < 1 || cfg.halo[2*k] < 0 || cfg.halo[2*k+1] < 0 || cfg.halo[2*k] > cfg.grid[k] ||
+                cfg.halo[2*k+1] > cfg.grid[k])
+                throw std::runtime_error("halos must not be wider than the domain");
+        if (cfg.num_fields < 1 || cfg.num_domains < 1 || cfg.iterations < 1 || cfg.warmup < 0)
+            throw std::runtime_error("fields, domains and iterations must be positive");
+        return cfg;
+    }
+
+    /** @return true if the halos were exchanged correctly */
+    bool run(const bench::options& opts)
+    {
+        const auto cfg = make_config(opts);
+        const auto format = opts.get("format");
+        if (format != "json" && format != "csv") throw std::runtime_error("format must be json or csv");
+
+        int size;
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+        decomposition dec;
+        int dims[3] = {0, 0, 0};
+        int periods[3] = {cfg.periodic[0], cfg.periodic[1], cfg.periodic[2]};
+        MPI_Dims_create(size, 3, dims);
+        MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, false, &dec.comm);
+        int rank;
+        MPI_Comm_rank(dec.comm, &rank);
+        MPI_Cart_coords(dec.comm, rank, 3, dec.coords.data());
+        for (int k=0; k<3; ++k) dec.dims[k] = dims[k];
+
+        auto groups = make_fields(cfg, dec);
+        timer_type t;
+        if (cfg.backend == "ghex")
+            t = dispatch_layout(cfg.layout, [&](auto seq) { return run_ghex(seq, cfg, dec, groups); });
+        else if (cfg.backend == "mpi")
+            t = run_mpi(cfg, dec, groups);
+#ifdef GHEX_HALO_BENCHMARK_GCL
+        else
+            t = dispatch_layout(cfg.layout, [&](auto seq) { return run_gcl(seq, cfg, dec, groups); });
+#endif
+
+        // traffic of the exchanges, for offline replay (builds with GHEX_CAPTURE_TRAFFIC only)
+        gridtools::ghex::capture::write(rank, size, opts.get("capture"));
+
+        long errors = verify(cfg, dec, groups);
+        MPI_Allreduce(MPI_IN_PLACE, &errors, 1, MPI_LONG, MPI_SUM, dec.comm);
+        const auto all = gridtools::ghex::reduce(t, dec.comm);
+        const rank_result local{t.min(), t.mean(), t.max(), static_cast<double>(halo_bytes(cfg, dec, groups))};
+        std::vector<rank_result> results(size);
+        MPI_Gather(&local, 4, MPI_DOUBLE, results.data(), 4, MPI_DOUBLE, 0, dec.comm);
+        MPI_Comm_free(&dec.comm);
+
+        if (rank == 0)
+        {
+            std::ofstream file;
+            const auto output = opts.get("output");
+            if (output != "-")
+            {
+                file.open(output);
+                if (!file) throw std::runtime_error("could not open " + output);
+            }
+            std::ostream& os = (output != "-") ? file : std::cout;
+            if (format == "json") write_json(os, opts, dec, results, all, errors == 0);
+            else write_csv(os, opts, results, all, errors == 0);
+            if (errors) std::cerr << errors << " halo points were not exchanged correctly\n";
+        }
+        return errors == 0;
+    }
+
+} // namespace halo_exchange_driver
+
+int main(int argc, char** argv)
+{
+    MPI_Init(&argc, &argv);
+#ifdef GHEX_HALO_BENCHMARK_GCL
+    gridtools::GCL_Init(argc, argv);
+#endif
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    bench::options opts("Halo exchange benchmark: exchanges fields on a cartesian decomposition of the ranks and "
+        "reports the time per exchange and the bandwidth.");
+    opts.add("backend", "ghex, mpi or gcl", "ghex")
+        .add("grid", "interior points of a domain: n or nx,ny,nz", "64")
+        .add("halo", "halo widths: h or x-,x+,y-,y+,z-,z+", "1")
+        .add("fields", "number of fields", "3")
+        .add("types", "value types of the fields, assigned round robin: double, float, int, int64", "double")
+        .add("layout", "layout map of the fields: the highest value is the contiguous dimension", "2,1,0")
+        .add("periodic", "periodicity: p or px,py,pz", "1")
+        .add("stencil", "box (26 neighbors) or star (6 neighbors)", "box")
+        .add("domains", "domains per rank, stacked along x (ghex backend only)", "1")
+        .add("iterations", "number of timed exchanges", "100")
+        .add("warmup", "number of exchanges before timing", "10")
+        .add("format", "json or csv", "json")
+        .add("output", "output file, - for the standard output", "-")
+        .add("capture", "path prefix of the traffic capture files (builds with GHEX_CAPTURE_TRAFFIC)", "ghex_capture");
+
+    int result = 0;
+    try
+    {
+        if (!opts.parse(argc, argv))
+        {
+            if (rank == 0) opts.print_help(std::cout, argv[0]);
+        }
+        else if (!halo_exchange_driver::run(opts))
+            result = 1;
+    }
+    catch (std::exception& e)
+    {
+        if (rank == 0) std::cerr << "error: " << e.what() << "\n";
+        result = 1;
+    }
+
+    MPI_Finalize();
+    return result;
+}
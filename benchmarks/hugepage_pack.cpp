@@ -0,0 +1,128 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <array>
+
+#include <ghex/allocator/hugepage_allocator.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using pattern_type = gridtools::ghex::pattern<context_type::communicator_type,
+    gridtools::ghex::structured::grid::type<domain_descriptor_type>, int>;
+using iteration_space = pattern_type::iteration_space;
+using iteration_space_pair = pattern_type::iteration_space_pair;
+using coordinate_type = pattern_type::coordinate_type;
+
+namespace hugepage_pack {
+
+    const int num_iterations = 20;
+    const int num_warmup = 2;
+
+    /** @brief kB of anonymous memory of this process backed by transparent huge pages */
+    long anon_huge_kb()
+    {
+        std::ifstream smaps("/proc/self/smaps_rollup");
+        std::string key;
+        long value;
+        while (smaps >> key)
+        {
+            if (key == "AnonHugePages:" && smaps >> value) return value;
+            smaps.ignore(256, '\n');
+        }
+        return -1;
+    }
+
+    /** @brief times packing and unpacking of the lower faces of a field. Field and buffer are allocated with
+      * Allocator. Returns the mean pack and unpack times in us, and the memory backed by huge pages in kB. */
+    template<typename Allocator>
+    std::array<double,3> run(int n, int halo, const iteration_space_pair& is)
+    {
+        const std::array<int,3> offsets{halo,halo,halo};
+        const std::array<int,3> extents{n+2*halo,n+2*halo,n+2*halo};
+        std::vector<double, Allocator> data(static_cast<std::size_t>(extents[0])*extents[1]*extents[2], 1.0);
+        std::vector<double, Allocator> buffer(is.size());
+        // x is the stride-1 dimension
+        auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(0, data.data(), offsets, extents);
+        using ser = gridtools::ghex::structured::serialization<gridtools::ghex::cpu,
+            typename decltype(field)::dimension, typename decltype(field)::layout_map>;
+
+        gridtools::ghex::timer t_pack, t_unpack;
+        for (int i=0; i<num_warmup+num_iterations; ++i)
+        {
+            const bool record = i >= num_warmup;
+            t_pack.tic();
+            ser::pack_blocked(buffer.data(), is, field.data(), field.byte_strides(), field.offsets());
+            if (record) t_pack.toc();
+            t_unpack.tic();
+            ser::unpack_blocked(buffer.data(), is, field.data(), field.byte_strides(), field.offsets());
+            if (record) t_unpack.toc();
+        }
+        return {t_pack.mean(), t_unpack.mean(), static_cast<double>(anon_huge_kb())};
+    }
+
+} // namespace hugepage_pack
+
+TEST(Serialization, hugepage_pack)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    if (context.rank() != 0) return;
+
+    using small_pages = std::allocator<double>;
+    using huge_pages = gridtools::ghex::allocator::hugepage_allocator<double>;
+    const int halo = 3;
+
+    std::cout << "face packing with 4 KiB and huge pages (field and buffer), halo " << halo << ", times in us\n";
+    std::cout << std::setw(8) << "n" << std::setw(6) << "face" << std::setw(12) << "elements"
+              << std::setw(12) << "pack 4k" << std::setw(12) << "pack huge" << std::setw(10) << "speedup"
+              << std::setw(12) << "unpack 4k" << std::setw(12) << "unpack huge" << std::setw(10) << "speedup"
+              << std::setw(14) << "huge kB" << "\n";
+
+    auto make_is = [](const std::array<int,3>& first, const std::array<int,3>& last)
+    {
+        return iteration_space_pair{
+            iteration_space{coordinate_type{first}, coordinate_type{last}},
+            iteration_space{coordinate_type{first}, coordinate_type{last}}};
+    };
+
+    for (int n : {256, 384})
+    {
+        const std::vector<std::pair<const char*, iteration_space_pair>> faces{
+            {"x", make_is({0,0,0}, {halo-1,n-1,n-1})},
+            {"y", make_is({0,0,0}, {n-1,halo-1,n-1})},
+            {"z", make_is({0,0,0}, {n-1,n-1,halo-1})}};
+        for (const auto& f : faces)
+        {
+            const auto small = hugepage_pack::run<small_pages>(n, halo, f.second);
+            const auto huge = hugepage_pack::run<huge_pages>(n, halo, f.second);
+            std::cout << std::setw(8) << n << std::setw(6) << f.first << std::setw(12) << f.second.size()
+                      << std::setw(12) << small[0] << std::setw(12) << huge[0]
+                      << std::setw(10) << std::setprecision(3) << small[0]/huge[0]
+                      << std::setw(12) << std::setprecision(6) << small[1] << std::setw(12) << huge[1]
+                      << std::setw(10) << std::setprecision(3) << small[1]/huge[1]
+                      << std::setw(14) << std::setprecision(6) << huge[2] << "\n";
+        }
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+#include <thread>
+#include <cstdlib>
+#include <pthread.h>
+
+#include <ghex/allocator/numa_allocator_adaptor.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using pattern_type = gridtools::ghex::pattern<context_type::communicator_type,
+    gridtools::ghex::structured::grid::type<domain_descriptor_type>, int>;
+using iteration_space = pattern_type::iteration_space;
+using iteration_space_pair = pattern_type::iteration_space_pair;
+using coordinate_type = pattern_type::coordinate_type;
+using gridtools::ghex::allocator::numa_policy;
+using gridtools::ghex::allocator::numa_placement;
+namespace numa = gridtools::ghex::allocator::numa;
+
+namespace numa_pack {
+
+    const int num_iterations = 50;
+    const int num_warmup = 5;
+
+    using allocator_type = gridtools::ghex::allocator::numa_allocator_adaptor<std::allocator<double>>;
+
+    void pin(int cpu)
+    {
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        CPU_SET(cpu % std::thread::hardware_concurrency(), &mask);
+        pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    }
+
+    iteration_space_pair make_is(const std::array<int,3>& first, const std::array<int,3>& last)
+    {
+        return iteration_space_pair{
+            iteration_space{coordinate_type{first}, coordinate_type{last}},
+            iteration_space{coordinate_type{first}, coordinate_type{last}}};
+    }
+
+    /** @brief STREAM-like packing: every thread (pinned to cpu t) owns a field which it has touched itself and
+      * packs the three lower faces into its send buffer, like threads packing the halos of their domains. The send
+      * buffers are either allocated by the main thread (all on its node), or placed with a numa policy by the
+      * packing threads. Prints the aggregated bandwidth (bytes read and written) in GB/s. */
+    double run(int num_threads, int n, int halo, bool allocate_on_main, numa_placement placement)
+    {
+        const std::array<int,3> offsets{halo,halo,halo};
+        const std::array<int,3> extents{n+2*halo,n+2*halo,n+2*halo};
+        const std::vector<iteration_space_pair> faces{
+            make_is({0,0,0}, {halo-1,n-1,n-1}), make_is({0,0,0}, {n-1,halo-1,n-1}), make_is({0,0,0}, {n-1,n-1,halo-1})};
+        std::size_t buffer_size = 0;
+        for (const auto& is : faces) buffer_size += is.size();
+
+        std::vector<double*> buffers(num_threads, nullptr);
+        allocator_type main_alloc(numa_placement{numa_policy::first_touch, 0});
+        if (allocate_on_main)
+            for (auto& b : buffers) b = main_alloc.allocate(buffer_size);
+
+        std::vector<double> times(num_threads);
+        std::vector<std::thread> threads;
+        for (int t=0; t<num_threads; ++t)
+        {
+            threads.emplace_back([&,t]()
+            {
+                pin(t);
+                std::vector<double> data(static_cast<std::size_t>(extents[0])*extents[1]*extents[2], 1.0);
+                auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(0, data.data(), offsets, extents);
+                using ser = gridtools::ghex::structured::serialization<gridtools::ghex::cpu,
+                    typename decltype(field)::dimension, typename decltype(field)::layout_map>;
+                allocator_type alloc(placement);
+                if (!allocate_on_main) buffers[t] = alloc.allocate(buffer_size);
+                gridtools::ghex::timer timer;
+                for (int i=0; i<num_warmup+num_iterations; ++i)
+                {
+                    timer.tic();
+                    double* ptr = buffers[t];
+                    for (const auto& is : faces)
+                    {
+                        ser::pack_blocked(ptr, is, field.data(), field.byte_strides(), field.offsets());
+                        ptr += is.size();
+                    }
+                    if (i >= num_warmup) timer.toc();
+                }
+                times[t] = timer.sum();
+                if (!allocate_on_main) alloc.deallocate(buffers[t], buffer_size);
+            });
+        }
+        for (auto& th : threads) th.join();
+        if (allocate_on_main)
+            for (auto b : buffers) main_alloc.deallocate(b, buffer_size);
+
+        double max_time = 0;
+        for (auto t : times) max_time = std::max(max_time, t);
+        const double bytes = 2.0*sizeof(double)*buffer_size*num_iterations*num_threads;
+        return bytes/max_time*1.0e-3;
+    }
+
+} // namespace numa_pack
+
+TEST(Serialization, numa_pack)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    if (context.rank() != 0) return;
+
+    int num_threads = std::thread::hardware_concurrency();
+    if (const char* env = std::getenv("GHEX_NUMA_PACK_THREADS")) num_threads = std::atoi(env);
+    const int halo = 2;
+
+    std::cout << "threaded face packing, " << num_threads << " threads, " << numa::num_nodes() << " numa nodes"
+              << (numa::can_bind() ? "" : " (no libnuma: pages are not bound)") << ", halo " << halo
+              << ", bandwidth in GB/s\n";
+    std::cout << std::setw(8) << "n" << std::setw(14) << "main thread" << std::setw(14) << "first touch"
+              << std::setw(14) << "local" << std::setw(14) << "node 0" << "\n";
+
+    for (int n : {64, 128, 256})
+    {
+        std::cout << std::setw(8) << n
+                  << std::setw(14) << numa_pack::run(num_threads, n, halo, true, numa_placement{})
+                  << std::setw(14) << numa_pack::run(num_threads, n, halo, false, numa_placement{numa_policy::first_touch, 0})
+                  << std::setw(14) << numa_pack::run(num_threads, n, halo, false, numa_placement{numa_policy::local, 0})
+                  << std::setw(14) << numa_pack::run(num_threads, n, halo, false, numa_placement{numa_policy::node, 0})
+                  << "\n";
+    }
+}
@@ -0,0 +1,157 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_BENCHMARKS_OPTIONS_HPP
+#define INCLUDED_GHEX_BENCHMARKS_OPTIONS_HPP
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+    /** @brief named command line options of the benchmark drivers. Options are declared with a default value and
+      * passed as --name=value or --name value; lists are comma separated. */
+    class options
+    {
+    private: // member types
+        struct option
+        {
+            std::string name;
+            std::string help;
+            std::string value;
+        };
+
+    private: // members
+        std::string m_description;
+        std::vector<option> m_options;
+
+    public: // ctors
+        options(const std::string& description) : m_description{description} {}
+
+    public: // member functions
+        /** @brief declare an option
+          * @param name option name without the leading dashes
+          * @param help description printed by --help
+          * @param default_value value used when the option is not passed
+          * @return reference to this object, for chaining */
+        options& add(const std::string& name, const std::string& help, const std::string& default_value)
+        {
+            m_options.push_back(option{name, help, default_value});
+            return *this;
+        }
+
+        /** @brief parse the command line
+          * @return false if --help was passed, true otherwise */
+        bool parse(int argc, char** argv)
+        {
+            for (int i=1; i<argc; ++i)
+            {
+                std::string arg(argv[i]);
+                if (arg == "--help" || arg == "-h") return false;
+                if (arg.size() < 3 || arg.compare(0, 2, "--") != 0)
+                    throw std::runtime_error("unexpected argument " + arg);
+                arg = arg.substr(2);
+                std::string value;
+                const auto eq = arg.find('=');
+                if (eq != std::string::npos)
+                {
+                    value = arg.substr(eq+1);
+                    arg = arg.substr(0, eq);
+                }
+                else if (i+1 < argc)
+                    value = argv[++i];
+                else
+                    throw std::runtime_error("missing value of option --" + arg);
+                find(arg).value = value;
+            }
+            return true;
+        }
+
+        void print_help(std::ostream& os, const std::string& program) const
+        {
+            os << m_description << "\n\nusage: " << program << " [--option=value ...]\n\noptions:\n";
+            for (const auto& o : m_options)
+                os << "  --" << std::left << std::setw(20) << o.name << o.help << " (default: " << o.value << ")\n";
+        }
+
+        const std::string& get(const std::string& name) const { return find(name).value; }
+
+        template<typename T>
+        T get(const std::string& name) const
+        {
+            return convert<T>(name, get(name));
+        }
+
+        /** @return the comma separated values of an option */
+        template<typename T>
+        std::vector<T> get_list(const std::string& name) const
+        {
+            std::vector<T> res;
+            std::stringstream ss(get(name));
+            std::string item;
+            while (std::getline(ss, item, ',')) res.push_back(convert<T>(name, item));
+            return res;
+        }
+
+        /** @return the comma separated values of an option, where a single value is repeated n times */
+        template<typename T>
+        std::vector<T> get_list(const std::string& name, std::size_t n) const
+        {
+            auto res = get_list<T>(name);
+            if (res.size() == 1u) res.resize(n, res[0]);
+            if (res.size() != n)
+                throw std::runtime_error("option --" + name + " expects 1 or " + std::to_string(n) + " values");
+            return res;
+        }
+
+        /** @brief write all options and their values as the members of a JSON object */
+        void write_json(std::ostream& os, const std::string& indent) const
+        {
+            bool first = true;
+            for (const auto& o : m_options)
+            {
+                os << (first ? "" : ",\n") << indent << "\"" << o.name << "\": \"" << o.value << "\"";
+                first = false;
+            }
+        }
+
+    private: // implementation
+        const option& find(const std::string& name) const
+        {
+            for (const auto& o : m_options)
+                if (o.name == name) return o;
+            throw std::runtime_error("unknown option --" + name);
+        }
+
+        option& find(const std::string& name)
+        {
+            for (auto& o : m_options)
+                if (o.name == name) return o;
+            throw std::runtime_error("unknown option --" + name);
+        }
+
+        template<typename T>
+        static T convert(const std::string& name, const std::string& value)
+        {
+            std::stringstream ss(value);
+            T res;
+            if (!(ss >> res) || !ss.eof())
+                throw std::runtime_error("invalid value " + value + " of option --" + name);
+            return res;
+        }
+    };
+
+} // namespace bench
+
+#endif /* INCLUDED_GHEX_BENCHMARKS_OPTIONS_HPP */
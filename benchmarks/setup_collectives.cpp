@@ -0,0 +1,112 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+#include <ghex/transport_layer/mpi/setup.hpp>
+#include <ghex/common/timer.hpp>
+
+// node layout of the two-level collectives: 0 uses the ranks sharing memory, a positive value emulates nodes of
+// that many consecutive ranks (useful on a single node)
+#ifndef GHEX_SETUP_RANKS_PER_NODE
+#define GHEX_SETUP_RANKS_PER_NODE 0
+#endif
+
+using setup_communicator = gridtools::ghex::tl::mpi::setup_communicator;
+
+namespace setup_collectives {
+
+    const int num_iterations = 20;
+    const int payload_size = 64;
+
+    /** @brief the collectives issued by a pattern setup: an all-gather of counts and of variable payloads,
+      * a sparse all-to-all (each rank talks to a few neighbors) and a broadcast */
+    void run(setup_communicator& comm, gridtools::ghex::timer& t)
+    {
+        const int P = comm.size();
+        const int me = comm.rank();
+        const int my_size = payload_size + me%7;
+        std::vector<int> payload(my_size, me);
+        std::vector<int> send_counts(P, 0), send_displs(P, 0), recv_counts(P, 0), recv_displs(P, 0);
+        int send_total = 0, recv_total = 0;
+        for (int r=0; r<P; ++r)
+        {
+            const int d = (r-me+P)%P;
+            send_counts[r] = (d==1 || d==P-1 || d==2 || d==P-2) ? payload_size : 0;
+            recv_counts[r] = send_counts[r];
+            send_displs[r] = send_total; send_total += send_counts[r];
+            recv_displs[r] = recv_total; recv_total += recv_counts[r];
+        }
+        std::vector<int> send_buf(send_total, me), recv_buf(recv_total);
+        std::vector<int> bcast_buf(payload_size, me);
+
+        MPI_Barrier(comm);
+        t.tic();
+        auto sizes = comm.all_gather(my_size).get();
+        auto values = comm.all_gather(payload, sizes).get();
+        comm.all_to_allv(send_buf, send_counts, send_displs, recv_buf, recv_counts, recv_displs);
+        comm.broadcast(bcast_buf.data(), payload_size, P-1);
+        t.toc();
+    }
+
+} // namespace setup_collectives
+
+TEST(Setup, setup_collectives)
+{
+    int world_rank, world_size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &world_rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &world_size);
+
+    std::vector<int> rank_counts;
+    for (int p=2; p<world_size; p*=2) rank_counts.push_back(p);
+    rank_counts.push_back(world_size);
+
+    if (world_rank == 0)
+    {
+        std::cout << "setup collectives (all_gather x2, all_to_allv, broadcast), times in us\n";
+        std::cout << std::setw(8) << "ranks" << std::setw(8) << "nodes"
+                  << std::setw(14) << "flat" << std::setw(14) << "std"
+                  << std::setw(14) << "two-level" << std::setw(14) << "std" << "\n";
+    }
+    for (int p : rank_counts)
+    {
+        MPI_Comm sub_comm;
+        MPI_Comm_split(MPI_COMM_WORLD, world_rank<p ? 0 : MPI_UNDEFINED, world_rank, &sub_comm);
+        if (sub_comm != MPI_COMM_NULL)
+        {
+            // one rank per node is the flat scheme
+            setup_communicator flat{sub_comm, 1};
+            setup_communicator two_level{sub_comm, GHEX_SETUP_RANKS_PER_NODE};
+            const int num_nodes = two_level.topology().num_nodes();
+            flat.topology();
+
+            gridtools::ghex::timer t_flat, t_two_level;
+            for (int i=0; i<setup_collectives::num_iterations; ++i)
+            {
+                setup_collectives::run(flat, t_flat);
+                setup_collectives::run(two_level, t_two_level);
+            }
+            auto t_flat_all = gridtools::ghex::reduce(t_flat, sub_comm);
+            auto t_two_level_all = gridtools::ghex::reduce(t_two_level, sub_comm);
+            if (world_rank == 0)
+                std::cout << std::setw(8) << p << std::setw(8) << num_nodes
+                          << std::setw(14) << t_flat_all.mean() << std::setw(14) << t_flat_all.stddev()
+                          << std::setw(14) << t_two_level_all.mean() << std::setw(14) << t_two_level_all.stddev()
+                          << "\n";
+        }
+        // the topologies are released before their communicator
+        if (sub_comm != MPI_COMM_NULL) MPI_Comm_free(&sub_comm);
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+}
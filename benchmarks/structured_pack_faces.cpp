@@ -0,0 +1,136 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include "gtest/gtest.h"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <array>
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/timer.hpp>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using pattern_type = gridtools::ghex::pattern<context_type::communicator_type,
+    gridtools::ghex::structured::grid::type<domain_descriptor_type>, int>;
+using iteration_space = pattern_type::iteration_space;
+using iteration_space_pair = pattern_type::iteration_space_pair;
+using coordinate_type = pattern_type::coordinate_type;
+
+namespace structured_pack_faces {
+
+    const int num_iterations = 100;
+    const int num_warmup = 5;
+
+    template<typename Field>
+    using serialization_type = gridtools::ghex::structured::serialization<gridtools::ghex::cpu,
+        typename Field::dimension, typename Field::layout_map>;
+
+    /** @brief times element-wise and blocked packing and unpacking of one face of a field. Returns false if the
+      * two traversals do not produce the same buffer. */
+    template<typename Field>
+    bool run(context_type& context, const char* name, Field& field, const iteration_space_pair& is)
+    {
+        using ser = serialization_type<Field>;
+        std::vector<double> buffer_e(is.size());
+        std::vector<double> buffer_b(is.size());
+
+        gridtools::ghex::timer t_pack_e, t_pack_b, t_unpack_e, t_unpack_b;
+        for (int i=0; i<num_warmup+num_iterations; ++i)
+        {
+            const bool record = i >= num_warmup;
+            t_pack_e.tic();
+            ser::pack_elementwise(buffer_e.data(), is, field.data(), field.byte_strides(), field.offsets());
+            if (record) t_pack_e.toc();
+            t_pack_b.tic();
+            ser::pack_blocked(buffer_b.data(), is, field.data(), field.byte_strides(), field.offsets());
+            if (record) t_pack_b.toc();
+            t_unpack_e.tic();
+            ser::unpack_elementwise(buffer_e.data(), is, field.data(), field.byte_strides(), field.offsets());
+            if (record) t_unpack_e.toc();
+            t_unpack_b.tic();
+            ser::unpack_blocked(buffer_b.data(), is, field.data(), field.byte_strides(), field.offsets());
+            if (record) t_unpack_b.toc();
+        }
+        auto pe = gridtools::ghex::reduce(t_pack_e, context.mpi_comm());
+        auto pb = gridtools::ghex::reduce(t_pack_b, context.mpi_comm());
+        auto ue = gridtools::ghex::reduce(t_unpack_e, context.mpi_comm());
+        auto ub = gridtools::ghex::reduce(t_unpack_b, context.mpi_comm());
+
+        if (context.rank() == 0)
+        {
+            std::cout << std::setw(8) << field.extents()[0]
+                      << std::setw(6) << name
+                      << std::setw(10) << is.size()
+                      << std::setw(14) << pe.mean()
+                      << std::setw(14) << pb.mean()
+                      << std::setw(10) << std::setprecision(3) << pe.mean()/pb.mean()
+                      << std::setw(14) << std::setprecision(6) << ue.mean()
+                      << std::setw(14) << ub.mean()
+                      << std::setw(10) << std::setprecision(3) << ue.mean()/ub.mean()
+                      << std::setprecision(6) << "\n";
+        }
+        return buffer_e == buffer_b;
+    }
+
+} // namespace structured_pack_faces
+
+TEST(Serialization, structured_pack_faces)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    const int halo = 2;
+    const std::vector<int> domain_sizes{64, 128, 256};
+
+    if (context.rank() == 0)
+    {
+#if defined(GHEX_PACK_PREFETCH)
+        std::cout << "structured face packing (with prefetch), halo " << halo << ", times in us\n";
+#else
+        std::cout << "structured face packing, halo " << halo << ", times in us\n";
+#endif
+        std::cout << std::setw(8) << "n" << std::setw(6) << "face" << std::setw(10) << "elements"
+                  << std::setw(14) << "pack elem" << std::setw(14) << "pack block" << std::setw(10) << "speedup"
+                  << std::setw(14) << "unpack elem" << std::setw(14) << "unpack block" << std::setw(10) << "speedup" << "\n";
+    }
+
+    bool passed = true;
+    for (auto n : domain_sizes)
+    {
+        const std::array<int,3> offsets{halo,halo,halo};
+        const std::array<int,3> extents{n+2*halo,n+2*halo,n+2*halo};
+        std::vector<double> data(static_cast<std::size_t>(extents[0])*extents[1]*extents[2]);
+        for (std::size_t i=0; i<data.size(); ++i) data[i] = static_cast<double>(i);
+        // x is the stride-1 dimension
+        auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(0, data.data(), offsets, extents);
+
+        auto make_is = [](const std::array<int,3>& first, const std::array<int,3>& last)
+        {
+            return iteration_space_pair{
+                iteration_space{coordinate_type{first}, coordinate_type{last}},
+                iteration_space{coordinate_type{first}, coordinate_type{last}}};
+        };
+        // faces at the lower end of each dimension (inner halo region which is sent)
+        passed = structured_pack_faces::run(context, "x", field, make_is({0,0,0}, {halo-1,n-1,n-1})) && passed;
+        passed = structured_pack_faces::run(context, "y", field, make_is({0,0,0}, {n-1,halo-1,n-1})) && passed;
+        passed = structured_pack_faces::run(context, "z", field, make_is({0,0,0}, {n-1,n-1,halo-1})) && passed;
+    }
+
+    EXPECT_TRUE(passed);
+}
@@ -0,0 +1,386 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include <ghex/common/timer.hpp>
+#include <ghex/common/traffic_capture.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include "../options.hpp"
+
+namespace ghex = gridtools::ghex;
+using threading    = ghex::threads::none::primitives;
+
+#if defined(USE_UCP)
+// UCX backend
+#include <ghex/transport_layer/ucx/context.hpp>
+using transport    = ghex::tl::ucx_tag;
+const char* transport_name = "ucx";
+#elif defined(USE_INPROC)
+// in-process backend: the ranks of the capture are run as threads of one process
+#include <thread>
+#include <ghex/transport_layer/inproc/context.hpp>
+using transport    = ghex::tl::threads_tag;
+const char* transport_name = "inproc";
+#else
+// MPI backend
+#include <ghex/transport_layer/mpi/context.hpp>
+using transport    = ghex::tl::mpi_tag;
+const char* transport_name = "mpi";
+#endif
+
+#include <ghex/transport_layer/message_buffer.hpp>
+using context_type = ghex::tl::context<transport, threading>;
+using communicator_type = typename context_type::communicator_type;
+using future_type = typename communicator_type::future<void>;
+using msg_type = gridtools::ghex::tl::message_buffer<>;
+using clock_type = ghex::timer::clock_type;
+
+/* Offline replay of the traffic captured by an application compiled with GHEX_CAPTURE_TRAFFIC (see
+ * ghex/common/traffic_capture.hpp). Every rank reads its capture file <prefix>.<rank>.bin and re-issues the
+ * recorded messages with the same peers, tags and sizes through the transport of this build, in the order they
+ * were captured:
+ * - send/recv:      the message is posted with the ghex communicator (future API)
+ * - exchange_end:   all messages of the exchange are waited for
+ * - exchange_begin: the compute gap since the previous record is reproduced by spinning, scaled by --gaps
+ * Messages outside of exchanges are retired when they complete, and at the end of the trace. The records of all
+ * threads of a rank are replayed by one thread. Packing and unpacking are not replayed, such that the time of an
+ * exchange is the pure transport time of its messages. The replayed exchange times are reported per rank and
+ * compared with the captured ones, as JSON. */
+namespace capture_replay {
+
+    struct config
+    {
+        std::string prefix;
+        double gaps;
+        int repeat;
+        std::string output;
+    };
+
+    config make_config(const bench::options& opts)
+    {
+        config cfg;
+        cfg.prefix = opts.get("prefix");
+        cfg.gaps = opts.get<double>("gaps");
+        cfg.repeat = opts.get<int>("repeat");
+        cfg.output = opts.get("output");
+        if (cfg.gaps < 0.0) throw std::runtime_error("--gaps must not be negative");
+        if (cfg.repeat < 1) throw std::runtime_error("--repeat must be positive");
+        return cfg;
+    }
+
+    // non-owning view of a buffer with the interface of a message
+    struct buffer_view
+    {
+        using value_type = unsigned char;
+        unsigned char* m_data;
+        std::size_t m_size;
+        unsigned char* data() const noexcept { return m_data; }
+        std::size_t size() const noexcept { return m_size; }
+    };
+
+    // receive buffers are reused by messages of the same size
+    class buffer_pool
+    {
+    private: // members
+        std::map<std::size_t, std::vector<std::unique_ptr<msg_type>>> m_free;
+
+    public: // member functions
+        std::unique_ptr<msg_type> acquire(std::size_t bytes)
+        {
+            auto& l = m_free[bytes];
+            if (l.empty()) return std::unique_ptr<msg_type>(new msg_type(std::max<std::size_t>(bytes, 1u)));
+            auto m = std::move(l.back());
+            l.pop_back();
+            return m;
+        }
+
+        void release(std::size_t bytes, std::unique_ptr<msg_type> m) { m_free[bytes].push_back(std::move(m)); }
+    };
+
+    struct statistics
+    {
+        double min = std::numeric_limits<double>::max();
+        double max = 0.0;
+        double sum = 0.0;
+        std::size_t count = 0u;
+
+        void add(double x) { min = std::min(min, x); max = std::max(max, x); sum += x; ++count; }
+        double mean() const { return count ? sum/count : 0.0; }
+    };
+
+    // per rank results, sent to rank 0 as an array of doubles
+    struct rank_result
+    {
+        enum { exchanges, sends, send_bytes, captured_total, replay_total, captured_min, captured_mean, captured_max,
+               replay_min, replay_mean, replay_max, num_values };
+        double values[num_values];
+    };
+
+    void spin(double us)
+    {
+        if (us <= 0.0) return;
+        const auto end = clock_type::now() + std::chrono::duration_cast<clock_type::duration>(
+            std::chrono::duration<double, std::micro>(us));
+        while (clock_type::now() < end) {}
+    }
+
+    double elapsed_us(clock_type::time_point t0)
+    {
+        return std::chrono::duration<double, std::micro>(clock_type::now() - t0).count();
+    }
+
+    rank_result replay(context_type& context, const ghex::capture::rank_trace& trace, const config& cfg)
+    {
+        using ghex::capture::record_kind;
+        auto comm = context.get_communicator(context.get_token());
+        if (trace.rank != comm.rank() || trace.size != comm.size())
+            throw std::runtime_error("capture of rank " + std::to_string(trace.rank) + " of " +
+                std::to_string(trace.size) + " replayed on rank " + std::to_string(comm.rank()) + " of " +
+                std::to_string(comm.size()));
+
+        // one send buffer large enough for all sends
+        std::size_t max_send = 1u;
+        for (const auto& r : trace.records)
+            if (r.kind == record_kind::send) max_send = std::max<std::size_t>(max_send, r.bytes);
+        msg_type send_buffer(max_send);
+        std::fill(send_buffer.data(), send_buffer.data()+max_send, 0);
+        buffer_pool pool;
+
+        struct pending
+        {
+            std::uint32_t exchange;
+            future_type fut;
+            std::size_t bytes;
+            std::unique_ptr<msg_type> buffer;
+        };
+        std::vector<pending> in_flight;
+        auto retire = [&pool](pending& p) { if (p.buffer) pool.release(p.bytes, std::move(p.buffer)); };
+        // wait for the messages of an exchange, and retire the completed messages outside of exchanges
+        auto complete = [&](std::uint32_t id)
+        {
+            auto it = std::remove_if(in_flight.begin(), in_flight.end(), [&](pending& p)
+            {
+                if (p.exchange == id) p.fut.wait();
+                else if (p.exchange != 0u || !p.fut.ready()) return false;
+                retire(p);
+                return true;
+            });
+            in_flight.erase(it, in_flight.end());
+        };
+
+        statistics captured, replayed;
+        std::map<std::uint32_t, std::pair<double, clock_type::time_point>> open;
+        std::size_t sends = 0u;
+        double send_bytes = 0.0;
+        double captured_total = 0.0, replay_total = 0.0;
+        for (int k=0; k<cfg.repeat; ++k)
+        {
+            comm.barrier();
+            const auto t_start = clock_type::now();
+            double t_prev = trace.records.empty() ? 0.0 : trace.records.front().time_us;
+            for (const auto& r : trace.records)
+            {
+                if (r.kind == record_kind::exchange_begin || r.exchange == 0u)
+                    spin(cfg.gaps*(r.time_us-t_prev));
+                t_prev = r.time_us;
+                switch (r.kind)
+                {
+                    case record_kind::exchange_begin:
+                        open[r.exchange] = std::make_pair(r.time_us, clock_type::now());
+                        break;
+                    case record_kind::exchange_end:
+                    {
+                        complete(r.exchange);
+                        auto it = open.find(r.exchange);
+                        // exchanges begun before the capture was started are not timed
+                        if (it == open.end()) break;
+                        replayed.add(elapsed_us(it->second.second));
+                        captured.add(r.time_us - it->second.first);
+                        open.erase(it);
+                        break;
+                    }
+                    case record_kind::send:
+                        in_flight.push_back(pending{r.exchange,
+                            comm.send(buffer_view{send_buffer.data(), r.bytes}, r.peer, r.tag), r.bytes, nullptr});
+                        ++sends;
+                        send_bytes += r.bytes;
+                        break;
+                    case record_kind::recv:
+                    {
+                        auto buffer = pool.acquire(r.bytes);
+                        buffer_view view{buffer->data(), r.bytes};
+                        auto fut = comm.recv(view, r.peer, r.tag);
+                        in_flight.push_back(pending{r.exchange, std::move(fut), r.bytes, std::move(buffer)});
+                        break;
+                    }
+                }
+            }
+            // messages of exchanges which were not completed within the capture, and outside of exchanges
+            for (auto& p : in_flight)
+            {
+                p.fut.wait();
+                retire(p);
+            }
+            in_flight.clear();
+            open.clear();
+            replay_total += elapsed_us(t_start);
+            if (!trace.records.empty())
+                captured_total += trace.records.back().time_us - trace.records.front().time_us;
+        }
+
+        rank_result res;
+        auto& v = res.values;
+        v[rank_result::exchanges] = captured.count/cfg.repeat;
+        v[rank_result::sends] = sends/cfg.repeat;
+        v[rank_result::send_bytes] = send_bytes/cfg.repeat;
+        v[rank_result::captured_total] = captured_total/cfg.repeat;
+        v[rank_result::replay_total] = replay_total/cfg.repeat;
+        v[rank_result::captured_min] = captured.count ? captured.min : 0.0;
+        v[rank_result::captured_mean] = captured.mean();
+        v[rank_result::captured_max] = captured.max;
+        v[rank_result::replay_min] = replayed.count ? replayed.min : 0.0;
+        v[rank_result::replay_mean] = replayed.mean();
+        v[rank_result::replay_max] = replayed.max;
+        return res;
+    }
+
+    ghex::capture::rank_trace read_trace(const std::string& prefix, int rank)
+    {
+        return ghex::capture::read(prefix + "." + std::to_string(rank) + ".bin");
+    }
+
+    void write_json(std::ostream& os, const bench::options& opts, const std::vector<rank_result>& results)
+    {
+        const char* names[] = {"exchanges", "sends", "send_bytes", "captured_total_us", "replay_total_us",
+            "captured_exchange_min_us", "captured_exchange_mean_us", "captured_exchange_max_us",
+            "replay_exchange_min_us", "replay_exchange_mean_us", "replay_exchange_max_us"};
+        double captured_total = 0.0, replay_total = 0.0, captured_sum = 0.0, replay_sum = 0.0, exchanges = 0.0;
+        os << "{\n  \"benchmark\": \"capture_replay\",\n  \"transport\": \"" << transport_name << "\",\n"
+           << "  \"ranks\": " << results.size() << ",\n  \"options\": {\n";
+        opts.write_json(os, "    ");
+        os << "\n  },\n  \"results\": [\n";
+        for (std::size_t r=0; r<results.size(); ++r)
+        {
+            const auto& v = results[r].values;
+            os << "    {\"rank\": " << r;
+            for (int i=0; i<rank_result::num_values; ++i) os << ", \"" << names[i] << "\": " << v[i];
+            os << "}" << (r+1 < results.size() ? "," : "") << "\n";
+            captured_total = std::max(captured_total, v[rank_result::captured_total]);
+            replay_total = std::max(replay_total, v[rank_result::replay_total]);
+            captured_sum += v[rank_result::captured_mean]*v[rank_result::exchanges];
+            replay_sum += v[rank_result::replay_mean]*v[rank_result::exchanges];
+            exchanges += v[rank_result::exchanges];
+        }
+        os << "  ],\n  \"summary\": {\"captured_total_us\": " << captured_total << ", \"replay_total_us\": "
+           << replay_total << ", \"captured_exchange_mean_us\": " << (exchanges > 0.0 ? captured_sum/exchanges : 0.0)
+           << ", \"replay_exchange_mean_us\": " << (exchanges > 0.0 ? replay_sum/exchanges : 0.0)
+           << ", \"exchange_speedup\": " << (replay_sum > 0.0 ? captured_sum/replay_sum : 0.0) << "}\n}\n";
+    }
+
+#ifdef USE_INPROC
+    std::vector<rank_result> run(const config& cfg)
+    {
+        const int size = read_trace(cfg.prefix, 0).size;
+        std::vector<ghex::capture::rank_trace> traces;
+        for (int r=0; r<size; ++r) traces.push_back(read_trace(cfg.prefix, r));
+        std::vector<rank_result> results(size);
+        std::vector<std::string> errors(size);
+        ghex::tl::inproc::world world(size);
+        std::vector<std::thread> threads;
+        for (int r=0; r<size; ++r)
+            threads.emplace_back([&,r]()
+            {
+                auto context_ptr = ghex::tl::context_factory<transport,threading>::create(1, world, r);
+                try { results[r] = replay(*context_ptr, traces[r], cfg); }
+                catch (std::exception& e) { errors[r] = e.what(); }
+            });
+        for (auto& t : threads) t.join();
+        for (const auto& e : errors)
+            if (!e.empty()) throw std::runtime_error(e);
+        return results;
+    }
+#else
+    std::vector<rank_result> run(const config& cfg)
+    {
+        auto context_ptr = ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+        const int rank = context_ptr->rank();
+        const auto res = replay(*context_ptr, read_trace(cfg.prefix, rank), cfg);
+        std::vector<rank_result> results(rank == 0 ? context_ptr->size() : 0);
+        MPI_Gather(res.values, rank_result::num_values, MPI_DOUBLE, rank == 0 ? results.data() : nullptr,
+            rank_result::num_values, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+        return results;
+    }
+#endif
+
+} // namespace capture_replay
+
+int main(int argc, char** argv)
+{
+    int mode;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SINGLE, &mode);
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    bench::options opts("Replay of the traffic captured with GHEX_CAPTURE_TRAFFIC: the recorded messages of every "
+        "rank are re-issued through the transport of this build and the exchange times are compared.");
+    opts.add("prefix", "path prefix of the capture files <prefix>.<rank>.bin", "ghex_capture")
+        .add("gaps", "scale of the compute gaps between exchanges, 0 to replay back to back", "1")
+        .add("repeat", "number of replays of the trace", "1")
+        .add("output", "output file, - for the standard output", "-");
+
+    int result = 0;
+    try
+    {
+        if (!opts.parse(argc, argv))
+        {
+            if (rank == 0) opts.print_help(std::cout, argv[0]);
+        }
+        else
+        {
+            const auto cfg = capture_replay::make_config(opts);
+#ifdef USE_INPROC
+            if (size != 1) throw std::runtime_error("the inproc replay runs all ranks in one process");
+#endif
+            const auto results = capture_replay::run(cfg);
+            if (rank == 0)
+            {
+                std::ofstream file;
+                if (cfg.output != "-")
+                {
+                    file.open(cfg.output);
+                    if (!file) throw std::runtime_error("could not open " + cfg.output);
+                }
+                std::ostream& os = (cfg.output != "-") ? file : std::cout;
+                capture_replay::write_json(os, opts, results);
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "error: " << e.what() << "\n";
+        result = 1;
+        MPI_Abort(MPI_COMM_WORLD, result);
+    }
+
+    MPI_Finalize();
+    return result;
+}
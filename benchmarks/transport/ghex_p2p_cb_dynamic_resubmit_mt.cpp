@@ -1,212 +1,264 @@
-/* 
+/*
  * GridTools
- * 
+ *
  * Copyright (c) 2014-2020, ETH Zurich
  * All rights reserved.
- * 
+ *
  * Please, refer to the LICENSE file in the root directory.
  * SPDX-License-Identifier: BSD-3-Clause
- * 
+ *
  */
 #include <iostream>
 #include <vector>
+#include <atomic>
+#include <memory>
+#include <functional>
 
 #include <ghex/common/timer.hpp>
+#include "utils.hpp"
 
-#ifdef USE_POOL_ALLOCATOR
-#include "pool_allocator.hpp"
-using AllocType = ghex::allocator::pool_allocator<unsigned char, std::allocator<unsigned char>>;
+namespace ghex = gridtools::ghex;
+
+#ifdef USE_OPENMP
+#include <ghex/threads/omp/primitives.hpp>
+using threading    = ghex::threads::omp::primitives;
 #else
-using AllocType = std::allocator<unsigned char>;
+#include <ghex/threads/none/primitives.hpp>
+using threading    = ghex::threads::none::primitives;
 #endif
 
-#ifdef USE_MPI
-
-/* MPI backend */
-#include <ghex/transport_layer/callback_communicator.hpp>
-#include <ghex/transport_layer/mpi/communicator.hpp>
-using CommType = gridtools::ghex::tl::communicator<gridtools::ghex::tl::mpi_tag>;
+#ifdef USE_UCP
+// UCX backend
+#include <ghex/transport_layer/ucx/context.hpp>
+using transport    = ghex::tl::ucx_tag;
 #else
+// MPI backend
+#include <ghex/transport_layer/mpi/context.hpp>
+using transport    = ghex::tl::mpi_tag;
+#endif
+
+#include <ghex/transport_layer/shared_message_buffer.hpp>
+using context_type = ghex::tl::context<transport, threading>;
+using communicator_type = typename context_type::communicator_type;
 
-/* UCX backend */
-#ifdef USE_UCX_NBR
-#include <ghex/transport_layer/callback_communicator.hpp>
+#ifdef USE_THREAD_POOL_ALLOCATOR
+#include <ghex/allocator/thread_pool_allocator_adaptor.hpp>
+using PoolType  = ghex::allocator::thread_pool_impl<std::allocator<unsigned char>>;
+using AllocType = ghex::allocator::thread_pool_allocator_adaptor<std::allocator<unsigned char>>;
 #else
-#include <ghex/transport_layer/ucx/callback_communicator.hpp>
+using AllocType = std::allocator<unsigned char>;
 #endif
-#include <ghex/transport_layer/ucx/communicator.hpp>
-using CommType = gridtools::ghex::tl::communicator<gridtools::ghex::tl::ucx_tag>;
-#endif /* USE_MPI */
 
 using MsgType = gridtools::ghex::tl::shared_message_buffer<AllocType>;
 
-/* Track finished comm requests. 
-   This is shared between threads, because in the shared-worker case
-   there is no way of knowing which thread will service which requests,
-   and how many.
-*/
-int comm_cnt = 0, nlcomm_cnt = 0, submit_cnt = 0;
-int thrid, nthr;
-#pragma omp threadprivate(comm_cnt, nlcomm_cnt, submit_cnt, thrid, nthr)
-
-/* available comm slots - per-thread */
-int **available = NULL;
-int ongoing_comm = 0;
-int inflight;
-
-void send_callback(MsgType mesg, int rank, int tag)
+/* Every message is allocated right before it is posted. A received message is handed over to the
+   neighboring thread which releases it, as happens when the data is consumed elsewhere: the memory
+   is freed by a different thread than the one which allocated it. */
+struct mailbox
 {
-    // std::cout << "send callback called " << rank << " thread " << omp_get_thread_num() << " tag " << tag << "\n";
-    int pthr = tag/inflight;
-    int pos = tag - pthr*inflight;
-    if(pthr != thrid) nlcomm_cnt++;
-    comm_cnt++;
-    available[pthr][pos] = 1;
-}
+    std::vector<MsgType> m_msgs;
+    std::unique_ptr<std::atomic<int>[]> m_full;
 
-gridtools::ghex::tl::callback_communicator<CommType, AllocType> *pcomm = NULL;
-#pragma omp threadprivate(pcomm)
+    mailbox(int n, AllocType alloc) : m_msgs(n, MsgType(alloc)), m_full(new std::atomic<int>[n])
+    {
+        for (int j=0; j<n; ++j) m_full[j] = 0;
+    }
 
-void recv_callback(MsgType mesg, int rank, int tag)
-{
-    // std::cout << "recv callback called " << rank << " thread " << omp_get_thread_num() << " tag " << tag << " ongoing " << ongoing_comm << "\n";
-    int pthr = tag/inflight;
-    int pos = tag - pthr*inflight;
-    if(pthr != thrid) nlcomm_cnt++;
-    comm_cnt++;
-    submit_cnt+=nthr;
-
-    /* resubmit the recv request */
-    pcomm->recv(mesg, rank, tag, recv_callback);
-
-#pragma omp atomic
-    ongoing_comm--;
-}
+    // non-blocking: the message is kept (and released) by the caller if the slot is occupied
+    bool post(int j, MsgType& msg)
+    {
+        if (m_full[j].load(std::memory_order_acquire)) return false;
+        m_msgs[j] = msg;
+        m_full[j].store(1, std::memory_order_release);
+        return true;
+    }
+
+    int drain()
+    {
+        int n = 0;
+        for (std::size_t j=0; j<m_msgs.size(); ++j)
+            if (m_full[j].load(std::memory_order_acquire))
+            {
+                { MsgType released(std::move(m_msgs[j])); }
+                m_full[j].store(0, std::memory_order_release);
+                ++n;
+            }
+        return n;
+    }
+};
 
 int main(int argc, char *argv[])
 {
-    int rank, size, threads, peer_rank;
     int niter, buff_size;
+    int inflight;
+    int mode;
     gridtools::ghex::timer timer;
-    long bytes = 0;
 
-#ifdef USE_MPI
-    int mode;
+    if(argc != 4)
+    {
+        std::cerr << "Usage: bench [niter] [msg_size] [inflight]" << "\n";
+        std::terminate();
+    }
+    niter = atoi(argv[1]);
+    buff_size = atoi(argv[2]);
+    inflight = atoi(argv[3]);
+
+    int num_threads = 1;
+
+#ifdef USE_OPENMP
+#pragma omp parallel
+    {
+#pragma omp master
+        num_threads = omp_get_num_threads();
+    }
+#endif
+
 #ifdef USE_OPENMP
     MPI_Init_thread(NULL, NULL, MPI_THREAD_MULTIPLE, &mode);
     if(mode != MPI_THREAD_MULTIPLE){
-	std::cerr << "MPI_THREAD_MULTIPLE not supported by MPI, aborting\n";
-	std::terminate();
+        std::cerr << "MPI_THREAD_MULTIPLE not supported by MPI, aborting\n";
+        std::terminate();
     }
 #else
     MPI_Init_thread(NULL, NULL, MPI_THREAD_SINGLE, &mode);
 #endif
+
+    {
+#ifdef USE_THREAD_POOL_ALLOCATOR
+        // the pool outlives the context and all messages
+        PoolType pool{std::allocator<unsigned char>{}};
+        AllocType alloc(&pool);
+#else
+        AllocType alloc;
 #endif
+        std::vector<std::unique_ptr<mailbox>> mailboxes;
+        for (int t=0; t<num_threads; ++t)
+            mailboxes.push_back(std::make_unique<mailbox>(inflight, alloc));
 
-    niter = atoi(argv[1]);
-    buff_size = atoi(argv[2]);
-    inflight = atoi(argv[3]);   
-    
+        auto context_ptr = ghex::tl::context_factory<transport,threading>::create(num_threads, MPI_COMM_WORLD);
+        auto& context = *context_ptr;
+
+#ifdef USE_OPENMP
 #pragma omp parallel
-    {
-	gridtools::ghex::tl::callback_communicator<CommType, AllocType> *comm 
-	    = new gridtools::ghex::tl::callback_communicator<CommType, AllocType>();
-	AllocType alloc;
+#endif
+        {
+            auto token             = context.get_token();
+            auto comm              = context.get_communicator(token);
+            const auto rank        = comm.rank();
+            const auto thread_id   = token.id();
+            const auto num_threads = context.thread_primitives().size();
+            const auto peer_rank   = (rank+1)%2;
+            const int my_niter     = niter/num_threads;
 
-#pragma omp master
-	{
-	    rank = comm->rank();
-	    size = comm->size();
-	    peer_rank = (rank+1)%2;
-	    if(rank==0)	std::cout << "\n\nrunning test " << __FILE__ << " with communicator " << typeid(*comm).name() << "\n\n";
-	}
+            if (thread_id==0 && rank==0)
+            {
+                std::cout << "\n\nrunning test " << __FILE__ << " with communicator " << typeid(comm).name() << "\n\n";
+            };
 
-	/* needed in the recv_callback to resubmit the recv request */
-	pcomm = comm;
+            int sent = 0, received = 0, handed_over = 0, released = 0;
+            std::vector<int> available(inflight, 1);
+            // every slot (tag) carries a fixed number of messages on both sides
+            std::vector<int> remaining(inflight);
+            for (int j=0; j<inflight; ++j) remaining[j] = my_niter/inflight + (j < my_niter%inflight ? 1 : 0);
+            std::vector<MsgType> rmsgs(inflight, MsgType(alloc));
+            auto& outbox = *mailboxes[(thread_id+1)%num_threads];
+            auto& inbox  = *mailboxes[thread_id];
 
-	thrid = omp_get_thread_num();
-	nthr = omp_get_num_threads();
+            auto send_callback = [&](communicator_type::message_type, int, int tag)
+            {
+                available[tag - thread_id*inflight] = 1;
+                ++sent;
+            };
 
-#pragma omp master
-	available = new int*[nthr];
-#pragma omp barrier
-	available[thrid] = new int[inflight];
-
-	for(int j=0; j<inflight; j++){
-	    available[thrid][j] = 1;
-	}
-
-	/* make sure both ranks are started and all threads initialized */
-	comm->barrier();
-	
-	if(rank == 1) {
-	    timer.tic();
-	    bytes = (double)niter*size*buff_size/2;
-	}
-
-	if(rank == 0){
-
-	    int i = 0, dbg = 0, blk;
-	    blk = niter / 10;
-	    dbg = dbg + blk;
-	    
-	    /* send niter messages - as soon as a slot becomes free */
-	    while(submit_cnt < niter){
-		
-		for(int j=0; j<inflight; j++){
-		    if(available[thrid][j]){
-			if(rank==0 && thrid==0 && submit_cnt >= dbg) {
-			    std::cout << submit_cnt << " iters\n";
-			    dbg = dbg + blk;
-			}
-			available[thrid][j] = 0;
-			submit_cnt += nthr;
-			MsgType msg = MsgType(buff_size, alloc);
-			comm->send(msg, peer_rank, thrid*inflight+j, send_callback);
-		    } 
-		    else comm->progress();
-		}
-	    }
-
-	} else {
-
-	    /* recv requests are resubmitted as soon as a request is completed */
-	    /* so the number of submitted recv requests is always constant (inflight) */
-	    /* expect niter messages (i.e., niter recv callbacks) on receiver  */
-	    ongoing_comm = niter;
-#pragma omp barrier
-
-	    /* submit all recv requests */
-	    for(int j=0; j<inflight; j++){
-		MsgType msg = MsgType(buff_size, alloc);
-		comm->recv(msg, peer_rank, thrid*inflight+j, recv_callback);
-		submit_cnt+=nthr;
-	    }
-	    
-	    /* requests are re-submitted inside the calback. */
-	    /* progress (below) until niter messages have been received. */
-
-	    /* complete all comm */
-	    while(ongoing_comm > 0){
-		comm->progress();
-	    }
-	}
-
-#pragma omp barrier
-	comm->flush();
-	comm->barrier();
-	
-#pragma omp critical
-	std::cout << "rank " << rank << " thread " << thrid << " submitted " << submit_cnt/nthr
-		  << " serviced " << comm_cnt << ", non-local " << nlcomm_cnt << " completion events\n";
-	
-	delete comm;
-    }
+            std::function<void(communicator_type::message_type, int, int)> recv_callback =
+                [&](communicator_type::message_type, int, int tag)
+            {
+                const int j = tag - thread_id*inflight;
+                ++received;
+                if (outbox.post(j, rmsgs[j])) ++handed_over;
+                if (remaining[j] > 0)
+                {
+                    // count first: the callback may be invoked right away
+                    --remaining[j];
+                    rmsgs[j] = MsgType(buff_size, alloc);
+                    comm.recv(rmsgs[j], peer_rank, tag, recv_callback);
+                }
+            };
+
+            if (rank == 1)
+            {
+                for (int j=0; j<inflight && remaining[j]>0; ++j)
+                {
+                    --remaining[j];
+                    rmsgs[j] = MsgType(buff_size, alloc);
+                    comm.recv(rmsgs[j], peer_rank, thread_id*inflight+j, recv_callback);
+                }
+            }
+
+            comm.barrier();
+
+            if (thread_id == 0)
+            {
+                timer.tic();
+                if(rank == 1)
+                    std::cout << "number of threads: " << num_threads << "\n";
+            }
+
+            if (rank == 0)
+            {
+                // send my_niter messages - as soon as a slot becomes free
+                while (sent < my_niter)
+                {
+                    for (int j=0; j<inflight; ++j)
+                    {
+                        if (available[j] && remaining[j] > 0)
+                        {
+                            available[j] = 0;
+                            --remaining[j];
+                            MsgType msg(buff_size, alloc);
+                            comm.send(msg, peer_rank, thread_id*inflight+j, send_callback);
+                        }
+                    }
+                    comm.progress();
+                }
+            }
+            else
+            {
+                // recv requests are resubmitted in the callback, received messages of the neighbor released here
+                while (received < my_niter)
+                {
+                    comm.progress();
+                    released += inbox.drain();
+                }
+            }
 
-    if(rank == 1) timer.vtoc(bytes);
+            comm.barrier();
+            released += inbox.drain();
+
+            if (thread_id == 0 && rank == 1)
+            {
+                const auto t = timer.stoc();
+                std::cout << "time:       " << t/1000000 << "s\n";
+                std::cout << "final MB/s: " << ((double)my_niter*num_threads*buff_size)/t << "\n";
+                std::cout << "msg/s:      " << ((double)my_niter*num_threads)/t*1000000 << "\n";
+            }
+
+            comm.barrier();
+            context.thread_primitives().critical(
+                [&]()
+                {
+                    std::cout
+                    << "rank " << rank << " thread " << thread_id << " sent " << sent << " received " << received
+                    << ", handed over " << handed_over << " released " << released << "\n";
+                });
+        }
+
+#ifdef USE_THREAD_POOL_ALLOCATOR
+        if (context.rank() == 1)
+            std::cout << "allocations from the underlying allocator: " << pool.num_allocations() << "\n";
+#endif
+    }
 
-#ifdef USE_MPI
     MPI_Barrier(MPI_COMM_WORLD);
     MPI_Finalize();
-#endif
 }
@@ -0,0 +1,212 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <iostream>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+#include <ghex/common/timer.hpp>
+#include <ghex/threads/none/primitives.hpp>
+
+namespace ghex = gridtools::ghex;
+
+#ifdef USE_UCP
+// UCX backend
+#include <ghex/transport_layer/ucx/context.hpp>
+using transport    = ghex::tl::ucx_tag;
+#else
+// MPI backend
+#include <ghex/transport_layer/mpi/context.hpp>
+using transport    = ghex::tl::mpi_tag;
+#endif
+
+#include <ghex/transport_layer/shared_message_buffer.hpp>
+#include <ghex/transport_layer/intrusive_shared_message_buffer.hpp>
+#include <ghex/allocator/thread_pool_allocator_adaptor.hpp>
+using threading    = ghex::threads::none::primitives;
+using context_type = ghex::tl::context<transport, threading>;
+using communicator_type = typename context_type::communicator_type;
+
+using PoolType  = ghex::allocator::thread_pool_impl<std::allocator<unsigned char>>;
+using AllocType = ghex::allocator::thread_pool_allocator_adaptor<std::allocator<unsigned char>>;
+
+#ifdef USE_SHARED_MESSAGE
+using MsgType = ghex::tl::shared_message_buffer<AllocType>;
+#else
+using MsgType = ghex::tl::intrusive_shared_message_buffer<AllocType>;
+#endif
+
+/* count heap allocations of the process in order to report them per fan-out. All replaceable allocation and
+   deallocation functions are replaced as one set on top of malloc and free, such that every operator delete
+   matches its operator new. GCC (from version 11 on) still flags the free calls within the replacements with
+   -Wmismatched-new-delete, which is a false positive here. */
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<long> num_new{0};
+void* operator new(std::size_t n)
+{
+    ++num_new;
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n) { return operator new(n); }
+void* operator new(std::size_t n, const std::nothrow_t&) noexcept
+{
+    ++num_new;
+    return std::malloc(n ? n : 1);
+}
+void* operator new[](std::size_t n, const std::nothrow_t& t) noexcept { return operator new(n, t); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#ifdef __cpp_aligned_new
+void* operator new(std::size_t n, std::align_val_t al)
+{
+    ++num_new;
+    const std::size_t a = static_cast<std::size_t>(al);
+    // aligned_alloc requires a multiple of the alignment
+    if (void* p = std::aligned_alloc(a, ((n ? n : 1)+a-1)/a*a)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t n, std::align_val_t al) { return operator new(n, al); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+#endif
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+/* Rank 0 broadcasts one buffer to all other ranks per iteration (halo-broadcast pattern), using
+   send_multi with a callback which carries some state. Up to inflight fan-outs are pending at a time.
+   The other ranks receive with resubmitting callbacks. */
+int main(int argc, char *argv[])
+{
+    int niter, buff_size;
+    int inflight;
+    int mode;
+    gridtools::ghex::timer timer;
+
+    if(argc != 4)
+    {
+        std::cerr << "Usage: bench [niter] [msg_size] [inflight]" << "\n";
+        std::terminate();
+    }
+    niter = atoi(argv[1]);
+    buff_size = atoi(argv[2]);
+    inflight = atoi(argv[3]);
+
+    MPI_Init_thread(NULL, NULL, MPI_THREAD_SINGLE, &mode);
+
+    {
+        PoolType pool{std::allocator<unsigned char>{}};
+        AllocType alloc(&pool);
+
+        auto context_ptr = ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+        auto& context = *context_ptr;
+        auto token = context.get_token();
+        auto comm = context.get_communicator(token);
+        const auto rank = comm.rank();
+        const auto size = comm.size();
+
+        if (rank == 0)
+        {
+            std::cout << "\n\nrunning test " << __FILE__ << " with communicator " << typeid(comm).name() << "\n\n";
+            std::cout << "fan-out to " << size-1 << " ranks\n";
+        }
+
+        std::vector<int> dsts;
+        for (int r=1; r<size; ++r) dsts.push_back(r);
+
+        int completed = 0, received = 0;
+        std::vector<int> available(inflight, 1);
+        std::vector<int> remaining(inflight);
+        for (int j=0; j<inflight; ++j) remaining[j] = niter/inflight + (j < niter%inflight ? 1 : 0);
+        std::vector<MsgType> rmsgs;
+        for (int j=0; j<inflight; ++j) rmsgs.emplace_back(buff_size, alloc);
+
+        // a callback with state beyond the small-object buffer of std::function
+        std::array<long,4> state{};
+        auto send_callback = [&available, &completed, state](communicator_type::message_type, int, int tag)
+        {
+            available[tag] = 1;
+            completed += 1 + (int)state[0];
+        };
+
+        std::function<void(communicator_type::message_type, int, int)> recv_callback =
+            [&](communicator_type::message_type, int, int tag)
+        {
+            ++received;
+            if (remaining[tag] > 0)
+            {
+                --remaining[tag];
+                comm.recv(rmsgs[tag], 0, tag, recv_callback);
+            }
+        };
+
+        if (rank != 0)
+            for (int j=0; j<inflight && remaining[j]>0; ++j)
+            {
+                --remaining[j];
+                comm.recv(rmsgs[j], 0, j, recv_callback);
+            }
+
+        comm.barrier();
+        const long num_new_start = num_new.load();
+        timer.tic();
+
+        if (rank == 0)
+        {
+            while (completed < niter)
+            {
+                for (int j=0; j<inflight; ++j)
+                {
+                    if (available[j] && remaining[j] > 0)
+                    {
+                        available[j] = 0;
+                        --remaining[j];
+                        comm.send_multi(MsgType(buff_size, alloc), dsts, j, send_callback);
+                    }
+                }
+                comm.progress();
+            }
+        }
+        else
+        {
+            while (received < niter) comm.progress();
+        }
+
+        const auto t = timer.stoc();
+        const long num_new_loop = num_new.load() - num_new_start;
+        comm.barrier();
+
+        if (rank == 0)
+        {
+            std::cout << "time:                      " << t/1000000 << "s\n";
+            std::cout << "fan-outs/s:                " << ((double)niter)/t*1000000 << "\n";
+            std::cout << "msg/s:                     " << ((double)niter*(size-1))/t*1000000 << "\n";
+            std::cout << "heap allocations/fan-out:  " << ((double)num_new_loop)/niter << "\n";
+            std::cout << "allocations from the pool: " << pool.num_allocations() << "\n";
+        }
+    }
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Finalize();
+}
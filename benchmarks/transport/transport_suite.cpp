@@ -0,0 +1,681 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <mpi.h>
+
+#include <ghex/common/timer.hpp>
+#include "../options.hpp"
+
+namespace ghex = gridtools::ghex;
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#include <ghex/threads/omp/primitives.hpp>
+using threading    = ghex::threads::omp::primitives;
+#else
+#include <ghex/threads/none/primitives.hpp>
+using threading    = ghex::threads::none::primitives;
+#endif
+
+#ifdef USE_UCP
+// UCX backend
+#include <ghex/transport_layer/ucx/context.hpp>
+using transport    = ghex::tl::ucx_tag;
+const char* transport_name = "ucx";
+#else
+// MPI backend
+#include <ghex/transport_layer/mpi/context.hpp>
+using transport    = ghex::tl::mpi_tag;
+const char* transport_name = "mpi";
+#endif
+
+#include <ghex/transport_layer/message_buffer.hpp>
+using context_type = ghex::tl::context<transport, threading>;
+using communicator_type = typename context_type::communicator_type;
+using future_type = typename communicator_type::future<void>;
+using msg_type = gridtools::ghex::tl::message_buffer<>;
+using clock_type = ghex::timer::clock_type;
+
+/* OSU style microbenchmarks of the transport layer. The ranks are split into pairs (rank r of the lower half
+ * talks to rank r+size/2), and every thread of a rank talks to the same thread of its peer, such that all pairs
+ * and threads run concurrently. Tests:
+ * - latency: ping-pong of one message, the one-way latency is reported
+ * - bw:      the lower rank streams messages to its peer, keeping a window of messages in flight
+ * - bibw:    both ranks stream messages to each other
+ * The bandwidth tests report the bandwidth per thread pair, the aggregate bandwidth of all pairs (multi-pair
+ * throughput) and the aggregate message rate. Each test runs for every combination of
+ * - backend:    ghex communicator or raw MPI point to point calls
+ * - api:        futures or callbacks (ghex backend only)
+ * - completion: wait: post a window of messages and wait for all of them
+ *               avail: poll the messages and repost a message as soon as its slot completes
+ * - threads:    number of threads per rank (requires USE_OPENMP)
+ * The results are written as JSON. With a baseline (a previous output of this program), the results are
+ * compared, and metrics which are worse than the baseline by more than a threshold are reported as
+ * regressions. */
+namespace transport_suite {
+
+    struct config
+    {
+        std::vector<std::string> tests;
+        std::vector<std::string> backends;
+        std::vector<std::string> apis;
+        std::vector<std::string> completions;
+        std::vector<int> threads;
+        std::vector<int> sizes;
+        int iterations;
+        int warmup;
+        int window;
+        std::string output;
+        std::string baseline;
+        double threshold;
+    };
+
+    // large messages are sent fewer times
+    const int large_message = 65536;
+    int num_iterations(int n, int size) { return size > large_message ? std::max(1, n/10) : n; }
+
+    // channels
+    // --------
+    // A channel holds window+1 message slots to one peer: slots [0,window) have the message size, the last one
+    // carries a 1-byte acknowledgement.
+
+    /** @brief ghex communicator, completion through futures */
+    class future_channel
+    {
+    private: // members
+        communicator_type& m_comm;
+        int m_peer;
+        int m_tag;
+        std::vector<msg_type> m_smsgs, m_rmsgs;
+        std::vector<future_type> m_sreqs, m_rreqs;
+
+    public: // ctors
+        future_channel(communicator_type& comm, int peer, int tag, int window, int size)
+        : m_comm(comm), m_peer{peer}, m_tag{tag}, m_sreqs(window+1), m_rreqs(window+1)
+        {
+            for (int j=0; j<=window; ++j)
+            {
+                m_smsgs.emplace_back(j < window ? size : 1);
+                m_rmsgs.emplace_back(j < window ? size : 1);
+                for (auto& c : m_smsgs.back()) c = 0;
+            }
+        }
+
+    public: // member functions
+        void send(int j) { m_sreqs[j] = m_comm.send(m_smsgs[j], m_peer, m_tag+j); }
+        void recv(int j) { m_rreqs[j] = m_comm.recv(m_rmsgs[j], m_peer, m_tag+j); }
+        bool test_send(int j) { return m_sreqs[j].test(); }
+        bool test_recv(int j) { return m_rreqs[j].test(); }
+        void wait_send(int j) { m_sreqs[j].wait(); }
+        void wait_recv(int j) { m_rreqs[j].wait(); }
+        void progress() {}
+    };
+
+    /** @brief ghex communicator, completion through callbacks which set a flag per slot */
+    class callback_channel
+    {
+    private: // members
+        communicator_type& m_comm;
+        int m_peer;
+        int m_tag;
+        std::vector<msg_type> m_smsgs, m_rmsgs;
+        std::unique_ptr<std::atomic<bool>[]> m_sdone, m_rdone;
+
+    public: // ctors
+        callback_channel(communicator_type& comm, int peer, int tag, int window, int size)
+        : m_comm(comm), m_peer{peer}, m_tag{tag}
+        , m_sdone(new std::atomic<bool>[window+1]), m_rdone(new std::atomic<bool>[window+1])
+        {
+            for (int j=0; j<=window; ++j)
+            {
+                m_smsgs.emplace_back(j < window ? size : 1);
+                m_rmsgs.emplace_back(j < window ? size : 1);
+                for (auto& c : m_smsgs.back()) c = 0;
+                m_sdone[j] = true;
+                m_rdone[j] = true;
+            }
+        }
+
+    public: // member functions
+        void send(int j)
+        {
+            m_sdone[j] = false;
+            auto* done = &m_sdone[j];
+            m_comm.send(m_smsgs[j], m_peer, m_tag+j, [done](communicator_type::message_type, int, int) { *done = true; });
+        }
+        void recv(int j)
+        {
+            m_rdone[j] = false;
+            auto* done = &m_rdone[j];
+            m_comm.recv(m_rmsgs[j], m_peer, m_tag+j, [done](communicator_type::message_type, int, int) { *done = true; });
+        }
+        bool test_send(int j) const { return m_sdone[j]; }
+        bool test_recv(int j) const { return m_rdone[j]; }
+        void wait_send(int j) { while (!m_sdone[j]) m_comm.progress(); }
+        void wait_recv(int j) { while (!m_rdone[j]) m_comm.progress(); }
+        void progress() { m_comm.progress(); }
+    };
+
+    /** @brief raw MPI non-blocking point to point calls */
+    class mpi_channel
+    {
+    private: // members
+        int m_peer;
+        int m_tag;
+        std::vector<std::vector<unsigned char>> m_sbufs, m_rbufs;
+        std::vector<MPI_Request> m_sreqs, m_rreqs;
+
+    public: // ctors
+        mpi_channel(int peer, int tag, int window, int size)
+        : m_peer{peer}, m_tag{tag}, m_sreqs(window+1, MPI_REQUEST_NULL), m_rreqs(window+1, MPI_REQUEST_NULL)
+        {
+            for (int j=0; j<=window; ++j)
+            {
+                m_sbufs.emplace_back(j < window ? size : 1, 0);
+                m_rbufs.emplace_back(j < window ? size : 1, 0);
+            }
+        }
+
+    public: // member functions
+        void send(int j)
+        {
+            MPI_Isend(m_sbufs[j].data(), m_sbufs[j].size(), MPI_BYTE, m_peer, m_tag+j, MPI_COMM_WORLD, &m_sreqs[j]);
+        }
+        void recv(int j)
+        {
+            MPI_Irecv(m_rbufs[j].data(), m_rbufs[j].size(), MPI_BYTE, m_peer, m_tag+j, MPI_COMM_WORLD, &m_rreqs[j]);
+        }
+        bool test_send(int j) { int flag; MPI_Test(&m_sreqs[j], &flag, MPI_STATUS_IGNORE); return flag; }
+        bool test_recv(int j) { int flag; MPI_Test(&m_rreqs[j], &flag, MPI_STATUS_IGNORE); return flag; }
+        void wait_send(int j) { MPI_Wait(&m_sreqs[j], MPI_STATUS_IGNORE); }
+        void wait_recv(int j) { MPI_Wait(&m_rreqs[j], MPI_STATUS_IGNORE); }
+        void progress() {}
+    };
+
+    // tests
+    // -----
+
+    template<typename Channel>
+    void complete_send(Channel& ch, int j, bool avail)
+    {
+        if (!avail) return ch.wait_send(j);
+        while (!ch.test_send(j)) ch.progress();
+    }
+
+    template<typename Channel>
+    void complete_recv(Channel& ch, int j, bool avail)
+    {
+        if (!avail) return ch.wait_recv(j);
+        while (!ch.test_recv(j)) ch.progress();
+    }
+
+    /** @brief n round trips of one message */
+    template<typename Channel>
+    void ping_pong(Channel& ch, int n, bool initiator, bool avail)
+    {
+        for (int i=0; i<n; ++i)
+        {
+            if (initiator)
+            {
+                ch.send(0);
+                complete_send(ch, 0, avail);
+                ch.recv(0);
+                complete_recv(ch, 0, avail);
+            }
+            else
+            {
+                ch.recv(0);
+                complete_recv(ch, 0, avail);
+                ch.send(0);
+                complete_send(ch, 0, avail);
+            }
+        }
+    }
+
+    /** @brief send and/or receive n messages with a window of messages in flight */
+    template<typename Channel>
+    void stream(Channel& ch, int n, int window, bool do_send, bool do_recv, bool avail)
+    {
+        if (!avail)
+        {
+            for (int i=0; i<n; i+=window)
+            {
+                const int k = std::min(window, n-i);
+                for (int j=0; j<k; ++j)
+                {
+                    if (do_recv) ch.recv(j);
+                    if (do_send) ch.send(j);
+                }
+                for (int j=0; j<k; ++j)
+                {
+                    if (do_recv) ch.wait_recv(j);
+                    if (do_send) ch.wait_send(j);
+                }
+            }
+            return;
+        }
+        // slot j carries the messages i with i%window == j, such that both sides agree on the tags
+        std::vector<int> s_left(window), r_left(window);
+        std::vector<char> s_active(window, 0), r_active(window, 0);
+        int active = 0;
+        for (int j=0; j<window; ++j)
+        {
+            const int count = n/window + (j < n%window ? 1 : 0);
+            s_left[j] = do_send ? count : 0;
+            r_left[j] = do_recv ? count : 0;
+            if (r_left[j] > 0) { ch.recv(j); --r_left[j]; r_active[j] = 1; ++active; }
+            if (s_left[j] > 0) { ch.send(j); --s_left[j]; s_active[j] = 1; ++active; }
+        }
+        while (active > 0)
+        {
+            ch.progress();
+            for (int j=0; j<window; ++j)
+            {
+                if (r_active[j] && ch.test_recv(j))
+                {
+                    if (r_left[j] > 0) { ch.recv(j); --r_left[j]; }
+                    else { r_active[j] = 0; --active; }
+                }
+                if (s_active[j] && ch.test_send(j))
+                {
+                    if (s_left[j] > 0) { ch.send(j); --s_left[j]; }
+                    else { s_active[j] = 0; --active; }
+                }
+            }
+        }
+    }
+
+    /** @brief run one test
+      * @return time in us */
+    template<typename Channel>
+    double run_test(Channel& ch, const std::string& test, int n, int window, bool lower, bool avail)
+    {
+        const auto start = clock_type::now();
+        if (test == "latency")
+            ping_pong(ch, n, lower, avail);
+        else
+        {
+            const bool bidirectional = (test == "bibw");
+            stream(ch, n, window, lower || bidirectional, !lower || bidirectional, avail);
+            // the sender waits for the receiver to acknowledge the reception of all messages
+            if (lower) { ch.recv(window); complete_recv(ch, window, avail); }
+            else { ch.send(window); complete_send(ch, window, avail); }
+        }
+        return std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+    }
+
+    // results
+    // -------
+
+    struct result
+    {
+        std::string test, backend, api, completion;
+        int threads, size, iterations;
+        double latency_us, max_latency_us;
+        double bandwidth_MBps, aggregate_bandwidth_MBps, message_rate;
+
+        std::string key() const
+        {
+            return test + "/" + backend + "/" + api + "/" + completion + "/" + std::to_string(threads) + "/" +
+                std::to_string(size);
+        }
+
+        void write_json(std::ostream& os) const
+        {
+            os << "{\"test\": \"" << test << "\", \"backend\": \"" << backend << "\", \"api\": \"" << api
+               << "\", \"completion\": \"" << completion << "\", \"threads\": " << threads << ", \"size\": " << size
+               << ", \"iterations\": " << iterations;
+            if (test == "latency")
+                os << ", \"latency_us\": " << latency_us << ", \"max_latency_us\": " << max_latency_us;
+            else
+                os << ", \"bandwidth_MBps\": " << bandwidth_MBps << ", \"aggregate_bandwidth_MBps\": "
+                   << aggregate_bandwidth_MBps << ", \"message_rate\": " << message_rate;
+            os << "}";
+        }
+    };
+
+    /** @brief compute the metrics from the times of all threads of all ranks (lower half first) */
+    void evaluate(result& r, const std::vector<double>& times, int num_pairs)
+    {
+        r.latency_us = r.max_latency_us = 0.0;
+        r.aggregate_bandwidth_MBps = r.message_rate = 0.0;
+        const int num_lower = num_pairs*r.threads;
+        for (int i=0; i<num_lower; ++i)
+        {
+            const double t = times[i];
+            if (r.test == "latency")
+            {
+                const double l = t/(2.0*r.iterations);
+                r.latency_us += l/num_lower;
+                r.max_latency_us = std::max(r.max_latency_us, l);
+            }
+            else
+            {
+                const double messages = (r.test == "bibw" ? 2.0 : 1.0)*r.iterations;
+                // bytes per us = MB/s
+                r.aggregate_bandwidth_MBps += messages*r.size/t;
+                r.message_rate += messages/t*1.0e6;
+            }
+        }
+        r.bandwidth_MBps = r.aggregate_bandwidth_MBps/num_lower;
+    }
+
+    // baseline comparison
+    // -------------------
+
+    struct regression
+    {
+        std::string key;
+        std::string metric;
+        double baseline;
+        double value;
+    };
+
+    std::string json_string(const std::string& line, const std::string& key)
+    {
+        const auto pos = line.find("\"" + key + "\": \"");
+        if (pos == std::string::npos) return "";
+        const auto begin = pos + key.size() + 5;
+        return line.substr(begin, line.find('"', begin) - begin);
+    }
+
+    double json_number(const std::string& line, const std::string& key)
+    {
+        const auto pos = line.find("\"" + key + "\": ");
+        if (pos == std::string::npos) return 0.0;
+        return std::strtod(line.c_str() + pos + key.size() + 4, nullptr);
+    }
+
+    /** @brief compare with the results of a baseline file written by this program: latencies which grew and
+      * bandwidths or message rates which dropped by more than the threshold (relative) are regressions */
+    std::vector<regression> compare(const std::vector<result>& results, const std::string& file, double threshold)
+    {
+        std::ifstream is(file);
+        if (!is) throw std::runtime_error("could not open baseline " + file);
+        std::vector<result> base;
+        std::string line;
+        while (std::getline(is, line))
+        {
+            if (line.find("{\"test\": ") == std::string::npos) continue;
+            result r;
+            r.test = json_string(line, "test");
+            r.backend = json_string(line, "backend");
+            r.api = json_string(line, "api");
+            r.completion = json_string(line, "completion");
+            r.threads = static_cast<int>(json_number(line, "threads"));
+            r.size = static_cast<int>(json_number(line, "size"));
+            r.latency_us = json_number(line, "latency_us");
+            r.aggregate_bandwidth_MBps = json_number(line, "aggregate_bandwidth_MBps");
+            r.message_rate = json_number(line, "message_rate");
+            base.push_back(r);
+        }
+        std::vector<regression> res;
+        for (const auto& r : results)
+            for (const auto& b : base)
+            {
+                if (b.key() != r.key()) continue;
+                if (r.test == "latency")
+                {
+                    if (b.latency_us > 0.0 && r.latency_us > b.latency_us*(1.0+threshold))
+                        res.push_back(regression{r.key(), "latency_us", b.latency_us, r.latency_us});
+                }
+                else
+                {
+                    if (r.aggregate_bandwidth_MBps < b.aggregate_bandwidth_MBps*(1.0-threshold))
+                        res.push_back(regression{r.key(), "aggregate_bandwidth_MBps", b.aggregate_bandwidth_MBps,
+                            r.aggregate_bandwidth_MBps});
+                    if (r.message_rate < b.message_rate*(1.0-threshold))
+                        res.push_back(regression{r.key(), "message_rate", b.message_rate, r.message_rate});
+                }
+            }
+        return res;
+    }
+
+    // driver
+    // ------
+
+    config make_config(const bench::options& opts)
+    {
+        config cfg;
+        cfg.tests = opts.get_list<std::string>("tests");
+        cfg.backends = opts.get_list<std::string>("backends");
+        cfg.apis = opts.get_list<std::string>("apis");
+        cfg.completions = opts.get_list<std::string>("completions");
+        cfg.threads = opts.get_list<int>("threads");
+        cfg.sizes = opts.get_list<int>("sizes");
+        cfg.iterations = opts.get<int>("iterations");
+        cfg.warmup = opts.get<int>("warmup");
+        cfg.window = opts.get<int>("window");
+        cfg.output = opts.get("output");
+        cfg.baseline = opts.get("baseline");
+        cfg.threshold = opts.get<double>("threshold");
+
+        auto check = [](const std::vector<std::string>& values, const std::vector<std::string>& valid,
+            const std::string& name)
+        {
+            for (const auto& v : values)
+                if (std::find(valid.begin(), valid.end(), v) == valid.end())
+                    throw std::runtime_error("invalid value " + v + " of option --" + name);
+        };
+        check(cfg.tests, {"latency", "bw", "bibw"}, "tests");
+        check(cfg.backends, {"ghex", "mpi"}, "backends");
+        check(cfg.apis, {"future", "callback"}, "apis");
+        check(cfg.completions, {"wait", "avail"}, "completions");
+        for (int t : cfg.threads)
+        {
+            if (t < 1) throw std::runtime_error("the number of threads must be positive");
+#ifndef USE_OPENMP
+            if (t != 1) throw std::runtime_error("multiple threads require a build with USE_OPENMP");
+#endif
+        }
+        for (int s : cfg.sizes)
+            if (s < 1) throw std::runtime_error("message sizes must be positive");
+        if (cfg.iterations < 1 || cfg.warmup < 0 || cfg.window < 1)
+            throw std::runtime_error("iterations and window must be positive");
+        return cfg;
+    }
+
+    /** @brief run all tests with a number of threads per rank
+      * @param results results, appended on rank 0 */
+    void run(const config& cfg, int num_threads, std::vector<result>& results)
+    {
+        int rank, size;
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+        const int num_pairs = size/2;
+        const bool lower = rank < num_pairs;
+        const int peer = lower ? rank + num_pairs : rank - num_pairs;
+        const int tag_stride = cfg.window+1;
+
+        auto context_ptr = ghex::tl::context_factory<transport,threading>::create(num_threads, MPI_COMM_WORLD);
+        auto& context = *context_ptr;
+        std::vector<double> times(num_threads);
+        std::vector<double> all_times(num_threads*size);
+
+#ifdef USE_OPENMP
+#pragma omp parallel num_threads(num_threads)
+#endif
+        {
+            auto token = context.get_token();
+            auto comm = context.get_communicator(token);
+            auto& tp = context.thread_primitives();
+            const int thread_id = token.id();
+            auto barrier = [&]()
+            {
+                tp.barrier(token);
+                tp.master(token, [](){ MPI_Barrier(MPI_COMM_WORLD); });
+                tp.barrier(token);
+            };
+
+            for (const auto& backend : cfg.backends)
+            for (const auto& api : cfg.apis)
+            for (const auto& completion : cfg.completions)
+            for (const auto& test : cfg.tests)
+            for (int msg_size : cfg.sizes)
+            {
+                // the api applies to the ghex backend only
+                if (backend == "mpi" && &api != &cfg.apis.front()) continue;
+                const bool avail = (completion == "avail");
+                const int n = num_iterations(cfg.iterations, msg_size);
+                const int n_warmup = num_iterations(cfg.warmup, msg_size);
+                auto measure = [&](auto& ch)
+                {
+                    if (n_warmup > 0) run_test(ch, test, n_warmup, cfg.window, lower, avail);
+                    barrier();
+                    times[thread_id] = run_test(ch, test, n, cfg.window, lower, avail);
+                };
+                if (backend == "mpi")
+                {
+                    mpi_channel ch(peer, thread_id*tag_stride, cfg.window, msg_size);
+                    measure(ch);
+                }
+                else if (api == "future")
+                {
+                    future_channel ch(comm, peer, thread_id*tag_stride, cfg.window, msg_size);
+                    measure(ch);
+                }
+                else
+                {
+                    callback_channel ch(comm, peer, thread_id*tag_stride, cfg.window, msg_size);
+                    measure(ch);
+                }
+                barrier();
+                tp.master(token, [&]()
+                {
+                    // ranks are gathered in order: the lower half comes first
+                    MPI_Gather(times.data(), num_threads, MPI_DOUBLE, all_times.data(), num_threads, MPI_DOUBLE,
+                        0, MPI_COMM_WORLD);
+                    if (rank != 0) return;
+                    result r;
+                    r.test = test;
+                    r.backend = backend;
+                    r.api = (backend == "mpi") ? "request" : api;
+                    r.completion = completion;
+                    r.threads = num_threads;
+                    r.size = msg_size;
+                    r.iterations = n;
+                    evaluate(r, all_times, num_pairs);
+                    results.push_back(r);
+                });
+                tp.barrier(token);
+            }
+        }
+    }
+
+    void write_json(std::ostream& os, const bench::options& opts, int size, const std::vector<result>& results,
+        const std::vector<regression>& regressions, bool compared)
+    {
+        os << "{\n  \"benchmark\": \"transport\",\n  \"transport\": \"" << transport_name << "\",\n  \"options\": {\n";
+        opts.write_json(os, "    ");
+        os << "\n  },\n  \"ranks\": " << size << ",\n  \"pairs\": " << size/2 << ",\n  \"results\": [";
+        for (std::size_t i=0; i<results.size(); ++i)
+        {
+            os << (i ? ",\n    " : "\n    ");
+            results[i].write_json(os);
+        }
+        os << "\n  ]";
+        if (compared)
+        {
+            os << ",\n  \"regressions\": [";
+            for (std::size_t i=0; i<regressions.size(); ++i)
+                os << (i ? ",\n    " : "\n    ") << "{\"key\": \"" << regressions[i].key << "\", \"metric\": \""
+                   << regressions[i].metric << "\", \"baseline\": " << regressions[i].baseline << ", \"value\": "
+                   << regressions[i].value << "}";
+            os << (regressions.empty() ? "]" : "\n  ]");
+        }
+        os << "\n}\n";
+    }
+
+} // namespace transport_suite
+
+int main(int argc, char** argv)
+{
+    int mode;
+#ifdef USE_OPENMP
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &mode);
+    if(mode != MPI_THREAD_MULTIPLE){
+        std::cerr << "MPI_THREAD_MULTIPLE not supported by MPI, aborting\n";
+        std::terminate();
+    }
+#else
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_SINGLE, &mode);
+#endif
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    bench::options opts("Transport microbenchmarks: latency, bandwidth, multi-pair throughput and message rate "
+        "between pairs of ranks (rank r and r+size/2).");
+    opts.add("tests", "latency, bw (unidirectional) and/or bibw (bidirectional)", "latency,bw,bibw")
+        .add("backends", "ghex and/or mpi (raw point to point calls)", "ghex,mpi")
+        .add("apis", "future and/or callback (ghex backend)", "future,callback")
+        .add("completions", "wait (whole window) and/or avail (repost completed slots)", "wait,avail")
+        .add("threads", "threads per rank (more than 1 requires USE_OPENMP)", "1")
+        .add("sizes", "message sizes in bytes", "1,16,256,4096,65536,1048576")
+        .add("iterations", "messages per thread, divided by 10 above 64KiB", "1000")
+        .add("warmup", "untimed messages per thread before each test", "100")
+        .add("window", "messages in flight per thread in the bandwidth tests", "64")
+        .add("output", "output file, - for the standard output", "-")
+        .add("baseline", "JSON output of a previous run to compare with", "")
+        .add("threshold", "relative change of a metric reported as regression", "0.1");
+
+    int result = 0;
+    try
+    {
+        if (!opts.parse(argc, argv))
+        {
+            if (rank == 0) opts.print_help(std::cout, argv[0]);
+        }
+        else
+        {
+            const auto cfg = transport_suite::make_config(opts);
+            if (size < 2 || size%2 != 0) throw std::runtime_error("the number of ranks must be even");
+            std::vector<transport_suite::result> results;
+            for (int t : cfg.threads) transport_suite::run(cfg, t, results);
+            if (rank == 0)
+            {
+                std::vector<transport_suite::regression> regressions;
+                if (!cfg.baseline.empty())
+                    regressions = transport_suite::compare(results, cfg.baseline, cfg.threshold);
+                std::ofstream file;
+                if (cfg.output != "-")
+                {
+                    file.open(cfg.output);
+                    if (!file) throw std::runtime_error("could not open " + cfg.output);
+                }
+                std::ostream& os = (cfg.output != "-") ? file : std::cout;
+                transport_suite::write_json(os, opts, size, results, regressions, !cfg.baseline.empty());
+                for (const auto& r : regressions)
+                    std::cerr << "regression: " << r.key << " " << r.metric << " " << r.baseline << " -> " << r.value
+                              << "\n";
+                if (!regressions.empty()) result = 2;
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        if (rank == 0) std::cerr << "error: " << e.what() << "\n";
+        result = 1;
+    }
+
+    MPI_Finalize();
+    return result;
+}
@@ -0,0 +1,132 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_ALLOCATOR_HUGEPAGE_ALLOCATOR_HPP
+#define INCLUDED_GHEX_ALLOCATOR_HUGEPAGE_ALLOCATOR_HPP
+
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstdint>
+#include <type_traits>
+#include <sys/mman.h>
+
+namespace gridtools {
+    namespace ghex {
+        namespace allocator {
+
+            namespace hugepage {
+
+                /** @brief size of a (default) huge page */
+                static constexpr std::size_t page_size = std::size_t{2} << 20;
+
+                /** @brief allocations of at least this size are backed by huge pages, smaller ones are left to the
+                  * standard allocator in order not to waste most of a huge page */
+                static constexpr std::size_t threshold = page_size/2;
+
+                inline std::size_t round_up(std::size_t n) noexcept
+                {
+                    return (n + page_size - 1u)/page_size*page_size;
+                }
+
+                // false once a MAP_HUGETLB mapping failed (no huge pages reserved): don't try again
+                inline std::atomic<bool>& hugetlb_available() noexcept
+                {
+                    static std::atomic<bool> available{true};
+                    return available;
+                }
+
+                /** @brief map n bytes (a multiple of the huge page size) backed by huge pages: from the reserved
+                  * pool (MAP_HUGETLB) if available, otherwise as huge page aligned anonymous memory advised for
+                  * transparent huge pages. Returns nullptr on failure. */
+                inline void* map(std::size_t n) noexcept
+                {
+#ifdef MAP_HUGETLB
+                    if (hugetlb_available().load(std::memory_order_relaxed))
+                    {
+                        void* ptr = mmap(nullptr, n, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                        if (ptr != MAP_FAILED) return ptr;
+                        hugetlb_available().store(false, std::memory_order_relaxed);
+                    }
+#endif
+                    // over-allocate and trim to a huge page aligned region
+                    void* raw = mmap(nullptr, n + page_size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (raw == MAP_FAILED) return nullptr;
+                    const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(raw);
+                    const std::uintptr_t aligned = (begin + page_size - 1u)/page_size*page_size;
+                    const std::uintptr_t tail = begin + page_size - aligned;
+                    if (aligned > begin) munmap(raw, aligned - begin);
+                    if (tail > 0u) munmap(reinterpret_cast<void*>(aligned + n), tail);
+                    void* ptr = reinterpret_cast<void*>(aligned);
+#ifdef MADV_HUGEPAGE
+                    madvise(ptr, n, MADV_HUGEPAGE);
+#endif
+                    return ptr;
+                }
+
+                inline void unmap(void* ptr, std::size_t n) noexcept
+                {
+                    munmap(ptr, n);
+                }
+
+            } // namespace hugepage
+
+            /** @brief allocator which backs large allocations with huge pages in order to reduce TLB misses during
+              * strided packing and unpacking. Allocations below hugepage::threshold bytes are served by
+              * std::allocator. Memory is obtained directly from the kernel, hence this allocator is meant to be
+              * used underneath a pool.
+              * @tparam T value type */
+            template<typename T>
+            struct hugepage_allocator
+            {
+                using size_type = std::size_t;
+                using value_type = T;
+                using is_always_equal = std::true_type;
+
+                template<typename U>
+                struct rebind
+                {
+                    using other = hugepage_allocator<U>;
+                };
+
+                hugepage_allocator() noexcept {}
+                template<typename U>
+                hugepage_allocator(const hugepage_allocator<U>&) noexcept {}
+
+                /** @brief true if n elements are allocated as a fresh mapping of their own */
+                static bool maps_pages(size_type n) noexcept { return n*sizeof(T) >= hugepage::threshold; }
+
+                T* allocate(size_type n)
+                {
+                    const auto bytes = n*sizeof(T);
+                    if (bytes < hugepage::threshold) return std::allocator<T>{}.allocate(n);
+                    void* ptr = hugepage::map(hugepage::round_up(bytes));
+                    if (!ptr) throw std::bad_alloc();
+                    return static_cast<T*>(ptr);
+                }
+
+                void deallocate(T* ptr, size_type n)
+                {
+                    const auto bytes = n*sizeof(T);
+                    if (bytes < hugepage::threshold) std::allocator<T>{}.deallocate(ptr, n);
+                    else hugepage::unmap(ptr, hugepage::round_up(bytes));
+                }
+
+                friend bool operator==(const hugepage_allocator&, const hugepage_allocator&) { return true; }
+                friend bool operator!=(const hugepage_allocator&, const hugepage_allocator&) { return false; }
+            };
+
+        } // namespace allocator
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_ALLOCATOR_HUGEPAGE_ALLOCATOR_HPP */
@@ -0,0 +1,322 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_ALLOCATOR_NUMA_ALLOCATOR_ADAPTOR_HPP
+#define INCLUDED_GHEX_ALLOCATOR_NUMA_ALLOCATOR_ADAPTOR_HPP
+
+#include <memory>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <type_traits>
+#include <new>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef GHEX_USE_NUMA
+#include <sched.h>
+#include <numa.h>
+#include <numaif.h>
+#endif
+#include "../common/to_address.hpp"
+
+namespace gridtools {
+    namespace ghex {
+        namespace allocator {
+
+            /** @brief placement of freshly allocated memory on the NUMA nodes
+              * - none: left to the operating system (first write to a page, wherever that happens)
+              * - first_touch: the pages are written by the allocating thread, hence placed on its node
+              * - local: the pages are bound to the node of the allocating thread (requires libnuma, otherwise
+              *   first_touch)
+              * - node: the pages are bound to a given node, e.g. the one the network interface is attached to
+              *   (requires libnuma, otherwise first_touch) */
+            enum class numa_policy : int { none, first_touch, local, node };
+
+            struct numa_placement
+            {
+                numa_policy policy = numa_policy::none;
+                int node = 0;
+            };
+
+            inline bool operator==(const numa_placement& a, const numa_placement& b) noexcept
+            {
+                return a.policy == b.policy && (a.policy != numa_policy::node || a.node == b.node);
+            }
+
+            inline bool operator!=(const numa_placement& a, const numa_placement& b) noexcept { return !(a==b); }
+
+            namespace numa {
+
+                /** @brief true if pages can be bound to nodes explicitely */
+                inline bool can_bind() noexcept
+                {
+#ifdef GHEX_USE_NUMA
+                    return numa_available() >= 0;
+#else
+                    return false;
+#endif
+                }
+
+                /** @brief number of configured NUMA nodes (1 without libnuma) */
+                inline int num_nodes() noexcept
+                {
+#ifdef GHEX_USE_NUMA
+                    if (can_bind()) return numa_num_configured_nodes();
+#endif
+                    return 1;
+                }
+
+                /** @brief node of the cpu the calling thread runs on (0 without libnuma) */
+                inline int current_node() noexcept
+                {
+#ifdef GHEX_USE_NUMA
+                    if (can_bind())
+                    {
+                        const int cpu = sched_getcpu();
+                        if (cpu >= 0) return numa_node_of_cpu(cpu);
+                    }
+#endif
+                    return 0;
+                }
+
+                /** @brief node on which the page containing ptr resides, or -1 if unknown */
+                inline int node_of(const void* ptr) noexcept
+                {
+#ifdef GHEX_USE_NUMA
+                    if (can_bind())
+                    {
+                        int node = -1;
+                        void* page = const_cast<void*>(ptr);
+                        if (move_pages(0, 1, &page, nullptr, &node, 0) == 0 && node >= 0) return node;
+                    }
+#else
+                    (void)ptr;
+#endif
+                    return -1;
+                }
+
+                /** @brief true if memory with placement p is bound to a node explicitely */
+                inline bool binds(const numa_placement& p) noexcept
+                {
+                    return can_bind() && (p.policy == numa_policy::local ||
+                        (p.policy == numa_policy::node && p.node >= 0 && p.node < num_nodes()));
+                }
+
+                /** @brief number of bytes mapped for an allocation of n bytes */
+                inline std::size_t mapped_size(std::size_t n) noexcept
+                {
+                    const std::size_t page = sysconf(_SC_PAGESIZE);
+                    return (n + page - 1u)/page*page;
+                }
+
+                /** @brief bind the pages of the memory range [ptr, ptr+n) to the node given by a placement (binds(p)
+                  * must hold) and fault them in by the calling thread. The range must be a mapping of its own which
+                  * was not touched before: pages which are mapped already are not moved. */
+                inline void bind(void* ptr, std::size_t n, const numa_placement& p) noexcept
+                {
+#ifdef GHEX_USE_NUMA
+                    const int node = (p.policy == numa_policy::local) ? current_node() : p.node;
+                    unsigned long mask[1 + 1023/(8*sizeof(unsigned long))] = {};
+                    mask[node/(8*sizeof(unsigned long))] |= 1ul << (node%(8*sizeof(unsigned long)));
+                    mbind(ptr, mapped_size(n), MPOL_BIND, mask, 1024, 0);
+#else
+                    (void)p;
+#endif
+                    std::memset(ptr, 0, n);
+                }
+
+                /** @brief start addresses of the memory mapped by map: memory is released the way it was obtained,
+                  * independently of the placement of the adaptor which releases it */
+                class mapping_registry
+                {
+                private: // members
+                    std::mutex m_mutex;
+                    std::set<const void*> m_mappings;
+
+                public: // static member functions
+                    static mapping_registry& instance()
+                    {
+                        static mapping_registry r;
+                        return r;
+                    }
+
+                public: // member functions
+                    void insert(const void* ptr)
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_mappings.insert(ptr);
+                    }
+
+                    /** @return true if ptr was mapped by map */
+                    bool erase(const void* ptr)
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        return m_mappings.erase(ptr) > 0u;
+                    }
+                };
+
+                /** @brief map n bytes of fresh anonymous memory bound to the node given by a placement (binds(p) must
+                  * hold). Returns nullptr on failure. */
+                inline void* map(std::size_t n, const numa_placement& p)
+                {
+                    void* ptr = mmap(nullptr, mapped_size(n), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                    if (ptr == MAP_FAILED) return nullptr;
+                    mapping_registry::instance().insert(ptr);
+                    bind(ptr, n, p);
+                    return ptr;
+                }
+
+                /** @brief release memory of n bytes if it was obtained from map
+                  * @return false if the memory was not obtained from map (and is left untouched) */
+                inline bool unmap(void* ptr, std::size_t n)
+                {
+                    if (!mapping_registry::instance().erase(ptr)) return false;
+                    munmap(ptr, mapped_size(n));
+                    return true;
+                }
+
+                /** @brief place the freshly allocated memory range [ptr, ptr+n) by first touch: the pages are written
+                  * by the calling thread, hence placed on its node, unless they were mapped before */
+                inline void touch(void* ptr, std::size_t n, const numa_placement& p) noexcept
+                {
+                    if (p.policy == numa_policy::none || n == 0u) return;
+                    std::memset(ptr, 0, n);
+                }
+
+                // true if the allocator returns fresh mappings of its own for n elements (provides
+                // static bool maps_pages(size_type n)), which can be bound directly
+                template<typename Allocator>
+                inline auto maps_pages(const Allocator&, std::size_t n, int) noexcept -> decltype(Allocator::maps_pages(n))
+                {
+                    return Allocator::maps_pages(n);
+                }
+
+                template<typename Allocator>
+                inline bool maps_pages(const Allocator&, std::size_t, long) noexcept { return false; }
+
+            } // namespace numa
+
+            /** @brief allocator adaptor which places fresh memory on NUMA nodes according to a numa_placement. Memory
+              * which is bound to a node (numa::binds) must not share pages with other allocations: it is obtained from
+              * the underlying allocator only if that returns fresh mappings (see hugepage_allocator::maps_pages), and
+              * mapped by the adaptor otherwise. All other memory is obtained from the underlying allocator and placed
+              * by first touch. A default constructed adaptor does not change the
+              * placement. Only fresh allocations are affected: memory recycled by a pool on top of this adaptor keeps
+              * its placement.
+              * @tparam Allocator underlying allocator */
+            template<typename Allocator>
+            struct numa_allocator_adaptor
+            : public Allocator
+            {
+            public: // member types
+
+                using base               = Allocator;
+                using base_traits        = std::allocator_traits<Allocator>;
+                using pointer            = typename base_traits::pointer;
+                using const_pointer      = typename base_traits::const_pointer;
+                using void_pointer       = typename base_traits::void_pointer;
+                using const_void_pointer = typename base_traits::const_void_pointer;
+                using value_type         = typename base::value_type;
+                using size_type          = typename base_traits::size_type;
+                using difference_type    = typename base_traits::difference_type;
+
+                template<typename U>
+                struct rebind
+                {
+                    using other = numa_allocator_adaptor<typename base_traits::template rebind_alloc<U>>;
+                };
+
+            public: // members
+
+                numa_placement m_placement;
+
+            public: // ctors
+
+                template<typename Alloc = Allocator, typename std::enable_if<std::is_default_constructible<Alloc>::value, int>::type=0>
+                numa_allocator_adaptor(numa_placement p = numa_placement{})
+                : base()
+                , m_placement{p}
+                {
+                    static_assert(std::is_same<Alloc, Allocator>::value, "this is not a function template");
+                }
+                numa_allocator_adaptor(numa_placement p, Allocator alloc)
+                : base(alloc)
+                , m_placement{p}
+                {}
+
+                numa_allocator_adaptor(const numa_allocator_adaptor&) = default;
+                numa_allocator_adaptor(numa_allocator_adaptor&&) = default;
+                numa_allocator_adaptor& operator=(const numa_allocator_adaptor&) = default;
+                numa_allocator_adaptor& operator=(numa_allocator_adaptor&&) = default;
+
+                template<typename A>
+                numa_allocator_adaptor(const numa_allocator_adaptor<A>& other)
+                : base( static_cast<const A&>(other) )
+                , m_placement{ other.m_placement }
+                {}
+
+            public: // allocate, deallocate
+
+                pointer allocate(size_type n)
+                {
+                    if (numa::binds(m_placement) && !numa::maps_pages(static_cast<const base&>(*this), n, 0)) return map(n);
+                    return place(base_traits::allocate(*this, n), n);
+                }
+
+                pointer allocate(size_type n, const_void_pointer cvptr)
+                {
+                    if (numa::binds(m_placement) && !numa::maps_pages(static_cast<const base&>(*this), n, 0)) return map(n);
+                    return place(base_traits::allocate(*this, n, cvptr), n);
+                }
+
+                // the memory may stem from an adaptor with another placement (e.g. the allocator of a pool was
+                // replaced): whether it was mapped by an adaptor is looked up, not derived from m_placement
+                void deallocate(pointer ptr, size_type n)
+                {
+                    if (!numa::unmap(::gridtools::ghex::to_address(ptr), n*sizeof(value_type)))
+                        base_traits::deallocate(*this, ptr, n);
+                }
+
+            private: // implementation
+
+                pointer map(size_type n)
+                {
+                    void* ptr = numa::map(n*sizeof(value_type), m_placement);
+                    if (!ptr) throw std::bad_alloc();
+                    return static_cast<value_type*>(ptr);
+                }
+
+                pointer place(pointer ptr, size_type n)
+                {
+                    if (numa::binds(m_placement))
+                        numa::bind(::gridtools::ghex::to_address(ptr), n*sizeof(value_type), m_placement);
+                    else
+                        numa::touch(::gridtools::ghex::to_address(ptr), n*sizeof(value_type), m_placement);
+                    return ptr;
+                }
+
+            public: // comparison
+
+                friend bool operator==(const numa_allocator_adaptor& a, const numa_allocator_adaptor& b)
+                {
+                    return static_cast<const base&>(a) == static_cast<const base&>(b);
+                }
+
+                friend bool operator!=(const numa_allocator_adaptor& a, const numa_allocator_adaptor& b)
+                {
+                    return !(a == b);
+                }
+            };
+
+        } // namespace allocator
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_ALLOCATOR_NUMA_ALLOCATOR_ADAPTOR_HPP */
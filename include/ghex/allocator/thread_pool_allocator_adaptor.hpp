@@ -0,0 +1,414 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_ALLOCATOR_THREAD_POOL_ALLOCATOR_ADAPTOR_HPP
+#define INCLUDED_GHEX_ALLOCATOR_THREAD_POOL_ALLOCATOR_ADAPTOR_HPP
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include "../common/to_address.hpp"
+
+namespace gridtools {
+    namespace ghex {
+        namespace allocator {
+
+            /** @brief A memory pool for multi-threaded use. Every thread allocates from its own free lists (one per
+              * power-of-two size class) without synchronization. A block remembers the thread which allocated it:
+              * when it is deallocated by that thread it goes back to the thread's free list, when it is deallocated
+              * by another thread (e.g. in a completion callback) it is pushed onto a lock-free queue of the owner,
+              * which the owner drains once its free list runs empty. Free lists which grow beyond a high watermark
+              * (a thread keeps freeing more than it allocates) hand half of their blocks over to a shared depot.
+              * A starving thread refills from the depot, then takes over the queues of the other threads (whose
+              * owners may have stopped allocating), before falling back to the underlying allocator.
+              *
+              * All blocks must be returned before the pool is destroyed. The underlying allocator must be
+              * thread-safe.
+              * @tparam Allocator byte allocator */
+            template<typename Allocator>
+            class thread_pool_impl
+            {
+            public: // member types
+                using byte               = unsigned char;
+                using alloc_t            = typename std::allocator_traits<Allocator>::template rebind_alloc<byte>;
+                using traits             = std::allocator_traits<alloc_t>;
+                using pointer            = typename traits::pointer;
+                using const_void_pointer = typename traits::const_void_pointer;
+                using size_type          = typename traits::size_type;
+                using pointer_traits     = std::pointer_traits<pointer>;
+
+                static_assert(std::is_same<alloc_t, Allocator>::value, "must be a byte allocator");
+
+                /** smallest block size and number of size classes: block sizes range from 64 B to 32 MiB */
+                static constexpr size_type min_block_size = 64u;
+                static constexpr int num_classes = 20;
+                /** blocks kept per size class and thread before half of them are moved to the depot */
+                static constexpr size_type high_watermark = 256u;
+                static constexpr size_type header_size = 64u;
+
+            private: // implementation types
+                struct local_pool;
+
+                // precedes every block in a slot of header_size bytes, preserving the alignment of the allocation
+                struct header
+                {
+                    local_pool* m_owner;
+                    header* m_next;
+                    size_type m_size;
+                    int m_class;
+                };
+
+                static_assert(sizeof(header) <= header_size, "header too large");
+
+                struct local_pool
+                {
+                    header* m_free[num_classes] = {};
+                    size_type m_count[num_classes] = {};
+                    char m_padding[64];  // keeps the queue off the cache lines written by the owner
+                    std::atomic<header*> m_remote{nullptr};
+                };
+
+                struct depot
+                {
+                    std::mutex m_mutex;
+                    std::vector<header*> m_blocks;
+                };
+
+                // per-thread lookup of the local pool of a thread pool (by unique pool id)
+                struct thread_entry
+                {
+                    std::uint64_t m_id;
+                    local_pool* m_local;
+                };
+
+            private: // members
+                alloc_t m_alloc;
+                std::uint64_t m_id;
+                std::mutex m_mutex;
+                std::vector<std::unique_ptr<local_pool>> m_locals;
+                depot m_depot[num_classes];
+                std::atomic<size_type> m_num_allocations{0u};
+
+            public: // ctors
+                thread_pool_impl(Allocator alloc)
+                : m_alloc{alloc}
+                , m_id{next_id()}
+                {}
+
+                thread_pool_impl(const thread_pool_impl&) = delete;
+                thread_pool_impl& operator=(const thread_pool_impl&) = delete;
+
+                ~thread_pool_impl()
+                {
+                    for (auto& l : m_locals)
+                    {
+                        drain_remote(*l);
+                        for (int c=0; c<num_classes; ++c)
+                            for (header* h = l->m_free[c]; h; )
+                            {
+                                header* next = h->m_next;
+                                release(h);
+                                h = next;
+                            }
+                    }
+                    for (auto& d : m_depot)
+                        for (auto h : d.m_blocks)
+                            release(h);
+                }
+
+            public: // member functions
+                pointer allocate(size_type n, const_void_pointer cvptr = nullptr)
+                {
+                    const int c = size_class(n);
+                    header* h;
+                    if (c == num_classes)
+                    {
+                        // too large to be pooled
+                        h = acquire(c, n, cvptr);
+                        h->m_owner = nullptr;
+                    }
+                    else
+                    {
+                        local_pool& l = local();
+                        if (!l.m_free[c]) drain_remote(l);
+                        if (!l.m_free[c]) refill(l, c);
+                        if ((h = l.m_free[c]))
+                        {
+                            l.m_free[c] = h->m_next;
+                            --l.m_count[c];
+                        }
+                        else
+                            h = acquire(c, n, cvptr);
+                        h->m_owner = &l;
+                    }
+                    return pointer_traits::pointer_to(*(reinterpret_cast<byte*>(h)+header_size));
+                }
+
+                void deallocate(pointer ptr, size_type)
+                {
+                    header* h = reinterpret_cast<header*>(::gridtools::ghex::to_address(ptr)-header_size);
+                    local_pool* owner = h->m_owner;
+                    if (!owner)
+                    {
+                        release(h);
+                        return;
+                    }
+                    if (owner == &local())
+                        push_local(*owner, h);
+                    else
+                    {
+                        // lock-free push onto the owner's queue; the owner takes the whole list at once
+                        header* head = owner->m_remote.load(std::memory_order_relaxed);
+                        do { h->m_next = head; }
+                        while (!owner->m_remote.compare_exchange_weak(head, h, std::memory_order_release,
+                            std::memory_order_relaxed));
+                    }
+                }
+
+                /** @brief number of allocations obtained from the underlying allocator */
+                size_type num_allocations() const noexcept { return m_num_allocations.load(); }
+
+            private: // implementation
+                static std::uint64_t next_id()
+                {
+                    static std::atomic<std::uint64_t> id{0u};
+                    return ++id;
+                }
+
+                static int size_class(size_type n) noexcept
+                {
+                    int c = 0;
+                    for (size_type s = min_block_size; s < n && c < num_classes; s <<= 1) ++c;
+                    return c;
+                }
+
+                static size_type block_size(int c) noexcept { return min_block_size << c; }
+
+                local_pool& local()
+                {
+                    static thread_local std::vector<thread_entry> entries;
+                    for (const auto& e : entries)
+                        if (e.m_id == m_id) return *e.m_local;
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_locals.push_back(std::make_unique<local_pool>());
+                    entries.push_back(thread_entry{m_id, m_locals.back().get()});
+                    return *m_locals.back();
+                }
+
+                header* acquire(int c, size_type n, const_void_pointer cvptr)
+                {
+                    const size_type bytes = header_size + (c == num_classes ? n : block_size(c));
+                    ++m_num_allocations;
+                    header* h = reinterpret_cast<header*>(
+                        ::gridtools::ghex::to_address(traits::allocate(m_alloc, bytes, cvptr)));
+                    h->m_class = c;
+                    h->m_size = bytes;
+                    return h;
+                }
+
+                void release(header* h)
+                {
+                    traits::deallocate(m_alloc, pointer_traits::pointer_to(*reinterpret_cast<byte*>(h)), h->m_size);
+                }
+
+                void push_local(local_pool& l, header* h)
+                {
+                    const int c = h->m_class;
+                    h->m_next = l.m_free[c];
+                    l.m_free[c] = h;
+                    if (++l.m_count[c] > high_watermark)
+                    {
+                        // rebalance: hand over half of the blocks
+                        std::lock_guard<std::mutex> lock(m_depot[c].m_mutex);
+                        for (size_type i = 0; i < high_watermark/2; ++i)
+                        {
+                            header* b = l.m_free[c];
+                            l.m_free[c] = b->m_next;
+                            m_depot[c].m_blocks.push_back(b);
+                        }
+                        l.m_count[c] -= high_watermark/2;
+                    }
+                }
+
+                void drain_remote(local_pool& l)
+                {
+                    header* h = l.m_remote.exchange(nullptr, std::memory_order_acquire);
+                    while (h)
+                    {
+                        header* next = h->m_next;
+                        h->m_next = l.m_free[h->m_class];
+                        l.m_free[h->m_class] = h;
+                        ++l.m_count[h->m_class];
+                        h = next;
+                    }
+                }
+
+                void refill(local_pool& l, int c)
+                {
+                    {
+                        auto& d = m_depot[c];
+                        std::lock_guard<std::mutex> lock(d.m_mutex);
+                        for (size_type i = 0; i < high_watermark/4 && !d.m_blocks.empty(); ++i)
+                        {
+                            header* h = d.m_blocks.back();
+                            d.m_blocks.pop_back();
+                            h->m_next = l.m_free[c];
+                            l.m_free[c] = h;
+                            ++l.m_count[c];
+                        }
+                    }
+                    if (l.m_free[c]) return;
+                    // take over the blocks returned to other threads, which may have stopped allocating
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    for (auto& other : m_locals)
+                    {
+                        if (other.get() == &l) continue;
+                        header* h = other->m_remote.exchange(nullptr, std::memory_order_acquire);
+                        while (h)
+                        {
+                            header* next = h->m_next;
+                            push_local(l, h);
+                            h = next;
+                        }
+                        if (l.m_free[c]) return;
+                    }
+                }
+            };
+
+            /** @brief allocator which draws from a thread_pool_impl. Copies of the allocator may be used from any
+              * thread: allocations are served from the calling thread's free lists and deallocations return the
+              * memory to the thread which allocated it. */
+            template<typename Allocator>
+            struct thread_pool_allocator_adaptor
+            : public Allocator
+            {
+            public: // member types
+
+                using base               = Allocator;
+                using base_traits        = std::allocator_traits<Allocator>;
+                using pointer            = typename base_traits::pointer;
+                using const_pointer      = typename base_traits::const_pointer;
+                using void_pointer       = typename base_traits::void_pointer;
+                using const_void_pointer = typename base_traits::const_void_pointer;
+                using value_type         = typename base::value_type;
+                using size_type          = typename base_traits::size_type;
+                using difference_type    = typename base_traits::difference_type;
+                using pointer_traits     = std::pointer_traits<pointer>;
+
+                using byte               = unsigned char;
+                using byte_base          = typename base_traits::template rebind_alloc<byte>;
+                using byte_base_traits   = std::allocator_traits<byte_base>;
+                using byte_pointer_traits     = std::pointer_traits<typename byte_base_traits::pointer>;
+
+                template<typename U>
+                struct rebind
+                {
+                    using other = thread_pool_allocator_adaptor<typename base_traits::template rebind_alloc<U>>;
+                };
+
+            public: // members
+
+                thread_pool_impl<byte_base>* m_pool;
+
+            public: // ctors
+
+                template<typename Alloc = Allocator, typename std::enable_if<std::is_default_constructible<Alloc>::value, int>::type=0>
+                thread_pool_allocator_adaptor(thread_pool_impl<byte_base>* p)
+                : base()
+                , m_pool{ p }
+                {
+                    static_assert(std::is_same<Alloc, Allocator>::value, "this is not a function template");
+                }
+                thread_pool_allocator_adaptor(thread_pool_impl<byte_base>* p, Allocator alloc)
+                : base(alloc)
+                , m_pool{ p }
+                {}
+
+                thread_pool_allocator_adaptor(const thread_pool_allocator_adaptor&) = default;
+                thread_pool_allocator_adaptor(thread_pool_allocator_adaptor&&) = default;
+                thread_pool_allocator_adaptor& operator=(const thread_pool_allocator_adaptor&) = default;
+                thread_pool_allocator_adaptor& operator=(thread_pool_allocator_adaptor&&) = default;
+
+                template<typename A>
+                thread_pool_allocator_adaptor(const thread_pool_allocator_adaptor<A>& other)
+                : base( static_cast<const A&>(other) )
+                , m_pool{ other.m_pool }
+                {}
+
+                void swap(thread_pool_allocator_adaptor& other)
+                {
+                    std::swap(m_pool, other.m_pool);
+                    std::swap(static_cast<base&>(*this), static_cast<base&>(other));
+                }
+
+            public: // allocate, deallocate
+
+                pointer allocate(size_type n, const_void_pointer cvptr = nullptr)
+                {
+                    return
+                    pointer_traits::pointer_to(
+                        *reinterpret_cast<value_type*>(
+                            ::gridtools::ghex::to_address(
+                                m_pool->allocate(n*sizeof(value_type), cvptr)
+                            )
+                        )
+                    );
+                }
+
+                void deallocate(pointer ptr, size_type n)
+                {
+                    auto bptr = byte_pointer_traits::pointer_to(
+                        *reinterpret_cast<byte*>(
+                            ::gridtools::ghex::to_address(ptr)
+                        )
+                    );
+                    m_pool->deallocate(bptr, n*sizeof(value_type));
+                }
+
+            public: // container hooks
+
+                using propagate_on_container_copy_assignment = std::true_type;
+                using propagate_on_container_move_assignment = std::true_type;
+                using propagate_on_container_swap            = std::true_type;
+
+                thread_pool_allocator_adaptor select_on_container_copy_construction() const
+                {
+                    return *this;
+                }
+
+            public: // comparison
+
+                using is_always_equal = std::false_type;
+
+                friend bool operator==(const thread_pool_allocator_adaptor& a, const thread_pool_allocator_adaptor& b)
+                {
+                    return a.m_pool == b.m_pool;
+                }
+
+                friend bool operator!=(const thread_pool_allocator_adaptor& a, const thread_pool_allocator_adaptor& b)
+                {
+                    return a.m_pool != b.m_pool;
+                }
+
+            public: // other member functions
+
+                inline size_type max_size() const noexcept
+                {
+                    return base_traits::max_size(*this);
+                }
+            };
+
+        } // namespace allocator
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_ALLOCATOR_THREAD_POOL_ALLOCATOR_ADAPTOR_HPP */
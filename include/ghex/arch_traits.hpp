@@ -13,6 +13,8 @@
 
 #include "./allocator/pool_allocator_adaptor.hpp"
 #include "./allocator/aligned_allocator_adaptor.hpp"
+#include "./allocator/numa_allocator_adaptor.hpp"
+#include "./allocator/hugepage_allocator.hpp"
 #include "./allocator/cuda_allocator.hpp"
 #include "./transport_layer/message_buffer.hpp"
 #include "./arch_list.hpp"
@@ -29,7 +31,11 @@ namespace gridtools {
             static constexpr const char* name = "CPU";
 
             using device_id_type          = int;
-            using basic_allocator_type    = std::allocator<unsigned char>;
+#ifdef GHEX_USE_HUGE_PAGES
+            using basic_allocator_type    = allocator::numa_allocator_adaptor<allocator::hugepage_allocator<unsigned char>>;
+#else
+            using basic_allocator_type    = allocator::numa_allocator_adaptor<std::allocator<unsigned char>>;
+#endif
             using pool_type               = allocator::pool<basic_allocator_type>;
             using pool_allocator_type     = typename pool_type::allocator_type;
             
@@ -39,6 +45,12 @@ namespace gridtools {
 
             static device_id_type default_id() { return 0; }
 
+            /** @brief allocator for the memory pools, placing fresh memory according to the numa placement */
+            static basic_allocator_type make_basic_allocator(const allocator::numa_placement& placement)
+            {
+                return basic_allocator_type{placement};
+            }
+
             static message_type make_message(pool_type& pool, device_id_type index = default_id()) 
             { 
                 static_assert(std::is_same<decltype(index),device_id_type>::value, "trick to prevent warnings");
@@ -64,6 +76,12 @@ namespace gridtools {
 
             static device_id_type default_id() { return 0; }
 
+            // device memory is not placed on host NUMA nodes
+            static basic_allocator_type make_basic_allocator(const allocator::numa_placement&)
+            {
+                return {};
+            }
+
             static message_type make_message(pool_type& pool, device_id_type index = default_id()) 
             { 
                 static_assert(std::is_same<decltype(index),device_id_type>::value, "trick to prevent warnings");
@@ -13,6 +13,7 @@
 
 #include <vector>
 #include "./arch_traits.hpp"
+#include "./common/compression.hpp"
 
 namespace gridtools {
 
@@ -28,6 +29,19 @@ namespace gridtools {
         template<typename Pattern, typename Arch, typename Field>
         struct buffer_info;
 
+        namespace detail {
+            template<typename... Ts>
+            struct make_void { using type = void; };
+
+            /** @brief value type in the serialized buffers: Field::wire_type if present, Field::value_type otherwise */
+            template<typename Field, typename = void>
+            struct field_wire_type { using type = typename Field::value_type; };
+
+            template<typename Field>
+            struct field_wire_type<Field, typename make_void<typename Field::wire_type>::type>
+            { using type = typename Field::wire_type; };
+        } // namespace detail
+
         /** @brief ties together field, pattern and device
          * @tparam Transport message transport protocol
          * @tparam GridType grid tag type
@@ -44,13 +58,14 @@ namespace gridtools {
             using field_type               = Field;
             using device_id_type           = typename arch_traits<arch_type>::device_id_type;
             using value_type               = typename field_type::value_type; 
+            using wire_type                = typename detail::field_wire_type<field_type>::type;
        
         private: // friend class
             friend class pattern<Transport,GridType,DomainIdType>;
 
         private: // private ctor
             buffer_info(const pattern_type& p, field_type& field, device_id_type id) noexcept
-            :   m_p{&p}, m_field{&field}, m_id{id} { }
+            :   m_p{&p}, m_field{&field}, m_id{id}, m_compression{compression::none} { }
 
         public: // copy and move ctors
             buffer_info(const buffer_info&) noexcept = default;
@@ -61,11 +76,24 @@ namespace gridtools {
             const pattern_type& get_pattern() const noexcept { return *m_p; }
             const pattern_container_type& get_pattern_container() const noexcept { return m_p->container(); }
             field_type& get_field() noexcept { return *m_field; }
+            compression get_compression() const noexcept { return m_compression; }
+
+            /** @brief request compression of the buffers this field is serialized into (see
+              * communication_object::set_compression). All ranks must request the same codec for this field.
+              * @param codec compression codec
+              * @return copy of this buffer_info with compression enabled */
+            buffer_info compressed(compression codec = compression::shuffle_rle) const noexcept
+            {
+                buffer_info bi(*this);
+                bi.m_compression = codec;
+                return bi;
+            }
 
         private: // members
             const pattern_type* m_p;
             field_type* m_field;
             device_id_type m_id;
+            compression m_compression;
         };
 
     } // namespace ghex
@@ -138,7 +138,7 @@ namespace gridtools {
           * @param acc accumulator local to each rank
           * @param comm MPI communicator
           * @return combined allocator incorporating all samples */
-        accumulator reduce(const accumulator& acc, MPI_Comm comm)
+        inline accumulator reduce(const accumulator& acc, MPI_Comm comm)
         {
             int rank, size;
             MPI_Comm_rank(comm,&rank);
@@ -1,46 +1,136 @@
-/* 
+/*
  * GridTools
- * 
+ *
  * Copyright (c) 2014-2020, ETH Zurich
  * All rights reserved.
- * 
+ *
  * Please, refer to the LICENSE file in the root directory.
  * SPDX-License-Identifier: BSD-3-Clause
- * 
+ *
  */
 #ifndef INCLUDED_GHEX_COMMON_AWAIT_FUTURES_HPP
 #define INCLUDED_GHEX_COMMON_AWAIT_FUTURES_HPP
 
+#include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace gridtools {
 
     namespace ghex {
-        
-        /** @brief wait for all futures in a range to finish and call 
-          * a continuation with the future's value as argument. */
-        template<typename FutureRange, typename Continuation>
-        void await_futures(FutureRange& range, Continuation&& cont)
-        {
-            int size = range.size();
-            // make an index list (iota)
-            std::vector<int> index_list(size);
-            for (int i = 0; i < size; ++i)
-                index_list[i] = i;
-            // loop until all futures are ready
-            while(size>0)
+
+        /** @brief how a thread waits for a set of futures.
+          * - spin: poll all futures in a tight loop (lowest latency, occupies a core)
+          * - backoff: poll, and pause for an exponentially growing number of cycles after unsuccessful sweeps
+          * - yield: poll, and yield the thread after unsuccessful sweeps
+          * - waitany: block in MPI_Waitany until one operation completes
+          * - waitsome: block in MPI_Waitsome until at least one operation completes
+          * The blocking strategies apply to futures of transports which specialize blocking_await (see
+          * transport_layer/mpi/await_futures.hpp); other futures are polled with yield. */
+        enum class wait_strategy : int { spin, backoff, yield, waitany, waitsome };
+
+        namespace detail {
+
+            /** @brief hint to the processor that the thread is busy-waiting */
+            inline void cpu_relax() noexcept
+            {
+#if defined(__x86_64__) || defined(__i386__)
+                __builtin_ia32_pause();
+#elif defined(__aarch64__)
+                asm volatile("yield" ::: "memory");
+#endif
+            }
+
+            /** @brief action taken after a sweep over the futures which found none of them ready */
+            class idle_policy
+            {
+            private:
+                static constexpr int max_pause = 1024;
+                wait_strategy m_strategy;
+                int m_pause = 1;
+
+            public:
+                idle_policy(wait_strategy ws) noexcept : m_strategy{ws} {}
+
+                void progressed() noexcept { m_pause = 1; }
+
+                void idle() noexcept
+                {
+                    switch (m_strategy)
+                    {
+                        case wait_strategy::spin:
+                            break;
+                        case wait_strategy::backoff:
+                            for (int i = 0; i < m_pause; ++i) cpu_relax();
+                            if (m_pause < max_pause) m_pause *= 2;
+                            else std::this_thread::yield();
+                            break;
+                        default:
+                            std::this_thread::yield();
+                    }
+                }
+            };
+
+            // poll all futures until they are ready
+            template<typename FutureRange, typename Continuation>
+            void await_futures_poll(FutureRange& range, Continuation&& cont, wait_strategy ws)
             {
-                for (int j = 0; j < size; ++j)
+                int size = range.size();
+                // make an index list (iota)
+                std::vector<int> index_list(size);
+                for (int i = 0; i < size; ++i)
+                    index_list[i] = i;
+                idle_policy policy(ws);
+                // loop until all futures are ready
+                while(size>0)
                 {
-                    const auto k = index_list[j];
-                    if (range[k].test())
+                    const int old_size = size;
+                    for (int j = 0; j < size; ++j)
                     {
-                        if (j < --size)
-                            index_list[j--] = index_list[size];
-                        cont(range[k].get());
+                        const auto k = index_list[j];
+                        if (range[k].test())
+                        {
+                            if (j < --size)
+                                index_list[j--] = index_list[size];
+                            cont(range[k].get());
+                        }
                     }
+                    if (size < old_size) policy.progressed();
+                    else if (size > 0) policy.idle();
                 }
             }
+
+            /** @brief blocking wait for a range of futures, specialized by transports which can block until at least
+              * one of several operations completes. Specializations provide
+              * template<typename FutureRange, typename Continuation>
+              * static void await(FutureRange& range, Continuation&& cont, wait_strategy ws); */
+            template<typename Future, typename = void>
+            struct blocking_await
+            {
+                template<typename FutureRange, typename Continuation>
+                static void await(FutureRange& range, Continuation&& cont, wait_strategy)
+                {
+                    await_futures_poll(range, std::forward<Continuation>(cont), wait_strategy::yield);
+                }
+            };
+
+        } // namespace detail
+
+        /** @brief wait for all futures in a range to finish and call
+          * a continuation with the future's value as argument.
+          * @param range range of futures
+          * @param cont continuation, called once per future in the order of completion
+          * @param ws wait strategy, spin by default */
+        template<typename FutureRange, typename Continuation>
+        void await_futures(FutureRange& range, Continuation&& cont, wait_strategy ws = wait_strategy::spin)
+        {
+            using future_type = std::remove_reference_t<decltype(range[0])>;
+            if (range.size() == 0) return;
+            if (ws == wait_strategy::waitany || ws == wait_strategy::waitsome)
+                detail::blocking_await<future_type>::await(range, std::forward<Continuation>(cont), ws);
+            else
+                detail::await_futures_poll(range, std::forward<Continuation>(cont), ws);
         }
 
     } // namespace ghex
@@ -48,4 +138,3 @@ namespace gridtools {
 } // namespace gridtools
 
 #endif // INCLUDED_GHEX_COMMON_AWAIT_FUTURES_HPP
-
@@ -0,0 +1,60 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_COMMON_BFLOAT16_HPP
+#define INCLUDED_GHEX_COMMON_BFLOAT16_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <gridtools/common/host_device.hpp>
+
+namespace gridtools {
+    namespace ghex {
+
+        /** @brief minimal 16-bit brain floating point storage type (8 exponent bits, 7 mantissa bits). It is only
+          * meant as a compact wire format: conversion from float rounds to nearest even, arithmetic is done after
+          * conversion back to float. */
+        struct bfloat16
+        {
+            std::uint16_t bits;
+
+            bfloat16() noexcept = default;
+
+            GT_FUNCTION
+            bfloat16(float f) noexcept : bits(from_float(f)) {}
+
+            GT_FUNCTION
+            operator float() const noexcept
+            {
+                const std::uint32_t u = static_cast<std::uint32_t>(bits) << 16;
+                float f;
+                std::memcpy(&f, &u, sizeof(float));
+                return f;
+            }
+
+        private:
+            GT_FUNCTION
+            static std::uint16_t from_float(float f) noexcept
+            {
+                std::uint32_t u;
+                std::memcpy(&u, &f, sizeof(float));
+                // keep NaNs quiet (and NaN) after truncation
+                if ((u & 0x7fffffffu) > 0x7f800000u)
+                    return static_cast<std::uint16_t>((u >> 16) | 0x0040u);
+                // round to nearest even
+                u += 0x7fffu + ((u >> 16) & 1u);
+                return static_cast<std::uint16_t>(u >> 16);
+            }
+        };
+
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_COMMON_BFLOAT16_HPP */
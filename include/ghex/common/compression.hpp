@@ -0,0 +1,201 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_COMMON_COMPRESSION_HPP
+#define INCLUDED_GHEX_COMMON_COMPRESSION_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <stdexcept>
+
+namespace gridtools {
+    namespace ghex {
+
+        /** @brief built-in lossless codecs for serialized halo buffers:
+          * - none: buffers are sent as they are
+          * - shuffle_rle: bytes are grouped by their position within a word (byte shuffle) and run-length encoded
+          * - xor_delta_rle: bytes are xor'ed with the buffer of the previous exchange before shuffle_rle; both ends
+          *   keep a copy of the last transferred buffer */
+        enum class compression { none, shuffle_rle, xor_delta_rle };
+
+        /** @brief accumulated number of bytes before and after compression */
+        struct compression_statistics
+        {
+            std::size_t raw_bytes = 0u;
+            std::size_t sent_bytes = 0u;
+
+            double ratio() const noexcept { return sent_bytes ? static_cast<double>(raw_bytes)/sent_bytes : 1.0; }
+        };
+
+        namespace detail {
+
+            /** @brief header preceding every compressed message */
+            struct compression_header
+            {
+                std::uint32_t codec;     // codec applied to the payload (none if compression did not pay off)
+                std::uint32_t word_size; // shuffle width in bytes
+                std::uint64_t size;      // uncompressed size in bytes
+            };
+
+            /** @brief number of bytes a compressed message of a buffer with n bytes may occupy */
+            inline std::size_t compressed_capacity(std::size_t n) noexcept { return sizeof(compression_header) + n; }
+
+            /** @brief group byte k of each word together, optionally xor'ed with a reference buffer. Trailing bytes
+              * which do not form a complete word are copied as they are. */
+            inline void shuffle(const unsigned char* src, const unsigned char* ref, std::size_t n, std::size_t w,
+                unsigned char* dst) noexcept
+            {
+                const std::size_t nw = n/w;
+                for (std::size_t i=0; i<nw; ++i)
+                    for (std::size_t k=0; k<w; ++k)
+                        dst[k*nw+i] = ref ? src[i*w+k]^ref[i*w+k] : src[i*w+k];
+                for (std::size_t i=nw*w; i<n; ++i)
+                    dst[i] = ref ? src[i]^ref[i] : src[i];
+            }
+
+            /** @brief inverse of shuffle */
+            inline void unshuffle(const unsigned char* src, const unsigned char* ref, std::size_t n, std::size_t w,
+                unsigned char* dst) noexcept
+            {
+                const std::size_t nw = n/w;
+                for (std::size_t k=0; k<w; ++k)
+                    for (std::size_t i=0; i<nw; ++i)
+                        dst[i*w+k] = ref ? src[k*nw+i]^ref[i*w+k] : src[k*nw+i];
+                for (std::size_t i=nw*w; i<n; ++i)
+                    dst[i] = ref ? src[i]^ref[i] : src[i];
+            }
+
+            /** @brief run-length encoding: a control byte c < 128 is followed by c+1 literal bytes, a control byte
+              * c >= 128 is followed by one byte which is repeated c-125 times.
+              * @return number of bytes written or 0 if the result would not fit into capacity bytes */
+            inline std::size_t rle_encode(const unsigned char* src, std::size_t n, unsigned char* dst,
+                std::size_t capacity) noexcept
+            {
+                std::size_t i = 0, j = 0;
+                while (i < n)
+                {
+                    // length of the run starting at i
+                    std::size_t r = 1;
+                    while (i+r < n && r < 130 && src[i+r] == src[i]) ++r;
+                    if (r >= 3)
+                    {
+                        if (j+2 > capacity) return 0;
+                        dst[j++] = static_cast<unsigned char>(125+r);
+                        dst[j++] = src[i];
+                        i += r;
+                        continue;
+                    }
+                    // literal: extend until the next run of at least 3 bytes
+                    std::size_t l = r;
+                    while (i+l < n && l < 128 &&
+                           !(i+l+2 < n && src[i+l] == src[i+l+1] && src[i+l] == src[i+l+2])) ++l;
+                    if (j+1+l > capacity) return 0;
+                    dst[j++] = static_cast<unsigned char>(l-1);
+                    std::memcpy(dst+j, src+i, l);
+                    j += l;
+                    i += l;
+                }
+                return j;
+            }
+
+            /** @brief inverse of rle_encode, decodes exactly n bytes */
+            inline void rle_decode(const unsigned char* src, unsigned char* dst, std::size_t n) noexcept
+            {
+                std::size_t i = 0, j = 0;
+                while (j < n)
+                {
+                    const unsigned char c = src[i++];
+                    if (c < 128)
+                    {
+                        std::memcpy(dst+j, src+i, c+1u);
+                        i += c+1u;
+                        j += c+1u;
+                    }
+                    else
+                    {
+                        std::memset(dst+j, src[i++], c-125u);
+                        j += c-125u;
+                    }
+                }
+            }
+
+            /** @brief compress n bytes from src into dst, which must hold at least compressed_capacity(n) bytes.
+              * The payload is sent uncompressed if the codec does not reduce its size.
+              * @param codec codec
+              * @param src serialized buffer
+              * @param n size of the serialized buffer in bytes
+              * @param word_size shuffle width in bytes
+              * @param history last transferred buffer (only used by xor_delta_rle, updated on return)
+              * @param scratch temporary storage
+              * @param dst compressed message
+              * @return size of the compressed message in bytes */
+            inline std::size_t compress(compression codec, const unsigned char* src, std::size_t n,
+                std::size_t word_size, std::vector<unsigned char>& history, std::vector<unsigned char>& scratch,
+                unsigned char* dst)
+            {
+                const bool delta = (codec == compression::xor_delta_rle);
+                // the history is restarted whenever the buffer size changes (identically on both ends)
+                if (delta && history.size() != n) history.assign(n, 0u);
+                if (word_size == 0u) word_size = 1u;
+                scratch.resize(n);
+                shuffle(src, delta ? history.data() : nullptr, n, word_size, scratch.data());
+                std::size_t payload = rle_encode(scratch.data(), n, dst+sizeof(compression_header), n);
+                if (payload == 0u && n > 0u)
+                {
+                    codec = compression::none;
+                    std::memcpy(dst+sizeof(compression_header), src, n);
+                    payload = n;
+                }
+                if (delta) std::memcpy(history.data(), src, n);
+                const compression_header h{static_cast<std::uint32_t>(codec), static_cast<std::uint32_t>(word_size),
+                    static_cast<std::uint64_t>(n)};
+                std::memcpy(dst, &h, sizeof(compression_header));
+                return sizeof(compression_header) + payload;
+            }
+
+            /** @brief decompress a message produced by compress into n bytes at dst
+              * @param codec codec configured for this buffer (must match the sending end)
+              * @param src compressed message
+              * @param dst serialized buffer
+              * @param n size of the serialized buffer in bytes
+              * @param history last transferred buffer (only used by xor_delta_rle, updated on return)
+              * @param scratch temporary storage */
+            inline void decompress(compression codec, const unsigned char* src, unsigned char* dst, std::size_t n,
+                std::vector<unsigned char>& history, std::vector<unsigned char>& scratch)
+            {
+                compression_header h;
+                std::memcpy(&h, src, sizeof(compression_header));
+                if (h.size != n)
+                    throw std::runtime_error("compressed message does not match the receive buffer");
+                const bool delta = (codec == compression::xor_delta_rle);
+                if (delta && history.size() != n) history.assign(n, 0u);
+                src += sizeof(compression_header);
+                if (static_cast<compression>(h.codec) == compression::none)
+                {
+                    std::memcpy(dst, src, n);
+                }
+                else
+                {
+                    scratch.resize(n);
+                    rle_decode(src, scratch.data(), n);
+                    unshuffle(scratch.data(),
+                        static_cast<compression>(h.codec) == compression::xor_delta_rle ? history.data() : nullptr,
+                        n, h.word_size, dst);
+                }
+                if (delta) std::memcpy(history.data(), dst, n);
+            }
+
+        } // namespace detail
+
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_COMMON_COMPRESSION_HPP */
@@ -0,0 +1,301 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_COMMON_EXCHANGE_PROFILE_HPP
+#define INCLUDED_GHEX_COMMON_EXCHANGE_PROFILE_HPP
+
+#include <array>
+#include <map>
+#include <ostream>
+#include <vector>
+#include <mpi.h>
+#include "./accumulator.hpp"
+#include "./trace.hpp"
+
+namespace gridtools {
+
+    namespace ghex {
+
+        /** @brief phases of a halo exchange
+          * - plan: reserving the exchange state, sizing buffers and computing the chunk/compression layout
+          * - post_recvs: posting the receives
+          * - pack: serializing (and compressing) the send buffers
+          * - send: posting the sends
+          * - wait: waiting for receives and sends to complete
+          * - unpack: deserializing (and decompressing) the received buffers */
+        enum class exchange_phase : int { plan, post_recvs, pack, send, wait, unpack };
+
+        static constexpr int num_exchange_phases = 6;
+
+        inline const char* phase_name(exchange_phase p) noexcept
+        {
+            static const char* names[num_exchange_phases] = {"plan", "post_recvs", "pack", "send", "wait", "unpack"};
+            return names[static_cast<int>(p)];
+        }
+
+        /** @brief halo payload (bytes before compression) and number of messages exchanged with a neighbor */
+        struct neighbor_traffic
+        {
+            std::size_t sent_bytes = 0u;
+            std::size_t sent_messages = 0u;
+            std::size_t recv_bytes = 0u;
+            std::size_t recv_messages = 0u;
+
+            neighbor_traffic& operator+=(const neighbor_traffic& other) noexcept
+            {
+                sent_bytes += other.sent_bytes;
+                sent_messages += other.sent_messages;
+                recv_bytes += other.recv_bytes;
+                recv_messages += other.recv_messages;
+                return *this;
+            }
+        };
+
+        /** @brief statistics over the exchanges of a communication object: the time spent in each phase per exchange
+          * (in microseconds) and the traffic per neighbor rank. A profile reduced over ranks holds the traffic per
+          * rank, summed over its neighbors, instead. Only filled when the library is compiled with
+          * GHEX_PROFILE_EXCHANGES. */
+        class exchange_profile
+        {
+        public: // members
+            std::array<accumulator, num_exchange_phases> m_phases;
+            accumulator m_total;
+            std::map<int, neighbor_traffic> m_traffic;
+            std::map<int, neighbor_traffic> m_rank_traffic;
+
+        public: // member functions
+            const accumulator& operator[](exchange_phase p) const noexcept { return m_phases[static_cast<int>(p)]; }
+            const accumulator& total() const noexcept { return m_total; }
+            std::size_t num_exchanges() const noexcept { return m_total.num_samples(); }
+            /** @brief traffic per neighbor rank */
+            const std::map<int, neighbor_traffic>& traffic() const noexcept { return m_traffic; }
+            /** @brief traffic per rank, summed over its neighbors (reduced profiles only) */
+            const std::map<int, neighbor_traffic>& rank_traffic() const noexcept { return m_rank_traffic; }
+
+            void clear()
+            {
+                for (auto& acc : m_phases) acc.clear();
+                m_total.clear();
+                m_traffic.clear();
+                m_rank_traffic.clear();
+            }
+
+            /** @brief write the phase statistics as CSV: one line per phase and one for the whole exchange */
+            void write_phases_csv(std::ostream& os) const
+            {
+                os << "phase,samples,min_us,mean_us,max_us,stddev_us\n";
+                auto line = [&os](const char* name, const accumulator& acc)
+                {
+                    os << name << "," << acc.num_samples() << "," << (acc.num_samples() ? acc.min() : 0.0) << ","
+                       << acc.mean() << "," << (acc.num_samples() ? acc.max() : 0.0) << "," << acc.stddev() << "\n";
+                };
+                for (int p=0; p<num_exchange_phases; ++p) line(phase_name(static_cast<exchange_phase>(p)), m_phases[p]);
+                line("total", m_total);
+            }
+
+            /** @brief write the traffic as CSV: one line per neighbor rank */
+            void write_traffic_csv(std::ostream& os) const
+            {
+                write_traffic_csv(os, m_traffic);
+            }
+
+            /** @brief write the traffic of a reduced profile as CSV: one line per rank */
+            void write_rank_traffic_csv(std::ostream& os) const
+            {
+                write_traffic_csv(os, m_rank_traffic);
+            }
+
+            /** @brief write phases and traffic as one JSON object */
+            void write_json(std::ostream& os) const
+            {
+                auto acc_json = [&os](const accumulator& acc)
+                {
+                    os << "{\"samples\": " << acc.num_samples()
+                       << ", \"min_us\": " << (acc.num_samples() ? acc.min() : 0.0)
+                       << ", \"mean_us\": " << acc.mean()
+                       << ", \"max_us\": " << (acc.num_samples() ? acc.max() : 0.0)
+                       << ", \"stddev_us\": " << acc.stddev() << "}";
+                };
+                os << "{\n  \"phases\": {\n";
+                for (int p=0; p<num_exchange_phases; ++p)
+                {
+                    os << "    \"" << phase_name(static_cast<exchange_phase>(p)) << "\": ";
+                    acc_json(m_phases[p]);
+                    os << ",\n";
+                }
+                os << "    \"total\": ";
+                acc_json(m_total);
+                os << "\n  },\n  \"traffic\": ";
+                traffic_json(os, m_traffic);
+                os << ",\n  \"rank_traffic\": ";
+                traffic_json(os, m_rank_traffic);
+                os << "\n}\n";
+            }
+
+        private: // implementation
+            static void write_traffic_csv(std::ostream& os, const std::map<int, neighbor_traffic>& traffic)
+            {
+                os << "rank,sent_bytes,sent_messages,recv_bytes,recv_messages\n";
+                for (const auto& p : traffic)
+                    os << p.first << "," << p.second.sent_bytes << "," << p.second.sent_messages << ","
+                       << p.second.recv_bytes << "," << p.second.recv_messages << "\n";
+            }
+
+            static void traffic_json(std::ostream& os, const std::map<int, neighbor_traffic>& traffic)
+            {
+                os << "[";
+                bool first = true;
+                for (const auto& p : traffic)
+                {
+                    os << (first ? "\n" : ",\n") << "    {\"rank\": " << p.first
+                       << ", \"sent_bytes\": " << p.second.sent_bytes << ", \"sent_messages\": " << p.second.sent_messages
+                       << ", \"recv_bytes\": " << p.second.recv_bytes << ", \"recv_messages\": " << p.second.recv_messages
+                       << "}";
+                    first = false;
+                }
+                os << (first ? "]" : "\n  ]");
+            }
+        };
+
+        /** @brief all-reduce profiles over the MPI group defined by the communicator. The phase statistics
+          * incorporate the exchanges of all ranks; the traffic is listed per rank, summed over its neighbors, in
+          * rank_traffic (traffic is empty).
+          * @param prof profile local to each rank
+          * @param comm MPI communicator
+          * @return combined profile */
+        inline exchange_profile reduce(const exchange_profile& prof, MPI_Comm comm)
+        {
+            exchange_profile res;
+            for (int p=0; p<num_exchange_phases; ++p)
+                res.m_phases[p] = reduce(prof.m_phases[p], comm);
+            res.m_total = reduce(prof.m_total, comm);
+            int size;
+            MPI_Comm_size(comm, &size);
+            neighbor_traffic local;
+            for (const auto& p : prof.m_traffic) local += p.second;
+            std::vector<neighbor_traffic> all(size);
+            MPI_Allgather(&local, sizeof(neighbor_traffic), MPI_BYTE, all.data(), sizeof(neighbor_traffic), MPI_BYTE,
+                comm);
+            for (int r=0; r<size; ++r) res.m_rank_traffic[r] = all[r];
+            return res;
+        }
+
+        namespace detail {
+
+            /** @brief records the phases and the traffic of one exchange: the time of each phase is summed up and
+              * added to a profile when the exchange completes. Each phase is also recorded as a trace event. */
+            class exchange_recorder
+            {
+            private: // member types
+                using clock_type = trace::clock_type;
+
+            private: // members
+                std::array<double, num_exchange_phases> m_times;
+                clock_type::time_point m_last;
+                std::map<int, neighbor_traffic> m_traffic;
+
+            public: // member functions
+                /** @brief start an exchange */
+                void start()
+                {
+                    m_times.fill(0.0);
+                    m_traffic.clear();
+                    m_last = clock_type::now();
+                }
+
+                /** @brief restart the clock without attributing the elapsed time to a phase */
+                void tic() { m_last = clock_type::now(); }
+
+                /** @brief attribute the time elapsed since the last tic/toc to a phase */
+                void toc(exchange_phase p)
+                {
+                    const auto now = clock_type::now();
+                    m_times[static_cast<int>(p)] += std::chrono::duration<double, std::micro>(now - m_last).count();
+                    trace::complete(phase_name(p), "exchange", m_last, now);
+                    m_last = now;
+                }
+
+                void sent(int rank, std::size_t bytes)
+                {
+                    auto& t = m_traffic[rank];
+                    t.sent_bytes += bytes;
+                    ++t.sent_messages;
+                }
+
+                void received(int rank, std::size_t bytes)
+                {
+                    auto& t = m_traffic[rank];
+                    t.recv_bytes += bytes;
+                    ++t.recv_messages;
+                }
+
+                /** @brief add this exchange to a profile. The total is the sum of the phases: time spent outside of
+                  * the library between starting and waiting on the exchange is not counted. */
+                void commit(exchange_profile& prof)
+                {
+                    double total = 0.0;
+                    for (int p=0; p<num_exchange_phases; ++p)
+                    {
+                        prof.m_phases[p](m_times[p]);
+                        total += m_times[p];
+                    }
+                    prof.m_total(total);
+                    for (const auto& t : m_traffic) prof.m_traffic[t.first] += t.second;
+                }
+            };
+
+            /** @brief recorder used when only tracing is enabled: the phases are recorded as trace events */
+            class trace_recorder
+            {
+            private: // members
+                trace::time_point m_last;
+
+            public: // member functions
+                void start() { m_last = trace::now(); }
+                void tic() { m_last = trace::now(); }
+
+                void toc(exchange_phase p)
+                {
+                    const auto now = trace::now();
+                    trace::complete(phase_name(p), "exchange", m_last, now);
+                    m_last = now;
+                }
+
+                void sent(int, std::size_t) noexcept {}
+                void received(int, std::size_t) noexcept {}
+                void commit(exchange_profile&) noexcept {}
+            };
+
+            /** @brief recorder used when profiling and tracing are disabled: all calls compile to nothing */
+            struct null_recorder
+            {
+                void start() noexcept {}
+                void tic() noexcept {}
+                void toc(exchange_phase) noexcept {}
+                void sent(int, std::size_t) noexcept {}
+                void received(int, std::size_t) noexcept {}
+                void commit(exchange_profile&) noexcept {}
+            };
+
+#if defined(GHEX_PROFILE_EXCHANGES)
+            using recorder_type = exchange_recorder;
+#elif defined(GHEX_TRACE_EVENTS)
+            using recorder_type = trace_recorder;
+#else
+            using recorder_type = null_recorder;
+#endif
+
+        } // namespace detail
+
+    } // namespace ghex
+
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_COMMON_EXCHANGE_PROFILE_HPP */
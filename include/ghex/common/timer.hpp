@@ -13,6 +13,7 @@
 
 #include "./accumulator.hpp"
 #include <chrono>
+#include <iostream>
 
 namespace gridtools {
 
@@ -21,11 +22,13 @@ namespace gridtools {
         /** @brief timer with built-in statistics */
         class timer : public accumulator
         {
-        private: // member types
-            using base = accumulator;
+        public: // member types
             using clock_type = std::chrono::high_resolution_clock;
             using time_point = typename clock_type::time_point;
 
+        private: // member types
+            using base = accumulator;
+
         private: // members
             time_point m_time_point = clock_type::now();
 
@@ -87,7 +90,7 @@ namespace gridtools {
           * @param t timer local to each rank
           * @param comm MPI communicator
           * @return combined timer incorporating statistics over all timings */
-        timer reduce(const timer& t, MPI_Comm comm)
+        inline timer reduce(const timer& t, MPI_Comm comm)
         {
             return reduce(static_cast<accumulator>(t), comm);
         }
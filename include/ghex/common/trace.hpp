@@ -0,0 +1,329 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_COMMON_TRACE_HPP
+#define INCLUDED_GHEX_COMMON_TRACE_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "./timer.hpp"
+
+namespace gridtools {
+
+    namespace ghex {
+
+        /** @brief timeline of exchange and transport events. When the library is compiled with GHEX_TRACE_EVENTS,
+          * every thread records its events into a ring buffer of bounded size (the oldest events are overwritten),
+          * and finalize writes one Chrome trace file per rank, which can be loaded in Perfetto or chrome://tracing.
+          * Otherwise all functions are empty and no overhead is incurred. */
+        namespace trace {
+
+#ifdef GHEX_TRACE_EVENTS
+            static constexpr bool enabled = true;
+#else
+            static constexpr bool enabled = false;
+#endif
+
+            using clock_type = timer::clock_type;
+            using time_point = timer::time_point;
+
+            /** @brief a recorded event: instant events have begin == end. Name and category must be string
+              * literals. */
+            struct event
+            {
+                const char* name;
+                const char* category;
+                time_point begin;
+                time_point end;
+                bool instant;
+                int peer;
+                int tag;
+                std::size_t bytes;
+            };
+
+            namespace detail {
+
+                /** @brief ring buffer of events recorded by one thread */
+                class event_buffer
+                {
+                private: // members
+                    std::vector<event> m_events;
+                    std::size_t m_next = 0u;
+                    std::size_t m_count = 0u;
+                    int m_thread_id;
+
+                public: // ctors
+                    event_buffer(std::size_t capacity, int thread_id)
+                    : m_events(capacity)
+                    , m_thread_id{thread_id}
+                    {}
+
+                public: // member functions
+                    int thread_id() const noexcept { return m_thread_id; }
+                    std::size_t size() const noexcept { return std::min(m_count, m_events.size()); }
+                    std::size_t dropped() const noexcept { return m_count - size(); }
+
+                    void push(const event& e) noexcept
+                    {
+                        if (m_events.empty()) return;
+                        m_events[m_next] = e;
+                        if (++m_next == m_events.size()) m_next = 0u;
+                        ++m_count;
+                    }
+
+                    /** @brief discard all events and change the capacity */
+                    void reset(std::size_t capacity)
+                    {
+                        m_events.resize(capacity);
+                        m_next = 0u;
+                        m_count = 0u;
+                    }
+
+                    /** @brief visit the events from the oldest to the newest */
+                    template<typename F>
+                    void for_each(F&& f) const
+                    {
+                        const std::size_t n = size();
+                        const std::size_t first = (m_count > m_events.size()) ? m_next : 0u;
+                        for (std::size_t i=0; i<n; ++i)
+                            f(m_events[(first+i)%m_events.size()]);
+                    }
+                };
+
+                /** @brief owns the buffers of all threads of the process: buffers outlive their threads, such that
+                  * the events of finished threads can still be written */
+                class registry
+                {
+                private: // members
+                    std::mutex m_mutex;
+                    std::vector<std::unique_ptr<event_buffer>> m_buffers;
+                    std::size_t m_capacity = 65536u;
+                    const time_point m_origin = clock_type::now();
+
+                public: // static member functions
+                    static registry& instance()
+                    {
+                        static registry r;
+                        return r;
+                    }
+
+                public: // member functions
+                    time_point origin() const noexcept { return m_origin; }
+
+                    /** @brief buffer of the calling thread, created on first use */
+                    event_buffer& local()
+                    {
+                        thread_local event_buffer* buffer = nullptr;
+                        if (!buffer)
+                        {
+                            std::lock_guard<std::mutex> lock(m_mutex);
+                            m_buffers.emplace_back(new event_buffer(m_capacity, static_cast<int>(m_buffers.size())));
+                            buffer = m_buffers.back().get();
+                        }
+                        return *buffer;
+                    }
+
+                    void set_capacity(std::size_t capacity)
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_capacity = capacity;
+                        for (auto& b : m_buffers) b->reset(capacity);
+                    }
+
+                    std::size_t capacity() const noexcept { return m_capacity; }
+
+                    template<typename F>
+                    void for_each_buffer(F&& f)
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        for (auto& b : m_buffers) f(*b);
+                    }
+                };
+
+                // offset in microseconds to be added to the local clock to obtain the clock of rank 0, propagated
+                // along a binomial tree: in the round with distance d, the ranks [d, 2d) synchronize concurrently with
+                // the ranks d below, which are synchronized already. Each pair exchanges several round trips and keeps
+                // the estimate of the shortest one.
+                inline double clock_offset(MPI_Comm comm, time_point origin)
+                {
+                    const int rounds = 16;
+                    int rank, size;
+                    MPI_Comm_rank(comm, &rank);
+                    MPI_Comm_size(comm, &size);
+                    auto now = [origin]()
+                    {
+                        return std::chrono::duration<double, std::micro>(clock_type::now() - origin).count();
+                    };
+                    double offset = 0.0;
+                    for (int d=1; d<size; d*=2)
+                    {
+                        if (rank < d && rank+d < size)
+                        {
+                            for (int k=0; k<rounds; ++k)
+                            {
+                                char ping;
+                                MPI_Recv(&ping, 1, MPI_CHAR, rank+d, 0, comm, MPI_STATUS_IGNORE);
+                                const double t = now() + offset;
+                                MPI_Send(&t, 1, MPI_DOUBLE, rank+d, 0, comm);
+                            }
+                        }
+                        else if (rank >= d && rank < 2*d)
+                        {
+                            double best = std::numeric_limits<double>::max();
+                            for (int k=0; k<rounds; ++k)
+                            {
+                                char ping = 0;
+                                double t_root;
+                                const double t0 = now();
+                                MPI_Send(&ping, 1, MPI_CHAR, rank-d, 0, comm);
+                                MPI_Recv(&t_root, 1, MPI_DOUBLE, rank-d, 0, comm, MPI_STATUS_IGNORE);
+                                const double t1 = now();
+                                if (t1-t0 < best)
+                                {
+                                    best = t1-t0;
+                                    offset = t_root - 0.5*(t0+t1);
+                                }
+                            }
+                        }
+                    }
+                    return offset;
+                }
+
+            } // namespace detail
+
+            /** @return current time, or a default constructed time point if tracing is disabled */
+            inline time_point now() noexcept
+            {
+                return enabled ? clock_type::now() : time_point{};
+            }
+
+            /** @brief record an event spanning [begin, end) in the buffer of the calling thread
+              * @param name event name, a string literal
+              * @param category event category, a string literal
+              * @param peer rank of the peer, -1 if not applicable
+              * @param tag message tag, -1 if not applicable
+              * @param bytes message size */
+            inline void complete(const char* name, const char* category, time_point begin, time_point end,
+                int peer = -1, int tag = -1, std::size_t bytes = 0u)
+            {
+                if (!enabled) return;
+                detail::registry::instance().local().push(event{name, category, begin, end, false, peer, tag, bytes});
+            }
+
+            /** @brief record an instantaneous event in the buffer of the calling thread */
+            inline void instant(const char* name, const char* category, int peer = -1, int tag = -1,
+                std::size_t bytes = 0u)
+            {
+                if (!enabled) return;
+                const auto t = clock_type::now();
+                detail::registry::instance().local().push(event{name, category, t, t, true, peer, tag, bytes});
+            }
+
+            /** @brief records an event spanning its own lifetime */
+            class scope
+            {
+            private: // members
+                const char* m_name;
+                const char* m_category;
+                time_point m_begin;
+
+            public: // ctors
+                scope(const char* name, const char* category) noexcept
+                : m_name{name}
+                , m_category{category}
+                , m_begin{now()}
+                {}
+                scope(const scope&) = delete;
+                scope& operator=(const scope&) = delete;
+                ~scope() { complete(m_name, m_category, m_begin, now()); }
+            };
+
+            /** @brief set the number of events kept per thread (65536 by default): older events are overwritten.
+              * Discards all recorded events. Must not be called while other threads record events. */
+            inline void set_capacity(std::size_t events_per_thread)
+            {
+                if (!enabled) return;
+                detail::registry::instance().set_capacity(events_per_thread);
+            }
+
+            /** @return number of events currently held by all threads of this process */
+            inline std::size_t num_events()
+            {
+                std::size_t n = 0u;
+                if (!enabled) return n;
+                detail::registry::instance().for_each_buffer([&n](const detail::event_buffer& b) { n += b.size(); });
+                return n;
+            }
+
+            /** @brief write the events of all threads of this rank as a Chrome trace to the file
+              * <prefix>.<rank>.json and discard them. The timestamps are aligned to the clock of rank 0 of the
+              * communicator. Collective over the communicator, and no thread may record events during the call.
+              * @param comm MPI communicator
+              * @param prefix path prefix of the trace files */
+            inline void finalize(MPI_Comm comm, const std::string& prefix = "ghex_trace")
+            {
+                if (!enabled) return;
+                auto& reg = detail::registry::instance();
+                MPI_Comm c;
+                MPI_Comm_dup(comm, &c);
+                int rank;
+                MPI_Comm_rank(c, &rank);
+                const double offset = detail::clock_offset(c, reg.origin());
+                MPI_Comm_free(&c);
+
+                std::ofstream os(prefix + "." + std::to_string(rank) + ".json");
+                if (!os) throw std::runtime_error("could not open trace file " + prefix + "." + std::to_string(rank) + ".json");
+                auto ts = [&reg,offset](time_point t)
+                {
+                    return std::chrono::duration<double, std::micro>(t - reg.origin()).count() + offset;
+                };
+                std::size_t dropped = 0u;
+                os.precision(3);
+                os << std::fixed;
+                os << "{\"traceEvents\": [\n";
+                os << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << rank
+                   << ", \"args\": {\"name\": \"rank " << rank << "\"}}";
+                reg.for_each_buffer([&](detail::event_buffer& b)
+                {
+                    os << ",\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << rank << ", \"tid\": "
+                       << b.thread_id() << ", \"args\": {\"name\": \"thread " << b.thread_id() << "\"}}";
+                    b.for_each([&](const event& e)
+                    {
+                        os << ",\n{\"name\": \"" << e.name << "\", \"cat\": \"" << e.category << "\", \"pid\": "
+                           << rank << ", \"tid\": " << b.thread_id() << ", \"ts\": " << ts(e.begin);
+                        if (e.instant) os << ", \"ph\": \"i\", \"s\": \"t\"";
+                        else os << ", \"ph\": \"X\", \"dur\": "
+                                << std::chrono::duration<double, std::micro>(e.end - e.begin).count();
+                        if (e.peer >= 0 || e.bytes > 0u)
+                            os << ", \"args\": {\"peer\": " << e.peer << ", \"tag\": " << e.tag << ", \"bytes\": "
+                               << e.bytes << "}";
+                        os << "}";
+                    });
+                    dropped += b.dropped();
+                    b.reset(reg.capacity());
+                });
+                os << "\n],\n\"otherData\": {\"rank\": " << rank << ", \"clock_offset_us\": " << offset
+                   << ", \"dropped_events\": " << dropped << "}\n}\n";
+            }
+
+        } // namespace trace
+
+    } // namespace ghex
+
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_COMMON_TRACE_HPP */
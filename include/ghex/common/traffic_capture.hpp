@@ -0,0 +1,378 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_COMMON_TRAFFIC_CAPTURE_HPP
+#define INCLUDED_GHEX_COMMON_TRAFFIC_CAPTURE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./timer.hpp"
+
+namespace gridtools {
+
+    namespace ghex {
+
+        /** @brief capture of the communication traffic. When the library is compiled with GHEX_CAPTURE_TRAFFIC,
+          * every exchange of a communication object and every message posted through a transport communicator is
+          * recorded, and write stores the records of one rank in a compact binary file. The exchanges can then be
+          * replayed offline through any transport (see benchmarks/transport/capture_replay.cpp). Each thread keeps
+          * a bounded number of records (see set_capacity), further records are dropped and counted.
+          * Otherwise all functions are empty and no overhead is incurred. */
+        namespace capture {
+
+#ifdef GHEX_CAPTURE_TRAFFIC
+            static constexpr bool enabled = true;
+#else
+            static constexpr bool enabled = false;
+#endif
+
+            using clock_type = timer::clock_type;
+            using time_point = timer::time_point;
+
+            enum class record_kind : std::uint8_t
+            {
+                exchange_begin = 0,
+                exchange_end   = 1,
+                send           = 2,
+                recv           = 3
+            };
+
+            /** @brief a captured event. Messages posted while an exchange is started carry the id of that
+              * exchange, all other messages carry the id 0. */
+            struct record
+            {
+                record_kind kind;
+                std::uint16_t thread;
+                std::int32_t peer;
+                std::int32_t tag;
+                std::uint32_t exchange;
+                std::uint64_t bytes;
+                double time_us;
+            };
+
+            /** @brief the captured records of one rank, ordered by time */
+            struct rank_trace
+            {
+                int rank;
+                int size;
+                std::vector<record> records;
+            };
+
+            namespace detail {
+
+                static constexpr char magic[8] = {'G','H','E','X','C','A','P','T'};
+                static constexpr std::uint32_t version = 1u;
+                // kind, thread, peer, tag, exchange, bytes, time
+                static constexpr std::size_t record_bytes = 1u+2u+4u+4u+4u+8u+8u;
+
+                struct rank_record
+                {
+                    int rank;
+                    record r;
+                };
+
+                /** @brief records of one thread. The records are guarded by a mutex of their own, since the
+                  * records of one rank may be extracted while other threads of the process record events of other
+                  * ranks. */
+                struct record_buffer
+                {
+                    std::uint16_t m_thread_id;
+                    std::uint32_t m_exchange = 0u;
+                    std::mutex m_mutex;
+                    std::vector<rank_record> m_records;
+                    std::size_t m_dropped = 0u;
+
+                    record_buffer(std::uint16_t thread_id) : m_thread_id{thread_id} {}
+                };
+
+                /** @brief owns the buffers of all threads of the process (several ranks may share a process with
+                  * the inproc transport) */
+                class registry
+                {
+                private: // members
+                    std::mutex m_mutex;
+                    std::vector<std::unique_ptr<record_buffer>> m_buffers;
+                    std::atomic<std::uint32_t> m_next_exchange{1u};
+                    std::atomic<std::size_t> m_capacity{std::size_t{1u} << 20};
+                    const time_point m_origin = clock_type::now();
+
+                public: // static member functions
+                    static registry& instance()
+                    {
+                        static registry r;
+                        return r;
+                    }
+
+                public: // member functions
+                    /** @brief buffer of the calling thread, created on first use */
+                    record_buffer& local()
+                    {
+                        thread_local record_buffer* buffer = nullptr;
+                        if (!buffer)
+                        {
+                            std::lock_guard<std::mutex> lock(m_mutex);
+                            if (m_buffers.size() > std::numeric_limits<std::uint16_t>::max())
+                                throw std::runtime_error("traffic capture supports at most 65536 threads per process");
+                            m_buffers.emplace_back(new record_buffer(static_cast<std::uint16_t>(m_buffers.size())));
+                            buffer = m_buffers.back().get();
+                        }
+                        return *buffer;
+                    }
+
+                    std::uint32_t next_exchange() noexcept { return m_next_exchange++; }
+
+                    void push(int rank, record_kind kind, int peer, int tag, std::uint32_t exchange, std::size_t bytes)
+                    {
+                        const double t = std::chrono::duration<double, std::micro>(clock_type::now() - m_origin).count();
+                        auto& b = local();
+                        std::lock_guard<std::mutex> lock(b.m_mutex);
+                        if (b.m_records.size() >= m_capacity.load(std::memory_order_relaxed))
+                        {
+                            ++b.m_dropped;
+                            return;
+                        }
+                        b.m_records.push_back(rank_record{rank,
+                            record{kind, b.m_thread_id, peer, tag, exchange, static_cast<std::uint64_t>(bytes), t}});
+                    }
+
+                    void set_capacity(std::size_t capacity) noexcept { m_capacity = capacity; }
+
+                    /** @brief discard the records of all ranks */
+                    void clear()
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        for (auto& b : m_buffers)
+                        {
+                            std::lock_guard<std::mutex> b_lock(b->m_mutex);
+                            b->m_records.clear();
+                            b->m_records.shrink_to_fit();
+                            b->m_dropped = 0u;
+                        }
+                    }
+
+                    /** @brief remove the records of a rank from all buffers and return them ordered by time */
+                    std::vector<record> extract(int rank)
+                    {
+                        std::vector<record> res;
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        for (auto& b : m_buffers)
+                        {
+                            std::lock_guard<std::mutex> b_lock(b->m_mutex);
+                            auto it = std::stable_partition(b->m_records.begin(), b->m_records.end(),
+                                [rank](const rank_record& r) { return r.rank != rank; });
+                            for (auto jt = it; jt != b->m_records.end(); ++jt) res.push_back(jt->r);
+                            b->m_records.erase(it, b->m_records.end());
+                        }
+                        std::stable_sort(res.begin(), res.end(),
+                            [](const record& a, const record& b) { return a.time_us < b.time_us; });
+                        return res;
+                    }
+
+                    std::size_t size()
+                    {
+                        std::size_t n = 0u;
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        for (auto& b : m_buffers)
+                        {
+                            std::lock_guard<std::mutex> b_lock(b->m_mutex);
+                            n += b->m_records.size();
+                        }
+                        return n;
+                    }
+
+                    std::size_t dropped()
+                    {
+                        std::size_t n = 0u;
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        for (auto& b : m_buffers)
+                        {
+                            std::lock_guard<std::mutex> b_lock(b->m_mutex);
+                            n += b->m_dropped;
+                        }
+                        return n;
+                    }
+                };
+
+                // fixed size fields in host byte order, independent of the struct layout
+                template<typename T>
+                inline void put(std::vector<char>& buf, T x)
+                {
+                    char bytes[sizeof(T)];
+                    std::memcpy(bytes, &x, sizeof(T));
+                    buf.insert(buf.end(), bytes, bytes+sizeof(T));
+                }
+
+                template<typename T>
+                inline T get(const char*& ptr)
+                {
+                    T x;
+                    std::memcpy(&x, ptr, sizeof(T));
+                    ptr += sizeof(T);
+                    return x;
+                }
+
+            } // namespace detail
+
+            /** @brief record the start of an exchange: messages posted by the calling thread until exchange_posted
+              * are attributed to it
+              * @param rank rank of the communication object
+              * @return id of the exchange, 0 if capture is disabled */
+            inline std::uint32_t exchange_begin(int rank)
+            {
+                if (!enabled) return 0u;
+                auto& reg = detail::registry::instance();
+                const auto id = reg.next_exchange();
+                reg.push(rank, record_kind::exchange_begin, -1, -1, id, 0u);
+                reg.local().m_exchange = id;
+                return id;
+            }
+
+            /** @brief all messages of the current exchange of the calling thread are posted */
+            inline void exchange_posted()
+            {
+                if (!enabled) return;
+                detail::registry::instance().local().m_exchange = 0u;
+            }
+
+            /** @brief record the completion of an exchange */
+            inline void exchange_end(int rank, std::uint32_t id)
+            {
+                if (!enabled) return;
+                detail::registry::instance().push(rank, record_kind::exchange_end, -1, -1, id, 0u);
+            }
+
+            /** @brief record a posted send */
+            inline void send(int rank, int peer, int tag, std::size_t bytes)
+            {
+                if (!enabled) return;
+                auto& reg = detail::registry::instance();
+                reg.push(rank, record_kind::send, peer, tag, reg.local().m_exchange, bytes);
+            }
+
+            /** @brief record a posted receive */
+            inline void recv(int rank, int peer, int tag, std::size_t bytes)
+            {
+                if (!enabled) return;
+                auto& reg = detail::registry::instance();
+                reg.push(rank, record_kind::recv, peer, tag, reg.local().m_exchange, bytes);
+            }
+
+            /** @return number of records currently held by this process */
+            inline std::size_t num_records()
+            {
+                if (!enabled) return 0u;
+                return detail::registry::instance().size();
+            }
+
+            /** @return number of records dropped by this process since the last clear, because a thread held the
+              * maximum number of records */
+            inline std::size_t num_dropped()
+            {
+                if (!enabled) return 0u;
+                return detail::registry::instance().dropped();
+            }
+
+            /** @brief set the maximum number of records kept per thread (2^20 by default): records of a thread
+              * beyond this number are dropped until its records are written or cleared */
+            inline void set_capacity(std::size_t records_per_thread)
+            {
+                if (!enabled) return;
+                detail::registry::instance().set_capacity(records_per_thread);
+            }
+
+            /** @brief discard the records of all ranks of this process and reset the number of dropped records */
+            inline void clear()
+            {
+                if (!enabled) return;
+                detail::registry::instance().clear();
+            }
+
+            /** @brief write the records of a rank to the file <prefix>.<rank>.bin and discard them. Other threads
+              * may record events during the call: events of this rank recorded concurrently are written either by
+              * this call or by the next one.
+              * @param rank rank whose records are written
+              * @param size number of ranks
+              * @param prefix path prefix of the capture files */
+            inline void write(int rank, int size, const std::string& prefix = "ghex_capture")
+            {
+                if (!enabled) return;
+                const auto records = detail::registry::instance().extract(rank);
+                std::vector<char> buf;
+                buf.reserve(32u + records.size()*detail::record_bytes);
+                buf.insert(buf.end(), detail::magic, detail::magic+8);
+                detail::put<std::uint32_t>(buf, detail::version);
+                detail::put<std::int32_t>(buf, rank);
+                detail::put<std::int32_t>(buf, size);
+                detail::put<std::uint64_t>(buf, records.size());
+                for (const auto& r : records)
+                {
+                    detail::put<std::uint8_t>(buf, static_cast<std::uint8_t>(r.kind));
+                    detail::put<std::uint16_t>(buf, r.thread);
+                    detail::put<std::int32_t>(buf, r.peer);
+                    detail::put<std::int32_t>(buf, r.tag);
+                    detail::put<std::uint32_t>(buf, r.exchange);
+                    detail::put<std::uint64_t>(buf, r.bytes);
+                    detail::put<double>(buf, r.time_us);
+                }
+                const auto filename = prefix + "." + std::to_string(rank) + ".bin";
+                std::ofstream os(filename, std::ios::binary);
+                if (!os) throw std::runtime_error("could not open capture file " + filename);
+                os.write(buf.data(), buf.size());
+            }
+
+            /** @brief read a capture file written by write */
+            inline rank_trace read(const std::string& filename)
+            {
+                std::ifstream is(filename, std::ios::binary);
+                if (!is) throw std::runtime_error("could not open capture file " + filename);
+                std::vector<char> buf((std::istreambuf_iterator<char>(is)), std::istreambuf_iterator<char>());
+                const std::size_t header_bytes = 8u+4u+4u+4u+8u;
+                if (buf.size() < header_bytes || std::memcmp(buf.data(), detail::magic, 8) != 0)
+                    throw std::runtime_error("not a capture file: " + filename);
+                const char* ptr = buf.data()+8;
+                if (detail::get<std::uint32_t>(ptr) != detail::version)
+                    throw std::runtime_error("unsupported capture file version: " + filename);
+                rank_trace res;
+                res.rank = detail::get<std::int32_t>(ptr);
+                res.size = detail::get<std::int32_t>(ptr);
+                const auto n = detail::get<std::uint64_t>(ptr);
+                if (buf.size() != header_bytes + n*detail::record_bytes)
+                    throw std::runtime_error("truncated capture file: " + filename);
+                res.records.resize(n);
+                for (auto& r : res.records)
+                {
+                    r.kind = static_cast<record_kind>(detail::get<std::uint8_t>(ptr));
+                    r.thread = detail::get<std::uint16_t>(ptr);
+                    r.peer = detail::get<std::int32_t>(ptr);
+                    r.tag = detail::get<std::int32_t>(ptr);
+                    r.exchange = detail::get<std::uint32_t>(ptr);
+                    r.bytes = detail::get<std::uint64_t>(ptr);
+                    r.time_us = detail::get<double>(ptr);
+                }
+                return res;
+            }
+
+        } // namespace capture
+
+    } // namespace ghex
+
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_COMMON_TRAFFIC_CAPTURE_HPP */
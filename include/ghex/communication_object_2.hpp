@@ -15,13 +15,22 @@
 #include "./packer.hpp"
 #include "./common/utils.hpp"
 #include "./common/test_eq.hpp"
+#include "./common/compression.hpp"
+#include "./common/exchange_profile.hpp"
+#include "./common/traffic_capture.hpp"
 #include "./buffer_info.hpp"
 #include "./transport_layer/tags.hpp"
 #include "./structured/simple_field_wrapper.hpp"
 #include "./arch_traits.hpp"
+#include <limits>
 #include <map>
+#include <memory>
+#include <set>
+#include <algorithm>
 #include <stdio.h>
 #include <functional>
+#include <tuple>
+#include <utility>
 
 namespace gridtools {
 
@@ -31,6 +40,25 @@ namespace gridtools {
         template<typename Communicator, typename GridType, typename DomainIdType>
         class communication_object;
 
+        /** @brief buffer layout used by fused exchanges of several fields:
+          * - field_major: for each iteration space, all values of the first field, then all values of the second etc.
+          * - interleaved: for each point, the values of all fields one after the other */
+        enum class fused_layout { field_major, interleaved };
+
+        namespace detail {
+
+            // largest tag supported by a communicator: transports which restrict the tags provide tag_upper_bound
+            template<typename Communicator>
+            inline auto tag_upper_bound(const Communicator& comm, int) -> decltype(comm.tag_upper_bound())
+            {
+                return comm.tag_upper_bound();
+            }
+
+            template<typename Communicator>
+            inline int tag_upper_bound(const Communicator&, long) noexcept { return std::numeric_limits<int>::max(); }
+
+        } // namespace detail
+
         /** @brief handle type for waiting on asynchronous communication processes.
           * The wait function is stored in a member.
           * @tparam Transport message transport type
@@ -143,6 +171,22 @@ namespace gridtools {
                 const index_container_type* index_container;
                 std::size_t offset;
                 void* field_ptr;
+                std::size_t element_size;
+            };
+
+            /** @brief Byte range [begin, end) of a serialized buffer which is transferred as a separate message.
+              * Holds the (split) iteration spaces of each field which are packed into/unpacked from this range. */
+            struct chunk
+            {
+                struct piece
+                {
+                    std::size_t field_index;
+                    std::size_t offset;
+                    index_container_type index_container;
+                };
+                std::size_t begin;
+                std::size_t end;
+                std::vector<piece> pieces;
             };
 
             /** @brief Holds serial buffer memory and meta information associated with it
@@ -158,6 +202,11 @@ namespace gridtools {
                 std::size_t size;
                 std::vector<field_info_type> field_infos;
                 cuda::stream m_cuda_stream;
+                std::vector<chunk> chunks;
+                compression codec;
+                std::size_t word_size;
+                std::vector<unsigned char> compressed;
+                std::vector<unsigned char> history;
             };
 
             /** @brief Holds maps of buffers for send and recieve operations indexed by a domain_id_pair and a device id
@@ -174,7 +223,6 @@ namespace gridtools {
                 using send_memory_type = std::map<device_id_type, std::map<domain_id_pair,send_buffer_type>>;
                 using recv_memory_type = std::map<device_id_type, std::map<domain_id_pair,recv_buffer_type>>;
 
-                std::map<device_id_type, std::unique_ptr<typename arch_traits<Arch>::pool_type>> m_pools;
                 send_memory_type send_memory;
                 recv_memory_type recv_memory;
 
@@ -183,27 +231,217 @@ namespace gridtools {
                 using future_type     = typename communicator_type::template future<hook_type>;
                 std::vector<future_type> m_recv_futures;
 
+                // receive operations of chunked buffers: a null chunk pointer denotes the whole buffer
+                using chunk_hook_type   = std::pair<recv_buffer_type*, const chunk*>;
+                using chunk_future_type = typename communicator_type::template future<chunk_hook_type>;
+                std::vector<chunk_future_type> m_recv_chunk_futures;
+
+                // temporary storage and byte counts of the compression stage
+                std::vector<unsigned char> m_compression_scratch;
+                compression_statistics m_compression_stats;
             };
             
             /** tuple type of buffer_memory (one element for each device in arch_list) */
             using memory_type = detail::transform<arch_list>::with<buffer_memory>;
 
+            /** @brief Memory pools per device, shared by all exchanges of this object
+              * @tparam Arch the device on which the memory is allocated */
+            template<typename Arch>
+            struct pool_memory
+            {
+                using arch_type      = Arch;
+                using device_id_type = typename arch_traits<Arch>::device_id_type;
+                std::map<device_id_type, std::unique_ptr<typename arch_traits<Arch>::pool_type>> m_pools;
+            };
+
+            /** tuple type of pool_memory (one element for each device in arch_list) */
+            using pools_type = detail::transform<arch_list>::with<pool_memory>;
+
+            /** @brief Buffers and send operations of one exchange. Several exchanges may be in flight at the same
+              * time, each one occupying its own state and tag range. */
+            struct exchange_state
+            {
+                bool m_valid = false;
+                int m_tag_offset = 0;
+                memory_type m_mem;
+                std::vector<typename communicator_type::template future<void>> m_send_futures;
+                detail::recorder_type m_recorder;
+                std::uint32_t m_capture_id = 0u;
+            };
+
         private: // members
 
-            bool m_valid;
             communicator_type m_comm;
-            memory_type m_mem;
-            std::vector<typename communicator_type::template future<void>> m_send_futures;
+            pools_type m_pools;
+            std::vector<std::unique_ptr<exchange_state>> m_states;
+            int m_tag_stride;
+            long long m_tag_upper_bound;
+            std::size_t m_chunk_size;
+            fused_layout m_fused_layout;
+            std::set<std::vector<const void*>> m_fused_validated;
+            compression m_compression;
+            std::size_t m_compression_threshold;
+            wait_strategy m_wait_strategy;
+            allocator::numa_placement m_numa_placement;
+            exchange_profile m_profile;
 
         public: // ctors
 
             communication_object(communicator_type comm)
-            : m_valid(false) 
-            , m_comm(comm)
+            : m_comm(comm)
+            , m_tag_stride(0)
+            , m_tag_upper_bound(detail::tag_upper_bound(comm, 0))
+            , m_chunk_size(0)
+            , m_fused_layout(fused_layout::field_major)
+            , m_compression(compression::none)
+            , m_compression_threshold(4096)
+            , m_wait_strategy(wait_strategy::spin)
             {}
             communication_object(const communication_object&) = delete;
             communication_object(communication_object&&) = default;
 
+        public: // concurrent exchanges
+
+            /** @brief number of exchanges which have been started but not yet waited on */
+            int num_in_flight() const noexcept
+            {
+                return std::count_if(m_states.begin(), m_states.end(), [](const auto& s) { return s->m_valid; });
+            }
+
+            /** @brief Exchanges which are in flight at the same time are assigned different tag ranges: the k-th
+              * concurrent exchange (counting from 0) offsets its tags by k*tag_stride, hence the patterns of an
+              * exchange may not span more than tag_stride tags, and the tags must not exceed the upper bound of the
+              * transport (otherwise an exception is thrown before any message is posted, also when no other exchange
+              * is in flight). Unless set explicitely, the stride is fixed by the first exchange: the larger of 4096 and
+              * the tag span of its patterns. The assignment only depends on the number of exchanges in flight,
+              * therefore all ranks must start and wait on concurrent exchanges in the same order.
+              * @param tag_stride number of tags reserved for each concurrent exchange */
+            void set_tag_stride(int tag_stride)
+            {
+                if (num_in_flight() > 0)
+                    throw std::runtime_error("tag stride cannot be changed while an exchange is in progress");
+                m_tag_stride = tag_stride;
+            }
+
+            /** @brief number of tags reserved for each concurrent exchange, 0 until fixed by the first exchange */
+            int tag_stride() const noexcept { return m_tag_stride; }
+
+        public: // chunking
+
+            /** @brief split buffers larger than chunk_size bytes into chunks which are sent as soon as they are
+              * packed and unpacked as soon as they arrive. The iteration spaces are split such that each chunk holds
+              * at most chunk_size bytes (or a single row if a row is larger). Since splitting changes the order of the
+              * serialized elements, all ranks must use the same value.
+              * @param chunk_size chunk size in bytes, 0 disables chunking (default) */
+            void set_chunk_size(std::size_t chunk_size)
+            {
+                if (num_in_flight() > 0)
+                    throw std::runtime_error("chunk size cannot be changed while an exchange is in progress");
+                m_chunk_size = chunk_size;
+            }
+
+            std::size_t chunk_size() const noexcept { return m_chunk_size; }
+
+            /** @brief select the buffer layout of fused exchanges (see exchange_fused). All ranks must use the same
+              * layout.
+              * @param layout buffer layout, field_major by default */
+            void set_fused_layout(fused_layout layout)
+            {
+                if (num_in_flight() > 0)
+                    throw std::runtime_error("fused layout cannot be changed while an exchange is in progress");
+                m_fused_layout = layout;
+            }
+
+            fused_layout get_fused_layout() const noexcept { return m_fused_layout; }
+
+        public: // waiting
+
+            /** @brief select how wait() waits for the receives of an exchange: spinning gives the lowest latency,
+              * while backoff, yield and the blocking MPI strategies (waitany, waitsome) leave the core to other
+              * threads. Only the calling rank is affected.
+              * @param ws wait strategy, spin by default */
+            void set_wait_strategy(wait_strategy ws) noexcept { m_wait_strategy = ws; }
+
+            wait_strategy get_wait_strategy() const noexcept { return m_wait_strategy; }
+
+        public: // memory placement
+
+            /** @brief place the memory of the buffers on NUMA nodes: with first_touch or local, the buffers are placed
+              * on the node of the thread which starts the exchange (and packs), with node on a fixed node such as the
+              * one of the network interface. The placement applies to memory allocated after the call, buffers which
+              * are recycled from the pools keep their placement. Only the calling rank is affected.
+              * @param placement numa placement, none by default */
+            void set_numa_placement(allocator::numa_placement placement)
+            {
+                if (num_in_flight() > 0)
+                    throw std::runtime_error("numa placement cannot be changed while an exchange is in progress");
+                m_numa_placement = placement;
+                detail::for_each(m_pools, [placement](auto& pm)
+                {
+                    using traits = arch_traits<typename std::remove_reference_t<decltype(pm)>::arch_type>;
+                    for (auto& p : pm.m_pools)
+                        p.second->m_pool_impl->m_alloc = traits::make_basic_allocator(placement);
+                });
+            }
+
+            allocator::numa_placement get_numa_placement() const noexcept { return m_numa_placement; }
+
+        public: // profiling
+
+            /** @brief time spent in each phase and traffic per neighbor of the exchanges completed since construction
+              * or since the last call to clear_exchange_profile. Exchanges are only recorded when the library is
+              * compiled with GHEX_PROFILE_EXCHANGES, otherwise the profile stays empty and no overhead is incurred.
+              * Use reduce(profile, comm) to combine the profiles of all ranks. */
+            const exchange_profile& get_exchange_profile() const noexcept { return m_profile; }
+
+            void clear_exchange_profile() { m_profile.clear(); }
+
+        public: // compression
+
+            /** @brief compress all buffers of the cpu packer with the given codec between packing and sending, and
+              * between receiving and unpacking. Compression can also be requested for individual fields through
+              * buffer_info::compressed. Buffers smaller than the compression threshold and chunked buffers are sent
+              * uncompressed. All ranks must use the same settings.
+              * @param codec compression codec, none by default */
+            void set_compression(compression codec)
+            {
+                if (num_in_flight() > 0)
+                    throw std::runtime_error("compression cannot be changed while an exchange is in progress");
+                m_compression = codec;
+            }
+
+            compression get_compression() const noexcept { return m_compression; }
+
+            /** @brief buffers smaller than threshold bytes are never compressed
+              * @param threshold size in bytes, 4096 by default */
+            void set_compression_threshold(std::size_t threshold)
+            {
+                if (num_in_flight() > 0)
+                    throw std::runtime_error("compression threshold cannot be changed while an exchange is in progress");
+                m_compression_threshold = threshold;
+            }
+
+            std::size_t compression_threshold() const noexcept { return m_compression_threshold; }
+
+            /** @brief bytes sent by the compression stage since construction (or the last reset) */
+            compression_statistics get_compression_statistics() const noexcept
+            {
+                compression_statistics stats;
+                for (const auto& st : m_states)
+                {
+                    const auto& s_stats = std::get<buffer_memory<cpu>>(st->m_mem).m_compression_stats;
+                    stats.raw_bytes  += s_stats.raw_bytes;
+                    stats.sent_bytes += s_stats.sent_bytes;
+                }
+                return stats;
+            }
+
+            void reset_compression_statistics() noexcept
+            {
+                for (auto& st : m_states)
+                    std::get<buffer_memory<cpu>>(st->m_mem).m_compression_stats = compression_statistics{};
+            }
+
         public: // exchange arbitrary field-device-pattern combinations
 
             /** @brief blocking variant of halo exchange
@@ -228,9 +466,6 @@ namespace gridtools {
                 using test_t = pattern_container<communicator_type,grid_type,domain_id_type>;
                 static_assert(detail::test_eq_t<test_t, typename buffer_info_type<Archs,Fields>::pattern_container_type...>::value,
                         "patterns are not compatible with this communication object");
-                if (m_valid) 
-                    throw std::runtime_error("earlier exchange operation was not finished");
-                m_valid = true;
 
                 // temporarily store address of pattern containers
                 const test_t* ptrs[sizeof...(Fields)] = { &(buffer_infos.get_pattern_container())... };
@@ -243,27 +478,31 @@ namespace gridtools {
                     if (p_it_bool.second == true)
                         max_tag += ptrs[k]->max_tag()+1;
                 }
+                exchange_state& s = acquire_state(max_tag);
                 // compute tag offset for each field
-                int tag_offsets[sizeof...(Fields)] = { pat_ptr_map[&(buffer_infos.get_pattern_container())]... };
+                int tag_offsets[sizeof...(Fields)] = { s.m_tag_offset+pat_ptr_map[&(buffer_infos.get_pattern_container())]... };
                 // store arguments and corresponding memory in tuples
                 using buffer_infos_ptr_t     = std::tuple<std::remove_reference_t<decltype(buffer_infos)>*...>;
                 using memory_t               = std::tuple<buffer_memory<Archs>*...>;
                 buffer_infos_ptr_t buffer_info_tuple{&buffer_infos...};
-                memory_t memory_tuple{&(std::get<buffer_memory<Archs>>(m_mem))...};
+                memory_t memory_tuple{&(std::get<buffer_memory<Archs>>(s.m_mem))...};
                 // loop over buffer_infos/memory and compute required space
                 int i = 0;
                 detail::for_each(memory_tuple, buffer_info_tuple, [this,&i,&tag_offsets](auto mem, auto bi) 
                 {
                     using arch_type = typename std::remove_reference_t<decltype(*mem)>::arch_type;
-                    using value_type  = typename std::remove_reference_t<decltype(*bi)>::value_type;
+                    using wire_type = typename std::remove_reference_t<decltype(*bi)>::wire_type;
                     auto field_ptr = &(bi->get_field());
                     const domain_id_type my_dom_id = bi->get_field().domain_id();
-                    allocate<arch_type,value_type>(mem, bi->get_pattern(), field_ptr, my_dom_id, bi->device_id(), tag_offsets[i]);
+                    allocate<arch_type,wire_type>(mem, bi->get_pattern(), field_ptr, my_dom_id, bi->device_id(), tag_offsets[i],
+                        bi->get_compression());
                     ++i;
                 });
-                handle_type h(m_comm, [this](){this->wait();});
-                post_recvs();
-                pack();
+                handle_type h(m_comm, [this,&s](){this->wait(s);});
+                make_chunks(s);
+                setup_compression(s);
+                post_recvs(s);
+                pack(s);
                 return h; 
             }
 
@@ -278,9 +517,12 @@ namespace gridtools {
             template<typename Arch, typename Field>
             [[nodiscard]] handle_type exchange(buffer_info_type<Arch,Field>* first, std::size_t length)
             {
-                auto h = exchange_impl(first, length);
-                post_recvs();
-                pack();
+                exchange_state& s = acquire_state(first, length);
+                auto h = exchange_impl(s, first, length);
+                make_chunks(s);
+                setup_compression(s);
+                post_recvs(s);
+                pack(s);
                 return h;
             }
 
@@ -296,11 +538,17 @@ namespace gridtools {
                 using memory_t   = buffer_memory<gpu>;
                 using field_type = std::remove_reference_t<decltype(first->get_field())>;
                 using value_type = typename field_type::value_type;
-                auto h = exchange_impl(first, length);
-                post_recvs();
-                h.m_wait_fct = [this](){this->wait_u<value_type,field_type>();};
-                memory_t& mem = std::get<memory_t>(m_mem);
-                packer<gpu>::template pack_u<value_type,field_type>(mem, m_send_futures, m_comm);
+                // the specialized kernels operate on whole iteration spaces
+                if (m_chunk_size > 0u) return exchange(first, length);
+                exchange_state& s = acquire_state(first, length);
+                auto h = exchange_impl(s, first, length);
+                setup_compression(s);
+                post_recvs(s);
+                h.m_wait_fct = [this,&s](){this->wait_u<value_type,field_type>(s);};
+                memory_t& mem = std::get<memory_t>(s.m_mem);
+                packer<gpu>::template pack_u<value_type,field_type>(mem, s.m_send_futures, m_comm);
+                s.m_recorder.toc(exchange_phase::pack);
+                capture::exchange_posted();
                 return h;
             }
 #endif
@@ -314,18 +562,216 @@ namespace gridtools {
                 return exchange(first, length);
             }
 
+        public: // fused exchange of fields with identical type and memory layout
+
+            /** @brief non-blocking exchange of several fields with identical value type and memory layout. Fields which
+              * are bound to the same pattern (i.e. same pattern container and domain) are packed and unpacked in a single
+              * traversal of the iteration spaces, using the buffer layout selected with set_fused_layout. All ranks
+              * must pass their fields in the same order, and must either all use the fused or the regular exchange.
+              * The memory layouts are validated on all ranks the first time a sequence of patterns is exchanged,
+              * later exchanges of the same sequence are only checked locally.
+              * @tparam Arch device type
+              * @tparam Field field type
+              * @tparam BufferInfos buffer_info types (must be identical to buffer_info_type<Arch,Field>)
+              * @param first buffer_info object created by binding a field descriptor to a pattern
+              * @param others further buffer_info objects
+              * @return handle to await communication */
+            template<typename Arch, typename Field, typename... BufferInfos>
+            [[nodiscard]] handle_type exchange_fused(buffer_info_type<Arch,Field> first, BufferInfos... others)
+            {
+                buffer_info_type<Arch,Field> bis[] = {first, others...};
+                return exchange_fused(bis, 1u+sizeof...(BufferInfos));
+            }
+
+            /** @brief non-blocking fused exchange, vector interface (see above)
+              * @tparam Arch device type
+              * @tparam T field value type
+              * @tparam Order field storage layout
+              * @param first pointer to first buffer_info object
+              * @param length number of buffer_infos
+              * @return handle to await exchange */
+            template<typename Arch, typename T, int... Order>
+            [[nodiscard]] handle_type exchange_fused(
+                buffer_info_type<Arch,structured::simple_field_wrapper<T,Arch,structured::domain_descriptor<domain_id_type,sizeof...(Order)>,Order...>>* first,
+                std::size_t length)
+            {
+                using field_type = structured::simple_field_wrapper<T,Arch,structured::domain_descriptor<domain_id_type,sizeof...(Order)>,Order...>;
+                using bi_type    = buffer_info_type<Arch,field_type>;
+                using test_t     = pattern_container<communicator_type,grid_type,domain_id_type>;
+
+                // group the fields by pattern: the grouping only depends on the patterns and is therefore identical
+                // on all ranks
+                struct group
+                {
+                    bi_type* bi;
+                    std::vector<T*> data;
+                };
+                std::vector<group> groups;
+                bool mismatch = false;
+                for (std::size_t k=0; k<length; ++k)
+                {
+                    bi_type* bi = first+k;
+                    const auto& f = bi->get_field();
+                    auto it = std::find_if(groups.begin(), groups.end(),
+                        [bi](const group& g) { return &g.bi->get_pattern() == &bi->get_pattern(); });
+                    if (it == groups.end())
+                    {
+                        groups.push_back(group{bi, std::vector<T*>{f.data()}});
+                        continue;
+                    }
+                    const auto& g_f = it->bi->get_field();
+                    if (it->bi->device_id() != bi->device_id() ||
+                        !std::equal(f.byte_strides().begin(), f.byte_strides().end(), g_f.byte_strides().begin()) ||
+                        !std::equal(f.offsets().begin(), f.offsets().end(), g_f.offsets().begin()))
+                        mismatch = true;
+                    it->data.push_back(f.data());
+                }
+
+                // build a tag map
+                std::map<const test_t*,int> pat_ptr_map;
+                int max_tag = 0;
+                for (std::size_t k=0; k<length; ++k)
+                {
+                    const test_t* ptr = &((first+k)->get_pattern_container());
+                    auto p_it_bool = pat_ptr_map.insert( std::make_pair(ptr, max_tag) );
+                    if (p_it_bool.second == true)
+                        max_tag += ptr->max_tag()+1;
+                }
+
+                // the sequence of patterns is identical on all ranks, hence so is the decision to validate
+                std::vector<const void*> key;
+                key.reserve(length);
+                for (std::size_t k=0; k<length; ++k) key.push_back(&((first+k)->get_pattern()));
+                const bool validated = m_fused_validated.count(key) > 0;
+                if (validated && mismatch)
+                    throw std::runtime_error("fused exchange requires fields with identical memory layout");
+                exchange_state& s = acquire_state(max_tag);
+                if (!validated)
+                {
+                    // all ranks throw together, otherwise the neighbors of a failing rank would wait forever
+                    if (any_rank(mismatch, s.m_tag_offset))
+                    {
+                        clear(s);
+                        throw std::runtime_error(mismatch ?
+                            "fused exchange requires fields with identical memory layout" :
+                            "fused exchange requires fields with identical memory layout (violated on another rank)");
+                    }
+                    m_fused_validated.insert(std::move(key));
+                }
+                buffer_memory<Arch>* mem{&(std::get<buffer_memory<Arch>>(s.m_mem))};
+                for (auto& g : groups)
+                {
+                    auto field_ptr = &(g.bi->get_field());
+                    auto tag_offset = s.m_tag_offset+pat_ptr_map[&(g.bi->get_pattern_container())];
+                    allocate_fused<Arch,T>(mem, g.bi->get_pattern(), field_ptr, std::move(g.data), field_ptr->domain_id(),
+                        g.bi->device_id(), tag_offset, g.bi->get_compression());
+                }
+                handle_type h(m_comm, [this,&s](){this->wait(s);});
+                make_chunks(s);
+                setup_compression(s);
+                post_recvs(s);
+                pack(s);
+                return h;
+            }
+
+        public: // dimension-ordered exchange
+
+            /** @brief non-blocking dimension-ordered halo exchange (see structured::staged_pattern). The first stage is
+              * posted immediately, the remaining stages are carried out in sequence when the handle is waited on.
+              * The staged pattern and the fields must outlive the handle.
+              * @tparam StagedPattern staged pattern type
+              * @tparam Fields list of field types
+              * @param sp staged pattern
+              * @param fields field descriptors
+              * @return handle to await communication */
+            template<typename StagedPattern, typename... Fields>
+            [[nodiscard]] handle_type exchange_staged(const StagedPattern& sp, Fields&... fields)
+            {
+                if (sp.size() == 0) return handle_type(m_comm);
+                auto h = exchange(sp[0](fields)...);
+                const auto field_ptrs = std::make_tuple(&fields...);
+                auto wait_first = std::move(h.m_wait_fct);
+                h.m_wait_fct = [this,&sp,field_ptrs,wait_first]()
+                {
+                    wait_first();
+                    for (int s=1; s<sp.size(); ++s)
+                        exchange_stage(sp[s], field_ptrs, std::make_index_sequence<sizeof...(Fields)>{});
+                };
+                return h;
+            }
+
         private: // implementation
 
+            template<typename PatternContainer, typename FieldPtrs, std::size_t... Is>
+            void exchange_stage(const PatternContainer& pc, const FieldPtrs& field_ptrs, std::index_sequence<Is...>)
+            {
+                exchange(pc(*std::get<Is>(field_ptrs))...).wait();
+            }
+
+            // find a free exchange state for an exchange spanning num_tags tags (the lowest free state is taken,
+            // such that the states and tag ranges are assigned identically on all ranks)
+            exchange_state& acquire_state(int num_tags)
+            {
+                // the tag span is identical on all ranks, hence so is the stride
+                if (m_tag_stride == 0) m_tag_stride = std::max(4096, num_tags);
+                // checked for every state: the tags of state k would otherwise overlap the range of state k+1
+                if (num_tags > m_tag_stride)
+                    throw std::runtime_error("tag range of exchange exceeds the tag stride");
+                std::size_t k = 0;
+                while (k < m_states.size() && m_states[k]->m_valid) ++k;
+                if (static_cast<long long>(k)*m_tag_stride + num_tags - 1 > m_tag_upper_bound)
+                    throw std::runtime_error("tags of exchange exceed the tag upper bound of the transport");
+                if (k == m_states.size())
+                    m_states.push_back(std::unique_ptr<exchange_state>(new exchange_state{}));
+                exchange_state& s = *m_states[k];
+                s.m_valid = true;
+                s.m_tag_offset = static_cast<int>(k)*m_tag_stride;
+                s.m_recorder.start();
+                s.m_capture_id = capture::exchange_begin(m_comm.rank());
+                return s;
+            }
+
+            // logical or of a flag over all ranks by dissemination: ceil(log2(size)) rounds of point to point
+            // messages. The tag must belong to an acquired exchange state whose messages are not yet posted.
+            bool any_rank(bool flag, int tag)
+            {
+                int value = flag ? 1 : 0;
+                const int rank = m_comm.rank();
+                const int size = m_comm.size();
+                for (int d=1; d<size; d*=2)
+                {
+                    std::vector<int> out(1, value), in(1, 0);
+                    auto f_recv = m_comm.recv(in, (rank+size-d)%size, tag);
+                    auto f_send = m_comm.send(out, (rank+d)%size, tag);
+                    f_send.wait();
+                    f_recv.wait();
+                    value |= in[0];
+                }
+                return value != 0;
+            }
+
+            template<typename Arch, typename Field>
+            exchange_state& acquire_state(buffer_info_type<Arch,Field>* first, std::size_t length)
+            {
+                using test_t = pattern_container<communicator_type,grid_type,domain_id_type>;
+                std::map<const test_t*,int> pat_ptr_map;
+                int max_tag = 0;
+                for (std::size_t k=0; k<length; ++k)
+                {
+                    const test_t* ptr = &((first+k)->get_pattern_container());
+                    if (pat_ptr_map.insert(std::make_pair(ptr, max_tag)).second)
+                        max_tag += ptr->max_tag()+1;
+                }
+                return acquire_state(max_tag);
+            }
+
             template<typename Arch, typename Field>
-            [[nodiscard]] handle_type exchange_impl(buffer_info_type<Arch,Field>* first, std::size_t length)
+            [[nodiscard]] handle_type exchange_impl(exchange_state& s, buffer_info_type<Arch,Field>* first, std::size_t length)
             {
                 // check that arguments are compatible
                 using test_t = pattern_container<communicator_type,grid_type,domain_id_type>;
                 static_assert(std::is_same<test_t, typename buffer_info_type<Arch,Field>::pattern_container_type>::value,
                         "patterns are not compatible with this communication object");
-                if (m_valid)
-                    throw std::runtime_error("earlier exchange operation was not finished");
-                m_valid = true;
 
                 // build a tag map
                 std::map<const test_t*,int> pat_ptr_map;
@@ -339,22 +785,27 @@ namespace gridtools {
                 }
                 // loop over buffer_infos/memory and compute required space
                 using memory_t               = buffer_memory<Arch>*;
-                using value_type             = typename buffer_info_type<Arch,Field>::value_type;
-                memory_t mem{&(std::get<buffer_memory<Arch>>(m_mem))};
+                using wire_type              = typename buffer_info_type<Arch,Field>::wire_type;
+                memory_t mem{&(std::get<buffer_memory<Arch>>(s.m_mem))};
                 for (std::size_t k=0; k<length; ++k)
                 {
                     auto field_ptr = &((first+k)->get_field());
-                    auto tag_offset = pat_ptr_map[&((first+k)->get_pattern_container())];
+                    auto tag_offset = s.m_tag_offset+pat_ptr_map[&((first+k)->get_pattern_container())];
                     const auto my_dom_id  =(first+k)->get_field().domain_id();
-                    allocate<Arch,value_type>(mem, (first+k)->get_pattern(), field_ptr, my_dom_id, (first+k)->device_id(), tag_offset);
+                    allocate<Arch,wire_type>(mem, (first+k)->get_pattern(), field_ptr, my_dom_id, (first+k)->device_id(), tag_offset,
+                        (first+k)->get_compression());
                 }
-                return handle_type(m_comm, [this](){this->wait();});
+                return handle_type(m_comm, [this,&s](){this->wait(s);});
             }
 
-            void post_recvs()
+            void post_recvs(exchange_state& s)
             {
-                detail::for_each(m_mem, [this](auto& m)
+                s.m_recorder.toc(exchange_phase::plan);
+                detail::for_each(s.m_mem, [this](auto& m)
                 {
+                    using memory_t   = std::remove_reference_t<decltype(m)>;
+                    using value_type = typename memory_t::vector_type::value_type;
+                    const bool chunked = m_chunk_size > 0u;
                     for (auto& p0 : m.recv_memory)
                     {
                         for (auto& p1: p0.second)
@@ -362,51 +813,167 @@ namespace gridtools {
                             if (p1.second.size > 0u)
                             {
                                 p1.second.buffer.resize(p1.second.size);
-                                m.m_recv_futures.emplace_back(
-                                    typename std::remove_reference_t<decltype(m)>::future_type{
-                                        &p1.second,
-                                        m_comm.recv(p1.second.buffer, p1.second.address, p1.second.tag).m_handle});
+                                if (p1.second.codec != compression::none)
+                                {
+                                    // compressed messages are received into a separate buffer of maximum size
+                                    p1.second.compressed.resize(detail::compressed_capacity(p1.second.size));
+                                    tl::cb::ref_message<unsigned char> msg{p1.second.compressed.data(), p1.second.compressed.size()};
+                                    m.m_recv_futures.emplace_back(
+                                        typename memory_t::future_type{
+                                            &p1.second,
+                                            m_comm.recv(msg, p1.second.address, p1.second.tag).m_handle});
+                                }
+                                else if (!chunked)
+                                {
+                                    m.m_recv_futures.emplace_back(
+                                        typename memory_t::future_type{
+                                            &p1.second,
+                                            m_comm.recv(p1.second.buffer, p1.second.address, p1.second.tag).m_handle});
+                                }
+                                else if (p1.second.chunks.empty())
+                                {
+                                    m.m_recv_chunk_futures.emplace_back(
+                                        typename memory_t::chunk_future_type{
+                                            {&p1.second, nullptr},
+                                            m_comm.recv(p1.second.buffer, p1.second.address, p1.second.tag).m_handle});
+                                }
+                                else
+                                {
+                                    // chunks are received in order since they share source and tag
+                                    for (const auto& c : p1.second.chunks)
+                                    {
+                                        tl::cb::ref_message<value_type> msg{p1.second.buffer.data()+c.begin, c.end-c.begin};
+                                        m.m_recv_chunk_futures.emplace_back(
+                                            typename memory_t::chunk_future_type{
+                                                {&p1.second, &c},
+                                                m_comm.recv(msg, p1.second.address, p1.second.tag).m_handle});
+                                    }
+                                }
                             }
                         }
                     }
                 });
+                s.m_recorder.toc(exchange_phase::post_recvs);
             }
 
-            void pack()
+            void pack(exchange_state& s)
             {
-                detail::for_each(m_mem, [this](auto& m)
+                detail::for_each(s.m_mem, [this,&s](auto& m)
                 {
                     using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
-                    packer<arch_type>::pack(m,m_send_futures,m_comm);
+                    packer<arch_type>::pack(m,s.m_send_futures,m_comm,s.m_recorder);
+                });
+                capture::exchange_posted();
+            }
+
+            // compute the chunk layout of all buffers (identical on the sending and the receiving side)
+            void make_chunks(exchange_state& s)
+            {
+                if (m_chunk_size == 0u) return;
+                detail::for_each(s.m_mem, [this](auto& m)
+                {
+                    for (auto& p0 : m.send_memory)
+                        for (auto& p1 : p0.second)
+                            make_chunks(p1.second);
+                    for (auto& p0 : m.recv_memory)
+                        for (auto& p1 : p0.second)
+                            make_chunks(p1.second);
+                });
+            }
+
+            template<typename Buffer>
+            void make_chunks(Buffer& b)
+            {
+                b.chunks.clear();
+                if (b.size <= m_chunk_size) return;
+                chunk c{0u, 0u, {}};
+                index_container_type pieces;
+                for (std::size_t f=0; f<b.field_infos.size(); ++f)
+                {
+                    const auto& fi = b.field_infos[f];
+                    const std::size_t max_elements = std::max(m_chunk_size/fi.element_size, std::size_t{1});
+                    pieces.clear();
+                    for (const auto& is : *fi.index_container)
+                        pattern_type::split(is, max_elements, pieces);
+                    std::size_t offset = fi.offset;
+                    for (const auto& is : pieces)
+                    {
+                        const std::size_t bytes = static_cast<std::size_t>(is.size())*fi.element_size;
+                        // close the current chunk if the piece does not fit anymore
+                        if (!c.pieces.empty() && offset+bytes-c.begin > m_chunk_size)
+                        {
+                            c.end = offset;
+                            b.chunks.push_back(std::move(c));
+                            c = chunk{offset, 0u, {}};
+                        }
+                        if (c.pieces.empty() || c.pieces.back().field_index != f)
+                            c.pieces.push_back(typename chunk::piece{f, offset, {}});
+                        c.pieces.back().index_container.push_back(is);
+                        offset += bytes;
+                    }
+                }
+                c.end = b.size;
+                b.chunks.push_back(std::move(c));
+            }
+
+            // select the codec of each buffer (identical on the sending and the receiving side): only unchunked cpu
+            // buffers above the threshold are compressed
+            void setup_compression(exchange_state& s)
+            {
+                detail::for_each(s.m_mem, [this](auto& m)
+                {
+                    using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
+                    auto select = [this](auto& b)
+                    {
+                        if (m_compression != compression::none) b.codec = m_compression;
+                        if (!std::is_same<arch_type,cpu>::value || !b.chunks.empty() || b.size < m_compression_threshold)
+                            b.codec = compression::none;
+                    };
+                    for (auto& p0 : m.send_memory)
+                        for (auto& p1 : p0.second)
+                            select(p1.second);
+                    for (auto& p0 : m.recv_memory)
+                        for (auto& p1 : p0.second)
+                            select(p1.second);
                 });
             }
 
         private: // wait functions
 
-            void wait()
+            void wait(exchange_state& s)
             {
-                if (!m_valid) return;
-                detail::for_each(m_mem, [this](auto& m)
+                if (!s.m_valid) return;
+                // time spent between starting and waiting on the exchange is not attributed to any phase
+                s.m_recorder.tic();
+                detail::for_each(s.m_mem, [this,&s](auto& m)
                 {
                     using arch_type = typename std::remove_reference_t<decltype(m)>::arch_type;
-                    packer<arch_type>::unpack(m);
+                    packer<arch_type>::unpack(m, m_wait_strategy, s.m_recorder);
                 });
-                for (auto& f : m_send_futures) 
+                for (auto& f : s.m_send_futures) 
                     f.wait();
-                clear();
+                s.m_recorder.toc(exchange_phase::wait);
+                s.m_recorder.commit(m_profile);
+                capture::exchange_end(m_comm.rank(), s.m_capture_id);
+                clear(s);
             }
 
 #ifdef __CUDACC__
             template<typename T, typename Field>
-            void wait_u()
+            void wait_u(exchange_state& s)
             {
-                if (!m_valid) return;
+                if (!s.m_valid) return;
                 using memory_t   = buffer_memory<gpu>;
-                memory_t& mem = std::get<memory_t>(m_mem);
-                packer<gpu>::template unpack_u<T,Field>(mem);
-                for (auto& f : m_send_futures) 
+                memory_t& mem = std::get<memory_t>(s.m_mem);
+                s.m_recorder.tic();
+                packer<gpu>::template unpack_u<T,Field>(mem, m_wait_strategy);
+                s.m_recorder.toc(exchange_phase::unpack);
+                for (auto& f : s.m_send_futures) 
                     f.wait();
-                clear();
+                s.m_recorder.toc(exchange_phase::wait);
+                s.m_recorder.commit(m_profile);
+                capture::exchange_end(m_comm.rank(), s.m_capture_id);
+                clear(s);
             }
 #endif
         
@@ -414,19 +981,23 @@ namespace gridtools {
 
             // clear the internal flags so that a new exchange can be started
             // important: does not deallocate
-            void clear()
+            void clear(exchange_state& s)
             {
-                m_valid = false;
-                m_send_futures.clear();
-                detail::for_each(m_mem, [this](auto& m)
+                s.m_valid = false;
+                s.m_send_futures.clear();
+                detail::for_each(s.m_mem, [](auto& m)
                 {
                     m.m_recv_futures.clear();
+                    m.m_recv_chunk_futures.clear();
                     for (auto& p0 : m.send_memory)
                         for (auto& p1 : p0.second)
                         {
                             p1.second.buffer.resize(0);
                             p1.second.size = 0;
                             p1.second.field_infos.resize(0);
+                            p1.second.chunks.clear();
+                            p1.second.codec = compression::none;
+                            p1.second.compressed.resize(0);
                         }
                     for (auto& p0 : m.recv_memory)
                         for (auto& p1 : p0.second)
@@ -434,6 +1005,9 @@ namespace gridtools {
                             p1.second.buffer.resize(0);
                             p1.second.size = 0;
                             p1.second.field_infos.resize(0);
+                            p1.second.chunks.clear();
+                            p1.second.codec = compression::none;
+                            p1.second.compressed.resize(0);
                         }
                 });
             }
@@ -441,12 +1015,13 @@ namespace gridtools {
         private: // allocation member functions
 
             template<typename Arch, typename T, typename Memory, typename Field, typename O>
-            void allocate(Memory& mem, const pattern_type& pattern, Field* field_ptr, domain_id_type dom_id, typename arch_traits<Arch>::device_id_type device_id, O tag_offset)
+            void allocate(Memory& mem, const pattern_type& pattern, Field* field_ptr, domain_id_type dom_id, typename arch_traits<Arch>::device_id_type device_id, O tag_offset,
+                compression codec = compression::none)
             {
-                auto& pool = mem->m_pools[device_id];
+                auto& pool = std::get<pool_memory<Arch>>(m_pools).m_pools[device_id];
                 if (!pool)
                 {
-                    pool.reset( new typename arch_traits<Arch>::pool_type{ typename arch_traits<Arch>::basic_allocator_type{} } );
+                    pool.reset( new typename arch_traits<Arch>::pool_type{ arch_traits<Arch>::make_basic_allocator(m_numa_placement) } );
                 }
                 allocate<Arch,T,typename buffer_memory<Arch>::recv_buffer_type>( 
                     mem->recv_memory[device_id], 
@@ -460,7 +1035,9 @@ namespace gridtools {
                     tag_offset, 
                     true, 
                     *pool,
-                    field_ptr);
+                    field_ptr,
+                    1u,
+                    codec);
                 allocate<Arch,T,typename buffer_memory<Arch>::send_buffer_type>(
                     mem->send_memory[device_id], 
                     pattern.send_halos(),
@@ -473,15 +1050,49 @@ namespace gridtools {
                     tag_offset, 
                     false, 
                     *pool, 
-                    field_ptr);
+                    field_ptr,
+                    1u,
+                    codec);
+            }
+
+            // allocate one buffer slot per halo for a group of fields which are packed/unpacked together
+            template<typename Arch, typename T, typename Memory, typename Field, typename O>
+            void allocate_fused(Memory& mem, const pattern_type& pattern, Field* field_ptr, std::vector<T*> data,
+                domain_id_type dom_id, typename arch_traits<Arch>::device_id_type device_id, O tag_offset,
+                compression codec = compression::none)
+            {
+                auto& pool = std::get<pool_memory<Arch>>(m_pools).m_pools[device_id];
+                if (!pool)
+                {
+                    pool.reset( new typename arch_traits<Arch>::pool_type{ arch_traits<Arch>::make_basic_allocator(m_numa_placement) } );
+                }
+                const std::size_t num_fields = data.size();
+                const bool interleaved = (m_fused_layout == fused_layout::interleaved);
+                auto data_ptr = std::make_shared<const std::vector<T*>>(std::move(data));
+                auto unpack_fct = [field_ptr,data_ptr,interleaved](const void* buffer, const index_container_type& c, void* arg)
+                {
+                    field_ptr->unpack_fused(reinterpret_cast<const T*>(buffer),c,data_ptr->data(),data_ptr->size(),interleaved,arg);
+                };
+                auto pack_fct = [field_ptr,data_ptr,interleaved](void* buffer, const index_container_type& c, void* arg)
+                {
+                    field_ptr->pack_fused(reinterpret_cast<T*>(buffer),c,data_ptr->data(),data_ptr->size(),interleaved,arg);
+                };
+                allocate<Arch,T,typename buffer_memory<Arch>::recv_buffer_type>(
+                    mem->recv_memory[device_id], pattern.recv_halos(), unpack_fct, dom_id, device_id, tag_offset, true,
+                    *pool, field_ptr, num_fields, codec);
+                allocate<Arch,T,typename buffer_memory<Arch>::send_buffer_type>(
+                    mem->send_memory[device_id], pattern.send_halos(), pack_fct, dom_id, device_id, tag_offset, false,
+                    *pool, field_ptr, num_fields, codec);
             }
 
             // compute memory requirements to be allocated on the device
             template<typename Arch, typename ValueType, typename BufferType, typename Memory, typename Halos, typename Function, typename DeviceIdType, 
                 typename Pool, typename Field = void>
             void allocate(Memory& memory, const Halos& halos, Function&& func, domain_id_type my_dom_id, DeviceIdType device_id, 
-                          int tag_offset, bool receive, Pool& pool, Field* field_ptr = nullptr)
+                          int tag_offset, bool receive, Pool& pool, Field* field_ptr = nullptr, std::size_t num_fields = 1u,
+                          compression codec = compression::none)
             {
+                const std::size_t element_size = sizeof(ValueType)*num_fields;
                 for (const auto& p_id_c : halos)
                 {
                     const auto num_elements   = pattern_type::num_elements(p_id_c.second);
@@ -511,7 +1122,12 @@ namespace gridtools {
                                 arch_traits<Arch>::make_message(pool, device_id),
                                 0,
                                 std::vector<typename BufferType::field_info_type>(),
-                                cuda::stream()
+                                cuda::stream(),
+                                std::vector<chunk>(),
+                                compression::none,
+                                0u,
+                                std::vector<unsigned char>(),
+                                std::vector<unsigned char>()
                             })).first;
                     }
                     else if (it->second.size==0)
@@ -520,11 +1136,16 @@ namespace gridtools {
                         it->second.tag = p_id_c.first.tag+tag_offset;
                         it->second.field_infos.resize(0);
                     }
+                    // a buffer is compressed if any of its fields requests it; shuffling uses the smallest value size
+                    if (it->second.field_infos.empty()) it->second.word_size = sizeof(ValueType);
+                    it->second.word_size = std::min(it->second.word_size, sizeof(ValueType));
+                    if (it->second.codec == compression::none) it->second.codec = codec;
                     const auto prev_size = it->second.size;
                     const auto padding = ((prev_size+alignof(ValueType)-1)/alignof(ValueType))*alignof(ValueType) - prev_size;
                     it->second.field_infos.push_back(
-                        typename BufferType::field_info_type{std::forward<Function>(func), &p_id_c.second, prev_size + padding, field_ptr});
-                    it->second.size += padding + static_cast<std::size_t>(num_elements)*sizeof(ValueType);
+                        typename BufferType::field_info_type{std::forward<Function>(func), &p_id_c.second, prev_size + padding, field_ptr,
+                            element_size});
+                    it->second.size += padding + static_cast<std::size_t>(num_elements)*element_size;
                 }
             }
         };
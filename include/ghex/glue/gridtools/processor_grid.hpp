@@ -13,6 +13,7 @@
 
 #include <mpi.h>
 #include <array>
+#include <vector>
 
 #include "../../structured/domain_descriptor.hpp"
 #include "../../transport_layer/mpi/communicator.hpp"
@@ -50,70 +51,28 @@ namespace gridtools {
             std::array<bool, 3> periodic;
             std::copy(periodicity.begin(), periodicity.end(), periodic.begin());
 
-            // scan algorithm: x-direction
-            std::vector<int> extents_x(dims[0]);
-            for (int i=0; i<dims[0]; ++i)
+            // scan algorithm: a single allgather of the local extents, followed by a local scan along the line
+            // of the processor grid through this process in each dimension
+            std::vector<int> all_extents(3*context.size());
+            int lext[3] = {local_extents[0], local_extents[1], local_extents[2]};
+            MPI_Allgather(lext, 3, MPI_INT, all_extents.data(), 3, MPI_INT, context.mpi_comm());
+            std::array<std::vector<int>, 3> line_extents;
+            for (int d=0; d<3; ++d)
             {
-                int coords_i[3] = {i,0,0};
-                int rank_i;
-                MPI_Cart_rank(context.mpi_comm(), coords_i, &rank_i);
-                if (coords[0]==i && coords[1]==0 && coords[2]==0)
+                line_extents[d].resize(dims[d]);
+                for (int i=0; i<dims[d]; ++i)
                 {
-                    // broadcast
-                    int lext = local_extents[0];
-                    extents_x[i] = lext;
-                    MPI_Bcast(&lext, sizeof(int), MPI_BYTE, rank_i, context.mpi_comm());
-                }
-                else
-                {
-                    // recv
-                    MPI_Bcast(&extents_x[i], sizeof(int), MPI_BYTE, rank_i, context.mpi_comm());
-                }
-            }
-            std::partial_sum(extents_x.begin(), extents_x.end(), extents_x.begin());
-            // scan algorithm: y-direction
-            std::vector<int> extents_y(dims[1]);
-            for (int i=0; i<dims[1]; ++i)
-            {
-                int coords_i[3] = {0,i,0};
-                int rank_i;
-                MPI_Cart_rank(context.mpi_comm(), coords_i, &rank_i);
-                if (coords[1]==i && coords[0]==0 && coords[2]==0)
-                {
-                    // broadcast
-                    int lext = local_extents[1];
-                    extents_y[i] = lext;
-                    MPI_Bcast(&lext, sizeof(int), MPI_BYTE, rank_i, context.mpi_comm());
-                }
-                else
-                {
-                    // recv
-                    MPI_Bcast(&extents_y[i], sizeof(int), MPI_BYTE, rank_i, context.mpi_comm());
+                    int coords_i[3] = {coords[0], coords[1], coords[2]};
+                    coords_i[d] = i;
+                    int rank_i;
+                    MPI_Cart_rank(context.mpi_comm(), coords_i, &rank_i);
+                    line_extents[d][i] = all_extents[3*rank_i+d];
                 }
+                std::partial_sum(line_extents[d].begin(), line_extents[d].end(), line_extents[d].begin());
             }
-            std::partial_sum(extents_y.begin(), extents_y.end(), extents_y.begin());
-            // scan algorithm: z-direction
-            std::vector<int> extents_z(dims[2]);
-            for (int i=0; i<dims[2]; ++i)
-            {
-                int coords_i[3] = {0,0,i};
-                int rank_i;
-                MPI_Cart_rank(context.mpi_comm(), coords_i, &rank_i);
-                if (coords[2]==i && coords[0]==0 && coords[1]==0)
-                {
-                    // broadcast
-                    int lext = local_extents[2];
-                    extents_z[i] = lext;
-                    MPI_Bcast(&lext, sizeof(int), MPI_BYTE, rank_i, context.mpi_comm());
-                }
-                else
-                {
-                    // recv
-                    MPI_Bcast(&extents_z[i], sizeof(int), MPI_BYTE, rank_i, context.mpi_comm());
-                }
-            }
-            std::partial_sum(extents_z.begin(), extents_z.end(), extents_z.begin());
-
+            const auto& extents_x = line_extents[0];
+            const auto& extents_y = line_extents[1];
+            const auto& extents_z = line_extents[2];
 
             const std::array<int, 3> global_extents = {
                 extents_x.back(),
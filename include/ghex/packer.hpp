@@ -12,22 +12,27 @@
 #define INCLUDED_GHEX_PACKER_HPP
 
 #include "./common/await_futures.hpp"
+#include "./common/compression.hpp"
+#include "./common/exchange_profile.hpp"
 #include "./arch_list.hpp"
 #include "./structured/field_utils.hpp"
 #include "./cuda_utils/kernel_argument.hpp"
 #include "./cuda_utils/future.hpp"
+#include "./transport_layer/callback_utils.hpp"
 #include <gridtools/common/array.hpp>
 
 namespace gridtools {
 
     namespace ghex {
 
-        /** @brief generic implementation of pack and unpack */
+        /** @brief generic implementation of pack and unpack. The optional recorder attributes the time spent to
+          * the pack, send, wait and unpack phases and counts the traffic per neighbor (see exchange_profile.hpp). */
         template<typename Arch>
         struct packer
         {
-            template<typename Map, typename Futures, typename Communicator>
-            static void pack(Map& map, Futures& send_futures,Communicator& comm)
+            template<typename Map, typename Futures, typename Communicator,
+                typename Recorder = detail::null_recorder>
+            static void pack(Map& map, Futures& send_futures,Communicator& comm, Recorder&& rec = Recorder{})
             {
                 for (auto& p0 : map.send_memory)
                 {
@@ -36,24 +41,86 @@ namespace gridtools {
                         if (p1.second.size > 0u)
                         {
                             p1.second.buffer.resize(p1.second.size);
-                            for (const auto& fb : p1.second.field_infos)
-                                fb.call_back( p1.second.buffer.data() + fb.offset, *fb.index_container, nullptr);
-                            send_futures.push_back(comm.send(p1.second.buffer, p1.second.address, p1.second.tag));
+                            if (p1.second.chunks.empty())
+                            {
+                                for (const auto& fb : p1.second.field_infos)
+                                    fb.call_back( p1.second.buffer.data() + fb.offset, *fb.index_container, nullptr);
+                                if (p1.second.codec == compression::none)
+                                {
+                                    rec.toc(exchange_phase::pack);
+                                    send_futures.push_back(comm.send(p1.second.buffer, p1.second.address, p1.second.tag));
+                                }
+                                else
+                                {
+                                    auto& b = p1.second;
+                                    b.compressed.resize(detail::compressed_capacity(b.size));
+                                    const std::size_t n = detail::compress(b.codec, b.buffer.data(), b.size, b.word_size,
+                                        b.history, map.m_compression_scratch, b.compressed.data());
+                                    map.m_compression_stats.raw_bytes += b.size;
+                                    map.m_compression_stats.sent_bytes += n;
+                                    rec.toc(exchange_phase::pack);
+                                    send_futures.push_back(comm.send(
+                                        tl::cb::ref_message<unsigned char>{b.compressed.data(), n}, b.address, b.tag));
+                                }
+                                rec.toc(exchange_phase::send);
+                                rec.sent(p1.second.address, p1.second.size);
+                            }
+                            else
+                            {
+                                // send each chunk as soon as it is packed
+                                using value_type = typename Map::vector_type::value_type;
+                                for (const auto& c : p1.second.chunks)
+                                {
+                                    for (const auto& pc : c.pieces)
+                                        p1.second.field_infos[pc.field_index].call_back(
+                                            p1.second.buffer.data() + pc.offset, pc.index_container, nullptr);
+                                    rec.toc(exchange_phase::pack);
+                                    send_futures.push_back(comm.send(
+                                        tl::cb::ref_message<value_type>{p1.second.buffer.data()+c.begin, c.end-c.begin},
+                                        p1.second.address, p1.second.tag));
+                                    rec.toc(exchange_phase::send);
+                                    rec.sent(p1.second.address, (c.end-c.begin)*sizeof(value_type));
+                                }
+                            }
                         }
                     }
                 }
             }
 
-            template<typename BufferMem>
-            static void unpack(BufferMem& m)
+            template<typename BufferMem, typename Recorder = detail::null_recorder>
+            static void unpack(BufferMem& m, wait_strategy ws = wait_strategy::spin, Recorder&& rec = Recorder{})
             {
                 await_futures(
                     m.m_recv_futures,
-                    [](typename BufferMem::hook_type hook)
+                    [&m,&rec](typename BufferMem::hook_type hook)
                     {
+                        rec.toc(exchange_phase::wait);
+                        if (hook->codec != compression::none)
+                            detail::decompress(hook->codec, hook->compressed.data(), hook->buffer.data(), hook->size,
+                                hook->history, m.m_compression_scratch);
                         for (const auto& fb :  hook->field_infos)
                             fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, nullptr);
-                    });
+                        rec.toc(exchange_phase::unpack);
+                        rec.received(hook->address, hook->size);
+                    }, ws);
+                // chunked receives: unpack each chunk as soon as it arrives
+                await_futures(
+                    m.m_recv_chunk_futures,
+                    [&rec](typename BufferMem::chunk_hook_type hook)
+                    {
+                        rec.toc(exchange_phase::wait);
+                        auto b = hook.first;
+                        if (!hook.second)
+                            for (const auto& fb :  b->field_infos)
+                                fb.call_back(b->buffer.data() + fb.offset, *fb.index_container, nullptr);
+                        else
+                            for (const auto& pc : hook.second->pieces)
+                                b->field_infos[pc.field_index].call_back(
+                                    b->buffer.data() + pc.offset, pc.index_container, nullptr);
+                        rec.toc(exchange_phase::unpack);
+                        rec.received(b->address,
+                            hook.second ? (hook.second->end-hook.second->begin)*sizeof(*b->buffer.data()) : b->size);
+                    }, ws);
             }
         };
 
@@ -118,8 +185,9 @@ namespace gridtools {
         template<>
         struct packer<gpu>
         {
-            template<typename Map, typename Futures, typename Communicator>
-            static void pack(Map& map, Futures& send_futures,Communicator& comm)
+            template<typename Map, typename Futures, typename Communicator,
+                typename Recorder = detail::null_recorder>
+            static void pack(Map& map, Futures& send_futures,Communicator& comm, Recorder&& rec = Recorder{})
             {
                 using send_buffer_type     = typename Map::send_buffer_type;
                 using future_type = cuda::future<send_buffer_type*>;
@@ -144,9 +212,20 @@ namespace gridtools {
                     {
                         if (p1.second.size > 0u)
                         {
-                            for (const auto& fb : p1.second.field_infos)
+                            if (p1.second.chunks.empty())
                             {
-                                fb.call_back( p1.second.buffer.data() + fb.offset, *fb.index_container, (void*)(&p1.second.m_cuda_stream.get()));
+                                for (const auto& fb : p1.second.field_infos)
+                                {
+                                    fb.call_back( p1.second.buffer.data() + fb.offset, *fb.index_container, (void*)(&p1.second.m_cuda_stream.get()));
+                                }
+                            }
+                            else
+                            {
+                                // chunked buffers are packed piece-wise (same layout as on the host) and sent as a whole
+                                for (const auto& c : p1.second.chunks)
+                                    for (const auto& pc : c.pieces)
+                                        p1.second.field_infos[pc.field_index].call_back(
+                                            p1.second.buffer.data() + pc.offset, pc.index_container, (void*)(&p1.second.m_cuda_stream.get()));
                             }
                             stream_futures.push_back( future_type{&(p1.second), p1.second.m_cuda_stream} );
                             ++num_streams;
@@ -155,31 +234,70 @@ namespace gridtools {
                 }
                 await_futures(
                     stream_futures, 
-                    [&comm,&send_futures](send_buffer_type* b)
+                    [&comm,&send_futures,&rec](send_buffer_type* b)
                     {
-                        send_futures.push_back(comm.send(b->buffer, b->address, b->tag));
+                        rec.toc(exchange_phase::pack);
+                        if (b->chunks.empty())
+                        {
+                            send_futures.push_back(comm.send(b->buffer, b->address, b->tag));
+                            rec.sent(b->address, b->size);
+                        }
+                        else
+                        {
+                            using value_type = typename Map::vector_type::value_type;
+                            for (const auto& c : b->chunks)
+                            {
+                                send_futures.push_back(comm.send(
+                                    tl::cb::ref_message<value_type>{b->buffer.data()+c.begin, c.end-c.begin},
+                                    b->address, b->tag));
+                                rec.sent(b->address, (c.end-c.begin)*sizeof(value_type));
+                            }
+                        }
+                        rec.toc(exchange_phase::send);
                     });
             }
 
-            template<typename BufferMem>
-            static void unpack(BufferMem& m)
+            template<typename BufferMem, typename Recorder = detail::null_recorder>
+            static void unpack(BufferMem& m, wait_strategy ws = wait_strategy::spin, Recorder&& rec = Recorder{})
             {
                 std::vector<cudaStream_t*> stream_ptrs;
-                stream_ptrs.reserve(m.m_recv_futures.size());
+                stream_ptrs.reserve(m.m_recv_futures.size() + m.m_recv_chunk_futures.size());
                 await_futures(
                     m.m_recv_futures,
-                    [&stream_ptrs](typename BufferMem::hook_type hook)
+                    [&stream_ptrs,&rec](typename BufferMem::hook_type hook)
                     {
+                        rec.toc(exchange_phase::wait);
                         auto stream_ptr = &hook->m_cuda_stream.get();
                         for (const auto& fb : hook->field_infos)
                                 fb.call_back(hook->buffer.data() + fb.offset, *fb.index_container, (void*)(stream_ptr));
                         stream_ptrs.push_back(stream_ptr);
-
-                    });
+                        rec.toc(exchange_phase::unpack);
+                        rec.received(hook->address, hook->size);
+                    }, ws);
+                await_futures(
+                    m.m_recv_chunk_futures,
+                    [&stream_ptrs,&rec](typename BufferMem::chunk_hook_type hook)
+                    {
+                        rec.toc(exchange_phase::wait);
+                        auto b = hook.first;
+                        auto stream_ptr = &b->m_cuda_stream.get();
+                        if (!hook.second)
+                            for (const auto& fb : b->field_infos)
+                                fb.call_back(b->buffer.data() + fb.offset, *fb.index_container, (void*)(stream_ptr));
+                        else
+                            for (const auto& pc : hook.second->pieces)
+                                b->field_infos[pc.field_index].call_back(
+                                    b->buffer.data() + pc.offset, pc.index_container, (void*)(stream_ptr));
+                        stream_ptrs.push_back(stream_ptr);
+                        rec.toc(exchange_phase::unpack);
+                        rec.received(b->address,
+                            hook.second ? (hook.second->end-hook.second->begin)*sizeof(*b->buffer.data()) : b->size);
+                    }, ws);
                 for (auto x : stream_ptrs) 
                 {
                     cudaStreamSynchronize(*x);
                 }
+                rec.toc(exchange_phase::unpack);
             }
 
             template<typename T, typename FieldType, typename Map, typename Futures, typename Communicator>
@@ -304,7 +422,7 @@ namespace gridtools {
             }
 
             template<typename T, typename FieldType, typename BufferMem>
-            static void unpack_u(BufferMem& m)
+            static void unpack_u(BufferMem& m, wait_strategy ws = wait_strategy::spin)
             {
                 using recv_buffer_type     = typename BufferMem::recv_buffer_type;
                 using field_info_type      = typename recv_buffer_type::field_info_type;
@@ -395,7 +513,7 @@ namespace gridtools {
                             }
                         }
                         stream_ptrs.push_back(stream_ptr);
-                    });
+                    }, ws);
                 for (auto x : stream_ptrs) 
                 {
                     cudaStreamSynchronize(*x);
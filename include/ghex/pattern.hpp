@@ -22,6 +22,12 @@ namespace gridtools {
             // forward declaration
             template<typename GridType>
             struct make_pattern_impl;
+
+            template<typename GridType>
+            struct pattern_io_impl;
+
+            template<typename GridType>
+            struct make_staged_pattern_impl;
         } // namespace detail
 
         // forward declaration
@@ -44,10 +50,18 @@ namespace gridtools {
 
         private: // friend declarations
             friend class detail::make_pattern_impl<GridType>;
+            friend struct detail::pattern_io_impl<GridType>;
+            friend struct detail::make_staged_pattern_impl<GridType>;
 
         public: // copy constructor
             pattern_container(const pattern_container&) noexcept = delete;
-            pattern_container(pattern_container&&) noexcept = default;
+            pattern_container(pattern_container&& other) noexcept
+            : m_patterns(std::move(other.m_patterns)), m_max_tag(other.m_max_tag)
+            {
+                // patterns keep a back reference to their container
+                for (auto& p : m_patterns)
+                    p.m_container = this;
+            }
 
         private: // private constructor called through make_pattern
             pattern_container(data_type&& d, int mt) noexcept : m_patterns(d), m_max_tag(mt) 
@@ -101,6 +115,31 @@ namespace gridtools {
 
         }
 
+        /** @brief construct a pattern for each domain which only transfers active halo points (structured grids
+         * only). The receive halos are split into boxes of active points, hence the halo volume scales with the
+         * number of active points. The mask must be consistent across ranks: a halo point is active if and only if
+         * the owning domain treats it as active.
+         * @tparam GridType indicates structured/unstructured grids
+         * @tparam Transport transport protocol
+         * @tparam ThreadPrimitives threading primitivs (locks etc.)
+         * @tparam HaloGenerator function object which takes a domain as argument
+         * @tparam DomainRange a range type holding domains
+         * @tparam Mask function object with signature bool(const domain&, const coordinate&)
+         * @param context transport layer context
+         * @param hgen receive halo generator function object (emits iteration spaces (global coordinates) or index lists)
+         * @param d_range range of local domains
+         * @param mask activity mask, evaluated at the global coordinates of the receive halo points of each domain
+         * @return iterable of patterns (one per domain)
+         */
+        template<typename GridType, typename Transport, typename ThreadPrimitives, typename HaloGenerator, typename DomainRange,
+            typename Mask>
+        auto make_pattern(tl::context<Transport,ThreadPrimitives>& context, HaloGenerator&& hgen, DomainRange&& d_range,
+            const Mask& mask)
+        {
+            using grid_type = typename GridType::template type<typename std::remove_reference_t<DomainRange>::value_type>;
+            return detail::make_pattern_impl<grid_type>::apply(context, std::forward<HaloGenerator>(hgen), std::forward<DomainRange>(d_range), mask);
+        }
+
     } // namespace ghex
 
 } // namespace gridtools
@@ -0,0 +1,337 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_PATTERN_IO_HPP
+#define INCLUDED_GHEX_PATTERN_IO_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <stdexcept>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "./pattern.hpp"
+
+namespace gridtools {
+
+    namespace ghex {
+
+        namespace detail {
+
+            /** @brief 64-bit FNV-1a hash used to fingerprint a domain decomposition */
+            class pattern_hash
+            {
+            private: // members
+                std::uint64_t m_value = 14695981039346656037ull;
+
+            public: // member functions
+                void add_bytes(const void* ptr, std::size_t n) noexcept
+                {
+                    const unsigned char* p = reinterpret_cast<const unsigned char*>(ptr);
+                    for (std::size_t i=0; i<n; ++i)
+                    {
+                        m_value ^= p[i];
+                        m_value *= 1099511628211ull;
+                    }
+                }
+
+                template<typename T>
+                void add(const T& t) noexcept
+                {
+                    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be hashed");
+                    add_bytes(&t, sizeof(T));
+                }
+
+                std::uint64_t value() const noexcept { return m_value; }
+            };
+
+            /** @brief appends trivially copyable objects to a contiguous byte buffer */
+            class pattern_writer
+            {
+            private: // members
+                std::vector<char> m_data;
+
+            public: // member functions
+                template<typename T>
+                void write(const T* ptr, std::size_t n)
+                {
+                    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be serialized");
+                    if (n == 0) return;
+                    const auto s = m_data.size();
+                    m_data.resize(s + n*sizeof(T));
+                    std::memcpy(m_data.data()+s, ptr, n*sizeof(T));
+                }
+
+                template<typename T>
+                void write(const T& t) { write(&t, 1); }
+
+                const std::vector<char>& data() const noexcept { return m_data; }
+            };
+
+            /** @brief reads trivially copyable objects from a (memory mapped) byte range with bounds checking */
+            class pattern_reader
+            {
+            private: // members
+                const char* m_ptr;
+                const char* m_end;
+
+            public: // ctors
+                pattern_reader(const char* ptr, std::size_t n) noexcept : m_ptr{ptr}, m_end{ptr+n} {}
+
+            public: // member functions
+                template<typename T>
+                void read(T* ptr, std::size_t n)
+                {
+                    static_assert(std::is_trivially_copyable<T>::value, "only trivially copyable types can be deserialized");
+                    if (n == 0) return;
+                    if (static_cast<std::size_t>(m_end-m_ptr) < n*sizeof(T))
+                        throw std::runtime_error("pattern file is truncated");
+                    std::memcpy(ptr, m_ptr, n*sizeof(T));
+                    m_ptr += n*sizeof(T);
+                }
+
+                template<typename T>
+                T read() { T t; read(&t, 1); return t; }
+
+                bool at_end() const noexcept { return m_ptr == m_end; }
+            };
+
+            /** @brief read-only private memory mapping of a whole file (RAII) */
+            class mapped_file
+            {
+            private: // members
+                void*       m_ptr = nullptr;
+                std::size_t m_size = 0;
+
+            public: // ctors
+                mapped_file(const std::string& filename)
+                {
+                    const int fd = ::open(filename.c_str(), O_RDONLY);
+                    if (fd < 0) throw std::runtime_error("could not open pattern file " + filename);
+                    struct stat st;
+                    if (::fstat(fd, &st) != 0 || st.st_size <= 0)
+                    {
+                        ::close(fd);
+                        throw std::runtime_error("could not stat pattern file " + filename);
+                    }
+                    m_size = static_cast<std::size_t>(st.st_size);
+                    m_ptr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                    ::close(fd);
+                    if (m_ptr == MAP_FAILED)
+                    {
+                        m_ptr = nullptr;
+                        throw std::runtime_error("could not map pattern file " + filename);
+                    }
+                }
+                mapped_file(const mapped_file&) = delete;
+                mapped_file(mapped_file&&) = delete;
+                ~mapped_file() { if (m_ptr) ::munmap(m_ptr, m_size); }
+
+            public: // member functions
+                const char* data() const noexcept { return reinterpret_cast<const char*>(m_ptr); }
+                std::size_t size() const noexcept { return m_size; }
+            };
+
+            /** @brief fixed size header at the beginning of each pattern file */
+            struct pattern_file_header
+            {
+                char          magic[8];
+                std::uint32_t version;
+                std::uint32_t grid_kind;
+                std::uint64_t hash;
+                std::int32_t  max_tag;
+                std::int32_t  num_patterns;
+            };
+
+            static constexpr const char    pattern_file_magic[8] = {'G','H','E','X','P','A','T','\0'};
+            static constexpr std::uint32_t pattern_file_version = 2; // 2: real max_tag of unstructured patterns
+
+            inline std::string pattern_file_name(const std::string& prefix, int rank)
+            {
+                return prefix + "." + std::to_string(rank) + ".ghexpat";
+            }
+
+            /** @brief computes the decomposition hash: communicator layout, user key and the local domains
+             * (the latter are fed in by the grid specific implementation) */
+            template<typename GridType, typename DomainRange>
+            std::uint64_t decomposition_hash(int rank, int size, std::uint64_t key, const DomainRange& d_range)
+            {
+                const std::uint32_t grid_kind = pattern_io_impl<GridType>::grid_kind;
+                pattern_hash h;
+                h.add(grid_kind);
+                h.add(rank);
+                h.add(size);
+                h.add(key);
+                pattern_io_impl<GridType>::hash(h, d_range);
+                return h.value();
+            }
+
+            /** @brief mixes the halos generated for the local domains into a user key, such that patterns computed
+             * with a different halo configuration are not loaded */
+            template<typename GridType, typename HaloGenerator, typename DomainRange>
+            std::uint64_t halo_key(std::uint64_t key, const HaloGenerator& hgen, const DomainRange& d_range)
+            {
+                pattern_hash h;
+                h.add(key);
+                pattern_io_impl<GridType>::hash_halos(h, hgen, d_range);
+                return h.value();
+            }
+
+        } // namespace detail
+
+        /**
+         * @brief write the patterns of this rank to a binary file "<prefix>.<rank>.ghexpat". The file is tagged
+         * with a hash of the domain decomposition (number of ranks, this rank, local domains and a user supplied key)
+         * so that it can only be loaded back into an identical decomposition.
+         * Note: the halo generator is not part of the hash - use the key argument to distinguish different halo
+         * configurations on the same decomposition (make_pattern_cached mixes the generated halos into the key).
+         * @tparam Communicator communicator type
+         * @tparam GridType indicates structured/unstructured grids
+         * @tparam DomainIdType domain id type
+         * @tparam Transport transport protocol
+         * @tparam ThreadPrimitives threading primitivs (locks etc.)
+         * @tparam DomainRange a range type holding domains
+         * @param context transport layer context
+         * @param patterns pattern container to be saved
+         * @param d_range range of local domains which was used to create the patterns
+         * @param prefix file name prefix
+         * @param key user supplied key which is mixed into the decomposition hash
+         */
+        template<typename Communicator, typename GridType, typename DomainIdType,
+                 typename Transport, typename ThreadPrimitives, typename DomainRange>
+        void save_pattern(tl::context<Transport,ThreadPrimitives>& context,
+                          const pattern_container<Communicator,GridType,DomainIdType>& patterns,
+                          const DomainRange& d_range, const std::string& prefix, std::uint64_t key = 0)
+        {
+            detail::pattern_file_header header;
+            std::memcpy(header.magic, detail::pattern_file_magic, 8);
+            header.version      = detail::pattern_file_version;
+            header.grid_kind    = detail::pattern_io_impl<GridType>::grid_kind;
+            header.hash         = detail::decomposition_hash<GridType>(context.rank(), context.size(), key, d_range);
+            header.max_tag      = patterns.max_tag();
+            header.num_patterns = patterns.size();
+
+            detail::pattern_writer w;
+            w.write(header);
+            for (const auto& p : patterns)
+                detail::pattern_io_impl<GridType>::save(w, p);
+
+            const auto filename = detail::pattern_file_name(prefix, context.rank());
+            std::ofstream os(filename, std::ios::binary | std::ios::trunc);
+            if (!os) throw std::runtime_error("could not create pattern file " + filename);
+            os.write(w.data().data(), w.data().size());
+            if (!os) throw std::runtime_error("could not write pattern file " + filename);
+        }
+
+        /**
+         * @brief load patterns previously stored with save_pattern. The file is memory mapped and validated against the
+         * current decomposition. This function is collective: if the file of any rank is missing or invalid, an
+         * exception is thrown on all ranks.
+         * @tparam GridType indicates structured/unstructured grids
+         * @tparam Transport transport protocol
+         * @tparam ThreadPrimitives threading primitivs (locks etc.)
+         * @tparam DomainRange a range type holding domains
+         * @param context transport layer context
+         * @param d_range range of local domains
+         * @param prefix file name prefix
+         * @param key user supplied key which is mixed into the decomposition hash
+         * @return iterable of patterns (one per domain)
+         */
+        template<typename GridType, typename Transport, typename ThreadPrimitives, typename DomainRange>
+        auto load_pattern(tl::context<Transport,ThreadPrimitives>& context, DomainRange&& d_range,
+                          const std::string& prefix, std::uint64_t key = 0)
+        {
+            using grid_type      = typename GridType::template type<typename std::remove_reference_t<DomainRange>::value_type>;
+            using impl_type      = detail::pattern_io_impl<grid_type>;
+            using container_type = decltype(impl_type::load(context, std::declval<detail::pattern_reader&>(), d_range, 0, 0));
+
+            std::unique_ptr<container_type> result;
+            std::string error;
+            try
+            {
+                detail::mapped_file file(detail::pattern_file_name(prefix, context.rank()));
+                detail::pattern_reader r(file.data(), file.size());
+                const auto header = r.read<detail::pattern_file_header>();
+                if (std::memcmp(header.magic, detail::pattern_file_magic, 8) != 0)
+                    throw std::runtime_error("not a pattern file");
+                if (header.version != detail::pattern_file_version)
+                    throw std::runtime_error("unsupported pattern file version");
+                if (header.grid_kind != impl_type::grid_kind)
+                    throw std::runtime_error("pattern file holds a different grid type");
+                if (header.hash != detail::decomposition_hash<grid_type>(context.rank(), context.size(), key, d_range))
+                    throw std::runtime_error("pattern file does not match the domain decomposition");
+                result.reset(new container_type(impl_type::load(context, r, d_range, header.max_tag, header.num_patterns)));
+                if (!r.at_end())
+                    throw std::runtime_error("pattern file has trailing data");
+            }
+            catch (std::exception& e)
+            {
+                error = e.what();
+                if (error.empty()) error = "unknown error";
+            }
+
+            // all ranks need to agree, otherwise some ranks would fall back to the collective make_pattern alone:
+            // the error messages are gathered, and the message of the first failing rank is reported on all ranks
+            auto comm = context.get_setup_communicator();
+            const int length = static_cast<int>(error.size());
+            const auto lengths = comm.all_gather(length).get();
+            const auto errors = comm.all_gather(std::vector<char>(error.begin(), error.end()), lengths).get();
+            for (int r=0; r<(int)lengths.size(); ++r)
+                if (lengths[r] > 0)
+                    throw std::runtime_error("could not load pattern on rank " + std::to_string(r) + ": " +
+                        std::string(errors[r].begin(), errors[r].end()));
+            return std::move(*result);
+        }
+
+        /**
+         * @brief load the patterns from file if a valid file exists for all ranks, otherwise compute them with
+         * make_pattern and store them for subsequent runs. The halos generated for the local domains are part of
+         * the hash, so a changed halo configuration invalidates the file. This function is collective.
+         * @tparam GridType indicates structured/unstructured grids
+         * @tparam Transport transport protocol
+         * @tparam ThreadPrimitives threading primitivs (locks etc.)
+         * @tparam HaloGenerator function object which takes a domain as argument
+         * @tparam DomainRange a range type holding domains
+         * @param context transport layer context
+         * @param hgen receive halo generator function object
+         * @param d_range range of local domains
+         * @param prefix file name prefix
+         * @param key user supplied key which is mixed into the decomposition hash
+         * @return iterable of patterns (one per domain)
+         */
+        template<typename GridType, typename Transport, typename ThreadPrimitives, typename HaloGenerator, typename DomainRange>
+        auto make_pattern_cached(tl::context<Transport,ThreadPrimitives>& context, HaloGenerator&& hgen, DomainRange&& d_range,
+                                 const std::string& prefix, std::uint64_t key = 0)
+        {
+            using grid_type = typename GridType::template type<typename std::remove_reference_t<DomainRange>::value_type>;
+            const auto full_key = detail::halo_key<grid_type>(key, hgen, d_range);
+            try
+            {
+                return load_pattern<GridType>(context, d_range, prefix, full_key);
+            }
+            catch (std::runtime_error&) {}
+            auto patterns = make_pattern<GridType>(context, std::forward<HaloGenerator>(hgen), d_range);
+            save_pattern(context, patterns, d_range, prefix, full_key);
+            return patterns;
+        }
+
+    } // namespace ghex
+
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_PATTERN_IO_HPP */
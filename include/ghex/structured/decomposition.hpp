@@ -0,0 +1,409 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_DECOMPOSITION_HPP
+#define INCLUDED_GHEX_STRUCTURED_DECOMPOSITION_HPP
+
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
+
+#include "./domain_descriptor.hpp"
+
+namespace gridtools {
+    namespace ghex {
+    namespace structured {
+
+    /** @brief Cartesian decomposition of a global domain into domains which are distributed over ranks in blocks:
+     * the rank grid has rank_dims() ranks per dimension and each rank holds a block of domains_per_rank_dims()
+     * neighboring domains. The domain grid therefore has dims() = rank_dims()*domains_per_rank_dims() domains per
+     * dimension, and the global extent along each dimension is split into parts whose sizes differ by at most one.
+     * Besides the domains, the decomposition holds a prediction of the halo traffic of a halo exchange.
+     * @tparam DomainIdType domain id type
+     * @tparam Dimension dimension of domain */
+    template<typename DomainIdType, int Dimension>
+    class cartesian_decomposition
+    {
+    public: // member types
+        using domain_descriptor_type = domain_descriptor<DomainIdType,Dimension>;
+        using domain_id_type         = DomainIdType;
+        using dimension              = std::integral_constant<int,Dimension>;
+        using coordinate_type        = std::array<int,dimension::value>;
+
+    private: // members
+        coordinate_type m_extents;
+        coordinate_type m_rank_dims;
+        coordinate_type m_sub_dims;
+        coordinate_type m_dims;
+        std::vector<std::vector<domain_descriptor_type>> m_domains;
+        std::size_t m_halo_bytes = 0u;
+        std::size_t m_remote_halo_bytes = 0u;
+        std::size_t m_max_rank_halo_bytes = 0u;
+        std::size_t m_remote_messages = 0u;
+        std::size_t m_min_points = 0u;
+        std::size_t m_max_points = 0u;
+
+    public: // ctors
+        /** @brief construct a decomposition with a given layout and compute its communication volume
+         * @tparam RangeHalos range type holding halos (2 per dimension, left/right)
+         * @tparam RangePeriodic range type holding periodicity info
+         * @param extents global extents (the global domain starts at the origin)
+         * @param halos list of halo sizes (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...)
+         * @param periodic whether global domain is periodic in dimension i
+         * @param rank_dims number of ranks per dimension
+         * @param sub_dims number of domains per rank and dimension
+         * @param shape stencil shape (box or star)
+         * @param element_size size of a halo point in bytes */
+        template<typename RangeHalos, typename RangePeriodic>
+        cartesian_decomposition(const coordinate_type& extents, const RangeHalos& halos,
+            const RangePeriodic& periodic, const coordinate_type& rank_dims, const coordinate_type& sub_dims,
+            stencil_shape shape = stencil_shape::box, std::size_t element_size = sizeof(double))
+        : m_extents(extents), m_rank_dims(rank_dims), m_sub_dims(sub_dims)
+        {
+            std::array<int,dimension::value*2> h;
+            std::array<bool,dimension::value> p;
+            h.fill(0);
+            p.fill(true);
+            std::copy(halos.begin(), halos.end(), h.begin());
+            std::copy(periodic.begin(), periodic.end(), p.begin());
+
+            int num_ranks = 1;
+            int num_domains = 1;
+            for (int i=0; i<dimension::value; ++i)
+            {
+                m_dims[i] = m_rank_dims[i]*m_sub_dims[i];
+                num_ranks *= m_rank_dims[i];
+                num_domains *= m_dims[i];
+            }
+            m_domains.resize(num_ranks);
+            std::vector<std::size_t> points(num_ranks, 0u);
+            std::vector<std::size_t> rank_halo_bytes(num_ranks, 0u);
+
+            for (int id=0; id<num_domains; ++id)
+            {
+                const coordinate_type c = unravel(id, m_dims);
+                coordinate_type first, last;
+                std::size_t size = 1u;
+                for (int i=0; i<dimension::value; ++i)
+                {
+                    first[i] = this->first(c[i], i);
+                    last[i]  = this->first(c[i]+1, i)-1;
+                    size *= last[i]-first[i]+1;
+                }
+                const int r = rank_of(c);
+                m_domains[r].push_back(domain_descriptor_type{static_cast<domain_id_type>(id), first, last});
+                points[r] += size;
+
+                // halo regions (one per neighbor domain)
+                int num_regions = 1;
+                for (int i=0; i<dimension::value; ++i) num_regions *= 3;
+                for (int j=0; j<num_regions; ++j)
+                {
+                    if (j == num_regions/2) continue;
+                    coordinate_type n_c;
+                    std::size_t volume = 1u;
+                    int num_outside = 0;
+                    bool valid = true;
+                    for (int i=0, k=j; i<dimension::value; ++i, k/=3)
+                    {
+                        const int dir = k%3-1;
+                        n_c[i] = c[i]+dir;
+                        if (dir == 0)
+                        {
+                            volume *= last[i]-first[i]+1;
+                            continue;
+                        }
+                        ++num_outside;
+                        volume *= h[i*2+(dir>0 ? 1 : 0)];
+                        if (n_c[i] < 0 || n_c[i] >= m_dims[i])
+                        {
+                            if (!p[i]) valid = false;
+                            n_c[i] = (n_c[i]+m_dims[i])%m_dims[i];
+                        }
+                    }
+                    if (!valid || volume == 0u || (shape == stencil_shape::star && num_outside > 1)) continue;
+                    const std::size_t bytes = volume*element_size;
+                    m_halo_bytes += bytes;
+                    if (rank_of(n_c) != r)
+                    {
+                        m_remote_halo_bytes += bytes;
+                        rank_halo_bytes[r] += bytes;
+                        ++m_remote_messages;
+                    }
+                }
+            }
+            m_min_points = *std::min_element(points.begin(), points.end());
+            m_max_points = *std::max_element(points.begin(), points.end());
+            m_max_rank_halo_bytes = *std::max_element(rank_halo_bytes.begin(), rank_halo_bytes.end());
+        }
+
+    public: // member functions
+        /** @brief number of ranks */
+        int size() const noexcept { return m_domains.size(); }
+        /** @brief domains of a rank, ordered by domain id */
+        const std::vector<domain_descriptor_type>& local_domains(int rank) const { return m_domains[rank]; }
+        const coordinate_type& rank_dims() const noexcept { return m_rank_dims; }
+        const coordinate_type& domains_per_rank_dims() const noexcept { return m_sub_dims; }
+        const coordinate_type& dims() const noexcept { return m_dims; }
+        const coordinate_type& extents() const noexcept { return m_extents; }
+        coordinate_type global_first() const noexcept { coordinate_type x; x.fill(0); return x; }
+        coordinate_type global_last() const noexcept
+        {
+            coordinate_type x;
+            for (int i=0; i<dimension::value; ++i) x[i] = m_extents[i]-1;
+            return x;
+        }
+
+        /** @brief bytes received by all domains in one halo exchange */
+        std::size_t halo_bytes() const noexcept { return m_halo_bytes; }
+        /** @brief bytes received from domains on other ranks */
+        std::size_t remote_halo_bytes() const noexcept { return m_remote_halo_bytes; }
+        /** @brief maximum number of bytes a single rank receives from other ranks */
+        std::size_t max_rank_halo_bytes() const noexcept { return m_max_rank_halo_bytes; }
+        /** @brief number of halo regions received from other ranks (one message each) */
+        std::size_t remote_messages() const noexcept { return m_remote_messages; }
+        std::size_t min_points_per_rank() const noexcept { return m_min_points; }
+        std::size_t max_points_per_rank() const noexcept { return m_max_points; }
+        /** @brief ratio of the maximum to the mean number of points per rank */
+        double imbalance() const noexcept
+        {
+            std::size_t total = 1u;
+            for (int i=0; i<dimension::value; ++i) total *= m_extents[i];
+            return static_cast<double>(m_max_points)*size()/total;
+        }
+
+        /** @brief print the layout and the predicted communication volume */
+        void print(std::ostream& os) const
+        {
+            auto print_dims = [&os](const coordinate_type& x)
+            {
+                for (int i=0; i<dimension::value; ++i) os << (i ? "x" : "") << x[i];
+            };
+            os << "ranks ";
+            print_dims(m_rank_dims);
+            os << ", domains per rank ";
+            print_dims(m_sub_dims);
+            os << ", domains ";
+            print_dims(m_dims);
+            os << "\n  points per rank: min " << m_min_points << ", max " << m_max_points
+               << ", imbalance " << imbalance()
+               << "\n  halo bytes per exchange: total " << m_halo_bytes << ", remote " << m_remote_halo_bytes
+               << ", max per rank " << m_max_rank_halo_bytes << ", remote messages " << m_remote_messages << "\n";
+        }
+
+    private: // implementation
+        static coordinate_type unravel(int id, const coordinate_type& dims) noexcept
+        {
+            coordinate_type c;
+            for (int i=0; i<dimension::value; ++i)
+            {
+                c[i] = id%dims[i];
+                id /= dims[i];
+            }
+            return c;
+        }
+
+        // first global coordinate of the k-th part along dimension i
+        int first(int k, int i) const noexcept
+        {
+            return static_cast<int>((static_cast<long long>(k)*m_extents[i])/m_dims[i]);
+        }
+
+        // rank holding the domain at domain grid coordinate c
+        int rank_of(const coordinate_type& c) const noexcept
+        {
+            int r = 0;
+            for (int i=dimension::value-1; i>=0; --i)
+                r = r*m_rank_dims[i] + c[i]/m_sub_dims[i];
+            return r;
+        }
+    };
+
+    namespace detail {
+
+        // all ordered factorizations of n into Dimension factors
+        template<int Dimension>
+        void factorizations(int n, int i, std::array<int,Dimension>& f, std::vector<std::array<int,Dimension>>& out)
+        {
+            if (i == Dimension-1)
+            {
+                f[i] = n;
+                out.push_back(f);
+                return;
+            }
+            // divisors come in pairs (k, n/k)
+            std::vector<int> divisors, upper;
+            for (int k=1; static_cast<long long>(k)*k<=n; ++k)
+            {
+                if (n%k) continue;
+                divisors.push_back(k);
+                if (k != n/k) upper.push_back(n/k);
+            }
+            divisors.insert(divisors.end(), upper.rbegin(), upper.rend());
+            for (int k : divisors)
+            {
+                f[i] = k;
+                factorizations<Dimension>(n/k, i+1, f, out);
+            }
+        }
+
+        // key of a candidate layout, equal to (max_points_per_rank, remote_halo_bytes, halo_bytes, remote_messages)
+        // of the decomposition constructed from it. A halo region is the product of one interval per dimension, hence
+        // its sums over all domains factor into products of sums over the parts of each dimension, and the layout
+        // is ranked without constructing its domains.
+        template<int Dimension, typename RangePeriodic>
+        std::tuple<std::size_t,std::size_t,std::size_t,std::size_t> layout_key(
+            const std::array<int,Dimension>& extents, const std::array<int,Dimension*2>& h,
+            const RangePeriodic& periodic, const std::array<int,Dimension>& rank_dims,
+            const std::array<int,Dimension>& sub_dims, stencil_shape shape, std::size_t element_size)
+        {
+            std::array<bool,Dimension> p;
+            p.fill(true);
+            std::copy(periodic.begin(), periodic.end(), p.begin());
+
+            // per dimension and direction: summed widths and number of halo intervals, all and rank local
+            std::array<std::array<std::size_t,3>,Dimension> width, width_local, count, count_local;
+            std::size_t max_points = 1u;
+            for (int i=0; i<Dimension; ++i)
+            {
+                const int n = rank_dims[i]*sub_dims[i];
+                auto first = [&extents,i,n](int k)
+                {
+                    return static_cast<int>((static_cast<long long>(k)*extents[i])/n);
+                };
+                // ranks hold blocks of parts, the largest block per dimension yields the largest rank
+                std::size_t max_block = 0u;
+                for (int b=0; b<rank_dims[i]; ++b)
+                    max_block = std::max(max_block,
+                        static_cast<std::size_t>(first((b+1)*sub_dims[i]) - first(b*sub_dims[i])));
+                max_points *= max_block;
+
+                for (int d=0; d<3; ++d)
+                {
+                    const int dir = d-1;
+                    width[i][d] = width_local[i][d] = count[i][d] = count_local[i][d] = 0u;
+                    for (int c=0; c<n; ++c)
+                    {
+                        int n_c = c+dir;
+                        if (n_c < 0 || n_c >= n)
+                        {
+                            if (!p[i]) continue;
+                            n_c = (n_c+n)%n;
+                        }
+                        const std::size_t w = (dir == 0) ? first(c+1)-first(c) : h[i*2+(dir>0 ? 1 : 0)];
+                        width[i][d] += w;
+                        ++count[i][d];
+                        if (n_c/sub_dims[i] == c/sub_dims[i])
+                        {
+                            width_local[i][d] += w;
+                            ++count_local[i][d];
+                        }
+                    }
+                }
+            }
+
+            std::size_t halo_bytes = 0u, remote_halo_bytes = 0u, remote_messages = 0u;
+            int num_regions = 1;
+            for (int i=0; i<Dimension; ++i) num_regions *= 3;
+            for (int j=0; j<num_regions; ++j)
+            {
+                if (j == num_regions/2) continue;
+                std::size_t volume = 1u, volume_local = 1u, messages = 1u, messages_local = 1u;
+                int num_outside = 0;
+                for (int i=0, k=j; i<Dimension; ++i, k/=3)
+                {
+                    const int d = k%3;
+                    if (d != 1) ++num_outside;
+                    volume *= width[i][d];
+                    volume_local *= width_local[i][d];
+                    messages *= count[i][d];
+                    messages_local *= count_local[i][d];
+                }
+                if (volume == 0u || (shape == stencil_shape::star && num_outside > 1)) continue;
+                halo_bytes += volume*element_size;
+                remote_halo_bytes += (volume-volume_local)*element_size;
+                remote_messages += messages-messages_local;
+            }
+            return std::make_tuple(max_points, remote_halo_bytes, halo_bytes, remote_messages);
+        }
+
+    } // namespace detail
+
+    /** @brief find the Cartesian decomposition of a global domain which balances the points per rank and
+     * minimizes the halo traffic. All rank and domain grids are considered: candidates are ranked by the maximum
+     * number of points per rank, then by the bytes exchanged between ranks, the total halo bytes and the number of
+     * messages between ranks. Domains
+     * must be at least as large as the halos. The result is identical on all ranks.
+     * @tparam DomainIdType domain id type
+     * @tparam Dimension dimension of domain
+     * @tparam RangeHalos range type holding halos (2 per dimension, left/right)
+     * @tparam RangePeriodic range type holding periodicity info
+     * @param extents global extents (the global domain starts at the origin)
+     * @param halos list of halo sizes (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...)
+     * @param periodic whether global domain is periodic in dimension i
+     * @param num_ranks number of ranks
+     * @param domains_per_rank number of domains per rank (over-decomposition)
+     * @param shape stencil shape (box or star)
+     * @param element_size size of a halo point in bytes
+     * @return decomposition holding the domains of all ranks */
+    template<typename DomainIdType, int Dimension, typename RangeHalos, typename RangePeriodic>
+    cartesian_decomposition<DomainIdType,Dimension> make_cartesian_decomposition(
+        const std::array<int,Dimension>& extents, const RangeHalos& halos, const RangePeriodic& periodic,
+        int num_ranks, int domains_per_rank = 1, stencil_shape shape = stencil_shape::box,
+        std::size_t element_size = sizeof(double))
+    {
+        using decomposition_type = cartesian_decomposition<DomainIdType,Dimension>;
+        using coordinate_type    = typename decomposition_type::coordinate_type;
+        std::array<int,Dimension*2> h;
+        h.fill(0);
+        std::copy(halos.begin(), halos.end(), h.begin());
+
+        std::vector<coordinate_type> rank_grids, sub_grids;
+        coordinate_type f;
+        detail::factorizations<Dimension>(num_ranks, 0, f, rank_grids);
+        detail::factorizations<Dimension>(domains_per_rank, 0, f, sub_grids);
+
+        // candidates are ranked by their predicted traffic, only the best one is constructed
+        bool found = false;
+        coordinate_type best_r, best_s;
+        std::tuple<std::size_t,std::size_t,std::size_t,std::size_t> best_key;
+        for (const auto& r : rank_grids)
+            for (const auto& s : sub_grids)
+            {
+                // smallest domains must hold the halos
+                bool valid = true;
+                for (int i=0; i<Dimension; ++i)
+                {
+                    const long long n = r[i]*s[i];
+                    if (extents[i]/n < std::max(std::max(h[i*2], h[i*2+1]), 1)) valid = false;
+                }
+                if (!valid) continue;
+                const auto key = detail::layout_key<Dimension>(extents, h, periodic, r, s, shape, element_size);
+                if (!found || key < best_key)
+                {
+                    found = true;
+                    best_key = key;
+                    best_r = r;
+                    best_s = s;
+                }
+            }
+        if (!found)
+            throw std::runtime_error("global domain is too small for the requested number of domains");
+        return decomposition_type(extents, h, periodic, best_r, best_s, shape, element_size);
+    }
+
+    } // namespace structured
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_DECOMPOSITION_HPP */
@@ -29,6 +29,11 @@ namespace gridtools {
     template<typename DomainIdType, int Dimension>
     class halo_generator;
 
+    /** @brief stencil shape served by a halo generator:
+     * - box: all 3^D-1 outer regions (faces, edges and corners)
+     * - star: faces only, i.e. points which lie outside of the domain in a single dimension */
+    enum class stencil_shape { box, star };
+
     /** @brief implements domain descriptor concept for structured domains
      * @tparam DomainIdType domain id type
      * @tparam Dimension dimension of domain*/
@@ -106,9 +111,12 @@ namespace gridtools {
          * @param g_first first global coordinate of total domain (used for periodicity)
          * @param g_last last global coordinate of total domain (including, used for periodicity)
          * @param halos list of halo sizes (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...)
-         * @param periodic list of bools indicating periodicity per dimension (true, true, false, ...) */
+         * @param periodic list of bools indicating periodicity per dimension (true, true, false, ...)
+         * @param shape stencil shape: star omits edge and corner regions */
         template<typename Array, typename RangeHalos, typename RangePeriodic>
-        halo_generator(const Array& g_first, const Array& g_last, RangeHalos&& halos, RangePeriodic&& periodic)
+        halo_generator(const Array& g_first, const Array& g_last, RangeHalos&& halos, RangePeriodic&& periodic,
+            stencil_shape shape = stencil_shape::box)
+        : m_shape{shape}
         {
             std::copy(std::begin(g_first), std::end(g_first), m_first.begin());
             std::copy(std::begin(g_last), std::end(g_last), m_last.begin());
@@ -119,7 +127,8 @@ namespace gridtools {
         }
 
         // construct without periodicity
-        halo_generator(std::initializer_list<int> halos)
+        halo_generator(std::initializer_list<int> halos, stencil_shape shape = stencil_shape::box)
+        : m_shape{shape}
         {
             m_halos.fill(0);
             m_periodic.fill(false);
@@ -165,6 +174,14 @@ namespace gridtools {
             for (int j=0; j<static_cast<int>(outer_halos.size()); ++j)
             {
                 if (j==(::gridtools::ghex::detail::ct_pow(3,dimension::value)/2)) continue;
+                if (m_shape == stencil_shape::star)
+                {
+                    // digit d of j (base 3) selects left/middle/right in one dimension: keep faces only
+                    int num_outside = 0;
+                    for (int d=0, k=j; d<dimension::value; ++d, k/=3)
+                        if (k%3 != 1) ++num_outside;
+                    if (num_outside > 1) continue;
+                }
                 if (outer_halos[j].local().last() >= outer_halos[j].local().first())
                     halos.push_back(outer_halos[j]);
             }
@@ -186,6 +203,9 @@ namespace gridtools {
             return halos;
         }
 
+    public: // member functions
+        stencil_shape shape() const noexcept { return m_shape; }
+
     private: // member functions
         template<typename Box, typename Spaces>
         std::vector<Box> compute_spaces(const Spaces& spaces) const
@@ -231,6 +251,7 @@ namespace gridtools {
         coordinate_type m_last;
         std::array<int,dimension::value*2> m_halos;
         std::array<bool,dimension::value> m_periodic;
+        stencil_shape m_shape;
     };
     } // namespace structured
     } // namespace ghex
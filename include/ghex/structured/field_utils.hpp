@@ -13,6 +13,8 @@
 
 #include <gridtools/common/host_device.hpp>
 #include <cstddef> 
+#include <array>
+#include <utility>
 
 namespace gridtools {
     namespace ghex {
@@ -115,6 +117,32 @@ namespace gridtools {
             }
         };
 
+        /** @brief compile time blocking parameters for the serialization of iteration spaces: regions are traversed
+          * row by row, where a row is the contiguous run along the stride-1 dimension, in blocks of block_rows rows.
+          * This matters most for regions which are thin along the stride-1 dimension (e.g. x-faces for
+          * layout_map<2,1,0>), where each row touches a single cache line.
+          * @tparam D dimension
+          * @tparam Layout storage layout */
+        template<int D, typename Layout>
+        struct pack_blocking
+        {
+            /** @brief index of the stride-1 dimension */
+            static constexpr int stride_1_dim = Layout::template find<D-1>();
+            /** @brief number of rows per block (and prefetch distance): the more outer dimensions, the larger the
+              * jumps between blocks */
+            static constexpr std::size_t block_rows = (D > 2) ? 16 : 32;
+
+            /** @brief dimensions ordered from slowest to fastest varying */
+            static constexpr std::array<int,D> order() noexcept { return order(std::make_index_sequence<D>{}); }
+
+        private:
+            template<std::size_t... Is>
+            static constexpr std::array<int,D> order(std::index_sequence<Is...>) noexcept
+            {
+                return {{Layout::template find<Is>()...}};
+            }
+        };
+
     } // namespace detail
     } // namespace structured
     } // namespace ghex
@@ -14,6 +14,7 @@
 #include "./grid.hpp"
 #include "../pattern.hpp"
 #include <map>
+#include <algorithm>
 #include <iosfwd>
 
 namespace gridtools {
@@ -156,6 +157,124 @@ namespace gridtools {
             return s;
         }
 
+        /** @brief split an iteration space into pieces of at most max_elements elements (but at least one row
+          * along the first dimension) and append them to out. The iteration space is cut along the highest dimension
+          * first. The result only depends on the extents, hence send and receive side split in the same way. */
+        static void split(const iteration_space_pair& is, std::size_t max_elements, index_container_type& out)
+        {
+            split(is, coordinate_type::size()-1, max_elements, out);
+        }
+
+        /** @brief split an iteration space into boxes which only contain active points and append them to out.
+          * Runs of active points along the first dimension are merged into boxes along the higher dimensions
+          * wherever they line up. The boxes are ordered by their global first coordinate (highest dimension
+          * first).
+          * @tparam Pred predicate type with signature bool(const coordinate_type&)
+          * @param is iteration space
+          * @param active predicate evaluated at the global coordinates of each point
+          * @param out container of iteration spaces */
+        template<typename Pred>
+        static void split_active(const iteration_space_pair& is, Pred&& active, index_container_type& out)
+        {
+            const int dim = coordinate_type::size();
+            const auto& g = is.global();
+            // runs along the first dimension, one row at a time
+            std::vector<iteration_space> boxes;
+            coordinate_type x = g.first();
+            while (true)
+            {
+                x[0] = g.first()[0];
+                while (x[0] <= g.last()[0])
+                {
+                    if (!active(x)) { ++x[0]; continue; }
+                    coordinate_type first = x;
+                    while (x[0] <= g.last()[0] && active(x)) ++x[0];
+                    coordinate_type last = x;
+                    --last[0];
+                    boxes.push_back(iteration_space{first, last});
+                }
+                int d = 1;
+                for (; d<dim; ++d)
+                {
+                    if (++x[d] <= g.last()[d]) break;
+                    x[d] = g.first()[d];
+                }
+                if (d == dim) break;
+            }
+            // merge neighbouring boxes with identical extents in all other dimensions
+            for (int d=1; d<dim; ++d)
+            {
+                auto less = [d,dim](const iteration_space& a, const iteration_space& b)
+                {
+                    for (int i=dim-1; i>=0; --i)
+                    {
+                        if (i == d) continue;
+                        if (a.first()[i] != b.first()[i]) return a.first()[i] < b.first()[i];
+                        if (a.last()[i]  != b.last()[i])  return a.last()[i]  < b.last()[i];
+                    }
+                    return a.first()[d] < b.first()[d];
+                };
+                std::sort(boxes.begin(), boxes.end(), less);
+                std::vector<iteration_space> merged;
+                merged.reserve(boxes.size());
+                for (const auto& b : boxes)
+                {
+                    if (!merged.empty())
+                    {
+                        auto& m = merged.back();
+                        bool aligned = (m.last()[d]+1 == b.first()[d]);
+                        for (int i=0; i<dim && aligned; ++i)
+                            if (i != d && (m.first()[i] != b.first()[i] || m.last()[i] != b.last()[i])) aligned = false;
+                        if (aligned)
+                        {
+                            m.last()[d] = b.last()[d];
+                            continue;
+                        }
+                    }
+                    merged.push_back(b);
+                }
+                boxes.swap(merged);
+            }
+            std::sort(boxes.begin(), boxes.end(), [dim](const iteration_space& a, const iteration_space& b)
+            {
+                for (int i=dim-1; i>=0; --i)
+                    if (a.first()[i] != b.first()[i]) return a.first()[i] < b.first()[i];
+                return false;
+            });
+            for (const auto& b : boxes)
+                out.push_back(iteration_space_pair{
+                    iteration_space{is.local().first()+(b.first()-g.first()), is.local().first()+(b.last()-g.first())},
+                    b});
+        }
+
+    private: // static member functions
+        static void split(const iteration_space_pair& is, int dim, std::size_t max_elements, index_container_type& out)
+        {
+            if ((std::size_t)is.size() <= max_elements)
+            {
+                out.push_back(is);
+                return;
+            }
+            // number of elements in one slice orthogonal to dim
+            std::size_t slice = 1;
+            for (int i=0; i<dim; ++i) slice *= is.local().last()[i]-is.local().first()[i]+1;
+            const int extent = is.local().last()[dim]-is.local().first()[dim]+1;
+            const int step = slice <= max_elements ? (int)(max_elements/slice) : 1;
+            for (int i=0; i<extent; i+=step)
+            {
+                const int n = std::min(step, extent-i);
+                iteration_space_pair p{is};
+                p.local().first()[dim]  = is.local().first()[dim]+i;
+                p.local().last()[dim]   = is.local().first()[dim]+i+n-1;
+                p.global().first()[dim] = is.global().first()[dim]+i;
+                p.global().last()[dim]  = is.global().first()[dim]+i+n-1;
+                if (slice <= max_elements || dim == 0)
+                    out.push_back(p);
+                else
+                    split(p, dim-1, max_elements, out);
+            }
+        }
+
         friend class pattern_container<Communicator,grid_type,DomainIdType>;
 
     private: // members
@@ -206,6 +325,30 @@ namespace gridtools {
         {
             template<typename Transport, typename ThreadPrimitives, typename HaloGenerator, typename DomainRange>
             static auto apply(tl::context<Transport,ThreadPrimitives>& context, HaloGenerator&& hgen, DomainRange&& d_range)
+            {
+                return apply(context, std::forward<HaloGenerator>(hgen), std::forward<DomainRange>(d_range), nullptr);
+            }
+
+            // add an intersection of a receive halo with a remote domain (unmasked: as a whole)
+            template<typename Domain, typename IterationSpacePair, typename Container>
+            static void add_recv_halo(std::nullptr_t, const Domain&, const IterationSpacePair& is, Container& c)
+            {
+                c.push_back(is);
+            }
+
+            // add an intersection of a receive halo with a remote domain (masked: active sub-boxes only)
+            template<typename Mask, typename Domain, typename IterationSpacePair, typename Container>
+            static void add_recv_halo(const Mask& mask, const Domain& d, const IterationSpacePair& is, Container& c)
+            {
+                using pattern_type = typename IterationSpacePair::pattern_type;
+                using coordinate_type = typename pattern_type::coordinate_type;
+                pattern_type::split_active(is, [&mask,&d](const coordinate_type& x) { return mask(d, x); }, c);
+            }
+
+            template<typename Transport, typename ThreadPrimitives, typename HaloGenerator, typename DomainRange,
+                typename Mask>
+            static auto apply(tl::context<Transport,ThreadPrimitives>& context, HaloGenerator&& hgen, DomainRange&& d_range,
+                const Mask& mask)
             {
                 // typedefs
                 using context_type              = tl::context<Transport,ThreadPrimitives>;
@@ -218,6 +361,7 @@ namespace gridtools {
                 using iteration_space_pair      = typename pattern_type::iteration_space_pair;
                 using coordinate_type           = typename pattern_type::coordinate_type;
                 using extended_domain_id_type   = typename pattern_type::extended_domain_id_type;
+                using index_container_type      = typename pattern_type::index_container_type;
 
                 // get this address from new communicator
                 auto comm = context.get_setup_communicator();
@@ -234,8 +378,10 @@ namespace gridtools {
                 // - domain extents (local an global coordinates)
                 // - pattern objects (one per domain)
                 // - receive halos
+                std::vector<const domain_type*> d_vec;
                 for (const auto& d : d_range)
                 {
+                    d_vec.push_back(&d);
                     // fill data structures with domain related info
                     my_domain_ids.push_back( extended_domain_id_type{d.domain_id(), comm.rank(), my_address, 0} );
                     my_domain_extents.push_back( 
@@ -317,8 +463,14 @@ namespace gridtools {
                                     // prepare pair of intersection (local and global)
                                     iteration_space h{left, right};
                                     iteration_space hl{leftl, rightl};
-                                    // add halo to respective extended domain id key
-                                    my_patterns[i].recv_halos()[domain_id].push_back(iteration_space_pair{hl,h});
+                                    // add halo to respective extended domain id key (inactive points are dropped)
+                                    index_container_type c;
+                                    add_recv_halo(mask, *d_vec[i], iteration_space_pair{hl,h}, c);
+                                    if (!c.empty())
+                                    {
+                                        auto& vec = my_patterns[i].recv_halos()[domain_id];
+                                        vec.insert(vec.end(), c.begin(), c.end());
+                                    }
                                 }
                             }
                         }
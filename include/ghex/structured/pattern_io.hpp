@@ -0,0 +1,143 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_PATTERN_IO_HPP
+#define INCLUDED_GHEX_STRUCTURED_PATTERN_IO_HPP
+
+#include "./pattern.hpp"
+#include "../pattern_io.hpp"
+
+namespace gridtools {
+    namespace ghex {
+    namespace detail {
+
+        // serializes structured patterns: the domain extents are recomputed from the domain range, while the
+        // extended domain id, the global extents and the halo maps are stored as raw (trivially copyable) data
+        template<typename CoordinateArrayType>
+        struct pattern_io_impl<::gridtools::ghex::structured::detail::grid<CoordinateArrayType>>
+        {
+            using grid_type = ::gridtools::ghex::structured::detail::grid<CoordinateArrayType>;
+            using coordinate_type = typename grid_type::coordinate_type;
+
+            static constexpr std::uint32_t grid_kind = 1;
+
+            template<typename DomainRange>
+            static void hash(pattern_hash& h, const DomainRange& d_range)
+            {
+                for (const auto& d : d_range)
+                {
+                    const auto id = d.domain_id();
+                    h.add(id);
+                    h.add(coordinate_type{d.first()});
+                    h.add(coordinate_type{d.last()});
+                }
+            }
+
+            template<typename HaloGenerator, typename DomainRange>
+            static void hash_halos(pattern_hash& h, const HaloGenerator& hgen, const DomainRange& d_range)
+            {
+                for (const auto& d : d_range)
+                {
+                    const auto halos = hgen(d);
+                    const std::uint64_t num_halos = halos.size();
+                    h.add(num_halos);
+                    for (const auto& b : halos)
+                    {
+                        h.add(coordinate_type{b.local().first()});
+                        h.add(coordinate_type{b.local().last()});
+                        h.add(coordinate_type{b.global().first()});
+                        h.add(coordinate_type{b.global().last()});
+                    }
+                }
+            }
+
+            template<typename Pattern>
+            static void save(pattern_writer& w, const Pattern& p)
+            {
+                w.write(p.extended_domain_id());
+                w.write(p.global_first());
+                w.write(p.global_last());
+                save_map(w, p.send_halos());
+                save_map(w, p.recv_halos());
+            }
+
+            template<typename Transport, typename ThreadPrimitives, typename DomainRange>
+            static auto load(tl::context<Transport,ThreadPrimitives>&, pattern_reader& r, const DomainRange& d_range,
+                             int max_tag, int num_patterns)
+            {
+                using context_type         = tl::context<Transport,ThreadPrimitives>;
+                using domain_type          = typename std::remove_reference_t<DomainRange>::value_type;
+                using domain_id_type       = typename domain_type::domain_id_type;
+                using communicator_type    = typename context_type::communicator_type;
+                using pattern_type         = pattern<communicator_type, grid_type, domain_id_type>;
+                using iteration_space      = typename pattern_type::iteration_space;
+                using iteration_space_pair = typename pattern_type::iteration_space_pair;
+                using extended_id_type     = typename pattern_type::extended_domain_id_type;
+
+                std::vector<pattern_type> my_patterns;
+                for (const auto& d : d_range)
+                {
+                    if ((int)my_patterns.size() == num_patterns)
+                        throw std::runtime_error("pattern file holds fewer patterns than domains");
+                    const auto id = r.read<extended_id_type>();
+                    if (id.id != d.domain_id())
+                        throw std::runtime_error("pattern file domain ids do not match");
+                    my_patterns.emplace_back(
+                        iteration_space_pair{
+                            iteration_space{coordinate_type{d.first()}-coordinate_type{d.first()},
+                                            coordinate_type{d.last()} -coordinate_type{d.first()}},
+                            iteration_space{coordinate_type{d.first()}, coordinate_type{d.last()}}},
+                        id);
+                    auto& p = my_patterns.back();
+                    p.global_first() = r.read<coordinate_type>();
+                    p.global_last()  = r.read<coordinate_type>();
+                    load_map(r, p.send_halos());
+                    load_map(r, p.recv_halos());
+                }
+                if ((int)my_patterns.size() != num_patterns)
+                    throw std::runtime_error("pattern file holds more patterns than domains");
+                return pattern_container<communicator_type,grid_type,domain_id_type>(std::move(my_patterns), max_tag);
+            }
+
+        private:
+            template<typename Map>
+            static void save_map(pattern_writer& w, const Map& m)
+            {
+                w.write(static_cast<std::int32_t>(m.size()));
+                for (const auto& kv : m)
+                {
+                    w.write(kv.first);
+                    w.write(static_cast<std::int32_t>(kv.second.size()));
+                    w.write(kv.second.data(), kv.second.size());
+                }
+            }
+
+            template<typename Map>
+            static void load_map(pattern_reader& r, Map& m)
+            {
+                using key_type = typename Map::key_type;
+                const auto n = r.read<std::int32_t>();
+                for (std::int32_t i=0; i<n; ++i)
+                {
+                    const auto key = r.read<key_type>();
+                    const auto num_is = r.read<std::int32_t>();
+                    if (num_is < 0) throw std::runtime_error("pattern file is corrupt");
+                    auto& vec = m[key];
+                    vec.resize(num_is);
+                    r.read(vec.data(), vec.size());
+                }
+            }
+        };
+
+    } // namespace detail
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_PATTERN_IO_HPP */
@@ -15,6 +15,7 @@
 #include "./domain_descriptor.hpp"
 #include <cstring>
 #include <cstdint>
+#include <algorithm>
 #include <gridtools/common/array.hpp>
 #include "../arch_traits.hpp"
 
@@ -49,8 +50,8 @@ namespace gridtools {
 namespace ghex {
 namespace structured {    
 #ifdef __CUDACC__
-    template<typename Layout, typename T, std::size_t D, typename I, typename S>
-    __global__ void pack_kernel(int size, const T* data, T* buffer, 
+    template<typename Layout, typename T, typename W, std::size_t D, typename I, typename S>
+    __global__ void pack_kernel(int size, const T* data, W* buffer, 
                                 array<I,D> local_first, array<I,D> local_strides,
                                 array<S,D> byte_strides, array<I,D> offsets)
     {
@@ -64,12 +65,12 @@ namespace structured {
             const auto memory_coordinate = local_coordinate + local_first + offsets;
             // multiply with memory strides
             const auto idx = dot(memory_coordinate, byte_strides);
-            buffer[index] = *reinterpret_cast<const T*>((const char*)data + idx);
+            buffer[index] = static_cast<W>(*reinterpret_cast<const T*>((const char*)data + idx));
         }
     }
 
-    template<typename Layout, typename T, std::size_t D, typename I, typename S>
-    __global__ void unpack_kernel(int size, T* data, const T* buffer, 
+    template<typename Layout, typename T, typename W, std::size_t D, typename I, typename S>
+    __global__ void unpack_kernel(int size, T* data, const W* buffer, 
                                 array<I,D> local_first, array<I,D> local_strides,
                                 array<S,D> byte_strides, array<I,D> offsets)
     {
@@ -83,7 +84,39 @@ namespace structured {
             const auto memory_coordinate = local_coordinate + local_first + offsets;
             // multiply with memory strides
             const auto idx = dot(memory_coordinate, byte_strides);
-            *reinterpret_cast<T*>((char*)data + idx) = buffer[index];
+            *reinterpret_cast<T*>((char*)data + idx) = static_cast<T>(buffer[index]);
+        }
+    }
+
+    template<typename Layout, typename T, std::size_t D, typename I, typename S>
+    __global__ void pack_kernel_strided(int size, const T* data, T* buffer, std::size_t buffer_stride,
+                                        array<I,D> local_first, array<I,D> local_strides,
+                                        array<S,D> byte_strides, array<I,D> offsets)
+    {
+        const auto index = blockIdx.x*blockDim.x + threadIdx.x;
+        if (index < size)
+        {
+            array<I,D> local_coordinate;
+            detail::compute_coordinate<D>::template apply<Layout>(local_strides,local_coordinate,index);
+            const auto memory_coordinate = local_coordinate + local_first + offsets;
+            const auto idx = dot(memory_coordinate, byte_strides);
+            buffer[index*buffer_stride] = *reinterpret_cast<const T*>((const char*)data + idx);
+        }
+    }
+
+    template<typename Layout, typename T, std::size_t D, typename I, typename S>
+    __global__ void unpack_kernel_strided(int size, T* data, const T* buffer, std::size_t buffer_stride,
+                                          array<I,D> local_first, array<I,D> local_strides,
+                                          array<S,D> byte_strides, array<I,D> offsets)
+    {
+        const auto index = blockIdx.x*blockDim.x + threadIdx.x;
+        if (index < size)
+        {
+            array<I,D> local_coordinate;
+            detail::compute_coordinate<D>::template apply<Layout>(local_strides,local_coordinate,index);
+            const auto memory_coordinate = local_coordinate + local_first + offsets;
+            const auto idx = dot(memory_coordinate, byte_strides);
+            *reinterpret_cast<T*>((char*)data + idx) = buffer[index*buffer_stride];
         }
     }
 #endif
@@ -91,47 +124,267 @@ namespace structured {
     template<typename Arch, typename Dimension, typename Layout>
     struct serialization
     {
-        template<typename T, typename IndexContainer, typename Strides, typename Array>
+        using blocking = detail::pack_blocking<Dimension::value, Layout>;
+
+        /** @brief pack the iteration spaces of a field into a buffer. The buffer may hold a different (wire)
+          * type W, values are converted with static_cast.
+          * @tparam W buffer value type
+          * @tparam T field value type */
+        template<typename W, typename T, typename IndexContainer, typename Strides, typename Array>
         GT_FUNCTION_HOST
-        static void pack(T* buffer, const IndexContainer& c, const T* m_data, const Strides& m_byte_strides, 
+        static void pack(W* buffer, const IndexContainer& c, const T* m_data, const Strides& m_byte_strides, 
                          const Array& m_offsets, void*)
         {
             for (const auto& is : c)
             {
+                if (use_blocked<T>(is, m_byte_strides))
+                    pack_blocked(buffer, is, m_data, m_byte_strides, m_offsets);
+                else
+                    pack_elementwise(buffer, is, m_data, m_byte_strides, m_offsets);
+                buffer += is.size();
+            }
+        }
+
+        template<typename W, typename T, typename IndexContainer, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void unpack(const W* buffer, const IndexContainer& c, T* m_data, const Strides& m_byte_strides, 
+                           const Array& m_offsets, void*)
+        {
+            for (const auto& is : c)
+            {
+                if (use_blocked<T>(is, m_byte_strides))
+                    unpack_blocked(buffer, is, m_data, m_byte_strides, m_offsets);
+                else
+                    unpack_elementwise(buffer, is, m_data, m_byte_strides, m_offsets);
+                buffer += is.size();
+            }
+        }
+
+        /** @brief the blocked traversal requires contiguous rows along the stride-1 dimension */
+        template<typename T, typename IterationSpace, typename Strides>
+        static bool use_blocked(const IterationSpace&, const Strides& m_byte_strides) noexcept
+        {
+            return Dimension::value > 1 && m_byte_strides[blocking::stride_1_dim] == sizeof(T);
+        }
+
+        /** @brief element by element traversal of one iteration space following the storage layout */
+        template<typename W, typename T, typename IterationSpace, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void pack_elementwise(W* buffer, const IterationSpace& is, const T* m_data, const Strides& m_byte_strides, 
+                                     const Array& m_offsets)
+        {
+            ::gridtools::ghex::detail::for_loop_pointer_arithmetic<Dimension::value,Dimension::value,Layout>::apply(
+                [m_data,buffer](auto o_data, auto o_buffer)
+                {
+                    *reinterpret_cast<W*>(reinterpret_cast<char*>(buffer)+o_buffer/sizeof(T)*sizeof(W)) = 
+                    static_cast<W>(*reinterpret_cast<const T*>(reinterpret_cast<const char*>(m_data)+o_data)); 
+                }, 
+                is.local().first(), 
+                is.local().last(),
+                m_byte_strides,
+                m_offsets
+                );
+        }
+
+        template<typename W, typename T, typename IterationSpace, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void unpack_elementwise(const W* buffer, const IterationSpace& is, T* m_data, const Strides& m_byte_strides, 
+                                       const Array& m_offsets)
+        {
+            ::gridtools::ghex::detail::for_loop_pointer_arithmetic<Dimension::value,Dimension::value,Layout>::apply(
+                [m_data,buffer](auto o_data, auto o_buffer)
+                {
+                    *reinterpret_cast<T*>(reinterpret_cast<char*>(m_data)+o_data) = 
+                    static_cast<T>(*reinterpret_cast<const W*>(reinterpret_cast<const char*>(buffer)+o_buffer/sizeof(T)*sizeof(W))); 
+                }, 
+                is.local().first(), 
+                is.local().last(),
+                m_byte_strides,
+                m_offsets
+                );
+        }
+
+        /** @brief row-wise traversal of one iteration space in blocks of rows (see detail::pack_blocking). The
+          * buffer layout is identical to the one of the element-wise traversal. */
+        template<typename W, typename T, typename IterationSpace, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void pack_blocked(W* buffer, const IterationSpace& is, const T* m_data, const Strides& m_byte_strides, 
+                                 const Array& m_offsets)
+        {
+            const char* base = reinterpret_cast<const char*>(m_data);
+            const std::size_t run = row_length(is);
+            for_each_block<false>(is, base, m_byte_strides, m_offsets,
+                [buffer,base,run](std::ptrdiff_t o_data, std::ptrdiff_t pitch, std::size_t row, std::size_t n)
+                {
+                    copy_rows<T,W>(base+o_data, pitch, reinterpret_cast<char*>(buffer+row*run), run*sizeof(W), run, n);
+                });
+        }
+
+        template<typename W, typename T, typename IterationSpace, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void unpack_blocked(const W* buffer, const IterationSpace& is, T* m_data, const Strides& m_byte_strides, 
+                                   const Array& m_offsets)
+        {
+            char* base = reinterpret_cast<char*>(m_data);
+            const std::size_t run = row_length(is);
+            for_each_block<true>(is, base, m_byte_strides, m_offsets,
+                [buffer,base,run](std::ptrdiff_t o_data, std::ptrdiff_t pitch, std::size_t row, std::size_t n)
+                {
+                    copy_rows<W,T>(reinterpret_cast<const char*>(buffer+row*run), run*sizeof(W), base+o_data, pitch, run, n);
+                });
+        }
+
+    private:
+        template<typename IterationSpace>
+        static std::size_t row_length(const IterationSpace& is) noexcept
+        {
+            constexpr int s1 = blocking::stride_1_dim;
+            return is.local().last()[s1] - is.local().first()[s1] + 1;
+        }
+
+        // copy n rows of R elements
+        template<typename S, typename D, std::size_t R>
+        static void copy_rows_fixed(const char* src, std::ptrdiff_t src_pitch, char* dst, std::ptrdiff_t dst_pitch,
+                                    std::size_t n) noexcept
+        {
+            for (std::size_t k=0; k<n; ++k, src+=src_pitch, dst+=dst_pitch)
+                for (std::size_t j=0; j<R; ++j)
+                    reinterpret_cast<D*>(dst)[j] = static_cast<D>(reinterpret_cast<const S*>(src)[j]);
+        }
+
+        // copy n rows of run elements: short rows are dispatched to unrolled copies
+        template<typename S, typename D>
+        static void copy_rows(const char* src, std::ptrdiff_t src_pitch, char* dst, std::ptrdiff_t dst_pitch,
+                              std::size_t run, std::size_t n) noexcept
+        {
+            switch (run)
+            {
+                case 1: copy_rows_fixed<S,D,1>(src, src_pitch, dst, dst_pitch, n); break;
+                case 2: copy_rows_fixed<S,D,2>(src, src_pitch, dst, dst_pitch, n); break;
+                case 3: copy_rows_fixed<S,D,3>(src, src_pitch, dst, dst_pitch, n); break;
+                case 4: copy_rows_fixed<S,D,4>(src, src_pitch, dst, dst_pitch, n); break;
+                default:
+                    for (std::size_t k=0; k<n; ++k, src+=src_pitch, dst+=dst_pitch)
+                        for (std::size_t j=0; j<run; ++j)
+                            reinterpret_cast<D*>(dst)[j] = static_cast<D>(reinterpret_cast<const S*>(src)[j]);
+            }
+        }
+
+        // Calls f(byte offset of the first row, row pitch in bytes, row index, number of rows) for blocks of
+        // consecutive rows along the innermost outer dimension, in storage order. While a block is copied, the
+        // rows of the next block are prefetched (GHEX_PACK_PREFETCH).
+        template<bool Write, typename IterationSpace, typename Strides, typename Array, typename Func>
+        static void for_each_block(const IterationSpace& is, const char* base, const Strides& m_byte_strides,
+                                   const Array& m_offsets, Func&& f)
+        {
+            constexpr int D = Dimension::value;
+            constexpr std::size_t B = blocking::block_rows;
+            constexpr auto order = blocking::order();
+            const auto& first = is.local().first();
+            const auto& last = is.local().last();
+
+            std::ptrdiff_t offset = 0;
+            for (int d=0; d<D; ++d)
+                offset += static_cast<std::ptrdiff_t>(first[d]+m_offsets[d])*static_cast<std::ptrdiff_t>(m_byte_strides[d]);
+            // rows along the innermost outer dimension form a plane
+            constexpr int inner = (D > 1) ? D-2 : 0;
+            const std::size_t rows_per_plane = last[order[inner]] - first[order[inner]] + 1;
+            const std::ptrdiff_t pitch = m_byte_strides[order[inner]];
+            std::size_t extents[D];
+            std::size_t counter[D];
+            std::size_t num_planes = 1;
+            for (int i=0; i<D-2; ++i)
+            {
+                extents[i] = last[order[i]] - first[order[i]] + 1;
+                counter[i] = 0;
+                num_planes *= extents[i];
+            }
+
+            std::size_t row = 0;
+            for (std::size_t p=0; p<num_planes; ++p)
+            {
+                for (std::size_t r=0; r<rows_per_plane; r+=B)
+                {
+                    const std::size_t n = std::min(B, rows_per_plane-r);
+#if defined(GHEX_PACK_PREFETCH) && defined(__GNUC__)
+                    const std::size_t n_next = std::min(B, rows_per_plane-r-n);
+                    for (std::size_t k=0; k<n_next; ++k)
+                        __builtin_prefetch(base + offset + static_cast<std::ptrdiff_t>(r+n+k)*pitch, Write ? 1 : 0, 0);
+#else
+                    (void)base;
+#endif
+                    f(offset + static_cast<std::ptrdiff_t>(r)*pitch, pitch, row, n);
+                    row += n;
+                }
+                // odometer over the remaining outer dimensions
+                for (int i=D-3; i>=0; --i)
+                {
+                    const std::ptrdiff_t stride = m_byte_strides[order[i]];
+                    offset += stride;
+                    if (++counter[i] < extents[i]) break;
+                    counter[i] = 0;
+                    offset -= static_cast<std::ptrdiff_t>(extents[i])*stride;
+                }
+            }
+        }
+
+    public:
+        /** @brief pack several fields with identical layout (byte strides and offsets) in a single traversal of the
+          * iteration spaces. For each iteration space, the buffer holds either all values of field 0, then all values
+          * of field 1 etc. (field-major) or the values of all fields at the first point, then at the second point etc.
+          * (interleaved). */
+        template<typename T, typename IndexContainer, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void pack_fused(T* buffer, const IndexContainer& c, const T* const* data, std::size_t n,
+                               const Strides& m_byte_strides, const Array& m_offsets, bool interleaved, void*)
+        {
+            for (const auto& is : c)
+            {
+                char* b = reinterpret_cast<char*>(buffer);
+                const std::size_t field_stride = interleaved ? sizeof(T) : is.size()*sizeof(T);
+                const std::size_t point_factor = interleaved ? n : 1u;
                 ::gridtools::ghex::detail::for_loop_pointer_arithmetic<Dimension::value,Dimension::value,Layout>::apply(
-                    [m_data,buffer](auto o_data, auto o_buffer)
+                    [data,n,b,field_stride,point_factor](auto o_data, auto o_buffer)
                     {
-                        *reinterpret_cast<T*>(reinterpret_cast<char*>(buffer)+o_buffer) = 
-                        *reinterpret_cast<const T*>(reinterpret_cast<const char*>(m_data)+o_data); 
-                    }, 
-                    is.local().first(), 
+                        char* dst = b + o_buffer*point_factor;
+                        for (std::size_t f=0; f<n; ++f)
+                            *reinterpret_cast<T*>(dst + f*field_stride) =
+                            *reinterpret_cast<const T*>(reinterpret_cast<const char*>(data[f])+o_data);
+                    },
+                    is.local().first(),
                     is.local().last(),
                     m_byte_strides,
                     m_offsets
                     );
-                buffer += is.size();
+                buffer += is.size()*n;
             }
         }
 
+        /** @brief unpack several fields with identical layout in a single traversal (see pack_fused) */
         template<typename T, typename IndexContainer, typename Strides, typename Array>
         GT_FUNCTION_HOST
-        static void unpack(const T* buffer, const IndexContainer& c, T* m_data, const Strides& m_byte_strides, 
-                           const Array& m_offsets, void*)
+        static void unpack_fused(const T* buffer, const IndexContainer& c, T* const* data, std::size_t n,
+                                 const Strides& m_byte_strides, const Array& m_offsets, bool interleaved, void*)
         {
             for (const auto& is : c)
             {
+                const char* b = reinterpret_cast<const char*>(buffer);
+                const std::size_t field_stride = interleaved ? sizeof(T) : is.size()*sizeof(T);
+                const std::size_t point_factor = interleaved ? n : 1u;
                 ::gridtools::ghex::detail::for_loop_pointer_arithmetic<Dimension::value,Dimension::value,Layout>::apply(
-                    [m_data,buffer](auto o_data, auto o_buffer)
+                    [data,n,b,field_stride,point_factor](auto o_data, auto o_buffer)
                     {
-                        *reinterpret_cast<T*>(reinterpret_cast<char*>(m_data)+o_data) = 
-                        *reinterpret_cast<const T*>(reinterpret_cast<const char*>(buffer)+o_buffer); 
-                    }, 
-                    is.local().first(), 
+                        const char* src = b + o_buffer*point_factor;
+                        for (std::size_t f=0; f<n; ++f)
+                            *reinterpret_cast<T*>(reinterpret_cast<char*>(data[f])+o_data) =
+                            *reinterpret_cast<const T*>(src + f*field_stride);
+                    },
+                    is.local().first(),
                     is.local().last(),
                     m_byte_strides,
                     m_offsets
                     );
-                buffer += is.size();
+                buffer += is.size()*n;
             }
         }
     };
@@ -141,9 +394,9 @@ namespace structured {
     template<typename Dimension, typename Layout>
     struct serialization<gpu, Dimension, Layout>
     {
-        template<typename T, typename IndexContainer, typename Strides, typename Array>
+        template<typename W, typename T, typename IndexContainer, typename Strides, typename Array>
         GT_FUNCTION_HOST
-        static void pack(T* buffer, const IndexContainer& c, const T* m_data, const Strides& m_byte_strides, 
+        static void pack(W* buffer, const IndexContainer& c, const T* m_data, const Strides& m_byte_strides, 
                          const Array& m_offsets, void* arg)
         {
             auto stream_ptr = reinterpret_cast<cudaStream_t*>(arg);
@@ -163,9 +416,9 @@ namespace structured {
             }
         }
 
-        template<typename T, typename IndexContainer, typename Strides, typename Array>
+        template<typename W, typename T, typename IndexContainer, typename Strides, typename Array>
         GT_FUNCTION_HOST
-        static void unpack(const T* buffer, const IndexContainer& c, T* m_data, const Strides& m_byte_strides, 
+        static void unpack(const W* buffer, const IndexContainer& c, T* m_data, const Strides& m_byte_strides, 
                            const Array& m_offsets, void* arg)
         {
             auto stream_ptr = reinterpret_cast<cudaStream_t*>(arg);
@@ -184,6 +437,56 @@ namespace structured {
                 buffer += size;
             }
         }
+
+        // the field pointers live in host memory: one strided kernel per field and iteration space produces the same
+        // buffer layout as the cpu version
+        template<typename T, typename IndexContainer, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void pack_fused(T* buffer, const IndexContainer& c, const T* const* data, std::size_t n,
+                               const Strides& m_byte_strides, const Array& m_offsets, bool interleaved, void* arg)
+        {
+            auto stream_ptr = reinterpret_cast<cudaStream_t*>(arg);
+            for (const auto& is : c)
+            {
+                Array local_first, local_last;
+                std::copy(&is.local().first()[0], &is.local().first()[Dimension::value], local_first.data());
+                std::copy(&is.local().last()[0], &is.local().last()[Dimension::value], local_last.data());
+                Array local_extents, local_strides;
+                for (std::size_t i=0; i<Dimension::value; ++i)
+                    local_extents[i] = 1 + local_last[i] - local_first[i];
+                detail::compute_strides<Dimension::value>::template apply<Layout>(local_extents, local_strides);
+                const int size = is.size();
+                for (std::size_t f=0; f<n; ++f)
+                    pack_kernel_strided<Layout><<<(size+NCTIS-1)/NCTIS,NCTIS,0,*stream_ptr>>>(
+                        size, data[f], buffer + (interleaved ? f : f*size), (interleaved ? n : 1u),
+                        local_first, local_strides, m_byte_strides, m_offsets);
+                buffer += size*n;
+            }
+        }
+
+        template<typename T, typename IndexContainer, typename Strides, typename Array>
+        GT_FUNCTION_HOST
+        static void unpack_fused(const T* buffer, const IndexContainer& c, T* const* data, std::size_t n,
+                                 const Strides& m_byte_strides, const Array& m_offsets, bool interleaved, void* arg)
+        {
+            auto stream_ptr = reinterpret_cast<cudaStream_t*>(arg);
+            for (const auto& is : c)
+            {
+                Array local_first, local_last;
+                std::copy(&is.local().first()[0], &is.local().first()[Dimension::value], local_first.data());
+                std::copy(&is.local().last()[0], &is.local().last()[Dimension::value], local_last.data());
+                Array local_extents, local_strides;
+                for (std::size_t i=0; i<Dimension::value; ++i)
+                    local_extents[i] = 1 + local_last[i] - local_first[i];
+                detail::compute_strides<Dimension::value>::template apply<Layout>(local_extents, local_strides);
+                const int size = is.size();
+                for (std::size_t f=0; f<n; ++f)
+                    unpack_kernel_strided<Layout><<<(size+NCTIS-1)/NCTIS,NCTIS,0,*stream_ptr>>>(
+                        size, data[f], buffer + (interleaved ? f : f*size), (interleaved ? n : 1u),
+                        local_first, local_strides, m_byte_strides, m_offsets);
+                buffer += size*n;
+            }
+        }
     };
 #endif
 
@@ -326,9 +629,72 @@ namespace structured {
         {
             serialization<Arch,dimension,layout_map>::unpack(buffer, c, m_data, m_byte_strides, m_offsets, arg);
         }
+
+        /** @brief pack this field together with other fields of identical layout in one traversal
+          * @param data pointers to the data of all n fields (including this one) */
+        template<typename IndexContainer>
+        void pack_fused(T* buffer, const IndexContainer& c, const T* const* data, std::size_t n, bool interleaved, void* arg)
+        {
+            serialization<Arch,dimension,layout_map>::pack_fused(buffer, c, data, n, m_byte_strides, m_offsets, interleaved, arg);
+        }
+
+        template<typename IndexContainer>
+        void unpack_fused(const T* buffer, const IndexContainer& c, T* const* data, std::size_t n, bool interleaved, void* arg)
+        {
+            serialization<Arch,dimension,layout_map>::unpack_fused(buffer, c, data, n, m_byte_strides, m_offsets, interleaved, arg);
+        }
+    };
+
+    /** @brief simple_field_wrapper which is transferred with a different, usually narrower, value type (e.g. a double
+     * field sent as float or bfloat16): pack converts to the wire type, unpack converts back. The communication object
+     * sizes the buffers according to the wire type. All ranks must use the same wire type for a field.
+     * @tparam WireType value type in the serialized buffers
+     * @tparam T field value type
+     * @tparam Arch device type the data lives on
+     * @tparam DomainDescriptor domain type
+     * @tparam Order permutation of the set {0,...,N-1} indicating storage layout (N-1 -> stride=1)*/
+    template<typename WireType, typename T, typename Arch, typename DomainDescriptor, int... Order>
+    class reduced_precision_field_wrapper : public simple_field_wrapper<T,Arch,DomainDescriptor,Order...>
+    {
+    public: // member types
+        using base          = simple_field_wrapper<T,Arch,DomainDescriptor,Order...>;
+        using wire_type     = WireType;
+        using typename base::dimension;
+        using typename base::layout_map;
+
+    public: // ctors
+        using base::base;
+
+        reduced_precision_field_wrapper() noexcept = default;
+
+        explicit reduced_precision_field_wrapper(const base& field) noexcept : base(field) {}
+
+    public: // member functions
+        template<typename IndexContainer>
+        void pack(wire_type* buffer, const IndexContainer& c, void* arg)
+        {
+            serialization<Arch,dimension,layout_map>::pack(buffer, c, this->data(), this->byte_strides(), this->offsets(), arg);
+        }
+
+        template<typename IndexContainer>
+        void unpack(const wire_type* buffer, const IndexContainer& c, void* arg)
+        {
+            serialization<Arch,dimension,layout_map>::unpack(buffer, c, this->data(), this->byte_strides(), this->offsets(), arg);
+        }
     };
 } // namespace structured
 
+    /** @brief transfer a field with a different (wire) value type
+     * @tparam WireType value type in the serialized buffers
+     * @param field wrapped field
+     * @return wrapped field which converts to/from WireType during packing/unpacking */
+    template<typename WireType, typename T, typename Arch, typename DomainDescriptor, int... Order>
+    structured::reduced_precision_field_wrapper<WireType,T,Arch,DomainDescriptor,Order...>
+    with_wire_type(const structured::simple_field_wrapper<T,Arch,DomainDescriptor,Order...>& field)
+    {
+        return structured::reduced_precision_field_wrapper<WireType,T,Arch,DomainDescriptor,Order...>(field);
+    }
+
     /** @brief wrap a N-dimensional array (field) of contiguous memory 
      * @tparam Arch device type the data lives on
      * @tparam Order permutation of the set {0,...,N-1} indicating storage layout (N-1 -> stride=1)
@@ -0,0 +1,172 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_STRUCTURED_STAGED_PATTERN_HPP
+#define INCLUDED_GHEX_STRUCTURED_STAGED_PATTERN_HPP
+
+#include <algorithm>
+#include <array>
+#include <vector>
+#include <stdexcept>
+#include "./pattern.hpp"
+#include "./domain_descriptor.hpp"
+
+namespace gridtools {
+    namespace ghex {
+        namespace structured {
+
+    /** @brief communication patterns of a dimension-ordered (staged) halo exchange: stage d only exchanges the
+      * faces normal to dimension d. The face slabs are extended over the halos of the dimensions < d, which have
+      * been filled in the earlier stages, such that edge and corner halos are routed through the face neighbors.
+      * Each domain therefore talks to at most 2*D neighbors instead of 3^D-1, at the cost of D dependent rounds.
+      * @tparam PatternContainer pattern container type of a single stage */
+    template<typename PatternContainer>
+    class staged_pattern
+    {
+    public: // member types
+        using value_type = PatternContainer;
+
+    private: // members
+        std::vector<PatternContainer> m_stages;
+
+    public: // ctors
+        staged_pattern(std::vector<PatternContainer>&& stages) noexcept : m_stages(std::move(stages)) {}
+        staged_pattern(const staged_pattern&) = delete;
+        staged_pattern(staged_pattern&&) noexcept = default;
+
+    public: // member functions
+        /** @brief number of stages (equal to the number of dimensions) */
+        int size() const noexcept { return m_stages.size(); }
+        const PatternContainer& operator[](int i) const noexcept { return m_stages[i]; }
+        auto begin() const noexcept { return m_stages.cbegin(); }
+        auto end() const noexcept { return m_stages.cend(); }
+    };
+
+        } // namespace structured
+
+        namespace detail {
+
+        template<typename CoordinateArrayType>
+        struct make_staged_pattern_impl<::gridtools::ghex::structured::detail::grid<CoordinateArrayType>>
+        {
+            using grid_type       = ::gridtools::ghex::structured::detail::grid<CoordinateArrayType>;
+            using coordinate_type = typename grid_type::coordinate_type;
+            using dimension       = typename grid_type::dimension;
+
+            template<typename Transport, typename ThreadPrimitives, typename Array, typename RangeHalos,
+                typename RangePeriodic, typename DomainRange>
+            static auto apply(tl::context<Transport,ThreadPrimitives>& context, const Array& g_first,
+                const Array& g_last, RangeHalos&& halos, RangePeriodic&& periodic, DomainRange&& d_range)
+            {
+                using domain_type         = typename std::remove_reference_t<DomainRange>::value_type;
+                using halo_generator_type = typename domain_type::halo_generator_type;
+                using pattern_container_type = decltype(make_pattern<structured::grid>(context,
+                    std::declval<halo_generator_type&>(), d_range));
+
+                std::array<int,dimension::value*2> h;
+                std::array<bool,dimension::value> p;
+                h.fill(0);
+                p.fill(true);
+                std::copy(halos.begin(), halos.end(), h.begin());
+                std::copy(periodic.begin(), periodic.end(), p.begin());
+
+                std::vector<pattern_container_type> stages;
+                stages.reserve(dimension::value);
+                for (int d=0; d<(int)dimension::value; ++d)
+                {
+                    // stage d: halos along dimension d only
+                    std::array<int,dimension::value*2> h_d;
+                    h_d.fill(0);
+                    h_d[d*2]   = h[d*2];
+                    h_d[d*2+1] = h[d*2+1];
+                    auto hgen = halo_generator_type(g_first, g_last, h_d, p);
+                    stages.push_back(make_pattern<structured::grid>(context, hgen, d_range));
+                    // the decomposition is checked collectively such that all ranks fail alike
+                    const int regular = extend(stages.back(), d, h, p, g_first, g_last) ? 1 : 0;
+                    const auto all_regular = context.get_setup_communicator().all_gather(regular).get();
+                    if (std::find(all_regular.begin(), all_regular.end(), 0) != all_regular.end())
+                        throw std::runtime_error("staged exchange requires a regular cartesian domain decomposition");
+                }
+                return structured::staged_pattern<pattern_container_type>(std::move(stages));
+            }
+
+            // extend the iteration spaces of stage dim over the halos of the dimensions < dim. Sender and receiver
+            // of a face are aligned in all other dimensions and hence extend their iteration spaces identically; the
+            // halo along a non-periodic global boundary is never filled and is not extended over. Returns false if a
+            // face is not aligned with the local domain.
+            template<typename PatternContainer, typename Halos, typename Periodic, typename Array>
+            static bool extend(PatternContainer& pc, int dim, const Halos& h, const Periodic& periodic,
+                const Array& g_first, const Array& g_last)
+            {
+                for (auto& pat : pc.m_patterns)
+                {
+                    const auto& dom = pat.global_domain();
+                    coordinate_type lo, hi;
+                    for (int e=0; e<(int)dimension::value; ++e)
+                    {
+                        lo[e] = (e<dim && (periodic[e] || dom.first()[e] > g_first[e])) ? h[e*2]   : 0;
+                        hi[e] = (e<dim && (periodic[e] || dom.last()[e]  < g_last[e]))  ? h[e*2+1] : 0;
+                    }
+                    for (auto* m : {&pat.send_halos(), &pat.recv_halos()})
+                        for (auto& id_is : *m)
+                            for (auto& is : id_is.second)
+                            {
+                                for (int e=0; e<(int)dimension::value; ++e)
+                                {
+                                    if (e == dim) continue;
+                                    if (is.local().first()[e] != 0 ||
+                                        is.local().last()[e] != dom.last()[e]-dom.first()[e])
+                                        return false;
+                                    is.local().first()[e]  -= lo[e];
+                                    is.local().last()[e]   += hi[e];
+                                    is.global().first()[e] -= lo[e];
+                                    is.global().last()[e]  += hi[e];
+                                }
+                            }
+                }
+                return true;
+            }
+        };
+
+        } // namespace detail
+
+        namespace structured {
+
+    /** @brief construct the patterns of a dimension-ordered halo exchange (see staged_pattern). The arguments
+      * correspond to those of the halo generator. All domains must be arranged on a regular cartesian grid: the
+      * neighbor across a face must cover the same range in all other dimensions.
+      * @tparam Transport transport protocol
+      * @tparam ThreadPrimitives threading primitivs (locks etc.)
+      * @tparam Array coordinate-like type
+      * @tparam RangeHalos range type holding halos (2 per dimension, left/right)
+      * @tparam RangePeriodic range type holding periodicity info
+      * @tparam DomainRange a range type holding domains
+      * @param context transport layer context
+      * @param g_first first coordinate of global domain
+      * @param g_last last coordinate of global domain
+      * @param halos list of halo sizes (dim0_dir-, dim0_dir+, dim1_dir-, dim1_dir+, ...)
+      * @param periodic whether global domain is periodic in dimension i
+      * @param d_range range of local domains
+      * @return staged pattern holding one pattern container per dimension */
+    template<typename Transport, typename ThreadPrimitives, typename Array, typename RangeHalos,
+        typename RangePeriodic, typename DomainRange>
+    auto make_staged_pattern(tl::context<Transport,ThreadPrimitives>& context, const Array& g_first,
+        const Array& g_last, RangeHalos&& halos, RangePeriodic&& periodic, DomainRange&& d_range)
+    {
+        using grid_type = typename grid::template type<typename std::remove_reference_t<DomainRange>::value_type>;
+        return ::gridtools::ghex::detail::make_staged_pattern_impl<grid_type>::apply(context, g_first, g_last,
+            std::forward<RangeHalos>(halos), std::forward<RangePeriodic>(periodic), std::forward<DomainRange>(d_range));
+    }
+
+        } // namespace structured
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_STRUCTURED_STAGED_PATTERN_HPP */
@@ -12,7 +12,13 @@
 #define INCLUDED_GHEX_TL_CALLBACK_UTILS_HPP
 
 #include <boost/callable_traits.hpp>
+#include <atomic>
 #include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+#include "../common/trace.hpp"
 
 /** @brief checks the arguments of callback function object */
 #define GHEX_CHECK_CALLBACK_F(MESSAGE_TYPE, RANK_TYPE, TAG_TYPE)                              \
@@ -69,6 +75,16 @@ namespace gridtools {
                     std::size_t size() const noexcept { return m_size; }
                 };
 
+                /** @brief reference to an intrusively reference counted message, which owns one reference.
+                  * The reference is given up by calling m_release on m_owner. */
+                struct counted_ref_message
+                {
+                    unsigned char* m_data;
+                    std::size_t m_size;
+                    void* m_owner;
+                    void (*m_release)(void*);
+                };
+
                 /** @brief type erased message capable of holding any message. Uses optimized initialization for  
                   * ref_messages and std::shared_ptr pointing to messages. */
                 struct any_message
@@ -101,6 +117,7 @@ namespace gridtools {
                     std::size_t m_size;
                     std::unique_ptr<iface> m_ptr;
                     std::shared_ptr<char> m_ptr2;
+                    std::unique_ptr<void, void(*)(void*)> m_ptr3{nullptr, [](void*){}};
 
                     /** @brief Construct from an r-value: moves the message inside the type-erased structure.
                       * Requires the message not to reallocate during the move. Note, that this operation will allocate
@@ -136,6 +153,15 @@ namespace gridtools {
                     , m_ptr2(sm,reinterpret_cast<char*>(sm.get()))
                     {}
 
+                    /** @brief Construct from a counted reference: takes over the reference held by m.
+                      * Note, that this operation will not allocate storage on the heap.
+                      * @param m a counted_ref_message */
+                    any_message(counted_ref_message&& m)
+                    : m_data{m.m_data}
+                    , m_size{m.m_size}
+                    , m_ptr3{m.m_owner, m.m_release}
+                    {}
+
                     any_message(any_message&&) = default;
                     any_message& operator=(any_message&&) = default;
 
@@ -144,6 +170,75 @@ namespace gridtools {
                     std::size_t size() const noexcept { return m_size; }
                 };
 
+                /** @brief Completion record shared by the sends of a send_multi: the callback is invoked once the
+                  * last send has completed. Records are recycled through a per-thread free list, such that a fan-out
+                  * does not allocate once the list is warm. The per-destination callbacks only capture a pointer to
+                  * the record and hence fit into the small-object buffer of std::function.
+                  * @tparam CallBack the user callback type
+                  * @tparam Message the message type passed to the callback
+                  * @tparam RankType the rank type (integer)
+                  * @tparam TagType the tag type (integer) */
+                template<typename CallBack, typename Message, typename RankType, typename TagType>
+                class multi_request_record
+                {
+                  private: // members
+                    std::atomic<int> m_count;
+                    typename std::aligned_storage<sizeof(CallBack), alignof(CallBack)>::type m_cb;
+                    multi_request_record* m_next = nullptr;
+
+                    // free list of records owned by one thread
+                    struct pool
+                    {
+                        multi_request_record* m_head = nullptr;
+                        ~pool()
+                        {
+                            while (m_head)
+                            {
+                                auto next = m_head->m_next;
+                                delete m_head;
+                                m_head = next;
+                            }
+                        }
+                    };
+
+                    static pool& get_pool()
+                    {
+                        static thread_local pool p;
+                        return p;
+                    }
+
+                    multi_request_record() = default;
+
+                    CallBack& callback() noexcept { return *reinterpret_cast<CallBack*>(&m_cb); }
+
+                  public: // static member functions
+                    /** @brief obtain a record for n operations from the free list of the calling thread */
+                    static multi_request_record* make(int n, const CallBack& cb)
+                    {
+                        auto& p = get_pool();
+                        multi_request_record* r = p.m_head;
+                        if (r) p.m_head = r->m_next;
+                        else r = new multi_request_record;
+                        new(&r->m_cb) CallBack(cb);
+                        r->m_count.store(n, std::memory_order_relaxed);
+                        return r;
+                    }
+
+                  public: // member functions
+                    /** @brief notify completion of one operation: the last one invokes the callback. The record is
+                      * recycled before, such that the callback may reuse it for a new fan-out. */
+                    void complete(Message m, RankType r, TagType t)
+                    {
+                        if (m_count.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                        CallBack cb(std::move(callback()));
+                        callback().~CallBack();
+                        auto& p = get_pool();
+                        m_next = p.m_head;
+                        p.m_head = this;
+                        cb(std::move(m), r, t);
+                    }
+                };
+
                 /** @brief A container for storing callbacks and progressing them.
                   * @tparam FutureType a future type
                   * @tparam RankType the rank type (integer)
@@ -171,6 +266,8 @@ namespace gridtools {
 
                   private: // members
                     queue_type m_queue;
+                    // request states which are not referenced anymore, reused by enqueue
+                    std::vector<std::shared_ptr<request_state>> m_free_states;
 
                   public:
                     int m_progressed_cancels = 0;
@@ -189,7 +286,7 @@ namespace gridtools {
                       * @return returns a completion handle */
                     template<typename Callback>
                     request enqueue(message_type&& msg, rank_type rank, tag_type tag, future_type&& fut, Callback&& cb) {
-                        request m_req{std::make_shared<request_state>(false,m_queue.size())};
+                        request m_req{make_state(m_queue.size())};
                         m_queue.push_back(element_type{std::move(msg), rank, tag, std::forward<Callback>(cb), std::move(fut),
                                              m_req});
                         return m_req;
@@ -200,12 +297,18 @@ namespace gridtools {
                       * @return number of progressed elements */
                     int progress() {
                         int completed = 0;
+                        const auto begin = trace::now();
                         for (unsigned int i = 0; i < m_queue.size(); ++i) {
                             auto& element = m_queue[i];
                             if (element.m_future.ready()) {
+                                const auto cb_begin = trace::now();
+                                const auto bytes = element.m_msg.size();
                                 element.m_cb(std::move(element.m_msg), element.m_rank, element.m_tag);
+                                trace::complete("callback", "transport", cb_begin, trace::now(), element.m_rank,
+                                    element.m_tag, bytes);
                                 ++completed;
                                 element.m_request.m_request_state->m_ready = true;
+                                recycle(element.m_request.m_request_state);
                                 if (i + 1 < m_queue.size()) {
                                     element = std::move(m_queue.back());
                                     element.m_request.m_request_state->m_index = i;
@@ -214,6 +317,8 @@ namespace gridtools {
                                 m_queue.pop_back();
                             }
                         }
+                        // only progress calls which completed requests are recorded
+                        if (completed > 0) trace::complete("progress", "transport", begin, trace::now());
                         return completed;
                     }
 
@@ -226,6 +331,7 @@ namespace gridtools {
                         auto& element = m_queue[index];
                         auto res = element.m_future.cancel();
                         if (!res) return false;
+                        recycle(element.m_request.m_request_state);
                         if (m_queue.size() > index+1)
                         {
                             element = std::move(m_queue.back());
@@ -235,6 +341,23 @@ namespace gridtools {
                         ++m_progressed_cancels;
                         return true;
                     }
+
+                  private: // implementation
+                    std::shared_ptr<request_state> make_state(unsigned int index)
+                    {
+                        if (m_free_states.empty()) return std::make_shared<request_state>(false,index);
+                        auto state = std::move(m_free_states.back());
+                        m_free_states.pop_back();
+                        state->m_ready = false;
+                        state->m_index = index;
+                        return state;
+                    }
+
+                    // keep the state if the queue holds the only reference
+                    void recycle(std::shared_ptr<request_state>& state)
+                    {
+                        if (state.use_count() == 1) m_free_states.push_back(std::move(state));
+                    }
                 };
 
                 /** @brief a class to return the number of progressed callbacks */
@@ -14,6 +14,7 @@
 #include "callback_utils.hpp"
 #include "message_buffer.hpp"
 #include "shared_message_buffer.hpp"
+#include "intrusive_shared_message_buffer.hpp"
 
 namespace gridtools {
     namespace ghex {
@@ -41,6 +42,8 @@ namespace gridtools {
                 using rvalue_func  =  typename std::enable_if<is_rvalue<Msg>::value, Ret>::type;
                 template<typename Msg, typename Ret = request_cb>
                 using lvalue_func  =  typename std::enable_if<!is_rvalue<Msg>::value, Ret>::type;
+                template<typename CallBack>
+                using multi_record = ::gridtools::ghex::tl::cb::multi_request_record<std::decay_t<CallBack>, message_type, rank_type, tag_type>;
 
             public: // ctors
                 template<typename...Args>
@@ -105,6 +108,23 @@ namespace gridtools {
                     GHEX_CHECK_CALLBACK_F(message_type,rank_type,tag_type) 
                     return send(message_type{shared_msg.m_message}, dst, tag, std::forward<CallBack>(callback));
                 }
+
+                /** @brief send an intrusively shared message (intrusive_shared_message_buffer) and get notified with a
+                  * callback when the communication has finished. In contrast to the shared_message_buffer overload,
+                  * no type-erasure storage is allocated.
+                  * Note, that the communicator has to be progressed explicitely in order to guarantee completion.
+                  * @tparam Alloc an allocator type
+                  * @tparam CallBack a callback type with the signature void(message_type, rank_type, tag_type)
+                  * @param shared_msg a shared message
+                  * @param dst the destination rank
+                  * @param tag the communication tag
+                  * @param callback a callback instance
+                  * @return a request to test (but not wait) for completion */
+                template<typename Alloc, typename CallBack>
+                request_cb send(intrusive_shared_message_buffer<Alloc>& shared_msg, rank_type dst, tag_type tag, CallBack&& callback) {
+                    GHEX_CHECK_CALLBACK_F(message_type,rank_type,tag_type)
+                    return send(message_type{shared_msg.make_ref()}, dst, tag, std::forward<CallBack>(callback));
+                }
                 
                 /** @brief send a message and get notified with a callback when the communication has finished.
                   * The message must be kept alive by the caller until the communication is finished.
@@ -175,14 +195,12 @@ namespace gridtools {
                     GHEX_CHECK_CALLBACK_F(message_type,rank_type,tag_type) 
                     std::vector<request_cb> res;
                     res.reserve(neighs.size());
-                    auto counter = new std::atomic<int>(neighs.size());
+                    if (neighs.size() == 0) return res;
+                    auto record = multi_record<CallBack>::make(neighs.size(), callback);
                     for (auto id : neighs) {
                         res.push_back( send(msg, id, tag, 
-                            [callback,counter](message_type m, rank_type r, tag_type t) {
-                                if ( (--(*counter)) == 0) {
-                                    callback(std::move(m),r,t);
-                                    delete counter;
-                                }
+                            [record](message_type m, rank_type r, tag_type t) {
+                                record->complete(std::move(m),r,t);
                             }) );
                     }
                     return res;
@@ -206,21 +224,38 @@ namespace gridtools {
                     GHEX_CHECK_CALLBACK_F(message_type,rank_type,tag_type) 
                     std::vector<request_cb> res;
                     res.reserve(neighs.size());
+                    if (neighs.size() == 0) return res;
                     // keep message alive by making it shared
                     auto shared_msg = std::make_shared<Message>(std::move(msg));
-                    auto counter = new std::atomic<int>(neighs.size());
+                    auto record = multi_record<CallBack>::make(neighs.size(), callback);
                     for (auto id : neighs) {
                         res.push_back( send(shared_msg, id, tag, 
-                            [callback, counter](message_type m, rank_type r, tag_type t) {
-                                if ( (--(*counter)) == 0) {
-                                    callback(std::move(m),r,t);
-                                    delete counter;
-                                }
+                            [record](message_type m, rank_type r, tag_type t) {
+                                record->complete(std::move(m),r,t);
                             }) );
                     }
                     return res;
                 }
 
+                /** @brief send an intrusively shared message to multiple destinations and get notified with a
+                  * callback when the communication has finished. Every send holds a reference to the message, hence
+                  * it is safe to destroy the message at the caller's site, and no memory is allocated per destination.
+                  * Note, that the communicator has to be progressed explicitely in order to guarantee completion.
+                  * @tparam Alloc an allocator type
+                  * @tparam Neighs a container class holding rank types
+                  * @tparam CallBack a callback type with the signature void(message_type, rank_type, tag_type)
+                  * @param msg an r-value reference to the message to be sent
+                  * @param neighs a conainer of receivers
+                  * @param tag the communication tag
+                  * @param callback a callback instance
+                  * @return a vector of requests to thest (but not wait) for completion on each send operation */
+                template <typename Alloc, typename Neighs, typename CallBack>
+                std::vector<request_cb>
+                send_multi(intrusive_shared_message_buffer<Alloc>&& msg, Neighs const &neighs, tag_type tag, const CallBack& callback) {
+                    intrusive_shared_message_buffer<Alloc> owned_msg(std::move(msg));
+                    return send_multi(owned_msg, neighs, tag, callback);
+                }
+
                 /** @brief receive a shared message (shared pointer to a message) and get notified with a callback when the
                   * communication has finished.
                   * Note, that the communicator has to be progressed explicitely in order to guarantee completion.
@@ -253,6 +288,23 @@ namespace gridtools {
                     return recv(message_type{shared_msg.m_message}, src, tag, std::forward<CallBack>(callback));
                 }
 
+                /** @brief receive an intrusively shared message (intrusive_shared_message_buffer) and get notified with a
+                  * callback when the communication has finished. In contrast to the shared_message_buffer overload,
+                  * no type-erasure storage is allocated.
+                  * Note, that the communicator has to be progressed explicitely in order to guarantee completion.
+                  * @tparam Alloc an allocator type
+                  * @tparam CallBack a callback type with the signature void(message_type, rank_type, tag_type)
+                  * @param shared_msg a shared message
+                  * @param src the source rank
+                  * @param tag the communication tag
+                  * @param callback a callback instance
+                  * @return a request to test (but not wait) for completion */
+                template<typename Alloc, typename CallBack>
+                request_cb recv(intrusive_shared_message_buffer<Alloc>& shared_msg, rank_type src, tag_type tag, CallBack&& callback) {
+                    GHEX_CHECK_CALLBACK_F(message_type,rank_type,tag_type)
+                    return recv(message_type{shared_msg.make_ref()}, src, tag, std::forward<CallBack>(callback));
+                }
+
                 /** @brief receive a message and get notified with a callback when the communication has finished.
                   * The message must be kept alive by the caller until the communication is finished.
                   * Note, that the communicator has to be progressed explicitely in order to guarantee completion.
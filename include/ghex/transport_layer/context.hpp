@@ -23,7 +23,7 @@ namespace gridtools {
 
             namespace detail {
 
-                static MPI_Comm clone_mpi_comm(MPI_Comm mpi_comm) {
+                inline MPI_Comm clone_mpi_comm(MPI_Comm mpi_comm) {
                     // clone the communicator first to be independent of user calls to the mpi runtime
                     MPI_Comm new_comm;
                     MPI_Comm_dup(mpi_comm, &new_comm);
@@ -62,6 +62,7 @@ namespace gridtools {
                 transport_context_type m_transport_context;
                 int m_rank;
                 int m_size;
+                std::shared_ptr<mpi::node_topology> m_setup_topology;
 
             private: // private ctor
                 template<typename...Args>
@@ -71,6 +72,7 @@ namespace gridtools {
                     , m_transport_context{m_thread_primitives, std::forward<Args>(args)...}
                     , m_rank{ [](MPI_Comm c){ int r; GHEX_CHECK_MPI_RESULT(MPI_Comm_rank(c,&r)); return r; }(comm) }
                     , m_size{ [](MPI_Comm c){ int s; GHEX_CHECK_MPI_RESULT(MPI_Comm_size(c,&s)); return s; }(comm) }
+                    , m_setup_topology{ std::make_shared<mpi::node_topology>(comm) }
                 {}
 
             public: // ctors
@@ -79,6 +81,7 @@ namespace gridtools {
                 
                 ~context()
                 {
+                    m_setup_topology.reset();
                     MPI_Comm_free(&m_mpi_comm);
                 }
 
@@ -95,11 +98,12 @@ namespace gridtools {
                     return m_thread_primitives;
                 }
 
-                /** @brief return a special per-rank setup communicator.
+                /** @brief return a special per-rank setup communicator. The node layout used by its collectives is
+                  * shared among all setup communicators of this context.
                   * This function is not thread-safe and should only be used in the serial part of the code. */
                 mpi::setup_communicator get_setup_communicator()
                 {
-                    return mpi::setup_communicator(m_mpi_comm);
+                    return mpi::setup_communicator(m_mpi_comm, m_setup_topology);
                 }
 
                 /** @brief return a per-rank communicator.
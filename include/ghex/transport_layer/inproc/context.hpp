@@ -0,0 +1,157 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_INPROC_CONTEXT_HPP
+#define INCLUDED_GHEX_TL_INPROC_CONTEXT_HPP
+
+#include "../context.hpp"
+#include "./communicator.hpp"
+#include "./setup.hpp"
+#include "../communicator.hpp"
+
+namespace gridtools {
+    namespace ghex {
+        namespace tl {
+
+            template<typename ThreadPrimitives>
+            struct transport_context<threads_tag, ThreadPrimitives>
+            {
+                using thread_primitives_type = ThreadPrimitives;
+                using communicator_type = communicator<inproc::communicator<thread_primitives_type>>;
+                using thread_token = typename thread_primitives_type::token;
+                using shared_state_type = typename communicator_type::shared_state_type;
+                using state_type = typename communicator_type::state_type;
+                using state_ptr = std::unique_ptr<state_type>;
+                using state_vector = std::vector<state_ptr>;
+
+                thread_primitives_type& m_thread_primitives;
+                std::vector<thread_token>  m_tokens;
+                shared_state_type m_shared_state;
+                state_type m_state;
+                state_vector m_states;
+
+                transport_context(ThreadPrimitives& tp, inproc::world& w, int rank)
+                : m_thread_primitives(tp)
+                , m_tokens(tp.size())
+                , m_shared_state(&w, rank, this, &tp)
+                , m_state(nullptr)
+                , m_states(tp.size())
+                {}
+
+                communicator_type get_serial_communicator()
+                {
+                    return {&m_shared_state, &m_state};
+                }
+
+                communicator_type get_communicator(const thread_token& t)
+                {
+                    if (!m_states[t.id()])
+                    {
+                        m_tokens[t.id()] = t;
+                        m_states[t.id()] = std::make_unique<state_type>(&m_tokens[t.id()]);
+                    }
+                    return {&m_shared_state, m_states[t.id()].get()};
+                }
+            };
+
+            /** @brief context of one rank of an in-process world, where the ranks are threads. It provides the same
+              * interface as the MPI based context, except for the MPI communicator: the setup communicator performs
+              * its collectives among the threads of the world. Can only be created with the `context_factory`.
+              * @tparam ThreadPrimitives type for thread managment (of the threads within one rank) */
+            template<class ThreadPrimitives>
+            class context<threads_tag, ThreadPrimitives>
+            {
+            public: // member types
+                using tag                    = threads_tag;
+                using transport_context_type = transport_context<tag,ThreadPrimitives>;
+                using communicator_type      = typename transport_context_type::communicator_type;
+                using thread_primitives_type = ThreadPrimitives;
+                using thread_token           = typename thread_primitives_type::token;
+
+                friend struct context_factory<threads_tag,ThreadPrimitives>;
+
+            private: // members
+                inproc::world* m_world;
+                thread_primitives_type m_thread_primitives;
+                transport_context_type m_transport_context;
+                int m_rank;
+
+            private: // private ctor
+                context(int num_threads, inproc::world& w, int rank)
+                    : m_world{&w}
+                    , m_thread_primitives(num_threads)
+                    , m_transport_context{m_thread_primitives, w, rank}
+                    , m_rank{rank}
+                {}
+
+            public: // ctors
+                context(const context&) = delete;
+                context(context&&) = delete;
+
+            public: // member functions
+                int rank() const noexcept { return m_rank; }
+                int size() const noexcept { return m_world->size(); }
+
+                /** @brief return a reference to the thread-shared thread primitives instance.
+                  * This function is thread-safe. */
+                thread_primitives_type& thread_primitives() noexcept
+                {
+                    return m_thread_primitives;
+                }
+
+                /** @brief return a setup communicator spanning all ranks of the world.
+                  * This function is not thread-safe and should only be used in the serial part of the code. */
+                inproc::setup_communicator get_setup_communicator()
+                {
+                    return {m_world, m_rank};
+                }
+
+                /** @brief return a per-rank communicator.
+                  * This function is not thread-safe and should only be used in the serial part of the code. */
+                communicator_type get_serial_communicator()
+                {
+                    return m_transport_context.get_serial_communicator();
+                }
+
+                /** @brief return a per-thread communicator.
+                  * This function is thread-safe. */
+                communicator_type get_communicator(const thread_token& t)
+                {
+                    return m_transport_context.get_communicator(t);
+                }
+
+                /** @brief return a per-thread thread token.
+                  * This function is thread-safe. */
+                thread_token get_token() noexcept
+                {
+                    return m_thread_primitives.get_token();
+                }
+            };
+
+            template<class ThreadPrimitives>
+            struct context_factory<threads_tag, ThreadPrimitives>
+            {
+                /** @brief create the context of one rank. Called by the thread acting as this rank.
+                  * @param num_threads number of threads within this rank
+                  * @param w world of ranks
+                  * @param rank rank of the calling thread in [0, w.size()) */
+                static std::unique_ptr<context<threads_tag, ThreadPrimitives>> create(int num_threads, inproc::world& w, int rank)
+                {
+                    if (rank < 0 || rank >= w.size()) throw std::runtime_error("inproc: rank out of range");
+                    return std::unique_ptr<context<threads_tag, ThreadPrimitives>>{
+                        new context<threads_tag,ThreadPrimitives>{num_threads, w, rank}};
+                }
+            };
+
+        }
+    }
+}
+
+#endif /* INCLUDED_GHEX_TL_INPROC_CONTEXT_HPP */
@@ -0,0 +1,135 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_INPROC_FUTURE_HPP
+#define INCLUDED_GHEX_TL_INPROC_FUTURE_HPP
+
+#include <utility>
+#include "./world.hpp"
+
+namespace gridtools{
+    namespace ghex {
+        namespace tl {
+            namespace inproc {
+
+                /** @brief handle to a posted operation. An empty handle refers to a completed operation. */
+                struct request_t
+                {
+                    operation* m_op = nullptr;
+                    mailbox* m_mailbox = nullptr;
+
+                    request_t() noexcept = default;
+                    request_t(operation* op, mailbox* mb) noexcept : m_op{op}, m_mailbox{mb} {}
+                    request_t(const request_t&) = delete;
+                    request_t(request_t&& other) noexcept
+                    : m_op{std::exchange(other.m_op, nullptr)}, m_mailbox{other.m_mailbox} {}
+                    request_t& operator=(const request_t&) = delete;
+                    request_t& operator=(request_t&& other) noexcept
+                    {
+                        if (m_op) m_op->release();
+                        m_op = std::exchange(other.m_op, nullptr);
+                        m_mailbox = other.m_mailbox;
+                        return *this;
+                    }
+                    ~request_t() { if (m_op) m_op->release(); }
+
+                    request_kind kind() const noexcept { return m_op ? m_op->m_kind : request_kind::none; }
+
+                    bool test()
+                    {
+                        if (!m_op) return true;
+                        if (!m_op->done()) m_mailbox->progress();
+                        return m_op->done();
+                    }
+
+                    void wait()
+                    {
+                        while (!test()) std::this_thread::yield();
+                    }
+
+                    bool cancel()
+                    {
+                        return m_op && m_op->m_kind == request_kind::recv && m_mailbox->cancel(m_op);
+                    }
+                };
+
+                /** @brief future template for non-blocking communication */
+                template<typename T>
+                struct future_t
+                {
+                    using value_type  = T;
+                    using handle_type = request_t;
+
+                    value_type m_data;
+                    handle_type m_handle;
+
+                    future_t(value_type&& data, handle_type&& h)
+                    :   m_data(std::move(data))
+                    ,   m_handle(std::move(h))
+                    {}
+                    future_t(const future_t&) = delete;
+                    future_t(future_t&&) = default;
+                    future_t& operator=(const future_t&) = delete;
+                    future_t& operator=(future_t&&) = default;
+
+                    void wait() { m_handle.wait(); }
+
+                    bool test() { return m_handle.test(); }
+
+                    bool ready() { return m_handle.test(); }
+
+                    [[nodiscard]] value_type get()
+                    {
+                        wait();
+                        return std::move(m_data);
+                    }
+
+                    bool is_recv() const noexcept { return (m_handle.kind() == request_kind::recv); }
+
+                    /** Cancel the future.
+                      * @return True if the request was successfully canceled */
+                    bool cancel() { return m_handle.cancel(); }
+                };
+
+                template<>
+                struct future_t<void>
+                {
+                    using handle_type = request_t;
+
+                    handle_type m_handle;
+
+                    future_t() noexcept = default;
+                    future_t(handle_type&& h)
+                    :   m_handle(std::move(h))
+                    {}
+                    future_t(const future_t&) = delete;
+                    future_t(future_t&&) = default;
+                    future_t& operator=(const future_t&) = delete;
+                    future_t& operator=(future_t&&) = default;
+
+                    void wait() { m_handle.wait(); }
+
+                    bool test() { return m_handle.test(); }
+
+                    bool ready() { return m_handle.test(); }
+
+                    void get() { wait(); }
+
+                    bool is_recv() const noexcept { return (m_handle.kind() == request_kind::recv); }
+
+                    bool cancel() { return m_handle.cancel(); }
+                };
+
+            } // namespace inproc
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_INPROC_FUTURE_HPP */
@@ -0,0 +1,151 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_INPROC_SETUP_HPP
+#define INCLUDED_GHEX_TL_INPROC_SETUP_HPP
+
+#include <vector>
+#include <cstring>
+#include <thread>
+#include "./world.hpp"
+
+namespace gridtools{
+    namespace ghex {
+        namespace tl {
+            namespace inproc {
+
+                /** @brief result of a collective, which is complete on return */
+                template<typename T>
+                struct ready_future
+                {
+                    T m_data;
+
+                    void wait() noexcept {}
+                    bool test() noexcept { return true; }
+                    bool ready() noexcept { return true; }
+                    [[nodiscard]] T get() { return std::move(m_data); }
+                };
+
+                /** @brief communicator used for the setup phase when the ranks are threads. Provides the collectives
+                  * and the blocking messages needed to build structured patterns. All ranks of the world must call the
+                  * collectives in the same order. */
+                class setup_communicator
+                {
+                public:
+                    using rank_type    = int;
+                    using size_type    = int;
+                    using address_type = rank_type;
+                    template<typename T>
+                    using future = ready_future<T>;
+
+                private:
+                    // separates setup messages from the messages of the communicators
+                    static constexpr int channel = 1;
+
+                    world* m_world;
+                    rank_type m_rank;
+
+                public:
+                    setup_communicator(world* w, rank_type rank) noexcept
+                    : m_world{w}
+                    , m_rank{rank} {}
+                    setup_communicator(const setup_communicator&) = default;
+                    setup_communicator& operator=(const setup_communicator&) = default;
+
+                    /** @return rank of this thread */
+                    rank_type rank() const noexcept { return m_rank; }
+                    /** @return number of ranks */
+                    size_type size() const noexcept { return m_world->size(); }
+                    address_type address() const noexcept { return rank(); }
+
+                    void barrier() { m_world->barrier(m_rank); }
+
+                    /** @brief buffered send: returns immediately */
+                    template<typename T>
+                    void send(int dest, int tag, const T & value)
+                    {
+                        send(dest, tag, &value, 1);
+                    }
+
+                    template<typename T>
+                    void recv(int source, int tag, T & value)
+                    {
+                        recv(source, tag, &value, 1);
+                    }
+
+                    /** @brief buffered send: returns immediately */
+                    template<typename T>
+                    void send(int dest, int tag, const T* values, int n)
+                    {
+                        const std::size_t bytes = sizeof(T)*n;
+                        auto op = new operation(nullptr, bytes, m_rank, tag, request_kind::send, channel);
+                        op->m_buffer.reset(new unsigned char[bytes]);
+                        if (bytes) std::memcpy(op->m_buffer.get(), values, bytes);
+                        op->m_data = op->m_buffer.get();
+                        m_world->get_mailbox(dest).post(op);
+                        op->release();
+                    }
+
+                    template<typename T>
+                    void recv(int source, int tag, T* values, int n)
+                    {
+                        auto op = new operation(values, sizeof(T)*n, source, tag, request_kind::recv, channel);
+                        auto& mb = m_world->get_mailbox(m_rank);
+                        mb.post(op);
+                        while (mb.progress(), !op->done()) std::this_thread::yield();
+                        op->release();
+                    }
+
+                    template<typename T>
+                    void broadcast(T& value, int root)
+                    {
+                        m_world->broadcast(m_rank, &value, sizeof(T), root);
+                    }
+
+                    template<typename T>
+                    void broadcast(T * values, int n, int root)
+                    {
+                        m_world->broadcast(m_rank, values, sizeof(T)*n, root);
+                    }
+
+                    template<typename T>
+                    future< std::vector<std::vector<T>> > all_gather(const std::vector<T>& payload, const std::vector<int>& sizes)
+                    {
+                        std::vector<int> counts(size()), displs(size());
+                        int total = 0;
+                        for (int r=0; r<size(); ++r) { counts[r] = sizes[r]*sizeof(T); displs[r] = total; total += counts[r]; }
+                        std::vector<char> buffer(total);
+                        m_world->all_gather(m_rank, payload.data(), buffer.data(), counts, displs);
+                        std::vector<std::vector<T>> res(size());
+                        for (int r=0; r<size(); ++r)
+                        {
+                            res[r].resize(sizes[r]);
+                            if (counts[r]) std::memcpy(res[r].data(), buffer.data()+displs[r], counts[r]);
+                        }
+                        return {std::move(res)};
+                    }
+
+                    template<typename T>
+                    future< std::vector<T> > all_gather(const T& payload)
+                    {
+                        std::vector<T> res(size());
+                        std::vector<int> displs(size());
+                        for (int r=0; r<size(); ++r) displs[r] = r*sizeof(T);
+                        m_world->all_gather(m_rank, &payload, res.data(), std::vector<int>(size(), sizeof(T)), displs);
+                        return {std::move(res)};
+                    }
+                };
+
+            } // namespace inproc
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_INPROC_SETUP_HPP */
@@ -0,0 +1,261 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_INPROC_WORLD_HPP
+#define INCLUDED_GHEX_TL_INPROC_WORLD_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace gridtools {
+    namespace ghex {
+        namespace tl {
+            namespace inproc {
+
+                /** @brief the type of the communication */
+                enum class request_kind : int { none=0, send, recv };
+
+                /** @brief a posted send or receive. It is shared between the future of the posting rank and the
+                  * mailbox of the receiving rank (intrusive reference count). */
+                struct operation
+                {
+                    static constexpr int pending   = 0;
+                    static constexpr int completed = 1;
+                    static constexpr int cancelled = 2;
+
+                    std::atomic<int> m_refs{2};
+                    std::atomic<int> m_state{pending};
+                    operation* m_next = nullptr;
+                    void* m_data;
+                    std::size_t m_size;
+                    int m_source; // source rank of the message (the posting rank for sends)
+                    int m_tag;
+                    request_kind m_kind;
+                    int m_channel; // messages only match within a channel (communicators, setup)
+                    std::unique_ptr<unsigned char[]> m_buffer; // copy of the payload for buffered sends
+
+                    operation(const void* data, std::size_t size, int source, int tag, request_kind kind,
+                        int channel = 0) noexcept
+                    : m_data{const_cast<void*>(data)}, m_size{size}, m_source{source}, m_tag{tag}, m_kind{kind}
+                    , m_channel{channel} {}
+
+                    bool done() const noexcept { return m_state.load(std::memory_order_acquire) != pending; }
+
+                    void release() noexcept
+                    {
+                        if (m_refs.fetch_sub(1, std::memory_order_acq_rel) == 1) delete this;
+                    }
+                };
+
+                /** @brief messages addressed to one rank. Sends (from any rank) and receives (from the owning rank)
+                  * are pushed onto lock-free stacks. Whichever thread progresses the mailbox - sender or receiver -
+                  * moves them to ordered lists, matches receives with sends by source and tag in posting order (like
+                  * MPI) and copies the payload directly from the send buffer to the receive buffer. A message larger
+                  * than the receive buffer is truncated. */
+                class mailbox
+                {
+                private: // members
+                    std::atomic<operation*> m_posted_sends{nullptr};
+                    std::atomic<operation*> m_posted_recvs{nullptr};
+                    std::atomic<bool>       m_locked{false};
+                    // only accessed while holding the lock
+                    std::vector<operation*> m_sends;
+                    std::vector<operation*> m_recvs;
+
+                public: // ctors
+                    mailbox() = default;
+                    mailbox(const mailbox&) = delete;
+                    mailbox& operator=(const mailbox&) = delete;
+
+                    ~mailbox()
+                    {
+                        lock();
+                        drain(m_posted_sends, m_sends);
+                        drain(m_posted_recvs, m_recvs);
+                        for (auto op : m_sends) op->release();
+                        for (auto op : m_recvs) op->release();
+                    }
+
+                public: // member functions
+                    void post(operation* op) noexcept
+                    {
+                        auto& stack = (op->m_kind == request_kind::send) ? m_posted_sends : m_posted_recvs;
+                        op->m_next = stack.load(std::memory_order_relaxed);
+                        while (!stack.compare_exchange_weak(op->m_next, op,
+                            std::memory_order_release, std::memory_order_relaxed)) {}
+                    }
+
+                    /** @brief match and complete operations, unless another thread is doing so already
+                      * @return number of completed receives */
+                    int progress()
+                    {
+                        if (!try_lock()) return 0;
+                        int completed = 0;
+                        if (drain(m_posted_sends, m_sends) + drain(m_posted_recvs, m_recvs) > 0)
+                            completed = match();
+                        unlock();
+                        return completed;
+                    }
+
+                    /** @brief cancel a receive which has not been matched yet */
+                    bool cancel(operation* op)
+                    {
+                        lock();
+                        drain(m_posted_sends, m_sends);
+                        drain(m_posted_recvs, m_recvs);
+                        bool res = false;
+                        for (auto it = m_recvs.begin(); it != m_recvs.end(); ++it)
+                        {
+                            if (*it == op)
+                            {
+                                m_recvs.erase(it);
+                                op->m_state.store(operation::cancelled, std::memory_order_release);
+                                op->release();
+                                res = true;
+                                break;
+                            }
+                        }
+                        unlock();
+                        return res;
+                    }
+
+                private: // implementation
+                    bool try_lock() noexcept
+                    {
+                        return !m_locked.load(std::memory_order_relaxed) &&
+                            !m_locked.exchange(true, std::memory_order_acquire);
+                    }
+
+                    void lock() noexcept
+                    {
+                        while (!try_lock()) std::this_thread::yield();
+                    }
+
+                    void unlock() noexcept { m_locked.store(false, std::memory_order_release); }
+
+                    // append the posted operations in posting order
+                    static std::size_t drain(std::atomic<operation*>& stack, std::vector<operation*>& list)
+                    {
+                        operation* head = stack.exchange(nullptr, std::memory_order_acquire);
+                        const auto first = list.size();
+                        for (; head; head = head->m_next) list.push_back(head);
+                        std::reverse(list.begin()+first, list.end());
+                        return list.size() - first;
+                    }
+
+                    int match()
+                    {
+                        int completed = 0;
+                        auto r_out = m_recvs.begin();
+                        for (auto r = m_recvs.begin(); r != m_recvs.end(); ++r)
+                        {
+                            operation* recv = *r;
+                            auto s = m_sends.begin();
+                            while (s != m_sends.end() && ((*s)->m_source != recv->m_source ||
+                                (*s)->m_tag != recv->m_tag || (*s)->m_channel != recv->m_channel))
+                                ++s;
+                            if (s == m_sends.end())
+                            {
+                                *r_out++ = recv;
+                                continue;
+                            }
+                            operation* send = *s;
+                            m_sends.erase(s);
+                            // a message larger than the receive buffer is truncated
+                            recv->m_size = std::min(send->m_size, recv->m_size);
+                            if (recv->m_size) std::memcpy(recv->m_data, send->m_data, recv->m_size);
+                            send->m_state.store(operation::completed, std::memory_order_release);
+                            recv->m_state.store(operation::completed, std::memory_order_release);
+                            send->release();
+                            recv->release();
+                            ++completed;
+                        }
+                        m_recvs.erase(r_out, m_recvs.end());
+                        return completed;
+                    }
+                };
+
+                /** @brief a set of ranks which are threads of the same process. Holds one mailbox per rank and the
+                  * state of the collective operations used for setup. The world must outlive all contexts created
+                  * from it. */
+                class world
+                {
+                private: // members
+                    int m_size;
+                    std::unique_ptr<mailbox[]> m_mailboxes;
+                    std::vector<const void*> m_slots;
+                    std::atomic<int> m_arrived{0};
+                    std::atomic<int> m_generation{0};
+
+                public: // ctors
+                    /** @param size number of ranks */
+                    world(int size)
+                    : m_size{size}
+                    , m_mailboxes{new mailbox[size]}
+                    , m_slots(size, nullptr)
+                    {
+                        if (size < 1) throw std::runtime_error("inproc: a world needs at least one rank");
+                    }
+                    world(const world&) = delete;
+                    world& operator=(const world&) = delete;
+
+                public: // member functions
+                    int size() const noexcept { return m_size; }
+
+                    mailbox& get_mailbox(int rank) noexcept { return m_mailboxes[rank]; }
+
+                    /** @brief synchronize all ranks. The mailbox of the calling rank is progressed while waiting. */
+                    void barrier(int rank)
+                    {
+                        const int generation = m_generation.load(std::memory_order_acquire);
+                        if (m_arrived.fetch_add(1, std::memory_order_acq_rel) == m_size-1)
+                        {
+                            m_arrived.store(0, std::memory_order_relaxed);
+                            m_generation.store(generation+1, std::memory_order_release);
+                            return;
+                        }
+                        while (m_generation.load(std::memory_order_acquire) == generation)
+                        {
+                            if (m_mailboxes[rank].progress() == 0) std::this_thread::yield();
+                        }
+                    }
+
+                    /** @brief gather bytes from all ranks: counts[r] bytes from rank r are copied to dst+displs[r] */
+                    void all_gather(int rank, const void* src, void* dst, const std::vector<int>& counts,
+                        const std::vector<int>& displs)
+                    {
+                        m_slots[rank] = src;
+                        barrier(rank);
+                        for (int r=0; r<m_size; ++r)
+                            if (counts[r]) std::memcpy(static_cast<char*>(dst)+displs[r], m_slots[r], counts[r]);
+                        barrier(rank);
+                    }
+
+                    /** @brief copy bytes from the root to all other ranks */
+                    void broadcast(int rank, void* data, std::size_t bytes, int root)
+                    {
+                        if (rank == root) m_slots[rank] = data;
+                        barrier(rank);
+                        if (rank != root && bytes) std::memcpy(data, m_slots[root], bytes);
+                        barrier(rank);
+                    }
+                };
+
+            } // namespace inproc
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_INPROC_WORLD_HPP */
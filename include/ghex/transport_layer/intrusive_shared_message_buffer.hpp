@@ -0,0 +1,250 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_INTRUSIVE_SHARED_MESSAGE_BUFFER_HPP
+#define INCLUDED_GHEX_TL_INTRUSIVE_SHARED_MESSAGE_BUFFER_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include "../common/to_address.hpp"
+#include "./callback_utils.hpp"
+
+namespace gridtools {
+    namespace ghex {
+        namespace tl {
+
+            /** intrusive_shared_message_buffer is a copyable message whose reference count, size and allocator are
+              * stored in front of the data, in a single allocation obtained from the allocator. Copies share the
+              * data and the count is updated atomically, hence copies may be passed to and released by different
+              * threads. The last reference returns the memory to the allocator (e.g. to a pool).
+              *
+              * The interface is identical to shared_message_buffer, except that storage can only be reallocated
+              * (reserve/resize beyond the capacity) while the message is not shared. As for message_buffer, the
+              * content is not preserved on reallocation.
+              *
+              * @tparam Allocator The allocator used to allocate the memory for the message */
+            template<typename Allocator = std::allocator<unsigned char>>
+            class intrusive_shared_message_buffer
+            {
+            public: // member types
+
+                using byte              = unsigned char;
+                using value_type        = byte;
+                using allocator_type    = typename std::allocator_traits<Allocator>::template rebind_alloc<byte>;
+                using alloc_traits      = std::allocator_traits<allocator_type>;
+                using pointer           = typename alloc_traits::pointer;
+                using raw_pointer       = byte*;
+                using raw_const_pointer = const byte*;
+
+                static constexpr bool can_be_shared = true;
+
+            private: // implementation types
+
+                struct control_block
+                {
+                    std::atomic<int> m_count;
+                    std::size_t m_size;
+                    std::size_t m_capacity;
+                    allocator_type m_alloc;
+                };
+
+                // data starts after the control block, at the alignment of the allocation
+                static constexpr std::size_t header_size =
+                    (sizeof(control_block) + alignof(std::max_align_t) - 1u)/alignof(std::max_align_t)*
+                    alignof(std::max_align_t);
+
+            private: // members
+
+                control_block* m_block = nullptr;
+
+            public: // ctors
+
+                /** @brief construct an empty message */
+                template<
+                    typename Alloc = Allocator,
+                    typename std::enable_if<    std::is_default_constructible<Alloc>::value
+                                            && !std::is_convertible<Alloc,std::size_t>::value, int>::type = 0>
+                intrusive_shared_message_buffer(Alloc alloc = Alloc{})
+                : m_block{ create(0u, allocator_type(alloc)) }
+                {}
+
+                template<
+                    typename Alloc,
+                    typename std::enable_if<   !std::is_default_constructible<Alloc>::value
+                                            && !std::is_convertible<Alloc,std::size_t>::value, int>::type = 0>
+                intrusive_shared_message_buffer(Alloc alloc)
+                : m_block{ create(0u, allocator_type(alloc)) }
+                {}
+
+                /** @brief construct a message with given size */
+                template<
+                    typename Alloc = Allocator,
+                    typename std::enable_if< std::is_default_constructible<Alloc>::value, int>::type = 0>
+                intrusive_shared_message_buffer(std::size_t size_, Alloc alloc = Alloc{})
+                : m_block{ create(size_, allocator_type(alloc)) }
+                {
+                    m_block->m_size = size_;
+                }
+
+                template<
+                    typename Alloc,
+                    typename std::enable_if<!std::is_default_constructible<Alloc>::value, int>::type = 0>
+                intrusive_shared_message_buffer(std::size_t size_, Alloc alloc)
+                : m_block{ create(size_, allocator_type(alloc)) }
+                {
+                    m_block->m_size = size_;
+                }
+
+                intrusive_shared_message_buffer(const intrusive_shared_message_buffer& other) noexcept
+                : m_block{other.m_block}
+                {
+                    if (m_block) m_block->m_count.fetch_add(1, std::memory_order_relaxed);
+                }
+
+                intrusive_shared_message_buffer(intrusive_shared_message_buffer&& other) noexcept
+                : m_block{other.m_block}
+                {
+                    other.m_block = nullptr;
+                }
+
+                intrusive_shared_message_buffer& operator=(const intrusive_shared_message_buffer& other) noexcept
+                {
+                    if (m_block == other.m_block) return *this;
+                    if (other.m_block) other.m_block->m_count.fetch_add(1, std::memory_order_relaxed);
+                    release(m_block);
+                    m_block = other.m_block;
+                    return *this;
+                }
+
+                intrusive_shared_message_buffer& operator=(intrusive_shared_message_buffer&& other) noexcept
+                {
+                    if (this == &other) return *this;
+                    release(m_block);
+                    m_block = other.m_block;
+                    other.m_block = nullptr;
+                    return *this;
+                }
+
+                ~intrusive_shared_message_buffer()
+                {
+                    release(m_block);
+                }
+
+            public: // member functions
+
+                bool is_shared() const { return use_count() > 1; }
+                std::size_t use_count() const { return m_block ? m_block->m_count.load() : 0u; }
+
+                std::size_t size() const noexcept { return m_block ? m_block->m_size : 0u; }
+                std::size_t capacity() const noexcept { return m_block ? m_block->m_capacity : 0u; }
+
+                raw_const_pointer data() const noexcept { return m_block ? payload(m_block) : nullptr; }
+                raw_pointer data() noexcept { return m_block ? payload(m_block) : nullptr; }
+
+                template <typename T>
+                T* data() noexcept
+                {
+                    raw_pointer byte_ptr = data();
+                    assert(reinterpret_cast<std::uintptr_t>(byte_ptr) % alignof(T) == 0);
+                    return reinterpret_cast<T*>(byte_ptr);
+                }
+                template <typename T>
+                const T* data() const noexcept
+                {
+                    raw_const_pointer byte_ptr = data();
+                    assert(reinterpret_cast<std::uintptr_t>(byte_ptr) % alignof(T) == 0);
+                    return reinterpret_cast<const T*>(byte_ptr);
+                }
+
+                raw_const_pointer begin() const noexcept { return data(); }
+                raw_const_pointer end() const noexcept { return data()+size(); }
+                raw_pointer begin() noexcept { return data(); }
+                raw_pointer end() noexcept { return data()+size(); }
+
+                /** @brief reserves n bytes of memory and will allocate if n is greater than the current capacity.
+                  * Throws if the message would need to be reallocated while it is shared. */
+                void reserve(std::size_t n)
+                {
+                    if (n <= capacity()) return;
+                    if (!m_block) throw std::runtime_error("message is empty");
+                    if (is_shared()) throw std::runtime_error("cannot reallocate a shared message");
+                    control_block* b = create(n, m_block->m_alloc);
+                    b->m_size = m_block->m_size;
+                    release(m_block);
+                    m_block = b;
+                }
+
+                void resize(std::size_t n)
+                {
+                    reserve(n);
+                    m_block->m_size = n;
+                }
+
+                void clear() { resize(0); }
+
+                void swap(intrusive_shared_message_buffer& other) noexcept { std::swap(m_block, other.m_block); }
+
+                /** @brief a type-erased message which holds one reference to this message. It is used to hand the
+                  * message to the callback queues without allocating. */
+                cb::counted_ref_message make_ref() const noexcept
+                {
+                    if (m_block) m_block->m_count.fetch_add(1, std::memory_order_relaxed);
+                    return {const_cast<byte*>(data()), size(), m_block, &release_erased};
+                }
+
+            private: // implementation
+
+                static byte* payload(control_block* b) noexcept
+                {
+                    return reinterpret_cast<byte*>(b) + header_size;
+                }
+
+                static control_block* create(std::size_t capacity, allocator_type alloc)
+                {
+                    byte* ptr = ::gridtools::ghex::to_address(alloc_traits::allocate(alloc, header_size + capacity));
+                    control_block* b = new(ptr) control_block{{1}, 0u, capacity, std::move(alloc)};
+                    return b;
+                }
+
+                static void release(control_block* b) noexcept
+                {
+                    if (!b) return;
+                    // the last owner deallocates: acquire the writes of the other owners
+                    if (b->m_count.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+                    allocator_type alloc(std::move(b->m_alloc));
+                    const std::size_t bytes = header_size + b->m_capacity;
+                    b->~control_block();
+                    alloc_traits::deallocate(alloc,
+                        std::pointer_traits<pointer>::pointer_to(*reinterpret_cast<byte*>(b)), bytes);
+                }
+
+                static void release_erased(void* b) noexcept
+                {
+                    release(static_cast<control_block*>(b));
+                }
+            };
+
+            template<typename A>
+            void swap(intrusive_shared_message_buffer<A>& a, intrusive_shared_message_buffer<A>& b) noexcept
+            {
+                a.swap(b);
+            }
+
+        } // namespace tl
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_INTRUSIVE_SHARED_MESSAGE_BUFFER_HPP */
@@ -0,0 +1,78 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_TL_MPI_AWAIT_FUTURES_HPP
+#define INCLUDED_GHEX_TL_MPI_AWAIT_FUTURES_HPP
+
+#include <vector>
+#include "../../common/await_futures.hpp"
+#include "./future.hpp"
+
+namespace gridtools {
+    namespace ghex {
+        namespace detail {
+
+            /** @brief block in MPI_Waitany or MPI_Waitsome until at least one request completes: the completed
+              * requests are set to MPI_REQUEST_NULL by MPI and written back to the futures, such that get() does not
+              * wait again */
+            template<typename T>
+            struct blocking_await<tl::mpi::future_t<T>>
+            {
+                template<typename FutureRange, typename Continuation>
+                static void await(FutureRange& range, Continuation&& cont, wait_strategy ws)
+                {
+                    const int size = range.size();
+                    std::vector<MPI_Request> requests(size);
+                    std::vector<int> indices(size);
+                    int remaining = size;
+                    for (int i = 0; i < size; ++i)
+                    {
+                        requests[i] = range[i].m_handle.get();
+                        // completed before: MPI would skip the request, hence continue it here
+                        if (requests[i] == MPI_REQUEST_NULL)
+                        {
+                            cont(range[i].get());
+                            --remaining;
+                        }
+                    }
+                    while (remaining > 0)
+                    {
+                        int count = 0;
+                        if (ws == wait_strategy::waitany)
+                        {
+                            int index;
+                            GHEX_CHECK_MPI_RESULT(MPI_Waitany(size, requests.data(), &index, MPI_STATUS_IGNORE));
+                            if (index == MPI_UNDEFINED) break;
+                            indices[0] = index;
+                            count = 1;
+                        }
+                        else
+                        {
+                            GHEX_CHECK_MPI_RESULT(MPI_Waitsome(size, requests.data(), &count, indices.data(),
+                                MPI_STATUSES_IGNORE));
+                            if (count == MPI_UNDEFINED) break;
+                        }
+                        for (int i = 0; i < count; ++i)
+                        {
+                            const auto k = indices[i];
+                            range[k].m_handle.get() = requests[k];
+                            range[k].m_handle.trace_completion();
+                            cont(range[k].get());
+                        }
+                        remaining -= count;
+                    }
+                }
+            };
+
+        } // namespace detail
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_TL_MPI_AWAIT_FUTURES_HPP */
@@ -16,9 +16,11 @@
 #include "../shared_message_buffer.hpp"
 #include "../tags.hpp"
 #include "./future.hpp"
+#include "./await_futures.hpp"
 #include "./request_cb.hpp"
 #include "../context.hpp"
 #include "./communicator_state.hpp"
+#include "../../common/traffic_capture.hpp"
 
 namespace gridtools {
     
@@ -73,6 +75,15 @@ namespace gridtools {
                     rank_type size() const noexcept { return m_shared_state->size(); }
                     address_type address() const noexcept { return rank(); }
 
+                    /** @brief largest tag value supported by the communicator (MPI_TAG_UB) */
+                    tag_type tag_upper_bound() const
+                    {
+                        int* ub;
+                        int flag = 0;
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_get_attr(m_shared_state->m_comm, MPI_TAG_UB, &ub, &flag));
+                        return flag ? *ub : 32767;
+                    }
+
                     /** @brief send a message. The message must be kept alive by the caller until the communication is
                      * finished.
                      * @tparam Message a meassage type
@@ -87,6 +98,10 @@ namespace gridtools {
                                                         sizeof(typename Message::value_type) * msg.size(), MPI_BYTE,
                                                         dst, tag, m_shared_state->m_comm, &req.get()));
                         req.m_kind = request_kind::send;
+                        req.m_peer = dst;
+                        req.m_tag = tag;
+                        trace::instant("send posted", "mpi", dst, tag, sizeof(typename Message::value_type) * msg.size());
+                        capture::send(rank(), dst, tag, sizeof(typename Message::value_type) * msg.size());
                         return req;
                     }
 
@@ -104,6 +119,10 @@ namespace gridtools {
                                                         sizeof(typename Message::value_type) * msg.size(), MPI_BYTE,
                                                         src, tag, m_shared_state->m_comm, &req.get()));
                         req.m_kind = request_kind::recv;
+                        req.m_peer = src;
+                        req.m_tag = tag;
+                        trace::instant("recv posted", "mpi", src, tag, sizeof(typename Message::value_type) * msg.size());
+                        capture::recv(rank(), src, tag, sizeof(typename Message::value_type) * msg.size());
                         return req;
                     }
 
@@ -13,6 +13,7 @@
 
 #include "./error.hpp"
 #include "../../common/c_managed_struct.hpp"
+#include "../../common/trace.hpp"
 
 namespace gridtools{
     namespace ghex {
@@ -28,21 +29,34 @@ namespace gridtools{
                     GHEX_C_STRUCT(req_type, MPI_Request)
                     req_type m_req = MPI_REQUEST_NULL;
                     request_kind m_kind = request_kind::none;
+                    // peer rank and tag, recorded with the completion event
+                    int m_peer = -1;
+                    int m_tag = -1;
 
                     void wait()
                     {
                         //MPI_Status status;
+                        const bool active = trace::enabled && m_req.get() != MPI_REQUEST_NULL;
                         GHEX_CHECK_MPI_RESULT(MPI_Wait(&m_req.get(), MPI_STATUS_IGNORE));
+                        if (active) trace_completion();
                     }
 
                     bool test()
                     {
                         //MPI_Status result;
                         int flag = 0;
+                        const bool active = trace::enabled && m_req.get() != MPI_REQUEST_NULL;
                         GHEX_CHECK_MPI_RESULT(MPI_Test(&m_req.get(), &flag, MPI_STATUS_IGNORE));
+                        if (active && flag) trace_completion();
                         return flag != 0;
                     }
 
+                    void trace_completion()
+                    {
+                        trace::instant(m_kind == request_kind::recv ? "recv complete" : "send complete", "mpi", m_peer,
+                            m_tag);
+                    }
+
                     operator       MPI_Request&()       noexcept { return m_req; }
                     operator const MPI_Request&() const noexcept { return m_req; }
                           MPI_Request& get()       noexcept { return m_req; }
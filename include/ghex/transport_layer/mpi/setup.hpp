@@ -15,6 +15,8 @@
 #include "./status.hpp"
 #include "./future.hpp"
 #include <vector>
+#include <memory>
+#include <cstring>
 #include <cassert>
 
 namespace gridtools{
@@ -22,7 +24,123 @@ namespace gridtools{
         namespace tl {
             namespace mpi {
 
-            /** @brief special mpi communicator used for setup phase */
+            /** @brief two-level view of a communicator: the ranks sharing a node and one leader (the lowest rank)
+              * per node. The sub-communicators are created collectively on first use, the layout (node of each
+              * rank and the ranks of each node) is replicated on all ranks. */
+            class node_topology
+            {
+            private: // members
+                MPI_Comm m_comm;
+                int m_ranks_per_node;
+                bool m_initialized = false;
+                MPI_Comm m_node_comm = MPI_COMM_NULL;
+                MPI_Comm m_leader_comm = MPI_COMM_NULL;
+                int m_node = 0;
+                int m_node_rank = 0;
+                std::vector<int> m_ordering;     // ranks grouped by node
+                std::vector<int> m_node_offsets; // start of each node in m_ordering
+                std::vector<int> m_node_of;      // node of each rank
+                std::vector<int> m_node_rank_of; // rank within its node of each rank
+
+            public: // ctors
+                /** @param comm the communicator
+                  * @param ranks_per_node 0: group the ranks which share memory, otherwise group consecutive ranks
+                  * (emulates a multi-node layout) */
+                node_topology(MPI_Comm comm, int ranks_per_node = 0)
+                : m_comm{comm}
+                , m_ranks_per_node{ranks_per_node}
+                {}
+                node_topology(const node_topology&) = delete;
+                node_topology& operator=(const node_topology&) = delete;
+
+                ~node_topology()
+                {
+                    int finalized = 0;
+                    MPI_Finalized(&finalized);
+                    if (finalized) return;
+                    if (m_leader_comm != MPI_COMM_NULL) MPI_Comm_free(&m_leader_comm);
+                    if (m_node_comm != MPI_COMM_NULL) MPI_Comm_free(&m_node_comm);
+                }
+
+            public: // member functions
+                /** @brief creates the node and leader communicators. Collective, only the first call does work. */
+                void init()
+                {
+                    if (m_initialized) return;
+                    m_initialized = true;
+                    int rank, size;
+                    GHEX_CHECK_MPI_RESULT(MPI_Comm_rank(m_comm, &rank));
+                    GHEX_CHECK_MPI_RESULT(MPI_Comm_size(m_comm, &size));
+                    if (m_ranks_per_node > 0)
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_split(m_comm, rank/m_ranks_per_node, rank, &m_node_comm));
+                    }
+                    else
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_split_type(m_comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                            &m_node_comm));
+                    }
+                    int node_size;
+                    GHEX_CHECK_MPI_RESULT(MPI_Comm_rank(m_node_comm, &m_node_rank));
+                    GHEX_CHECK_MPI_RESULT(MPI_Comm_size(m_node_comm, &node_size));
+                    GHEX_CHECK_MPI_RESULT(MPI_Comm_split(m_comm, m_node_rank==0 ? 0 : MPI_UNDEFINED, rank,
+                        &m_leader_comm));
+
+                    // the leaders collect the ranks of their node and exchange them
+                    std::vector<int> members(node_size);
+                    GHEX_CHECK_MPI_RESULT(MPI_Gather(&rank, 1, MPI_INT, members.data(), 1, MPI_INT, 0, m_node_comm));
+                    int info[2] = {0, 0};
+                    m_ordering.resize(size);
+                    if (m_node_rank == 0)
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_size(m_leader_comm, &info[0]));
+                        GHEX_CHECK_MPI_RESULT(MPI_Comm_rank(m_leader_comm, &info[1]));
+                        std::vector<int> node_sizes(info[0]);
+                        GHEX_CHECK_MPI_RESULT(MPI_Allgather(&node_size, 1, MPI_INT, node_sizes.data(), 1, MPI_INT,
+                            m_leader_comm));
+                        m_node_offsets.resize(info[0]+1, 0);
+                        for (int n=0; n<info[0]; ++n) m_node_offsets[n+1] = m_node_offsets[n] + node_sizes[n];
+                        GHEX_CHECK_MPI_RESULT(MPI_Allgatherv(members.data(), node_size, MPI_INT, m_ordering.data(),
+                            node_sizes.data(), m_node_offsets.data(), MPI_INT, m_leader_comm));
+                    }
+                    // and share the layout within the node
+                    GHEX_CHECK_MPI_RESULT(MPI_Bcast(info, 2, MPI_INT, 0, m_node_comm));
+                    m_node = info[1];
+                    m_node_offsets.resize(info[0]+1);
+                    GHEX_CHECK_MPI_RESULT(MPI_Bcast(m_node_offsets.data(), info[0]+1, MPI_INT, 0, m_node_comm));
+                    GHEX_CHECK_MPI_RESULT(MPI_Bcast(m_ordering.data(), size, MPI_INT, 0, m_node_comm));
+                    m_node_of.resize(size);
+                    m_node_rank_of.resize(size);
+                    for (int n=0; n<info[0]; ++n)
+                        for (int k=m_node_offsets[n]; k<m_node_offsets[n+1]; ++k)
+                        {
+                            m_node_of[m_ordering[k]] = n;
+                            m_node_rank_of[m_ordering[k]] = k-m_node_offsets[n];
+                        }
+                }
+
+                int num_nodes() const noexcept { return (int)m_node_offsets.size()-1; }
+                /** @brief whether a two-level scheme pays off: more than one node and more than one rank per node */
+                bool hierarchical() const noexcept
+                {
+                    return num_nodes() > 1 && num_nodes() < (int)m_ordering.size();
+                }
+                int node() const noexcept { return m_node; }
+                int node_rank() const noexcept { return m_node_rank; }
+                bool is_leader() const noexcept { return m_node_rank == 0; }
+                MPI_Comm node_comm() const noexcept { return m_node_comm; }
+                MPI_Comm leader_comm() const noexcept { return m_leader_comm; }
+                /** @brief all ranks, grouped by node (in node order) */
+                const std::vector<int>& ordering() const noexcept { return m_ordering; }
+                /** @brief start of each node in ordering(), has num_nodes()+1 entries */
+                const std::vector<int>& node_offsets() const noexcept { return m_node_offsets; }
+                int node_of(int rank) const noexcept { return m_node_of[rank]; }
+                int node_rank_of(int rank) const noexcept { return m_node_rank_of[rank]; }
+            };
+
+            /** @brief special mpi communicator used for setup phase. When the ranks are spread over several nodes
+              * with several ranks each, the collectives are performed in two levels: the data is aggregated on a
+              * leader per node, exchanged between the leaders and distributed within the nodes. */
             class setup_communicator
             : public communicator_base
             {
@@ -34,8 +152,21 @@ namespace gridtools{
                 template<typename T>
                 using future = future_t<T>;
 
+            private:
+                std::shared_ptr<node_topology> m_topology;
+
             public:
-                setup_communicator(const MPI_Comm& comm) : base_type{comm} {}
+                setup_communicator(const MPI_Comm& comm)
+                : base_type{comm}
+                , m_topology{std::make_shared<node_topology>(comm)} {}
+                /** @brief construct with an emulated node layout of ranks_per_node consecutive ranks per node */
+                setup_communicator(const MPI_Comm& comm, int ranks_per_node)
+                : base_type{comm}
+                , m_topology{std::make_shared<node_topology>(comm, ranks_per_node)} {}
+                /** @brief construct with a shared (possibly already initialized) node topology */
+                setup_communicator(const MPI_Comm& comm, std::shared_ptr<node_topology> topology)
+                : base_type{comm}
+                , m_topology{std::move(topology)} {}
                 setup_communicator(const setup_communicator&) = default;
                 setup_communicator& operator=(const setup_communicator&) = default;
                 setup_communicator(setup_communicator&&) noexcept = default;
@@ -43,6 +174,13 @@ namespace gridtools{
 
                 address_type address() const { return rank(); }
 
+                /** @brief node layout of this communicator (collective on first call) */
+                const node_topology& topology() const
+                {
+                    m_topology->init();
+                    return *m_topology;
+                }
+
                 template<typename T>
                 void send(int dest, int tag, const T & value)
                 {
@@ -74,56 +212,29 @@ namespace gridtools{
                 template<typename T> 
                 void broadcast(T& value, int root)
                 {
-                    GHEX_CHECK_MPI_RESULT(MPI_Bcast(&value, sizeof(T), MPI_BYTE, root, *this));
+                    broadcast_bytes(&value, sizeof(T), root);
                 }
 
                 template<typename T> 
                 void broadcast(T * values, int n, int root)
                 {
-                    GHEX_CHECK_MPI_RESULT(MPI_Bcast(values, sizeof(T)*n, MPI_BYTE, root, *this));
+                    broadcast_bytes(values, sizeof(T)*n, root);
                 }
 
                 template<typename T>
                 future< std::vector<std::vector<T>> > all_gather(const std::vector<T>& payload, const std::vector<int>& sizes)
                 {
+                    std::vector<int> counts(size());
+                    for (int r=0; r<size(); ++r) counts[r] = sizes[r]*sizeof(T);
+                    std::vector<char> buffer;
+                    const auto displs = all_gather_bytes(payload.data(), counts, buffer);
                     std::vector<std::vector<T>> res(size());
-                    for (int neigh=0; neigh<size(); ++neigh)
-                    {
-                        res[neigh].resize(sizes[neigh]);
-                    }
-                    std::vector<handle_type> m_reqs;
-                    m_reqs.reserve((size())*2);
-                    for (int neigh=0; neigh<size(); ++neigh)
-                    {
-                        m_reqs.push_back( handle_type{} );
-                        GHEX_CHECK_MPI_RESULT(MPI_Irecv(reinterpret_cast<void*>(res[neigh].data()), sizeof(T)*sizes[neigh], MPI_BYTE, neigh, 99, *this, &m_reqs.back().get()));
-                    }
-                    for (int neigh=0; neigh<size(); ++neigh)
+                    for (int r=0; r<size(); ++r)
                     {
-                        m_reqs.push_back( handle_type{} );
-                        GHEX_CHECK_MPI_RESULT(MPI_Isend(reinterpret_cast<const void*>(payload.data()), sizeof(T)*payload.size(), MPI_BYTE, neigh, 99, *this, &m_reqs.back().get()));
+                        res[r].resize(sizes[r]);
+                        if (counts[r]) std::memcpy(res[r].data(), buffer.data()+displs[r], counts[r]);
                     }
-                    for (auto& r : m_reqs)
-                        r.wait();
-
-                    return {std::move(res), std::move(m_reqs.front())};
-
-                    /*handle_type h;
-                    std::vector<int> displs(size());
-                    std::vector<int> recvcounts(size());
-                    std::vector<std::vector<T>> res(size());
-                    for (int i=0; i<size(); ++i)
-                    {
-                        res[i].resize(sizes[i]);
-                        recvcounts[i] = sizes[i]*sizeof(T);
-                        displs[i] = reinterpret_cast<char*>(&res[i][0]) - reinterpret_cast<char*>(&res[0][0]);
-                    }
-                    GHEX_CHECK_MPI_RESULT( MPI_Iallgatherv(
-                        &payload[0], payload.size()*sizeof(T), MPI_BYTE,
-                        &res[0][0], &recvcounts[0], &displs[0], MPI_BYTE,
-                        *this, 
-                        &h.m_req));
-                    return {std::move(res), std::move(h)};*/
+                    return {std::move(res), handle_type{}};
                 }
 
                 template<typename T>
@@ -131,12 +242,20 @@ namespace gridtools{
                 {
                     std::vector<T> res(size());
                     handle_type h;
-                    GHEX_CHECK_MPI_RESULT(
-                        MPI_Iallgather
-                        (&payload, sizeof(T), MPI_BYTE,
-                        &res[0], sizeof(T), MPI_BYTE,
-                        *this,
-                        &h.get()));
+                    if (!topology().hierarchical())
+                    {
+                        GHEX_CHECK_MPI_RESULT(
+                            MPI_Iallgather
+                            (&payload, sizeof(T), MPI_BYTE,
+                            &res[0], sizeof(T), MPI_BYTE,
+                            *this,
+                            &h.get()));
+                        return {std::move(res), std::move(h)};
+                    }
+                    std::vector<char> buffer;
+                    const auto displs = all_gather_bytes(&payload, std::vector<int>(size(), sizeof(T)), buffer);
+                    for (int r=0; r<size(); ++r)
+                        std::memcpy(&res[r], buffer.data()+displs[r], sizeof(T));
                     return {std::move(res), std::move(h)};
                 }
                 
@@ -149,10 +268,12 @@ namespace gridtools{
                     assert(recv_buf.size() % comm_size == 0);
                     int send_count = send_buf.size() / comm_size * sizeof(T);
                     int recv_count = recv_buf.size() / comm_size * sizeof(T);
-                    GHEX_CHECK_MPI_RESULT(
-                            MPI_Alltoall
-                            (reinterpret_cast<const void*>(send_buf.data()), send_count, MPI_BYTE,
-                             reinterpret_cast<void*>(recv_buf.data()), recv_count, MPI_BYTE, *this));
+                    std::vector<int> send_counts_b(comm_size, send_count), send_displs_b(comm_size),
+                        recv_counts_b(comm_size, recv_count), recv_displs_b(comm_size);
+                    for (auto i=0; i<comm_size; ++i) send_displs_b[i] = i*send_count;
+                    for (auto i=0; i<comm_size; ++i) recv_displs_b[i] = i*recv_count;
+                    all_to_all_bytes(reinterpret_cast<const char*>(send_buf.data()), send_counts_b, send_displs_b,
+                        reinterpret_cast<char*>(recv_buf.data()), recv_counts_b, recv_displs_b);
                 }
                 
                 /** @brief just a wrapper using custom types*/
@@ -166,13 +287,197 @@ namespace gridtools{
                     for (auto i=0; i<comm_size; ++i) send_displs_b[i] = send_displs[i] * sizeof(T);
                     for (auto i=0; i<comm_size; ++i) recv_counts_b[i] = recv_counts[i] * sizeof(T);
                     for (auto i=0; i<comm_size; ++i) recv_displs_b[i] = recv_displs[i] * sizeof(T);
-                    GHEX_CHECK_MPI_RESULT(
-                            MPI_Alltoallv
-                            (reinterpret_cast<const void*>(send_buf.data()), &send_counts_b[0], &send_displs_b[0], MPI_BYTE,
-                             reinterpret_cast<void*>(recv_buf.data()), &recv_counts_b[0], &recv_displs_b[0], MPI_BYTE,
-                             *this));
+                    all_to_all_bytes(reinterpret_cast<const char*>(send_buf.data()), send_counts_b, send_displs_b,
+                        reinterpret_cast<char*>(recv_buf.data()), recv_counts_b, recv_displs_b);
+                }
+
+            private: // implementation
+                void broadcast_bytes(void* data, int bytes, int root)
+                {
+                    const auto& topo = topology();
+                    if (!topo.hierarchical())
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Bcast(data, bytes, MPI_BYTE, root, *this));
+                        return;
+                    }
+                    const int root_node = topo.node_of(root);
+                    // within the root's node, then between the leaders, then within the other nodes
+                    if (topo.node() == root_node)
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Bcast(data, bytes, MPI_BYTE, topo.node_rank_of(root), topo.node_comm()));
+                    }
+                    if (topo.is_leader())
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Bcast(data, bytes, MPI_BYTE, root_node, topo.leader_comm()));
+                    }
+                    if (topo.node() != root_node)
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Bcast(data, bytes, MPI_BYTE, 0, topo.node_comm()));
+                    }
+                }
+
+                /** @brief gathers counts[r] bytes from each rank r into buffer on all ranks
+                  * @return offset of each rank's data within buffer */
+                std::vector<int> all_gather_bytes(const void* data, const std::vector<int>& counts, std::vector<char>& buffer) const
+                {
+                    const auto& topo = topology();
+                    std::vector<int> displs(size());
+                    if (!topo.hierarchical())
+                    {
+                        int total = 0;
+                        for (int r=0; r<size(); ++r) { displs[r] = total; total += counts[r]; }
+                        buffer.resize(total);
+                        GHEX_CHECK_MPI_RESULT(MPI_Allgatherv(data, counts[rank()], MPI_BYTE,
+                            buffer.data(), counts.data(), displs.data(), MPI_BYTE, *this));
+                        return displs;
+                    }
+                    // data is laid out by node, such that each node forms a contiguous block
+                    const auto& ordering = topo.ordering();
+                    const auto& offsets = topo.node_offsets();
+                    const int num_nodes = topo.num_nodes();
+                    std::vector<int> node_counts(num_nodes), node_displs(num_nodes);
+                    int total = 0;
+                    for (int n=0; n<num_nodes; ++n)
+                    {
+                        node_displs[n] = total;
+                        for (int k=offsets[n]; k<offsets[n+1]; ++k) { displs[ordering[k]] = total; total += counts[ordering[k]]; }
+                        node_counts[n] = total - node_displs[n];
+                    }
+                    buffer.resize(total);
+                    const int n = topo.node();
+                    std::vector<int> member_counts, member_displs;
+                    for (int k=offsets[n]; k<offsets[n+1]; ++k)
+                    {
+                        member_counts.push_back(counts[ordering[k]]);
+                        member_displs.push_back(displs[ordering[k]]);
+                    }
+                    GHEX_CHECK_MPI_RESULT(MPI_Gatherv(data, counts[rank()], MPI_BYTE,
+                        buffer.data(), member_counts.data(), member_displs.data(), MPI_BYTE, 0, topo.node_comm()));
+                    if (topo.is_leader())
+                    {
+                        GHEX_CHECK_MPI_RESULT(MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL,
+                            buffer.data(), node_counts.data(), node_displs.data(), MPI_BYTE, topo.leader_comm()));
+                    }
+                    GHEX_CHECK_MPI_RESULT(MPI_Bcast(buffer.data(), total, MPI_BYTE, 0, topo.node_comm()));
+                    return displs;
+                }
+
+                /** @brief all-to-all exchange with counts and displacements in bytes. In the two-level scheme, the
+                  * leader gathers the blocks of its node, sends one message per node to the other leaders and
+                  * scatters the received blocks, such that only the leaders communicate across nodes. */
+                void all_to_all_bytes(const char* send, const std::vector<int>& send_counts, const std::vector<int>& send_displs,
+                    char* recv, const std::vector<int>& recv_counts, const std::vector<int>& recv_displs) const
+                {
+                    const auto& topo = topology();
+                    if (!topo.hierarchical())
+                    {
+                        GHEX_CHECK_MPI_RESULT(
+                                MPI_Alltoallv
+                                (reinterpret_cast<const void*>(send), send_counts.data(), send_displs.data(), MPI_BYTE,
+                                 reinterpret_cast<void*>(recv), recv_counts.data(), recv_displs.data(), MPI_BYTE,
+                                 *this));
+                        return;
+                    }
+                    const int P = size();
+                    const auto& ordering = topo.ordering();
+                    const auto& offsets = topo.node_offsets();
+                    const int num_nodes = topo.num_nodes();
+                    const int m = offsets[topo.node()+1] - offsets[topo.node()];
+                    const bool leader = topo.is_leader();
+
+                    // the leader collects the send and receive counts of its node
+                    std::vector<int> my_counts(send_counts);
+                    my_counts.insert(my_counts.end(), recv_counts.begin(), recv_counts.end());
+                    std::vector<int> counts(leader ? 2*P*m : 0);
+                    GHEX_CHECK_MPI_RESULT(MPI_Gather(my_counts.data(), 2*P, MPI_INT, counts.data(), 2*P, MPI_INT, 0,
+                        topo.node_comm()));
+                    auto scount = [&](int i, int k) { return counts[i*2*P + ordering[k]]; };
+                    auto rcount = [&](int i, int k) { return counts[i*2*P + P + ordering[k]]; };
+
+                    // as well as the send data, ordered by destination
+                    int send_total = 0;
+                    for (int r=0; r<P; ++r) send_total += send_counts[r];
+                    std::vector<char> packed(send_total);
+                    for (int k=0, pos=0; k<P; ++k)
+                    {
+                        const int r = ordering[k];
+                        if (send_counts[r]) std::memcpy(packed.data()+pos, send+send_displs[r], send_counts[r]);
+                        pos += send_counts[r];
+                    }
+                    std::vector<int> member_counts(leader ? m : 0, 0), member_displs(leader ? m : 0, 0);
+                    std::vector<int> spos(leader ? m*P : 0);
+                    int gathered_total = 0;
+                    for (int i=0; i<(leader ? m : 0); ++i)
+                    {
+                        member_displs[i] = gathered_total;
+                        for (int k=0; k<P; ++k) { spos[i*P+k] = gathered_total; gathered_total += scount(i,k); }
+                        member_counts[i] = gathered_total - member_displs[i];
+                    }
+                    std::vector<char> gathered(gathered_total);
+                    GHEX_CHECK_MPI_RESULT(MPI_Gatherv(packed.data(), send_total, MPI_BYTE,
+                        gathered.data(), member_counts.data(), member_displs.data(), MPI_BYTE, 0, topo.node_comm()));
+
+                    // the leaders exchange one block per pair of nodes, ordered by (destination, source)
+                    std::vector<char> scattered;
+                    std::vector<int> recv_member_counts(leader ? m : 0, 0), recv_member_displs(leader ? m : 0, 0);
+                    if (leader)
+                    {
+                        std::vector<int> lsend_counts(num_nodes, 0), lsend_displs(num_nodes, 0);
+                        std::vector<int> lrecv_counts(num_nodes, 0), lrecv_displs(num_nodes, 0);
+                        int lsend_total = 0, lrecv_total = 0;
+                        for (int t=0; t<num_nodes; ++t)
+                        {
+                            lsend_displs[t] = lsend_total;
+                            lrecv_displs[t] = lrecv_total;
+                            for (int k=offsets[t]; k<offsets[t+1]; ++k)
+                                for (int i=0; i<m; ++i) { lsend_total += scount(i,k); lrecv_total += rcount(i,k); }
+                            lsend_counts[t] = lsend_total - lsend_displs[t];
+                            lrecv_counts[t] = lrecv_total - lrecv_displs[t];
+                        }
+                        std::vector<char> lsend(lsend_total), lrecv(lrecv_total);
+                        for (int k=0, pos=0; k<P; ++k)
+                            for (int i=0; i<m; ++i)
+                            {
+                                const int c = scount(i,k);
+                                if (c) std::memcpy(lsend.data()+pos, gathered.data()+spos[i*P+k], c);
+                                pos += c;
+                            }
+                        GHEX_CHECK_MPI_RESULT(MPI_Alltoallv(lsend.data(), lsend_counts.data(), lsend_displs.data(), MPI_BYTE,
+                            lrecv.data(), lrecv_counts.data(), lrecv_displs.data(), MPI_BYTE, topo.leader_comm()));
+
+                        // reorder by (destination member, source rank) for the scatter
+                        std::vector<int> rpos(m*P);
+                        int scattered_total = 0;
+                        for (int i=0; i<m; ++i)
+                        {
+                            recv_member_displs[i] = scattered_total;
+                            for (int k=0; k<P; ++k) { rpos[i*P+k] = scattered_total; scattered_total += rcount(i,k); }
+                            recv_member_counts[i] = scattered_total - recv_member_displs[i];
+                        }
+                        scattered.resize(scattered_total);
+                        for (int u=0, pos=0; u<num_nodes; ++u)
+                            for (int i=0; i<m; ++i)
+                                for (int k=offsets[u]; k<offsets[u+1]; ++k)
+                                {
+                                    const int c = rcount(i,k);
+                                    if (c) std::memcpy(scattered.data()+rpos[i*P+k], lrecv.data()+pos, c);
+                                    pos += c;
+                                }
+                    }
+
+                    // the members receive their data ordered by source
+                    int recv_total = 0;
+                    for (int r=0; r<P; ++r) recv_total += recv_counts[r];
+                    std::vector<char> unpacked(recv_total);
+                    GHEX_CHECK_MPI_RESULT(MPI_Scatterv(scattered.data(), recv_member_counts.data(), recv_member_displs.data(),
+                        MPI_BYTE, unpacked.data(), recv_total, MPI_BYTE, 0, topo.node_comm()));
+                    for (int k=0, pos=0; k<P; ++k)
+                    {
+                        const int r = ordering[k];
+                        if (recv_counts[r]) std::memcpy(recv+recv_displs[r], unpacked.data()+pos, recv_counts[r]);
+                        pos += recv_counts[r];
+                    }
                 }
-            
             };
 
             } // namespace mpi
@@ -12,6 +12,7 @@
 #define INCLUDED_GHEX_TL_SHARED_MESSAGE_BUFFER_HPP
 
 #include <memory>
+#include <atomic>
 #include "./message_buffer.hpp"
 
 namespace gridtools {
@@ -29,7 +30,7 @@ namespace gridtools {
                 using message_type      = message_buffer<Allocator>;
 
 		message_type m_message;
-		int refcount;
+		std::atomic<int> refcount;
 
 		refcounted_message(size_t capacity, Allocator allc):
 		    m_message{std::move(message_type(capacity, allc))}, refcount{1}
@@ -97,12 +98,12 @@ namespace gridtools {
 		}
 
 		shared_message_buffer(message_type&& m){
-		    m_sptr = new refcounted_message<Allocator>(m);
+		    m_sptr = new refcounted_message<Allocator>(std::move(m));
 		}
 
                 shared_message_buffer(const shared_message_buffer& other){
 		    m_sptr = other.m_sptr;
-		    if(m_sptr) m_sptr->refcount++;
+		    if(m_sptr) m_sptr->refcount.fetch_add(1, std::memory_order_relaxed);
 		}
 		
                 shared_message_buffer(shared_message_buffer&& other){
@@ -111,26 +112,23 @@ namespace gridtools {
 		}
 		
                 shared_message_buffer& operator=(const shared_message_buffer& other){
+		    if(m_sptr == other.m_sptr) return *this;
+		    if(other.m_sptr) other.m_sptr->refcount.fetch_add(1, std::memory_order_relaxed);
+		    release();
 		    m_sptr = other.m_sptr;
-		    if(m_sptr) m_sptr->refcount++;
 		    return *this;
 		}
 		
 		shared_message_buffer& operator=(shared_message_buffer&& other){
+		    if(this == &other) return *this;
+		    release();
 		    m_sptr = other.m_sptr;
 		    other.m_sptr = nullptr;
 		    return *this;
 		}
 
 		~shared_message_buffer(){
-		    if(m_sptr){
-			if(m_sptr->refcount==0) ERR("inconsistent refcount in shared message");
-			m_sptr->refcount--;
-			if(m_sptr->refcount==0) {
-			    delete m_sptr;
-			    m_sptr = nullptr;
-			}
-		    }
+		    release();
 		}
 
             public: // member functions
@@ -140,7 +138,7 @@ namespace gridtools {
 		}
                 auto use_count() const { 
 		    if(nullptr == m_sptr) return 0; 
-		    return m_sptr->refcount; 
+		    return m_sptr->refcount.load(); 
 		}
 
                 std::size_t size() const noexcept { 
@@ -202,8 +200,8 @@ namespace gridtools {
 		/* manually decrease the use count. Needed in the UCX communicator */
 		void release(){
 		    if(nullptr == m_sptr) return;
-		    m_sptr->refcount--;
-		    if(m_sptr->refcount==0) delete m_sptr;
+		    // the last owner deletes: acquire the writes of the other owners
+		    if(m_sptr->refcount.fetch_sub(1, std::memory_order_acq_rel) == 1) delete m_sptr;
 		    m_sptr = nullptr;
 		}
             };
@@ -20,6 +20,8 @@ namespace gridtools {
             /** @brief mpi transport tag */
             struct mpi_tag {};
             struct ucx_tag {};
+            /** @brief in-process transport tag: ranks are threads of one process */
+            struct threads_tag {};
 
 
         } // namespace tl
@@ -14,6 +14,7 @@
 #include <atomic>
 #include "../shared_message_buffer.hpp"
 #include "./future.hpp"
+#include "../../common/traffic_capture.hpp"
 
 namespace gridtools {
     namespace ghex {
@@ -86,6 +87,8 @@ namespace gridtools {
                             ucp_dt_make_contig(1),                           // data type
                             stag,                                            // tag
                             &communicator::empty_send_callback);             // callback function pointer: empty here
+                        trace::instant("send posted", "ucx", dst, tag, msg.size()*sizeof(typename Message::value_type));
+                        capture::send(rank(), dst, tag, msg.size()*sizeof(typename Message::value_type));
                         
                         if (reinterpret_cast<std::uintptr_t>(ret) == UCS_OK)
                         {
@@ -126,6 +129,8 @@ namespace gridtools {
                                     rtag,                                            // tag
                                     ~std::uint_fast64_t(0ul),                        // tag mask
                                     &communicator::empty_recv_callback);             // callback function pointer: empty here
+                                trace::instant("recv posted", "ucx", src, tag, msg.size()*sizeof(typename Message::value_type));
+                                capture::recv(rank(), src, tag, msg.size()*sizeof(typename Message::value_type));
                                 if(!UCS_PTR_IS_ERR(ret))
                                 {
 			                        if (UCS_INPROGRESS != ucp_request_check_status(ret))
@@ -199,6 +204,8 @@ namespace gridtools {
                             ucp_dt_make_contig(1),                           // data type
                             stag,                                            // tag
                             &communicator::send_callback);                   // callback function pointer
+                        trace::instant("send posted", "ucx", dst, tag, msg.size());
+                        capture::send(rank(), dst, tag, msg.size());
                         
                         if (reinterpret_cast<std::uintptr_t>(ret) == UCS_OK)
                         {
@@ -253,6 +260,8 @@ namespace gridtools {
                                     rtag,                                            // tag
                                     ~std::uint_fast64_t(0ul),                        // tag mask
                                     &communicator::recv_callback);                   // callback function pointer
+                                trace::instant("recv posted", "ucx", src, tag, msg.size());
+                                capture::recv(rank(), src, tag, msg.size());
                                 if(!UCS_PTR_IS_ERR(ret))
                                 {
 			                        if (UCS_INPROGRESS != ucp_request_check_status(ret))
@@ -337,14 +346,24 @@ namespace gridtools {
 
                 private:
                     
-                    static void empty_send_callback(void *, ucs_status_t) {}
+                    static void empty_send_callback(void *, ucs_status_t status)
+                    {
+                        if (status == UCS_OK) trace::instant("send complete", "ucx");
+                    }
 
-                    static void empty_recv_callback(void *, ucs_status_t, ucp_tag_recv_info_t*) {}
+                    static void empty_recv_callback(void *, ucs_status_t status, ucp_tag_recv_info_t* info)
+                    {
+                        // the sender's rank and tag are encoded in the lower and upper half of the ucx tag
+                        if (status == UCS_OK && info)
+                            trace::instant("recv complete", "ucx", (int)(info->sender_tag & 0xffffffffu),
+                                (int)(info->sender_tag >> 32), info->length);
+                    }
 
                     inline static void send_callback(void * __restrict ucx_req, ucs_status_t __restrict status)
                     {
                         auto& req = request_cb_data_type::get(ucx_req);
                         if (status == UCS_OK) {
+                            trace::instant("send complete", "ucx", req.m_rank, req.m_tag);
                             // call the callback
                             req.m_cb(std::move(req.m_msg), req.m_rank, req.m_tag);
                             ++(req.m_worker->m_progressed_sends);
@@ -371,6 +390,7 @@ namespace gridtools {
                                 // we're in early completion mode
                                 return;
                             }
+                            trace::instant("recv complete", "ucx", req.m_rank, req.m_tag);
 
                             req.m_cb(std::move(req.m_msg), req.m_rank, req.m_tag);
                             ++(req.m_worker->m_progressed_recvs);
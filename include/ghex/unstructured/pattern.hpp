@@ -13,6 +13,7 @@
 
 #include <vector>
 #include <map>
+#include <algorithm>
 #include <numeric>
 #include <cstring>
 #include <iosfwd>
@@ -61,6 +62,7 @@ namespace gridtools {
                     public:
 
                         using u_m_allocator_t = gridtools::ghex::allocator::cuda::unified_memory_allocator<index_type>;
+                        using index_vector_type = std::vector<index_type, u_m_allocator_t>;
 
                     private:
 
@@ -148,6 +150,23 @@ namespace gridtools {
                     return s;
                 }
 
+                /** @brief split an iteration space into pieces of at most max_elements elements (but at least one column
+                 * of 'levels' elements) and append them to out, preserving the order of the indices */
+                static void split(const iteration_space_pair& is, std::size_t max_elements, index_container_type& out) {
+                    if (is.size() <= max_elements) {
+                        out.push_back(is);
+                        return;
+                    }
+                    const std::size_t step = std::max(max_elements / is.levels(), std::size_t{1});
+                    const auto& idx = is.local_index();
+                    for (std::size_t i = 0; i < idx.size(); i += step) {
+                        const std::size_t n = std::min(step, idx.size() - i);
+                        out.emplace_back(is.partition(),
+                                typename iteration_space::index_vector_type(idx.begin() + i, idx.begin() + i + n),
+                                is.levels());
+                    }
+                }
+
             private:
 
                 // members
@@ -239,8 +258,8 @@ namespace gridtools {
                     std::vector<std::size_t> send_levels{};
                     send_levels.resize(size);
 
-                    // needed with multiple domains per rank
-                    int m_max_tag = 999;
+                    // largest tag of all patterns of all ranks
+                    int m_max_tag = 0;
 
                     for (const auto& d : d_range) { // WARN: so far, multiple domains are not fully supported
 
@@ -259,6 +278,7 @@ namespace gridtools {
                                 // WARN: very simplified definition of extended domain id;
                                 // a more complex one is needed for multiple domains
                                 int tag = (h.partition() << 7) + my_address; // WARN: maximum address / rank = 2^7 - 1
+                                m_max_tag = std::max(tag, m_max_tag);
                                 extended_domain_id_type id{h.partition(), h.partition(), static_cast<address_type>(h.partition()), tag}; // WARN: address is not obtained from the other domain
                                 index_container_type ic{ {h.partition(), h.local_index(), h.levels()} };
                                 p.recv_halos().insert(std::make_pair(id, ic));
@@ -300,6 +320,7 @@ namespace gridtools {
                                 // WARN: very simplified definition of extended domain id;
                                 // a more complex one is needed for multiple domains
                                 int tag = (my_address << 7) + rank; // WARN: maximum rank / address = 2^7 - 1
+                                m_max_tag = std::max(tag, m_max_tag);
                                 extended_domain_id_type id{static_cast<int>(rank), static_cast<int>(rank), static_cast<address_type>(rank), tag};
                                 std::vector<index_type, u_m_allocator_t> remote_index{};
                                 remote_index.resize(send_counts[rank]);
@@ -316,6 +337,9 @@ namespace gridtools {
 
                     }
 
+                    for (auto x : comm.all_gather(m_max_tag).get())
+                        m_max_tag = std::max(x, m_max_tag);
+
                     return pattern_container<communicator_type, grid_type, domain_id_type>(std::move(my_patterns), m_max_tag);
 
                 }
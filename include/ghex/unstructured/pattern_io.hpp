@@ -0,0 +1,144 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#ifndef INCLUDED_GHEX_UNSTRUCTURED_PATTERN_IO_HPP
+#define INCLUDED_GHEX_UNSTRUCTURED_PATTERN_IO_HPP
+
+#include "./pattern.hpp"
+#include "../pattern_io.hpp"
+
+namespace gridtools {
+    namespace ghex {
+
+        namespace detail {
+
+            /** @brief serializes unstructured patterns: the domain iteration space is recomputed from the domain range,
+             * while the extended domain ids and the index lists of the halo maps are stored in the file*/
+            template<typename Index>
+            struct pattern_io_impl<unstructured::detail::grid<Index>> {
+
+                using grid_type = unstructured::detail::grid<Index>;
+
+                static constexpr std::uint32_t grid_kind = 2;
+
+                template<typename DomainRange>
+                static void hash(pattern_hash& h, const DomainRange& d_range) {
+                    for (const auto& d : d_range) {
+                        const auto id = d.domain_id();
+                        const auto first = d.first();
+                        const auto last = d.last();
+                        const std::uint64_t levels = d.levels();
+                        h.add(id);
+                        h.add(first);
+                        h.add(last);
+                        h.add(levels);
+                    }
+                }
+
+                template<typename HaloGenerator, typename DomainRange>
+                static void hash_halos(pattern_hash& h, const HaloGenerator& hgen, const DomainRange& d_range) {
+                    for (const auto& d : d_range) {
+                        const auto halos = hgen(d);
+                        for (const auto& halo : halos) {
+                            const auto partition = halo.partition();
+                            const std::uint64_t size = halo.size();
+                            const std::uint64_t levels = halo.levels();
+                            h.add(partition);
+                            h.add(size);
+                            h.add(levels);
+                            for (const auto& i : halo.local_index()) h.add(i);
+                            for (const auto& i : halo.remote_index()) h.add(i);
+                        }
+                    }
+                }
+
+                template<typename Pattern>
+                static void save(pattern_writer& w, const Pattern& p) {
+                    w.write(p.extended_domain_id());
+                    save_map(w, p.send_halos());
+                    save_map(w, p.recv_halos());
+                }
+
+                template<typename Transport, typename ThreadPrimitives, typename DomainRange>
+                static auto load(tl::context<Transport, ThreadPrimitives>& context, pattern_reader& r, const DomainRange& d_range,
+                        int max_tag, int num_patterns) {
+
+                    using context_type = tl::context<Transport, ThreadPrimitives>;
+                    using domain_type = typename std::remove_reference_t<DomainRange>::value_type;
+                    using domain_id_type = typename domain_type::domain_id_type;
+                    using communicator_type = typename context_type::communicator_type;
+                    using pattern_type = pattern<communicator_type, grid_type, domain_id_type>;
+                    using extended_domain_id_type = typename pattern_type::extended_domain_id_type;
+
+                    auto my_rank = context.get_serial_communicator().rank();
+
+                    std::vector<pattern_type> my_patterns;
+                    for (const auto& d : d_range) {
+                        if (static_cast<int>(my_patterns.size()) == num_patterns)
+                            throw std::runtime_error("pattern file holds fewer patterns than domains");
+                        const auto id = r.read<extended_domain_id_type>();
+                        pattern_type p{{my_rank, d.first(), d.last(), d.levels()}, id};
+                        load_map(r, p.send_halos());
+                        load_map(r, p.recv_halos());
+                        my_patterns.push_back(p);
+                    }
+                    if (static_cast<int>(my_patterns.size()) != num_patterns)
+                        throw std::runtime_error("pattern file holds more patterns than domains");
+
+                    return pattern_container<communicator_type, grid_type, domain_id_type>(std::move(my_patterns), max_tag);
+
+                }
+
+            private:
+
+                template<typename Map>
+                static void save_map(pattern_writer& w, const Map& m) {
+                    w.write(static_cast<std::int32_t>(m.size()));
+                    for (const auto& kv : m) {
+                        w.write(kv.first);
+                        w.write(static_cast<std::int32_t>(kv.second.size()));
+                        for (const auto& is : kv.second) {
+                            w.write(static_cast<std::int32_t>(is.partition()));
+                            w.write(static_cast<std::uint64_t>(is.levels()));
+                            w.write(static_cast<std::uint64_t>(is.local_index().size()));
+                            w.write(is.local_index().data(), is.local_index().size());
+                        }
+                    }
+                }
+
+                template<typename Map>
+                static void load_map(pattern_reader& r, Map& m) {
+                    using key_type = typename Map::key_type;
+                    using iteration_space = typename Map::mapped_type::value_type;
+                    using index_vector_type = std::remove_const_t<std::remove_reference_t<decltype(std::declval<iteration_space>().local_index())>>;
+                    const auto n = r.read<std::int32_t>();
+                    for (std::int32_t i = 0; i < n; ++i) {
+                        const auto key = r.read<key_type>();
+                        const auto num_is = r.read<std::int32_t>();
+                        auto& vec = m[key];
+                        for (std::int32_t j = 0; j < num_is; ++j) {
+                            const auto partition = r.read<std::int32_t>();
+                            const auto levels = r.read<std::uint64_t>();
+                            const auto size = r.read<std::uint64_t>();
+                            index_vector_type local_index(static_cast<std::size_t>(size));
+                            r.read(local_index.data(), local_index.size());
+                            vec.emplace_back(partition, local_index, static_cast<std::size_t>(levels));
+                        }
+                    }
+                }
+
+            };
+
+        } // namespace detail
+
+    } // namespace ghex
+} // namespace gridtools
+
+#endif /* INCLUDED_GHEX_UNSTRUCTURED_PATTERN_IO_HPP */
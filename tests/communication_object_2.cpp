@@ -396,6 +396,13 @@ TEST(communication_object_2, exchange)
     // blocking variant
 #ifdef GHEX_HYBRID_TESTS
     auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+#ifdef GHEX_TEST_CHUNK_SIZE
+    co.set_chunk_size(GHEX_TEST_CHUNK_SIZE);
+#endif
+#ifdef GHEX_TEST_COMPRESSION
+    co.set_compression(gridtools::ghex::compression::GHEX_TEST_COMPRESSION);
+    co.set_compression_threshold(0);
+#endif
     co.bexchange(
         pattern1(field_1a_gpu),
         pattern1(field_1b),
@@ -406,6 +413,13 @@ TEST(communication_object_2, exchange)
     );
 #else
     auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+#ifdef GHEX_TEST_CHUNK_SIZE
+    co.set_chunk_size(GHEX_TEST_CHUNK_SIZE);
+#endif
+#ifdef GHEX_TEST_COMPRESSION
+    co.set_compression(gridtools::ghex::compression::GHEX_TEST_COMPRESSION);
+    co.set_compression_threshold(0);
+#endif
     co.bexchange(
         pattern1(field_1a_gpu),
         pattern1(field_1b_gpu),
@@ -418,6 +432,13 @@ TEST(communication_object_2, exchange)
 #endif
 #ifdef GHEX_TEST_SERIAL_VECTOR
     auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+#ifdef GHEX_TEST_CHUNK_SIZE
+    co.set_chunk_size(GHEX_TEST_CHUNK_SIZE);
+#endif
+#ifdef GHEX_TEST_COMPRESSION
+    co.set_compression(gridtools::ghex::compression::GHEX_TEST_COMPRESSION);
+    co.set_compression_threshold(0);
+#endif
     std::vector<std::remove_reference_t<decltype(pattern1(field_1a_gpu))>> field_vec{
         pattern1(field_1a_gpu),
         pattern1(field_1b_gpu),
@@ -425,8 +446,13 @@ TEST(communication_object_2, exchange)
         pattern2(field_2b_gpu),
         pattern1(field_3a_gpu),
         pattern1(field_3b_gpu)};
+#ifdef GHEX_TEST_FUSED_LAYOUT
+    co.set_fused_layout(gridtools::ghex::fused_layout::GHEX_TEST_FUSED_LAYOUT);
+    co.exchange_fused(field_vec.data(), field_vec.size()).wait();
+#else
     co.exchange(field_vec.data(), field_vec.size()).wait();
 #endif
+#endif
 
 #ifdef GHEX_TEST_SERIAL_SPLIT
     auto token = context.get_token();
@@ -741,6 +767,13 @@ TEST(communication_object_2, exchange)
 #ifdef GHEX_TEST_SERIAL
     // blocking variant
     auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+#ifdef GHEX_TEST_CHUNK_SIZE
+    co.set_chunk_size(GHEX_TEST_CHUNK_SIZE);
+#endif
+#ifdef GHEX_TEST_COMPRESSION
+    co.set_compression(gridtools::ghex::compression::GHEX_TEST_COMPRESSION);
+    co.set_compression_threshold(0);
+#endif
     co.bexchange(
         pattern1(field_1a),
         pattern1(field_1b),
@@ -752,6 +785,13 @@ TEST(communication_object_2, exchange)
 #endif
 #ifdef GHEX_TEST_SERIAL_VECTOR
     auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+#ifdef GHEX_TEST_CHUNK_SIZE
+    co.set_chunk_size(GHEX_TEST_CHUNK_SIZE);
+#endif
+#ifdef GHEX_TEST_COMPRESSION
+    co.set_compression(gridtools::ghex::compression::GHEX_TEST_COMPRESSION);
+    co.set_compression_threshold(0);
+#endif
     std::vector<std::remove_reference_t<decltype(pattern1(field_1a))>> field_vec{
         pattern1(field_1a),
         pattern1(field_1b),
@@ -759,8 +799,13 @@ TEST(communication_object_2, exchange)
         pattern2(field_2b),
         pattern1(field_3a),
         pattern1(field_3b)};
+#ifdef GHEX_TEST_FUSED_LAYOUT
+    co.set_fused_layout(gridtools::ghex::fused_layout::GHEX_TEST_FUSED_LAYOUT);
+    co.exchange_fused(field_vec.data(), field_vec.size()).wait();
+#else
     co.exchange(field_vec.data(), field_vec.size()).wait();
 #endif
+#endif
 
 #ifdef GHEX_TEST_SERIAL_SPLIT
     // non-blocking variant
@@ -1014,3 +1059,61 @@ TEST(communication_object_2, exchange)
     EXPECT_TRUE(passed);
 #endif
 }
+
+#if defined(GHEX_TEST_SERIAL_VECTOR) && defined(GHEX_TEST_FUSED_LAYOUT) && !defined(__CUDACC__) && !defined(GHEX_EMULATE_GPU)
+TEST(communication_object_2, fused_layout_mismatch)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    const int rank = context.rank();
+    const int size = context.size();
+
+    // 1D decomposition along x, periodic
+    const int n = 4;
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        rank, std::array<int,3>{rank*n, 0, 0}, std::array<int,3>{(rank+1)*n-1, n-1, n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+        std::array<int,3>{n*size-1,n-1,n-1}, std::array<int,6>{1,1,0,0,0,0}, std::array<bool,3>{true,true,true});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    using pattern_type = std::remove_reference_t<decltype(pattern)>;
+    auto co = gridtools::ghex::make_communication_object<pattern_type>(context.get_communicator(context.get_token()));
+    co.set_fused_layout(gridtools::ghex::fused_layout::GHEX_TEST_FUSED_LAYOUT);
+
+    // the second field has a wider buffer on rank 0 only
+    const std::array<int,3> offset{1,0,0}, ext{n+2,n,n}, offset_wide{2,0,0}, ext_wide{n+4,n,n};
+    std::vector<double> raw_a((n+4)*n*n, -1.0), raw_b((n+4)*n*n, -1.0);
+    auto field_a = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw_a.data(), offset, ext);
+    auto field_b = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw_b.data(),
+        rank == 0 ? offset_wide : offset, rank == 0 ? ext_wide : ext);
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                field_a(x,y,z) = field_b(x,y,z) = rank*n+x;
+
+    // all ranks throw, not only the rank with the mismatch
+    std::vector<std::remove_reference_t<decltype(pattern(field_a))>> mismatched{pattern(field_a), pattern(field_b)};
+    EXPECT_THROW(co.exchange_fused(mismatched.data(), mismatched.size()), std::runtime_error);
+
+    // the communication object remains usable
+    std::vector<std::remove_reference_t<decltype(pattern(field_a))>> single{pattern(field_a)};
+    co.exchange_fused(single.data(), single.size()).wait();
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+        {
+            EXPECT_EQ(field_a(-1,y,z), (rank*n-1+n*size)%(n*size));
+            EXPECT_EQ(field_a(n,y,z), ((rank+1)*n)%(n*size));
+        }
+
+    // once validated, a sequence of patterns is only checked locally
+    std::vector<double> raw_c((n+4)*n*n, -1.0), raw_d((n+4)*n*n, -1.0);
+    auto field_c = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw_c.data(), offset, ext);
+    auto field_d = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw_d.data(), offset_wide, ext_wide);
+    std::vector<std::remove_reference_t<decltype(pattern(field_a))>> matched{pattern(field_a), pattern(field_c)};
+    co.exchange_fused(matched.data(), matched.size()).wait();
+    co.exchange_fused(matched.data(), matched.size()).wait();
+    std::vector<std::remove_reference_t<decltype(pattern(field_a))>> mismatched_all{pattern(field_a), pattern(field_d)};
+    EXPECT_THROW(co.exchange_fused(mismatched_all.data(), mismatched_all.size()), std::runtime_error);
+    EXPECT_EQ(co.num_in_flight(), 0);
+    co.exchange_fused(matched.data(), matched.size()).wait();
+}
+#endif
@@ -0,0 +1,105 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/common/compression.hpp>
+#include <gtest/gtest.h>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using gridtools::ghex::compression;
+
+// serialize a sequence of doubles into bytes
+std::vector<unsigned char> to_bytes(const std::vector<double>& v)
+{
+    std::vector<unsigned char> b(v.size()*sizeof(double)+3, 0x5a); // 3 trailing bytes do not form a word
+    std::memcpy(b.data(), v.data(), v.size()*sizeof(double));
+    return b;
+}
+
+// compress src, decompress the message and check the result; returns the message size
+std::size_t round_trip(compression codec, const std::vector<unsigned char>& src,
+    std::vector<unsigned char>& send_history, std::vector<unsigned char>& recv_history)
+{
+    using namespace gridtools::ghex::detail;
+    std::vector<unsigned char> scratch;
+    std::vector<unsigned char> msg(compressed_capacity(src.size()));
+    const std::size_t n = compress(codec, src.data(), src.size(), sizeof(double), send_history, scratch, msg.data());
+    EXPECT_LE(n, msg.size());
+    std::vector<unsigned char> dst(src.size());
+    decompress(codec, msg.data(), dst.data(), dst.size(), recv_history, scratch);
+    EXPECT_TRUE(dst == src);
+    return n;
+}
+
+TEST(compression, rle)
+{
+    using namespace gridtools::ghex::detail;
+    // runs of all lengths mixed with literals
+    std::vector<unsigned char> src;
+    for (int r=1; r<300; r+=7)
+    {
+        src.insert(src.end(), r, static_cast<unsigned char>(r));
+        src.push_back(1); src.push_back(2);
+    }
+    std::vector<unsigned char> enc(src.size()*2);
+    const std::size_t n = rle_encode(src.data(), src.size(), enc.data(), enc.size());
+    ASSERT_GT(n, 0u);
+    EXPECT_LT(n, src.size());
+    std::vector<unsigned char> dec(src.size());
+    rle_decode(enc.data(), dec.data(), dec.size());
+    EXPECT_TRUE(dec == src);
+    // insufficient capacity is reported
+    EXPECT_EQ(rle_encode(src.data(), src.size(), enc.data(), n-1), 0u);
+}
+
+TEST(compression, smooth_and_noisy)
+{
+    const std::size_t n = 4096;
+    std::vector<double> smooth(n), noisy(n);
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    for (std::size_t i=0; i<n; ++i)
+    {
+        smooth[i] = 280.0 + std::sin(0.001*i);
+        noisy[i] = dist(gen);
+    }
+    for (auto codec : {compression::shuffle_rle, compression::xor_delta_rle})
+    {
+        std::vector<unsigned char> h_send, h_recv;
+        const auto b_smooth = to_bytes(smooth);
+        EXPECT_LT(round_trip(codec, b_smooth, h_send, h_recv), b_smooth.size());
+        // incompressible data falls back to the raw payload
+        const auto b_noisy = to_bytes(noisy);
+        EXPECT_LE(round_trip(codec, b_noisy, h_send, h_recv),
+            gridtools::ghex::detail::compressed_capacity(b_noisy.size()));
+    }
+}
+
+TEST(compression, xor_delta_history)
+{
+    const std::size_t n = 4096;
+    std::vector<double> v(n);
+    for (std::size_t i=0; i<n; ++i) v[i] = std::cos(0.01*i);
+    std::vector<unsigned char> h_send, h_recv;
+    const std::size_t first = round_trip(compression::xor_delta_rle, to_bytes(v), h_send, h_recv);
+    // a small change of a few values compresses much better against the previous exchange
+    v[10] += 1.0e-3;
+    v[2000] -= 1.0e-3;
+    const std::size_t second = round_trip(compression::xor_delta_rle, to_bytes(v), h_send, h_recv);
+    EXPECT_LT(second*10, first);
+    EXPECT_TRUE(h_send == h_recv);
+    // a size change restarts the history on both ends
+    v.resize(n/2);
+    round_trip(compression::xor_delta_rle, to_bytes(v), h_send, h_recv);
+    EXPECT_TRUE(h_send == h_recv);
+}
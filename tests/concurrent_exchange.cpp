@@ -0,0 +1,124 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <array>
+#include <limits>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+TEST(concurrent_exchange, pipelined_groups)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    // 1D decomposition along x, periodic
+    const int n = 8, h = 2;
+    const int nx = n*context.size();
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{nx-1,n-1,n-1};
+    const std::array<int,3> offsets{h,h,h};
+    const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(),
+        std::array<int,3>{context.rank()*n, 0, 0},
+        std::array<int,3>{(context.rank()+1)*n-1, n-1, n-1}} };
+    auto halo_gen_1 = domain_descriptor_type::halo_generator_type(g_first, g_last,
+        std::array<int,6>{1,1,1,1,1,1}, std::array<bool,3>{true,true,true});
+    auto halo_gen_2 = domain_descriptor_type::halo_generator_type(g_first, g_last,
+        std::array<int,6>{h,h,h,h,h,h}, std::array<bool,3>{true,true,true});
+    auto pattern_1 = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen_1, local_domains);
+    auto pattern_2 = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen_2, local_domains);
+
+    auto value = [nx,n](int f, int x, int y, int z)
+    {
+        return f*1.0e6 + (x+nx)%nx + 100.0*((y+n)%n) + 10000.0*((z+n)%n);
+    };
+    const int num_fields = 4;
+    std::vector<std::vector<double>> raw(num_fields, std::vector<double>(extents[0]*extents[1]*extents[2], -1.0));
+    using field_type = decltype(gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(0, raw[0].data(), offsets, extents));
+    std::vector<field_type> fields;
+    for (int f=0; f<num_fields; ++f)
+    {
+        fields.push_back(gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw[f].data(), offsets, extents));
+        for (int z=0; z<n; ++z)
+            for (int y=0; y<n; ++y)
+                for (int x=0; x<n; ++x)
+                    fields[f](x,y,z) = value(f, context.rank()*n+x, y, z);
+    }
+    auto check = [&](int f, int hw)
+    {
+        bool passed = true;
+        for (int z=-hw; z<n+hw; ++z)
+            for (int y=-hw; y<n+hw; ++y)
+                for (int x=-hw; x<n+hw; ++x)
+                    if (fields[f](x,y,z) != value(f, context.rank()*n+x, y, z)) passed = false;
+        return passed;
+    };
+
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern_1)>(context.get_communicator(context.get_token()));
+
+    // the tag stride is fixed by the first exchange
+    EXPECT_EQ(co.tag_stride(), 0);
+
+    // group A and B are in flight at the same time, the same pattern is used by two exchanges
+    auto h_a = co.exchange(pattern_1(fields[0]), pattern_2(fields[1]));
+    auto h_b = co.exchange(pattern_2(fields[2]));
+    auto h_c = co.exchange(pattern_1(fields[3]));
+    EXPECT_EQ(co.num_in_flight(), 3);
+    EXPECT_EQ(co.tag_stride(), 4096);
+    // settings cannot be changed meanwhile
+    EXPECT_THROW(co.set_chunk_size(128), std::runtime_error);
+    h_c.wait();
+    h_a.wait();
+    EXPECT_EQ(co.num_in_flight(), 1);
+    // a freed state is reused while another exchange is still in flight
+    auto h_d = co.exchange(pattern_2(fields[0]));
+    h_b.wait();
+    h_d.wait();
+    EXPECT_EQ(co.num_in_flight(), 0);
+    EXPECT_TRUE(check(0, h));
+    EXPECT_TRUE(check(1, h));
+    EXPECT_TRUE(check(2, h));
+    EXPECT_TRUE(check(3, 1));
+
+    // a concurrent exchange must fit into the tag stride
+    co.set_tag_stride(1);
+    auto h_e = co.exchange(pattern_1(fields[0]));
+    EXPECT_THROW(co.exchange(pattern_1(fields[1]), pattern_2(fields[2])).wait(), std::runtime_error);
+    h_e.wait();
+    EXPECT_EQ(co.num_in_flight(), 0);
+
+    // so must the first exchange, whose tags would otherwise overlap the range of the next one
+    EXPECT_THROW(co.exchange(pattern_1(fields[1]), pattern_2(fields[2])).wait(), std::runtime_error);
+    EXPECT_EQ(co.num_in_flight(), 0);
+    co.set_tag_stride(2);
+    co.exchange(pattern_1(fields[1]), pattern_2(fields[2])).wait();
+    EXPECT_TRUE(check(1, 1));
+    EXPECT_TRUE(check(2, h));
+
+    // the tags of a concurrent exchange must not exceed the upper bound of the transport
+    co.set_tag_stride(std::numeric_limits<int>::max());
+    auto h_f = co.exchange(pattern_1(fields[0]));
+    EXPECT_THROW(co.exchange(pattern_1(fields[1]), pattern_2(fields[2])).wait(), std::runtime_error);
+    h_f.wait();
+    EXPECT_EQ(co.num_in_flight(), 0);
+    EXPECT_TRUE(check(0, 1));
+}
@@ -0,0 +1,137 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/decomposition.hpp>
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <array>
+#include <sstream>
+#include <tuple>
+#include <vector>
+
+using gridtools::ghex::structured::stencil_shape;
+using decomposition_type = gridtools::ghex::structured::cartesian_decomposition<int,3>;
+
+// every global point is owned by exactly one domain and domain ids are unique
+void check_cover(const decomposition_type& d)
+{
+    const auto& e = d.extents();
+    std::vector<int> owner(e[0]*e[1]*e[2], 0);
+    std::vector<int> ids;
+    for (int r=0; r<d.size(); ++r)
+        for (const auto& dom : d.local_domains(r))
+        {
+            ids.push_back(dom.domain_id());
+            for (int z=dom.first()[2]; z<=dom.last()[2]; ++z)
+                for (int y=dom.first()[1]; y<=dom.last()[1]; ++y)
+                    for (int x=dom.first()[0]; x<=dom.last()[0]; ++x)
+                        ++owner[x+e[0]*(y+e[1]*z)];
+        }
+    for (auto o : owner) EXPECT_EQ(o, 1);
+    std::sort(ids.begin(), ids.end());
+    EXPECT_TRUE(std::adjacent_find(ids.begin(), ids.end()) == ids.end());
+}
+
+TEST(decomposition, surface_minimizing)
+{
+    const std::array<int,6> halos{1,1,1,1,1,1};
+    const std::array<bool,3> periodic{true,true,false};
+
+    // a cube is split evenly in all dimensions
+    auto d = gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{64,64,64}, halos, periodic, 8);
+    EXPECT_EQ(d.rank_dims(), (std::array<int,3>{2,2,2}));
+    EXPECT_EQ(d.min_points_per_rank(), d.max_points_per_rank());
+    check_cover(d);
+
+    // a flat domain is not split along the thin dimension
+    d = gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{128,128,4}, halos, periodic, 16);
+    EXPECT_EQ(d.rank_dims(), (std::array<int,3>{4,4,1}));
+    check_cover(d);
+
+    // the chosen layout beats a slab decomposition
+    decomposition_type slabs(std::array<int,3>{128,128,4}, halos, periodic, std::array<int,3>{16,1,1},
+        std::array<int,3>{1,1,1});
+    EXPECT_LT(d.remote_halo_bytes(), slabs.remote_halo_bytes());
+    EXPECT_EQ(d.max_points_per_rank(), slabs.max_points_per_rank());
+
+    // uneven extents are balanced up to one layer
+    d = gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{50,31,7}, halos, periodic, 6);
+    EXPECT_LE(d.imbalance(), 1.1);
+    check_cover(d);
+}
+
+TEST(decomposition, over_decomposition)
+{
+    const std::array<int,6> halos{2,2,2,2,0,0};
+    const std::array<bool,3> periodic{true,true,true};
+    auto d = gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{64,64,10}, halos, periodic, 4, 4);
+    EXPECT_EQ(d.size(), 4);
+    for (int r=0; r<d.size(); ++r)
+        EXPECT_EQ(d.local_domains(r).size(), 4u);
+    check_cover(d);
+    // domains of a rank form a block, hence halos between them stay on the rank
+    EXPECT_LT(d.remote_halo_bytes(), d.halo_bytes());
+    // at least as good as a square layout of square blocks
+    decomposition_type square(std::array<int,3>{64,64,10}, halos, periodic, std::array<int,3>{2,2,1},
+        std::array<int,3>{2,2,1});
+    EXPECT_LE(d.remote_halo_bytes(), square.remote_halo_bytes());
+
+    // star stencils receive no corners
+    auto d_star = gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{64,64,10}, halos, periodic, 4, 4, stencil_shape::star);
+    EXPECT_LT(d_star.halo_bytes(), d.halo_bytes());
+
+    std::stringstream ss;
+    d.print(ss);
+    EXPECT_NE(ss.str().find("remote"), std::string::npos);
+
+    // too many domains for the halo widths
+    EXPECT_THROW((gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{4,4,4}, halos, periodic, 8, 8)), std::runtime_error);
+}
+
+TEST(decomposition, predicted_key)
+{
+    // the key used to rank candidates matches the constructed decomposition
+    const std::array<std::array<int,6>,3> halos{{{1,1,1,1,1,1}, {2,1,0,3,1,0}, {0,0,1,1,2,2}}};
+    const std::array<std::array<bool,3>,2> periodic{{{true,true,false}, {false,true,true}}};
+    const std::array<int,3> extents{50,31,17};
+    for (const auto& h : halos)
+        for (const auto& p : periodic)
+            for (auto shape : {stencil_shape::box, stencil_shape::star})
+            {
+                std::vector<std::array<int,3>> rank_grids, sub_grids;
+                std::array<int,3> f;
+                gridtools::ghex::structured::detail::factorizations<3>(12, 0, f, rank_grids);
+                gridtools::ghex::structured::detail::factorizations<3>(2, 0, f, sub_grids);
+                for (const auto& r : rank_grids)
+                    for (const auto& s : sub_grids)
+                    {
+                        bool valid = true;
+                        for (int i=0; i<3; ++i) valid = valid && extents[i] >= 3*r[i]*s[i];
+                        if (!valid) continue;
+                        decomposition_type d(extents, h, p, r, s, shape);
+                        EXPECT_EQ(gridtools::ghex::structured::detail::layout_key<3>(extents, h, p, r, s, shape,
+                            sizeof(double)), std::make_tuple(d.max_points_per_rank(), d.remote_halo_bytes(),
+                            d.halo_bytes(), d.remote_messages()));
+                    }
+            }
+
+    // large rank counts are decomposed quickly
+    auto d = gridtools::ghex::structured::make_cartesian_decomposition<int,3>(
+        std::array<int,3>{1024,1024,1024}, halos[0], periodic[0], 1<<15);
+    EXPECT_EQ(d.rank_dims()[0]*d.rank_dims()[1]*d.rank_dims()[2], 1<<15);
+    EXPECT_EQ(d.min_points_per_rank(), d.max_points_per_rank());
+}
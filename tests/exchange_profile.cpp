@@ -0,0 +1,160 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <array>
+#include <vector>
+#include <sstream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using gridtools::ghex::exchange_phase;
+
+#ifndef GHEX_PROFILE_EXCHANGES
+#error "this test requires GHEX_PROFILE_EXCHANGES"
+#endif
+
+TEST(exchange_profile, phases_and_traffic)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    const int rank = context.rank();
+    const int size = context.size();
+
+    // 1D decomposition along x, periodic
+    const int n = 8;
+    const int nx = n*size;
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        rank, std::array<int,3>{rank*n, 0, 0}, std::array<int,3>{(rank+1)*n-1, n-1, n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+        std::array<int,3>{nx-1,n-1,n-1}, std::array<int,6>{1,1,0,0,0,0}, std::array<bool,3>{true,true,true});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    std::vector<double> raw((n+2)*n*n, -1.0);
+    auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw.data(),
+        std::array<int,3>{1,0,0}, std::array<int,3>{n+2,n,n});
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                field(x,y,z) = rank*n+x;
+
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+    EXPECT_EQ(co.get_exchange_profile().num_exchanges(), 0u);
+
+    const int num_exchanges = 3;
+    for (int i=0; i<num_exchanges; ++i)
+        co.exchange(pattern(field)).wait();
+    EXPECT_EQ(field(-1,0,0), (rank*n+nx-1)%nx);
+    EXPECT_EQ(field(n,0,0), ((rank+1)*n)%nx);
+
+    const auto& prof = co.get_exchange_profile();
+    EXPECT_EQ(prof.num_exchanges(), (std::size_t)num_exchanges);
+    double sum = 0.0;
+    for (int p=0; p<gridtools::ghex::num_exchange_phases; ++p)
+    {
+        EXPECT_EQ(prof[static_cast<exchange_phase>(p)].num_samples(), (std::size_t)num_exchanges);
+        EXPECT_GE(prof[static_cast<exchange_phase>(p)].min(), 0.0);
+        sum += prof[static_cast<exchange_phase>(p)].sum();
+    }
+    EXPECT_NEAR(sum, prof.total().sum(), 1.0e-6*sum+1.0e-9);
+
+    // one face of n*n doubles is sent to and received from each of the two neighbors per exchange
+    const int left = (rank+size-1)%size;
+    const int right = (rank+1)%size;
+    const std::size_t face = n*n*sizeof(double);
+    ASSERT_EQ(prof.traffic().size(), size > 2 ? 2u : 1u);
+    for (int nb : {left, right})
+    {
+        const auto& t = prof.traffic().at(nb);
+        const std::size_t k = (size > 2 ? 1u : 2u)*num_exchanges;
+        EXPECT_EQ(t.sent_bytes, k*face);
+        EXPECT_EQ(t.recv_bytes, k*face);
+        EXPECT_EQ(t.sent_messages, k);
+        EXPECT_EQ(t.recv_messages, k);
+    }
+
+    // chunked buffers count one message per chunk
+    co.clear_exchange_profile();
+    EXPECT_EQ(co.get_exchange_profile().num_exchanges(), 0u);
+    EXPECT_TRUE(co.get_exchange_profile().traffic().empty());
+    co.set_chunk_size(face/4);
+    co.exchange(pattern(field)).wait();
+    const auto& t = co.get_exchange_profile().traffic().at(right);
+    EXPECT_EQ(t.sent_bytes, (size > 2 ? 1u : 2u)*face);
+    EXPECT_EQ(t.sent_messages, (size > 2 ? 1u : 2u)*4u);
+    EXPECT_EQ(t.recv_messages, (size > 2 ? 1u : 2u)*4u);
+
+    // reduction over all ranks
+    const auto all = reduce(co.get_exchange_profile(), MPI_COMM_WORLD);
+    EXPECT_EQ(all.num_exchanges(), (std::size_t)size);
+    EXPECT_TRUE(all.traffic().empty());
+    ASSERT_EQ(all.rank_traffic().size(), (std::size_t)size);
+    for (const auto& p : all.rank_traffic())
+    {
+        EXPECT_EQ(p.second.sent_bytes, 2*face);
+        EXPECT_EQ(p.second.recv_bytes, 2*face);
+    }
+}
+
+TEST(exchange_profile, output)
+{
+    gridtools::ghex::exchange_profile prof;
+    gridtools::ghex::detail::exchange_recorder rec;
+    rec.start();
+    rec.toc(exchange_phase::plan);
+    rec.sent(3, 128);
+    rec.received(3, 64);
+    rec.received(5, 32);
+    rec.toc(exchange_phase::unpack);
+    rec.commit(prof);
+
+    std::stringstream phases;
+    prof.write_phases_csv(phases);
+    std::string line;
+    int num_lines = 0;
+    std::getline(phases, line);
+    EXPECT_EQ(line, "phase,samples,min_us,mean_us,max_us,stddev_us");
+    while (std::getline(phases, line))
+    {
+        EXPECT_EQ(line.substr(line.find(',')+1, 2), "1,");
+        ++num_lines;
+    }
+    EXPECT_EQ(num_lines, gridtools::ghex::num_exchange_phases+1);
+
+    std::stringstream traffic;
+    prof.write_traffic_csv(traffic);
+    EXPECT_EQ(traffic.str(), "rank,sent_bytes,sent_messages,recv_bytes,recv_messages\n3,128,1,64,1\n5,0,0,32,1\n");
+
+    std::stringstream json;
+    prof.write_json(json);
+    EXPECT_NE(json.str().find("\"unpack\": {\"samples\": 1"), std::string::npos);
+    EXPECT_NE(json.str().find("{\"rank\": 5, \"sent_bytes\": 0, \"sent_messages\": 0, \"recv_bytes\": 32, \"recv_messages\": 1}"),
+        std::string::npos);
+    EXPECT_NE(json.str().find("\"rank_traffic\": []"), std::string::npos);
+
+    // a reduced profile lists its traffic per rank separately
+    gridtools::ghex::exchange_profile reduced;
+    reduced.m_rank_traffic[0] = prof.traffic().at(3);
+    std::stringstream rank_traffic;
+    reduced.write_rank_traffic_csv(rank_traffic);
+    EXPECT_EQ(rank_traffic.str(), "rank,sent_bytes,sent_messages,recv_bytes,recv_messages\n0,128,1,64,1\n");
+    json.str("");
+    reduced.write_json(json);
+    EXPECT_NE(json.str().find("\"traffic\": [],\n  \"rank_traffic\": [\n    {\"rank\": 0, \"sent_bytes\": 128"),
+        std::string::npos);
+}
@@ -0,0 +1,59 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/domain_descriptor.hpp>
+#include <gtest/gtest.h>
+#include <array>
+
+using gridtools::ghex::structured::stencil_shape;
+
+// number of dimensions in which a halo lies outside of the domain [0, n-1]^D
+template<typename Halo>
+int num_outside(const Halo& h, int n)
+{
+    int k = 0;
+    for (int d=0; d<3; ++d)
+        if (h.local().first()[d] < 0 || h.local().last()[d] > n-1) ++k;
+    return k;
+}
+
+TEST(halo_generator, stencil_shape)
+{
+    using domain_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+    const int n = 8;
+    domain_type d{0, std::array<int,3>{0,0,0}, std::array<int,3>{n-1,n-1,n-1}};
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{n-1,n-1,n-1};
+    const std::array<int,6> halos{1,2,1,2,1,2};
+    const std::array<bool,3> periodic{true,true,true};
+
+    auto box = domain_type::halo_generator_type(g_first, g_last, halos, periodic)(d);
+    EXPECT_EQ(box.size(), 26u);
+
+    auto star_gen = domain_type::halo_generator_type(g_first, g_last, halos, periodic, stencil_shape::star);
+    EXPECT_EQ(star_gen.shape(), stencil_shape::star);
+    auto star = star_gen(d);
+    ASSERT_EQ(star.size(), 6u);
+    for (const auto& h : star)
+    {
+        EXPECT_EQ(num_outside(h, n), 1);
+        // faces span the whole domain in the other dimensions
+        int num_full = 0;
+        for (int dim=0; dim<3; ++dim)
+            if (h.local().first()[dim] == 0 && h.local().last()[dim] == n-1) ++num_full;
+        EXPECT_EQ(num_full, 2);
+    }
+
+    // no halo in the last dimension: 2D star
+    auto star_2d = domain_type::halo_generator_type(g_first, g_last, std::array<int,6>{1,1,1,1,0,0}, periodic,
+        stencil_shape::star)(d);
+    EXPECT_EQ(star_2d.size(), 4u);
+}
@@ -0,0 +1,58 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/allocator/hugepage_allocator.hpp>
+#include <ghex/allocator/numa_allocator_adaptor.hpp>
+#include <ghex/allocator/pool_allocator_adaptor.hpp>
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <vector>
+
+namespace hugepage = gridtools::ghex::allocator::hugepage;
+using gridtools::ghex::allocator::hugepage_allocator;
+
+TEST(hugepage_allocator, allocate)
+{
+    hugepage_allocator<double> alloc;
+    for (std::size_t n : {std::size_t{1}, std::size_t{1000}, hugepage::threshold/sizeof(double),
+        hugepage::page_size/sizeof(double)+1, std::size_t{5}*hugepage::page_size/sizeof(double)})
+    {
+        double* ptr = alloc.allocate(n);
+        if (n*sizeof(double) >= hugepage::threshold)
+        {
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % hugepage::page_size, 0u);
+        }
+        for (std::size_t i=0; i<n; ++i) ptr[i] = i;
+        EXPECT_EQ(ptr[n-1], n-1);
+        alloc.deallocate(ptr, n);
+    }
+
+    std::vector<int, hugepage_allocator<int>> v(hugepage::page_size, 1);
+    EXPECT_EQ(v[0] + v.back(), 2);
+}
+
+TEST(hugepage_allocator, pool)
+{
+    using alloc_type = gridtools::ghex::allocator::numa_allocator_adaptor<hugepage_allocator<unsigned char>>;
+    using gridtools::ghex::allocator::numa_placement;
+    using gridtools::ghex::allocator::numa_policy;
+    gridtools::ghex::allocator::pool<alloc_type> pool{alloc_type{numa_placement{numa_policy::local, 0}}};
+    auto a = pool.get_allocator();
+    const std::size_t n = 3*hugepage::page_size + 17;
+    auto ptr = a.allocate(n);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(ptr) % hugepage::page_size, 0u);
+    ptr[n-1] = 42;
+    a.deallocate(ptr, n);
+    auto ptr2 = a.allocate(n);
+    EXPECT_EQ(ptr, ptr2);
+    EXPECT_EQ(ptr2[n-1], 42);
+    a.deallocate(ptr2, n);
+}
@@ -0,0 +1,81 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/allocator/thread_pool_allocator_adaptor.hpp>
+#include <ghex/transport_layer/intrusive_shared_message_buffer.hpp>
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+
+using pool_type    = gridtools::ghex::allocator::thread_pool_impl<std::allocator<unsigned char>>;
+using alloc_type   = gridtools::ghex::allocator::thread_pool_allocator_adaptor<std::allocator<unsigned char>>;
+using message_type = gridtools::ghex::tl::intrusive_shared_message_buffer<alloc_type>;
+
+TEST(intrusive_message_buffer, single_allocation)
+{
+    pool_type pool{std::allocator<unsigned char>{}};
+    alloc_type alloc(&pool);
+    {
+        message_type msg(1000, alloc);
+        EXPECT_EQ(msg.size(), 1000u);
+        EXPECT_EQ(reinterpret_cast<std::uintptr_t>(msg.data()) % alignof(std::max_align_t), 0u);
+        msg.data<int>()[0] = 42;
+
+        message_type copy(msg);
+        message_type assigned(alloc);
+        assigned = copy;
+        assigned = assigned;
+        EXPECT_EQ(msg.use_count(), 3u);
+        EXPECT_EQ(assigned.data(), msg.data());
+        EXPECT_EQ(assigned.data<int>()[0], 42);
+
+        // the type-erased message holds a reference
+        {
+            gridtools::ghex::tl::cb::any_message any{msg.make_ref()};
+            EXPECT_EQ(any.data(), msg.data());
+            EXPECT_EQ(any.size(), msg.size());
+            EXPECT_EQ(msg.use_count(), 4u);
+        }
+        EXPECT_EQ(msg.use_count(), 3u);
+
+        // shared storage cannot be reallocated
+        EXPECT_THROW(copy.resize(2000), std::runtime_error);
+        EXPECT_NO_THROW(copy.resize(10));
+        EXPECT_EQ(msg.size(), 10u);
+    }
+    // one allocation per message (the empty one included), storage is reused afterwards
+    EXPECT_EQ(pool.num_allocations(), 2u);
+    {
+        message_type msg(1000, alloc);
+    }
+    EXPECT_EQ(pool.num_allocations(), 2u);
+}
+
+TEST(intrusive_message_buffer, release_from_threads)
+{
+    pool_type pool{std::allocator<unsigned char>{}};
+    alloc_type alloc(&pool);
+    const int num_threads = 4;
+    const int num_messages = 1000;
+
+    // every message is released concurrently by all threads, the last one returns it to the pool
+    for (int m=0; m<num_messages; ++m)
+    {
+        message_type msg(256, alloc);
+        std::vector<message_type> copies(num_threads, msg);
+        msg = message_type(alloc);
+        std::vector<std::thread> threads;
+        for (int i=0; i<num_threads; ++i)
+            threads.emplace_back([&copies,i]() { message_type released(std::move(copies[i])); });
+        for (auto& t : threads) t.join();
+    }
+    EXPECT_LT(pool.num_allocations(), (std::size_t)(num_messages/10));
+}
@@ -0,0 +1,116 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+// irregular land/sea distribution in the horizontal, constant along z
+bool active(int x, int y, int)
+{
+    return ((x/3 + y/2) % 2 == 0) || (x % 5 == 0);
+}
+
+double value(int x, int y, int z)
+{
+    return x + 100.0*y + 10000.0*z;
+}
+
+TEST(masked_pattern, exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[2] = {0,0};
+    MPI_Dims_create(context.size(), 2, dims_);
+    const int cx = context.rank()%dims_[0];
+    const int cy = context.rank()/dims_[0];
+
+    const int n = 12;
+    const int nz = 3;
+    const int h = 2;
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{dims_[0]*n-1, dims_[1]*n-1, nz-1};
+    const std::array<int,3> offsets{h,h,0};
+    const std::array<int,3> extents{n+2*h,n+2*h,nz};
+
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(),
+        std::array<int,3>{cx*n, cy*n, 0},
+        std::array<int,3>{(cx+1)*n-1, (cy+1)*n-1, nz-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last,
+        std::array<int,6>{h,h,h,h,0,0}, std::array<bool,3>{true,true,false});
+    auto mask = [](const domain_descriptor_type&, const auto& x) { return active(x[0], x[1], x[2]); };
+
+    auto dense  = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    auto masked = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains, mask);
+    using pattern_type = std::remove_reference_t<decltype(masked[0])>;
+
+    // the masked receive halos hold exactly the active points of the dense halos
+    int num_active = 0;
+    int num_dense = 0;
+    for (const auto& p : dense[0].recv_halos())
+        for (const auto& is : p.second)
+            for (int z=is.global().first()[2]; z<=is.global().last()[2]; ++z)
+                for (int y=is.global().first()[1]; y<=is.global().last()[1]; ++y)
+                    for (int x=is.global().first()[0]; x<=is.global().last()[0]; ++x)
+                    {
+                        ++num_dense;
+                        if (active(x,y,z)) ++num_active;
+                    }
+    int num_masked = 0;
+    for (const auto& p : masked[0].recv_halos())
+    {
+        num_masked += pattern_type::num_elements(p.second);
+        for (const auto& is : p.second)
+            for (int z=is.global().first()[2]; z<=is.global().last()[2]; ++z)
+                for (int y=is.global().first()[1]; y<=is.global().last()[1]; ++y)
+                    for (int x=is.global().first()[0]; x<=is.global().last()[0]; ++x)
+                        EXPECT_TRUE(active(x,y,z));
+    }
+    EXPECT_EQ(num_masked, num_active);
+    EXPECT_LT(num_masked, num_dense);
+
+    // exchange: active halo points are updated, inactive ones are untouched
+    std::vector<double> raw(extents[0]*extents[1]*extents[2], -1.0);
+    auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw.data(), offsets, extents);
+    for (int z=0; z<nz; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                field(x,y,z) = value(cx*n+x, cy*n+y, z);
+
+    auto co = gridtools::ghex::make_communication_object<decltype(masked)>(context.get_communicator(context.get_token()));
+    co.exchange(masked(field)).wait();
+
+    const int gx = g_last[0]+1, gy = g_last[1]+1;
+    for (int z=0; z<nz; ++z)
+        for (int y=-h; y<n+h; ++y)
+            for (int x=-h; x<n+h; ++x)
+            {
+                if (x>=0 && x<n && y>=0 && y<n) continue;
+                const int X = (cx*n+x+gx)%gx;
+                const int Y = (cy*n+y+gy)%gy;
+                if (active(X,Y,z))
+                    EXPECT_EQ(field(x,y,z), value(X,Y,z));
+                else
+                    EXPECT_EQ(field(x,y,z), -1.0);
+            }
+}
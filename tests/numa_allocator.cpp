@@ -0,0 +1,112 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/allocator/numa_allocator_adaptor.hpp>
+#include <ghex/allocator/pool_allocator_adaptor.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <gtest/gtest.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace numa = gridtools::ghex::allocator::numa;
+using gridtools::ghex::allocator::numa_policy;
+using gridtools::ghex::allocator::numa_placement;
+using alloc_type = gridtools::ghex::allocator::numa_allocator_adaptor<std::allocator<unsigned char>>;
+
+TEST(numa_allocator, placement)
+{
+    const std::size_t n = 1u<<22;
+    for (auto policy : {numa_policy::none, numa_policy::first_touch, numa_policy::local, numa_policy::node})
+    {
+        const numa_placement p{policy, numa::num_nodes()-1};
+        alloc_type alloc(p);
+        std::vector<unsigned char, alloc_type> v(n, 1, alloc);
+        EXPECT_EQ(v.get_allocator().m_placement, p);
+        EXPECT_EQ(v[0] + v[n-1], 2);
+        // bound memory is mapped by the adaptor, hence not shared with other allocations of the heap
+        if (numa::binds(p))
+        {
+            EXPECT_EQ(reinterpret_cast<std::uintptr_t>(v.data()) % sysconf(_SC_PAGESIZE), 0u);
+        }
+        EXPECT_TRUE(alloc == alloc_type{});
+        if (numa::can_bind() && policy == numa_policy::node)
+        {
+            EXPECT_EQ(numa::node_of(v.data() + n/2), p.node);
+        }
+        if (numa::can_bind() && policy == numa_policy::local)
+        {
+            EXPECT_EQ(numa::node_of(v.data() + n/2), numa::current_node());
+        }
+    }
+
+    // memory is released the way it was obtained, whatever the placement of the releasing adaptor
+    for (auto from : {numa_policy::none, numa_policy::local})
+        for (auto to : {numa_policy::none, numa_policy::local})
+        {
+            alloc_type a{numa_placement{from, 0}}, b{numa_placement{to, 0}};
+            auto ptr = a.allocate(n);
+            ptr[n-1] = 1;
+            b.deallocate(ptr, n);
+        }
+
+    // pooled memory keeps its placement, the content of recycled memory is not touched
+    gridtools::ghex::allocator::pool<alloc_type> pool{alloc_type{numa_placement{numa_policy::first_touch, 0}}};
+    auto a = pool.get_allocator();
+    auto ptr = a.allocate(n);
+    ptr[n-1] = 42;
+    a.deallocate(ptr, n);
+    auto ptr2 = a.allocate(n);
+    EXPECT_EQ(ptr, ptr2);
+    EXPECT_EQ(ptr2[n-1], 42);
+    a.deallocate(ptr2, n);
+}
+
+TEST(numa_allocator, communication_object)
+{
+    using transport = gridtools::ghex::tl::mpi_tag;
+    using threading = gridtools::ghex::threads::none::primitives;
+    using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    // one periodic domain: the halos are exchanged with itself
+    const int n = 16;
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(), std::array<int,3>{0,0,0}, std::array<int,3>{n-1,n-1,n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+        std::array<int,3>{n-1,n-1,n-1}, std::array<int,6>{1,1,1,1,1,1}, std::array<bool,3>{true,true,true});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    std::vector<double> raw((n+2)*(n+2)*(n+2), -1.0);
+    auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw.data(),
+        std::array<int,3>{1,1,1}, std::array<int,3>{n+2,n+2,n+2});
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                field(x,y,z) = x + 100*y + 10000*z;
+
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+    EXPECT_EQ(co.get_numa_placement(), numa_placement{});
+    co.exchange(pattern(field)).wait();
+    // changes the placement of the existing pools as well
+    co.set_numa_placement(numa_placement{numa_policy::local, 0});
+    EXPECT_EQ(co.get_numa_placement().policy, numa_policy::local);
+    co.exchange(pattern(field)).wait();
+    EXPECT_EQ(field(-1,-1,-1), (n-1) + 100*(n-1) + 10000*(n-1));
+    EXPECT_EQ(field(n,n,n), 0);
+    // buffers and pooled memory of the previous placement are released correctly
+    co.set_numa_placement(numa_placement{});
+    co.exchange(pattern(field)).wait();
+    EXPECT_EQ(field(-1,-1,-1), (n-1) + 100*(n-1) + 10000*(n-1));
+}
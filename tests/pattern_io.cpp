@@ -0,0 +1,319 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/pattern_io.hpp>
+#include <ghex/unstructured/pattern_io.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+template<typename Map>
+bool compare_maps(const Map& a, const Map& b)
+{
+    if (a.size() != b.size()) return false;
+    auto it_b = b.begin();
+    for (const auto& kv : a)
+    {
+        if (kv.first.id != it_b->first.id || kv.first.tag != it_b->first.tag ||
+            kv.first.mpi_rank != it_b->first.mpi_rank || kv.first.address != it_b->first.address) return false;
+        if (kv.second.size() != it_b->second.size()) return false;
+        for (unsigned int i=0; i<kv.second.size(); ++i)
+        {
+            const auto& x = kv.second[i];
+            const auto& y = it_b->second[i];
+            if (x.local().first() != y.local().first() || x.local().last() != y.local().last()) return false;
+            if (x.global().first() != y.global().first() || x.global().last() != y.global().last()) return false;
+        }
+        ++it_b;
+    }
+    return true;
+}
+
+// unstructured ring: each rank owns the points 0..n-1 and holds a copy of the last point of the left neighbor
+// at n and of the first point of the right neighbor at n+1, with a column of levels per point
+struct ring_domain
+{
+    using domain_id_type = int;
+    using index_t = int;
+    int m_id;
+    int m_n;
+    domain_id_type domain_id() const noexcept { return m_id; }
+    index_t first() const noexcept { return 0; }
+    index_t last() const noexcept { return m_n-1; }
+    std::size_t levels() const noexcept { return 2; }
+};
+
+struct ring_halo_generator
+{
+    using index_t = int;
+    using index_vector_type = std::vector<index_t, gridtools::ghex::allocator::cuda::unified_memory_allocator<index_t>>;
+
+    struct halo
+    {
+        int m_partition;
+        index_vector_type m_local_index;
+        std::vector<index_t> m_remote_index;
+        int partition() const noexcept { return m_partition; }
+        const index_vector_type& local_index() const noexcept { return m_local_index; }
+        const std::vector<index_t>& remote_index() const noexcept { return m_remote_index; }
+        std::size_t levels() const noexcept { return 2; }
+        std::size_t size() const noexcept { return m_local_index.size(); }
+    };
+
+    int m_size;
+
+    // one halo per remote rank, the neighbors coincide on 1 and 2 ranks
+    std::vector<halo> operator()(const ring_domain& d) const
+    {
+        std::vector<halo> halos;
+        for (int r=0; r<m_size; ++r) halos.push_back(halo{r, {}, {}});
+        auto& left = halos[(d.domain_id()+m_size-1)%m_size];
+        left.m_local_index.push_back(d.m_n);
+        left.m_remote_index.push_back(d.m_n-1);
+        auto& right = halos[(d.domain_id()+1)%m_size];
+        right.m_local_index.push_back(d.m_n+1);
+        right.m_remote_index.push_back(0);
+        return halos;
+    }
+};
+
+struct ring_field
+{
+    using arch_type = gridtools::ghex::cpu;
+    using domain_id_type = int;
+    using value_type = double;
+    using device_id_type = gridtools::ghex::arch_traits<arch_type>::device_id_type;
+
+    domain_id_type m_id;
+    std::vector<double> m_values;
+
+    domain_id_type domain_id() const { return m_id; }
+    device_id_type device_id() const { return 0; }
+    std::size_t data_type_size() const { return sizeof(value_type); }
+    double& operator()(int idx, std::size_t level) { return m_values[idx*2+level]; }
+
+    template<typename IndexContainer>
+    void pack(value_type* buffer, const IndexContainer& c, void*)
+    {
+        for (const auto& is : c)
+            for (auto idx : is.local_index())
+                for (std::size_t level=0; level<is.levels(); ++level)
+                    *buffer++ = (*this)(idx, level);
+    }
+
+    template<typename IndexContainer>
+    void unpack(const value_type* buffer, const IndexContainer& c, void*)
+    {
+        for (const auto& is : c)
+            for (auto idx : is.local_index())
+                for (std::size_t level=0; level<is.levels(); ++level)
+                    (*this)(idx, level) = *buffer++;
+    }
+};
+
+template<typename Map>
+bool compare_unstructured_maps(const Map& a, const Map& b)
+{
+    if (a.size() != b.size()) return false;
+    auto it_b = b.begin();
+    for (const auto& kv : a)
+    {
+        if (kv.first.id != it_b->first.id || kv.first.tag != it_b->first.tag ||
+            kv.first.mpi_rank != it_b->first.mpi_rank || kv.first.address != it_b->first.address) return false;
+        if (kv.second.size() != it_b->second.size()) return false;
+        for (unsigned int i=0; i<kv.second.size(); ++i)
+        {
+            const auto& x = kv.second[i];
+            const auto& y = it_b->second[i];
+            if (x.partition() != y.partition() || x.levels() != y.levels() || x.local_index() != y.local_index())
+                return false;
+        }
+        ++it_b;
+    }
+    return true;
+}
+
+TEST(pattern_io, save_load)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    const std::array<int,3> local_ext{4,3,2};
+    const std::array<bool,3> periodic{true,true,false};
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{local_ext[0]*4-1, ((context.size()-1)/2+1)*local_ext[1]-1, local_ext[2]-1};
+    const std::array<int,6> halos{1,1,1,1,1,1};
+
+    // two domains per rank
+    std::vector<domain_descriptor_type> local_domains;
+    local_domains.push_back( domain_descriptor_type{
+        context.rank()*2,
+        std::array<int,3>{ ((context.rank()%2)*2  )*local_ext[0],   (context.rank()/2  )*local_ext[1],                0},
+        std::array<int,3>{ ((context.rank()%2)*2+1)*local_ext[0]-1, (context.rank()/2+1)*local_ext[1]-1, local_ext[2]-1}});
+    local_domains.push_back( domain_descriptor_type{
+        context.rank()*2+1,
+        std::array<int,3>{ ((context.rank()%2)*2+1)*local_ext[0],   (context.rank()/2  )*local_ext[1],             0},
+        std::array<int,3>{ ((context.rank()%2)*2+2)*local_ext[0]-1, (context.rank()/2+1)*local_ext[1]-1, local_ext[2]-1}});
+
+    auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+
+    const std::string prefix = "ghex_test_pattern_io";
+
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    gridtools::ghex::save_pattern(context, pattern, local_domains, prefix, 42);
+
+    auto loaded = gridtools::ghex::load_pattern<gridtools::ghex::structured::grid>(context, local_domains, prefix, 42);
+    ASSERT_EQ(loaded.size(), pattern.size());
+    EXPECT_EQ(loaded.max_tag(), pattern.max_tag());
+    for (int i=0; i<pattern.size(); ++i)
+    {
+        EXPECT_EQ(loaded[i].domain_id(), pattern[i].domain_id());
+        EXPECT_EQ(&loaded[i].container(), &loaded);
+        EXPECT_TRUE(loaded[i].global_first() == pattern[i].global_first());
+        EXPECT_TRUE(loaded[i].global_last() == pattern[i].global_last());
+        EXPECT_TRUE(compare_maps(loaded[i].send_halos(), pattern[i].send_halos()));
+        EXPECT_TRUE(compare_maps(loaded[i].recv_halos(), pattern[i].recv_halos()));
+    }
+
+    // different key: hash mismatch on all ranks
+    EXPECT_THROW(gridtools::ghex::load_pattern<gridtools::ghex::structured::grid>(context, local_domains, prefix, 43),
+        std::runtime_error);
+
+    // different decomposition: hash mismatch on one rank only, but all ranks must fail
+    auto modified_domains = local_domains;
+    if (context.rank() == 0) std::swap(modified_domains[0], modified_domains[1]);
+    EXPECT_THROW(gridtools::ghex::load_pattern<gridtools::ghex::structured::grid>(context, modified_domains, prefix, 42),
+        std::runtime_error);
+    // the error of the failing rank is reported on all ranks
+    try
+    {
+        gridtools::ghex::load_pattern<gridtools::ghex::structured::grid>(context, modified_domains, prefix, 42);
+    }
+    catch (std::runtime_error& e)
+    {
+        EXPECT_EQ(std::string(e.what()), "could not load pattern on rank 0: pattern file does not match the domain decomposition");
+    }
+
+    // cached construction stores the patterns with the generated halos mixed into the key, and picks up the file
+    using grid_type = typename gridtools::ghex::structured::grid::template type<domain_descriptor_type>;
+    const auto halo_key = gridtools::ghex::detail::halo_key<grid_type>(42, halo_gen, local_domains);
+    auto cached = gridtools::ghex::make_pattern_cached<gridtools::ghex::structured::grid>(context, halo_gen, local_domains, prefix, 42);
+    EXPECT_NO_THROW(gridtools::ghex::load_pattern<gridtools::ghex::structured::grid>(context, local_domains, prefix, halo_key));
+    auto cached_again = gridtools::ghex::make_pattern_cached<gridtools::ghex::structured::grid>(context, halo_gen, local_domains, prefix, 42);
+    ASSERT_EQ(cached.size(), pattern.size());
+    ASSERT_EQ(cached_again.size(), pattern.size());
+    for (int i=0; i<pattern.size(); ++i)
+    {
+        EXPECT_EQ(&cached[i].container(), &cached);
+        EXPECT_TRUE(compare_maps(cached[i].send_halos(), pattern[i].send_halos()));
+        EXPECT_TRUE(compare_maps(cached[i].recv_halos(), pattern[i].recv_halos()));
+        EXPECT_TRUE(compare_maps(cached_again[i].send_halos(), pattern[i].send_halos()));
+        EXPECT_TRUE(compare_maps(cached_again[i].recv_halos(), pattern[i].recv_halos()));
+    }
+
+    // a different halo configuration with the same key does not load the stale patterns
+    auto halo_gen_2 = domain_descriptor_type::halo_generator_type(g_first, g_last, std::array<int,6>{2,2,1,1,0,0}, periodic);
+    EXPECT_NE(gridtools::ghex::detail::halo_key<grid_type>(42, halo_gen_2, local_domains), halo_key);
+    auto pattern_2 = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen_2, local_domains);
+    auto cached_2 = gridtools::ghex::make_pattern_cached<gridtools::ghex::structured::grid>(context, halo_gen_2, local_domains, prefix, 42);
+    ASSERT_EQ(cached_2.size(), pattern_2.size());
+    for (int i=0; i<pattern_2.size(); ++i)
+    {
+        EXPECT_TRUE(compare_maps(cached_2[i].send_halos(), pattern_2[i].send_halos()));
+        EXPECT_TRUE(compare_maps(cached_2[i].recv_halos(), pattern_2[i].recv_halos()));
+    }
+
+    context.get_setup_communicator().barrier();
+    std::remove(gridtools::ghex::detail::pattern_file_name(prefix, context.rank()).c_str());
+}
+
+TEST(pattern_io, unstructured_save_load)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    const int rank = context.rank();
+    const int size = context.size();
+
+    const int n = 5;
+    std::vector<ring_domain> local_domains{ ring_domain{rank, n} };
+    ring_halo_generator halo_gen{size};
+
+    const std::string prefix = "ghex_test_pattern_io_unstructured";
+
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::unstructured::grid>(context, halo_gen, local_domains);
+    // the tag ranges of concurrent exchanges are derived from max_tag
+    for (const auto& p : pattern)
+    {
+        for (const auto& kv : p.send_halos()) EXPECT_LE(kv.first.tag, pattern.max_tag());
+        for (const auto& kv : p.recv_halos()) EXPECT_LE(kv.first.tag, pattern.max_tag());
+    }
+    gridtools::ghex::save_pattern(context, pattern, local_domains, prefix, 42);
+
+    auto loaded = gridtools::ghex::load_pattern<gridtools::ghex::unstructured::grid>(context, local_domains, prefix, 42);
+    ASSERT_EQ(loaded.size(), pattern.size());
+    EXPECT_EQ(loaded.max_tag(), pattern.max_tag());
+    for (int i=0; i<pattern.size(); ++i)
+    {
+        EXPECT_EQ(loaded[i].domain_id(), pattern[i].domain_id());
+        EXPECT_EQ(&loaded[i].container(), &loaded);
+        EXPECT_TRUE(compare_unstructured_maps(loaded[i].send_halos(), pattern[i].send_halos()));
+        EXPECT_TRUE(compare_unstructured_maps(loaded[i].recv_halos(), pattern[i].recv_halos()));
+    }
+
+    // different key: hash mismatch on all ranks
+    EXPECT_THROW(gridtools::ghex::load_pattern<gridtools::ghex::unstructured::grid>(context, local_domains, prefix, 43),
+        std::runtime_error);
+
+    // the loaded patterns exchange the same values as the generated ones
+    auto value = [n,size](int r, int idx, std::size_t level) { return 10.0*(((r+size)%size)*n+idx) + level; };
+    ring_field field{rank, std::vector<double>((n+2)*2, -1.0)};
+    ring_field field_loaded{rank, std::vector<double>((n+2)*2, -1.0)};
+    for (int idx=0; idx<n; ++idx)
+        for (std::size_t level=0; level<2; ++level)
+            field(idx, level) = field_loaded(idx, level) = value(rank, idx, level);
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+    co.exchange(pattern(field)).wait();
+    co.exchange(loaded(field_loaded)).wait();
+    EXPECT_EQ(field.m_values, field_loaded.m_values);
+    for (std::size_t level=0; level<2; ++level)
+    {
+        EXPECT_EQ(field_loaded(n, level), value(rank-1, n-1, level));
+        EXPECT_EQ(field_loaded(n+1, level), value(rank+1, 0, level));
+    }
+
+    // cached construction picks up the file written on the first call
+    auto cached = gridtools::ghex::make_pattern_cached<gridtools::ghex::unstructured::grid>(context, halo_gen, local_domains, prefix, 42);
+    auto cached_again = gridtools::ghex::make_pattern_cached<gridtools::ghex::unstructured::grid>(context, halo_gen, local_domains, prefix, 42);
+    ASSERT_EQ(cached_again.size(), pattern.size());
+    EXPECT_EQ(cached_again.max_tag(), pattern.max_tag());
+    for (int i=0; i<pattern.size(); ++i)
+    {
+        EXPECT_TRUE(compare_unstructured_maps(cached[i].send_halos(), pattern[i].send_halos()));
+        EXPECT_TRUE(compare_unstructured_maps(cached_again[i].send_halos(), pattern[i].send_halos()));
+        EXPECT_TRUE(compare_unstructured_maps(cached_again[i].recv_halos(), pattern[i].recv_halos()));
+    }
+
+    context.get_setup_communicator().barrier();
+    std::remove(gridtools::ghex::detail::pattern_file_name(prefix, context.rank()).c_str());
+}
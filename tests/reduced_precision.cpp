@@ -0,0 +1,119 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/common/bfloat16.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+// value at a (periodic) global coordinate
+double value(int x, int y, int z, int nx)
+{
+    x = (x+nx)%nx;
+    return 1.0 + x + 0.01*y + 0.0001*z + 1.0/3.0;
+}
+
+template<typename Field>
+double max_rel_error(const Field& f, int x0, int nx, int n, int h)
+{
+    double err = 0;
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=-h; x<n+h; ++x)
+            {
+                const double ref = value(x0+x, y, z, nx);
+                err = std::max(err, std::abs(f(x,y,z)-ref)/std::abs(ref));
+            }
+    return err;
+}
+
+TEST(reduced_precision, exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    const int n = 8;
+    const int h = 2;
+    const int nx = n*context.size();
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{nx-1,n-1,n-1};
+    const std::array<int,3> offsets{h,h,h};
+    const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+
+    // decomposition along x, halos along x only
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(),
+        std::array<int,3>{context.rank()*n, 0, 0},
+        std::array<int,3>{(context.rank()+1)*n-1, n-1, n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last,
+        std::array<int,6>{h,h,0,0,0,0}, std::array<bool,3>{true,false,false});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+
+    std::vector<std::vector<double>> raw(3, std::vector<double>(extents[0]*extents[1]*extents[2], 0.0));
+    auto f_double = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw[0].data(), offsets, extents);
+    auto f_float  = gridtools::ghex::with_wire_type<float>(
+        gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw[1].data(), offsets, extents));
+    auto f_bf16   = gridtools::ghex::with_wire_type<gridtools::ghex::bfloat16>(
+        gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw[2].data(), offsets, extents));
+
+    static_assert(std::is_same<decltype(pattern(f_float))::wire_type, float>::value, "wrong wire type");
+    static_assert(std::is_same<decltype(pattern(f_double))::wire_type, double>::value, "wrong wire type");
+
+    const int x0 = context.rank()*n;
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+            {
+                f_double(x,y,z) = value(x0+x,y,z,nx);
+                f_float(x,y,z)  = value(x0+x,y,z,nx);
+                f_bf16(x,y,z)   = value(x0+x,y,z,nx);
+            }
+
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+    co.exchange(pattern(f_double), pattern(f_float), pattern(f_bf16)).wait();
+
+    EXPECT_EQ(max_rel_error(f_double, x0, nx, n, h), 0.0);
+    const double err_float = max_rel_error(f_float, x0, nx, n, h);
+    EXPECT_GT(err_float, 0.0);
+    EXPECT_LE(err_float, std::ldexp(1.0, -24));
+    const double err_bf16 = max_rel_error(f_bf16, x0, nx, n, h);
+    EXPECT_GT(err_bf16, err_float);
+    EXPECT_LE(err_bf16, std::ldexp(1.0, -8));
+
+    // interior values are untouched
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                EXPECT_EQ(f_bf16(x,y,z), value(x0+x,y,z,nx));
+
+    // chunked transfer yields the same values
+    std::vector<double> raw_chunked(raw[2].size(), 0.0);
+    auto f_bf16_chunked = gridtools::ghex::with_wire_type<gridtools::ghex::bfloat16>(
+        gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw_chunked.data(), offsets, extents));
+    for (int z=0; z<n; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                f_bf16_chunked(x,y,z) = value(x0+x,y,z,nx);
+    co.set_chunk_size(64);
+    co.exchange(pattern(f_bf16_chunked)).wait();
+    EXPECT_TRUE(raw_chunked == raw[2]);
+}
@@ -0,0 +1,110 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/transport_layer/mpi/setup.hpp>
+#include <gtest/gtest.h>
+#include <vector>
+
+using setup_communicator = gridtools::ghex::tl::mpi::setup_communicator;
+
+// emulated node layouts: 2 and 3 consecutive ranks per node (the latter leaves an incomplete last node)
+const int ranks_per_node[] = {2, 3};
+
+TEST(setup_collectives, topology)
+{
+    for (int rpn : ranks_per_node)
+    {
+        setup_communicator comm{MPI_COMM_WORLD, rpn};
+        const auto& topo = comm.topology();
+        EXPECT_EQ(topo.num_nodes(), (comm.size()+rpn-1)/rpn);
+        EXPECT_EQ(topo.node(), comm.rank()/rpn);
+        EXPECT_EQ(topo.node_rank(), comm.rank()%rpn);
+        for (int r=0; r<comm.size(); ++r)
+        {
+            EXPECT_EQ(topo.node_of(r), r/rpn);
+            EXPECT_EQ(topo.ordering()[r], r);
+        }
+        EXPECT_EQ(topo.hierarchical(), comm.size() > rpn);
+    }
+}
+
+TEST(setup_collectives, all_gather)
+{
+    for (int rpn : ranks_per_node)
+    {
+        setup_communicator comm{MPI_COMM_WORLD, rpn};
+        const int my_num_values = (comm.rank()%3)*2+1;
+        std::vector<double> my_values(my_num_values);
+        for (int i=0; i<my_num_values; ++i) my_values[i] = comm.rank()*1000 + i;
+
+        auto num_values = comm.all_gather(my_num_values).get();
+        auto values = comm.all_gather(my_values, num_values).get();
+        ASSERT_EQ(values.size(), (unsigned)comm.size());
+        for (int r=0; r<comm.size(); ++r)
+        {
+            EXPECT_EQ(num_values[r], (r%3)*2+1);
+            ASSERT_EQ(values[r].size(), (unsigned)num_values[r]);
+            for (int i=0; i<num_values[r]; ++i) EXPECT_EQ(values[r][i], r*1000.0 + i);
+        }
+    }
+}
+
+TEST(setup_collectives, broadcast)
+{
+    for (int rpn : ranks_per_node)
+    {
+        setup_communicator comm{MPI_COMM_WORLD, rpn};
+        for (int root=0; root<comm.size(); ++root)
+        {
+            int values[3] = {-1, -1, -1};
+            if (comm.rank() == root) { values[0] = root; values[1] = 2*root; values[2] = 3*root; }
+            comm.broadcast(values, 3, root);
+            EXPECT_EQ(values[0], root);
+            EXPECT_EQ(values[1], 2*root);
+            EXPECT_EQ(values[2], 3*root);
+        }
+    }
+}
+
+TEST(setup_collectives, all_to_all)
+{
+    for (int rpn : ranks_per_node)
+    {
+        setup_communicator comm{MPI_COMM_WORLD, rpn};
+        const int P = comm.size();
+        const int me = comm.rank();
+
+        // fixed counts
+        std::vector<int> send_buf(2*P), recv_buf(2*P, -1);
+        for (int r=0; r<P; ++r) { send_buf[2*r] = me*100 + r; send_buf[2*r+1] = -(me*100 + r); }
+        comm.all_to_all(send_buf, recv_buf);
+        for (int r=0; r<P; ++r)
+        {
+            EXPECT_EQ(recv_buf[2*r], r*100 + me);
+            EXPECT_EQ(recv_buf[2*r+1], -(r*100 + me));
+        }
+
+        // variable counts: rank s sends (s+d)%3 values to rank d, including empty messages
+        std::vector<int> send_counts(P), send_displs(P), recv_counts(P), recv_displs(P);
+        int send_total = 0, recv_total = 0;
+        for (int r=0; r<P; ++r)
+        {
+            send_counts[r] = (me+r)%3; send_displs[r] = send_total; send_total += send_counts[r];
+            recv_counts[r] = (r+me)%3; recv_displs[r] = recv_total; recv_total += recv_counts[r];
+        }
+        std::vector<double> send_v(send_total), recv_v(recv_total, -1.0);
+        for (int r=0; r<P; ++r)
+            for (int i=0; i<send_counts[r]; ++i) send_v[send_displs[r]+i] = me*1000 + r*10 + i;
+        comm.all_to_allv(send_v, send_counts, send_displs, recv_v, recv_counts, recv_displs);
+        for (int r=0; r<P; ++r)
+            for (int i=0; i<recv_counts[r]; ++i) EXPECT_EQ(recv_v[recv_displs[r]+i], r*1000.0 + me*10 + i);
+    }
+}
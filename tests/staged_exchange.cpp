@@ -0,0 +1,110 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/staged_pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+
+TEST(staged_exchange, corners)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    int dims_[2] = {0,0};
+    MPI_Dims_create(context.size(), 2, dims_);
+    const std::array<int,2> coords{context.rank()%dims_[0], context.rank()/dims_[0]};
+
+    // asymmetric halos, periodic in x and y, bounded in z
+    const int n = 6, nz = 5;
+    const std::array<int,6> halos{1,2,2,1,1,2};
+    const std::array<bool,3> periodic{true,true,false};
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{dims_[0]*n-1, dims_[1]*n-1, nz-1};
+    const std::array<int,3> offsets{halos[0],halos[2],halos[4]};
+    const std::array<int,3> extents{n+halos[0]+halos[1], n+halos[2]+halos[3], nz+halos[4]+halos[5]};
+
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(),
+        std::array<int,3>{coords[0]*n, coords[1]*n, 0},
+        std::array<int,3>{(coords[0]+1)*n-1, (coords[1]+1)*n-1, nz-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(g_first, g_last, halos, periodic);
+    auto direct = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    auto staged = gridtools::ghex::structured::make_staged_pattern(context, g_first, g_last, halos, periodic,
+        local_domains);
+    ASSERT_EQ(staged.size(), 3);
+
+    // every stage talks to the face neighbors along its dimension only
+    for (int s=0; s<staged.size(); ++s)
+        EXPECT_LE(staged[s][0].recv_halos().size(), 2u);
+    EXPECT_EQ(staged[2][0].recv_halos().size(), 0u);
+
+    const int gx = g_last[0]+1, gy = g_last[1]+1;
+    auto value = [gx,gy](int x, int y, int z) { return 1.0*((x+gx)%gx) + 100.0*((y+gy)%gy) + 10000.0*z; };
+    std::vector<double> raw_direct(extents[0]*extents[1]*extents[2], -1.0);
+    std::vector<double> raw_staged(raw_direct.size(), -1.0);
+    auto f_direct = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw_direct.data(), offsets, extents);
+    auto f_staged = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw_staged.data(), offsets, extents);
+    for (int z=0; z<nz; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                f_direct(x,y,z) = f_staged(x,y,z) = value(coords[0]*n+x, coords[1]*n+y, z);
+
+    auto co = gridtools::ghex::make_communication_object<decltype(direct)>(context.get_communicator(context.get_token()));
+    co.exchange(direct(f_direct)).wait();
+    co.exchange_staged(staged, f_staged).wait();
+
+    // identical to the direct exchange, including edges and corners
+    EXPECT_TRUE(raw_staged == raw_direct);
+    EXPECT_EQ(f_staged(-1,-2,0), value(coords[0]*n-1, coords[1]*n-2, 0));
+    EXPECT_EQ(f_staged(n+1,n,nz-1), value(coords[0]*n+n+1, coords[1]*n+n, nz-1));
+    // the halo beyond the bounded z direction is untouched
+    EXPECT_EQ(f_staged(-1,-1,-1), -1.0);
+
+    // a second exchange with the same objects
+    std::fill(raw_staged.begin(), raw_staged.end(), -1.0);
+    for (int z=0; z<nz; ++z)
+        for (int y=0; y<n; ++y)
+            for (int x=0; x<n; ++x)
+                f_staged(x,y,z) = value(coords[0]*n+x, coords[1]*n+y, z);
+    co.exchange_staged(staged, f_staged).wait();
+    EXPECT_TRUE(raw_staged == raw_direct);
+}
+
+TEST(staged_exchange, irregular_decomposition)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    if (context.size() != 4) return;
+
+    // 2 x 2 ranks where the x split differs between the two rows
+    const int n = 8;
+    const int row = context.rank()/2, col = context.rank()%2;
+    const int split = (row == 0) ? 4 : 3;
+    const std::array<int,3> g_first{0,0,0};
+    const std::array<int,3> g_last{n-1,2*n-1,0};
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(),
+        std::array<int,3>{col == 0 ? 0 : split, row*n, 0},
+        std::array<int,3>{col == 0 ? split-1 : n-1, (row+1)*n-1, 0}} };
+    EXPECT_THROW(gridtools::ghex::structured::make_staged_pattern(context, g_first, g_last,
+        std::array<int,6>{1,1,1,1,0,0}, std::array<bool,3>{true,true,false}, local_domains), std::runtime_error);
+}
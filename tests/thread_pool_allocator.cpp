@@ -0,0 +1,141 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/allocator/thread_pool_allocator_adaptor.hpp>
+#include <ghex/transport_layer/shared_message_buffer.hpp>
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using pool_type  = gridtools::ghex::allocator::thread_pool_impl<std::allocator<unsigned char>>;
+using alloc_type = gridtools::ghex::allocator::thread_pool_allocator_adaptor<std::allocator<unsigned char>>;
+
+TEST(thread_pool_allocator, reuse)
+{
+    pool_type pool{std::allocator<unsigned char>{}};
+    alloc_type alloc(&pool);
+
+    auto p1 = alloc.allocate(100);
+    alloc.deallocate(p1, 100);
+    // same size class
+    auto p2 = alloc.allocate(128);
+    EXPECT_EQ(p1, p2);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(p2) % alignof(std::max_align_t), 0u);
+    // different size class
+    auto p3 = alloc.allocate(129);
+    EXPECT_NE(p2, p3);
+    EXPECT_EQ(pool.num_allocations(), 2u);
+    alloc.deallocate(p2, 128);
+    alloc.deallocate(p3, 129);
+
+    // rebound allocators share the pool
+    alloc_type::rebind<double>::other alloc_d(alloc);
+    auto pd = alloc_d.allocate(16);
+    EXPECT_EQ(reinterpret_cast<unsigned char*>(pd), p2);
+    alloc_d.deallocate(pd, 16);
+
+    // too large to be pooled
+    const std::size_t large = pool_type::min_block_size << pool_type::num_classes;
+    auto pl = alloc.allocate(large+1);
+    alloc.deallocate(pl, large+1);
+    EXPECT_EQ(pool.num_allocations(), 3u);
+}
+
+TEST(thread_pool_allocator, remote_free)
+{
+    pool_type pool{std::allocator<unsigned char>{}};
+    alloc_type alloc(&pool);
+    const int n = 100;
+
+    // allocated here, freed by another thread
+    std::vector<unsigned char*> ptrs;
+    for (int i=0; i<n; ++i) ptrs.push_back(alloc.allocate(1000));
+    std::thread t([&]() { for (auto p : ptrs) alloc.deallocate(p, 1000); });
+    t.join();
+    EXPECT_EQ(pool.num_allocations(), (std::size_t)n);
+
+    // the blocks are back with their owner
+    for (int i=0; i<n; ++i) ptrs[i] = alloc.allocate(1000);
+    EXPECT_EQ(pool.num_allocations(), (std::size_t)n);
+    for (auto p : ptrs) alloc.deallocate(p, 1000);
+}
+
+TEST(thread_pool_allocator, rebalance)
+{
+    pool_type pool{std::allocator<unsigned char>{}};
+    alloc_type alloc(&pool);
+    const std::size_t n = 4*pool_type::high_watermark;
+    std::vector<unsigned char*> ptrs(n);
+
+    // a thread frees more than it keeps: the surplus goes to the depot and is picked up by another thread
+    for (auto& p : ptrs) p = alloc.allocate(64);
+    for (auto p : ptrs) alloc.deallocate(p, 64);
+    std::thread t1([&]() { for (auto& p : ptrs) p = alloc.allocate(64); });
+    t1.join();
+    EXPECT_LT(pool.num_allocations(), n + n/2);
+
+    // blocks returned to a thread which has stopped allocating are taken over
+    const auto num_allocations = pool.num_allocations();
+    for (auto p : ptrs) alloc.deallocate(p, 64);
+    std::thread t2([&]() { for (auto& p : ptrs) p = alloc.allocate(64); });
+    t2.join();
+    EXPECT_LE(pool.num_allocations(), num_allocations + pool_type::high_watermark);
+    for (auto p : ptrs) alloc.deallocate(p, 64);
+}
+
+TEST(thread_pool_allocator, producer_consumer)
+{
+    pool_type pool{std::allocator<unsigned char>{}};
+    alloc_type alloc(&pool);
+    using message_type = gridtools::ghex::tl::shared_message_buffer<alloc_type>;
+
+    // producers allocate messages which consumers release
+    const int num_pairs = 2;
+    const int num_messages = 20000;
+    const int window = 64;
+    std::vector<std::vector<std::atomic<int>>> slots;
+    for (int i=0; i<num_pairs; ++i) slots.emplace_back(window);
+    std::vector<std::vector<message_type>> boxes(num_pairs, std::vector<message_type>(window, message_type(alloc)));
+    std::atomic<bool> passed{true};
+    std::vector<std::thread> threads;
+    for (int i=0; i<num_pairs; ++i)
+    {
+        threads.emplace_back([&,i]()
+        {
+            for (int m=0; m<num_messages; ++m)
+            {
+                auto& slot = slots[i][m%window];
+                while (slot.load(std::memory_order_acquire) != 0) {}
+                message_type msg(256 + (m%4)*256, alloc);
+                msg.data()[0] = (unsigned char)m;
+                boxes[i][m%window] = msg;
+                slot.store(1, std::memory_order_release);
+            }
+        });
+        threads.emplace_back([&,i]()
+        {
+            for (int m=0; m<num_messages; ++m)
+            {
+                auto& slot = slots[i][m%window];
+                while (slot.load(std::memory_order_acquire) != 1) {}
+                if (boxes[i][m%window].data()[0] != (unsigned char)m) passed = false;
+                boxes[i][m%window] = message_type(alloc);
+                slot.store(0, std::memory_order_release);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+    boxes.clear();
+    EXPECT_TRUE(passed);
+    // memory is recycled: far fewer allocations than messages
+    EXPECT_LT(pool.num_allocations(), (std::size_t)(num_pairs*num_messages/10));
+}
@@ -0,0 +1,148 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/trace.hpp>
+#include <array>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+namespace trace = gridtools::ghex::trace;
+
+#ifndef GHEX_TRACE_EVENTS
+#error "this test requires GHEX_TRACE_EVENTS"
+#endif
+
+std::string read_trace(int rank)
+{
+    std::ifstream is("ghex_trace_test." + std::to_string(rank) + ".json");
+    std::stringstream ss;
+    ss << is.rdbuf();
+    return ss.str();
+}
+
+std::size_t count(const std::string& s, const std::string& pattern)
+{
+    std::size_t n = 0u;
+    for (auto pos = s.find(pattern); pos != std::string::npos; pos = s.find(pattern, pos+1)) ++n;
+    return n;
+}
+
+TEST(trace_events, ring_buffer)
+{
+    trace::detail::event_buffer b(4, 0);
+    for (int i=0; i<6; ++i)
+        b.push(trace::event{"e", "test", trace::now(), trace::now(), true, i, 0, 0u});
+    EXPECT_EQ(b.size(), 4u);
+    EXPECT_EQ(b.dropped(), 2u);
+    // oldest first
+    int expected = 2;
+    b.for_each([&expected](const trace::event& e) { EXPECT_EQ(e.peer, expected++); });
+    EXPECT_EQ(expected, 6);
+}
+
+TEST(trace_events, exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    const int rank = context.rank();
+    const int size = context.size();
+
+    // 1D decomposition along x, periodic
+    const int n = 8;
+    const int nx = n*size;
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        rank, std::array<int,3>{rank*n, 0, 0}, std::array<int,3>{(rank+1)*n-1, n-1, n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+        std::array<int,3>{nx-1,n-1,n-1}, std::array<int,6>{1,1,0,0,0,0}, std::array<bool,3>{true,true,true});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    std::vector<double> raw((n+2)*n*n, -1.0);
+    auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw.data(),
+        std::array<int,3>{1,0,0}, std::array<int,3>{n+2,n,n});
+
+    // discard the events of the setup
+    trace::set_capacity(4096);
+    auto comm = context.get_communicator(context.get_token());
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(comm);
+    const int num_exchanges = 2;
+    for (int i=0; i<num_exchanges; ++i)
+        co.exchange(pattern(field)).wait();
+
+    // callback based messages: the receive is queued since the message is sent after the barrier
+    using msg_type = typename decltype(comm)::message_type;
+    int received = 0, sent = 0;
+    comm.recv(msg_type{std::vector<int>(4)}, (rank+size-1)%size, 7, [&received](msg_type, int, int) { ++received; });
+    MPI_Barrier(MPI_COMM_WORLD);
+    comm.send(msg_type{std::vector<int>(4, rank)}, (rank+1)%size, 7, [&sent](msg_type, int, int) { ++sent; });
+    while (received < 1 || sent < 1) comm.progress();
+    EXPECT_GT(trace::num_events(), 0u);
+
+    trace::finalize(MPI_COMM_WORLD, "ghex_trace_test");
+    EXPECT_EQ(trace::num_events(), 0u);
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    const auto json = read_trace(rank);
+    EXPECT_EQ(json.find("{\"traceEvents\": ["), 0u);
+    EXPECT_NE(json.find("\"args\": {\"name\": \"rank " + std::to_string(rank) + "\"}"), std::string::npos);
+    // every phase is recorded at least once per exchange
+    for (const char* phase : {"plan", "post_recvs", "pack", "send", "wait", "unpack"})
+        EXPECT_GE(count(json, std::string("{\"name\": \"") + phase + "\", \"cat\": \"exchange\""),
+            (std::size_t)num_exchanges);
+    // two faces are sent and received per exchange, plus one callback message
+    EXPECT_EQ(count(json, "{\"name\": \"send posted\""), 2u*num_exchanges+1u);
+    EXPECT_EQ(count(json, "{\"name\": \"recv posted\""), 2u*num_exchanges+1u);
+    EXPECT_GE(count(json, "\"peer\": " + std::to_string((rank+1)%size) + ", \"tag\": 7, \"bytes\": 16}"), 1u);
+    EXPECT_EQ(count(json, "\"peer\": " + std::to_string((rank+size-1)%size) + ", \"tag\": 7, \"bytes\": 16}"), 2u);
+    EXPECT_GE(count(json, "{\"name\": \"callback\""), 1u);
+    // completed requests name their peer and tag
+    std::size_t completions = 0u;
+    std::stringstream lines(json);
+    for (std::string line; std::getline(lines, line);)
+    {
+        if (line.find("complete\", \"cat\": \"mpi\"") == std::string::npos) continue;
+        ++completions;
+        const bool from_neighbor =
+            line.find("\"peer\": " + std::to_string((rank+1)%size) + ", \"tag\": ") != std::string::npos ||
+            line.find("\"peer\": " + std::to_string((rank+size-1)%size) + ", \"tag\": ") != std::string::npos;
+        EXPECT_TRUE(from_neighbor);
+    }
+    EXPECT_GE(completions, 4u*num_exchanges);
+    EXPECT_NE(json.find("\"dropped_events\": 0}"), std::string::npos);
+    if (rank == 0)
+    {
+        EXPECT_NE(json.find("\"clock_offset_us\": 0.000,"), std::string::npos);
+    }
+
+    // bounded memory: only the newest events are kept
+    trace::set_capacity(8);
+    for (int i=0; i<20; ++i) trace::instant("marker", "test", i);
+    EXPECT_EQ(trace::num_events(), 8u);
+    trace::finalize(MPI_COMM_WORLD, "ghex_trace_test");
+    MPI_Barrier(MPI_COMM_WORLD);
+    const auto small = read_trace(rank);
+    EXPECT_EQ(count(small, "{\"name\": \"marker\""), 8u);
+    EXPECT_NE(small.find("\"peer\": 19,"), std::string::npos);
+    EXPECT_EQ(small.find("\"peer\": 11,"), std::string::npos);
+    EXPECT_NE(small.find("\"dropped_events\": 12}"), std::string::npos);
+    std::remove(("ghex_trace_test." + std::to_string(rank) + ".json").c_str());
+}
@@ -0,0 +1,228 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/traffic_capture.hpp>
+#include <array>
+#include <map>
+#include <vector>
+#include <string>
+#include <thread>
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+namespace capture = gridtools::ghex::capture;
+
+#ifndef GHEX_CAPTURE_TRAFFIC
+#error "this test requires GHEX_CAPTURE_TRAFFIC"
+#endif
+
+TEST(traffic_capture, exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    const int rank = context.rank();
+    const int size = context.size();
+    const int left = (rank+size-1)%size;
+    const int right = (rank+1)%size;
+
+    // 1D decomposition along x, periodic
+    const int n = 8;
+    const int nx = n*size;
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        rank, std::array<int,3>{rank*n, 0, 0}, std::array<int,3>{(rank+1)*n-1, n-1, n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+        std::array<int,3>{nx-1,n-1,n-1}, std::array<int,6>{1,1,0,0,0,0}, std::array<bool,3>{true,true,true});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+    std::vector<double> raw_1((n+2)*n*n, -1.0);
+    std::vector<double> raw_2((n+2)*n*n, -1.0);
+    auto field_1 = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw_1.data(),
+        std::array<int,3>{1,0,0}, std::array<int,3>{n+2,n,n});
+    auto field_2 = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw_2.data(),
+        std::array<int,3>{1,0,0}, std::array<int,3>{n+2,n,n});
+
+    // discard the records of the setup
+    capture::write(rank, size, "ghex_capture_test");
+    EXPECT_EQ(capture::num_records(), 0u);
+    auto comm = context.get_communicator(context.get_token());
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(comm);
+
+    // one exchange after the other, then two exchanges in flight at the same time
+    co.exchange(pattern(field_1)).wait();
+    auto h_1 = co.exchange(pattern(field_1));
+    auto h_2 = co.exchange(pattern(field_2));
+    h_2.wait();
+    h_1.wait();
+
+    // messages outside of any exchange
+    std::vector<int> out(4, rank), in(4);
+    auto f_recv = comm.recv(in, left, 7);
+    auto f_send = comm.send(out, right, 7);
+    f_send.wait();
+    f_recv.wait();
+    EXPECT_GT(capture::num_records(), 0u);
+
+    capture::write(rank, size, "ghex_capture_test");
+    EXPECT_EQ(capture::num_records(), 0u);
+    const std::string filename = "ghex_capture_test." + std::to_string(rank) + ".bin";
+    const auto t = capture::read(filename);
+    EXPECT_EQ(t.rank, rank);
+    EXPECT_EQ(t.size, size);
+
+    // per exchange: begin, one send and one receive of a face to each neighbor, end
+    struct exchange_records
+    {
+        int begin = 0, end = 0;
+        double t_begin = 0.0, t_end = 0.0;
+        std::map<int,int> sends, recvs;
+        std::size_t bytes = 0u;
+    };
+    std::map<std::uint32_t, exchange_records> exchanges;
+    int raw_sends = 0, raw_recvs = 0;
+    double t_prev = 0.0;
+    for (const auto& r : t.records)
+    {
+        EXPECT_GE(r.time_us, t_prev);
+        t_prev = r.time_us;
+        if (r.exchange == 0u)
+        {
+            ASSERT_TRUE(r.kind == capture::record_kind::send || r.kind == capture::record_kind::recv);
+            EXPECT_EQ(r.tag, 7);
+            EXPECT_EQ(r.bytes, 4u*sizeof(int));
+            if (r.kind == capture::record_kind::send) { ++raw_sends; EXPECT_EQ(r.peer, right); }
+            else { ++raw_recvs; EXPECT_EQ(r.peer, left); }
+            continue;
+        }
+        auto& e = exchanges[r.exchange];
+        switch (r.kind)
+        {
+            case capture::record_kind::exchange_begin: ++e.begin; e.t_begin = r.time_us; break;
+            case capture::record_kind::exchange_end: ++e.end; e.t_end = r.time_us; break;
+            case capture::record_kind::send: ++e.sends[r.peer]; e.bytes += r.bytes; EXPECT_GE(r.tag, 0); break;
+            case capture::record_kind::recv: ++e.recvs[r.peer]; e.bytes += r.bytes; EXPECT_GE(r.tag, 0); break;
+        }
+    }
+    EXPECT_EQ(raw_sends, 1);
+    EXPECT_EQ(raw_recvs, 1);
+    ASSERT_EQ(exchanges.size(), 3u);
+    for (const auto& p : exchanges)
+    {
+        const auto& e = p.second;
+        EXPECT_EQ(e.begin, 1);
+        EXPECT_EQ(e.end, 1);
+        EXPECT_LE(e.t_begin, e.t_end);
+        std::map<int,int> expected;
+        ++expected[left];
+        ++expected[right];
+        EXPECT_EQ(e.sends, expected);
+        EXPECT_EQ(e.recvs, expected);
+        EXPECT_EQ(e.bytes, 4u*n*n*sizeof(double));
+    }
+    // the second exchange is started while the first is in flight, and completes first
+    auto it = exchanges.begin();
+    const auto& e_1 = (++it)->second;
+    const auto& e_2 = (++it)->second;
+    EXPECT_LT(e_1.t_begin, e_2.t_begin);
+    EXPECT_LT(e_2.t_begin, e_1.t_end);
+    EXPECT_LE(e_2.t_end, e_1.t_end);
+
+    std::remove(filename.c_str());
+}
+
+TEST(traffic_capture, file_format)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // records of another rank of the process are kept
+    capture::send(rank+size, 0, 1, 2u);
+    const auto id = capture::exchange_begin(rank);
+    capture::send(rank, 3, 4, 123456789012ul);
+    capture::exchange_posted();
+    capture::recv(rank, 5, 6, 7u);
+    capture::exchange_end(rank, id);
+    capture::write(rank, size, "ghex_capture_test");
+    EXPECT_EQ(capture::num_records(), 1u);
+    const std::string filename = "ghex_capture_test." + std::to_string(rank) + ".bin";
+    const auto t = capture::read(filename);
+    ASSERT_EQ(t.records.size(), 4u);
+    EXPECT_TRUE(t.records[0].kind == capture::record_kind::exchange_begin);
+    EXPECT_EQ(t.records[0].exchange, id);
+    EXPECT_TRUE(t.records[1].kind == capture::record_kind::send);
+    EXPECT_EQ(t.records[1].peer, 3);
+    EXPECT_EQ(t.records[1].tag, 4);
+    EXPECT_EQ(t.records[1].exchange, id);
+    EXPECT_EQ(t.records[1].bytes, 123456789012ul);
+    EXPECT_TRUE(t.records[2].kind == capture::record_kind::recv);
+    EXPECT_EQ(t.records[2].exchange, 0u);
+    EXPECT_TRUE(t.records[3].kind == capture::record_kind::exchange_end);
+    EXPECT_EQ(t.records[3].exchange, id);
+    // header and 4 records
+    std::FILE* fp = std::fopen(filename.c_str(), "rb");
+    ASSERT_NE(fp, nullptr);
+    std::fseek(fp, 0, SEEK_END);
+    EXPECT_EQ(std::ftell(fp), 28l + 4l*31l);
+    std::fclose(fp);
+
+    capture::write(rank+size, 2*size, "ghex_capture_test");
+    EXPECT_EQ(capture::num_records(), 0u);
+    std::remove(filename.c_str());
+    std::remove(("ghex_capture_test." + std::to_string(rank+size) + ".bin").c_str());
+}
+
+TEST(traffic_capture, capacity_and_threads)
+{
+    int rank, size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    const std::string filename = "ghex_capture_test." + std::to_string(rank) + ".bin";
+
+    // records beyond the capacity of a thread are dropped
+    capture::clear();
+    capture::set_capacity(3);
+    for (int i=0; i<5; ++i) capture::send(rank, i, 0, 8u);
+    EXPECT_EQ(capture::num_records(), 3u);
+    EXPECT_EQ(capture::num_dropped(), 2u);
+    capture::clear();
+    EXPECT_EQ(capture::num_records(), 0u);
+    EXPECT_EQ(capture::num_dropped(), 0u);
+    capture::set_capacity(std::size_t{1u} << 20);
+
+    // the records of one rank are written while other threads record events of other ranks
+    const int num_threads = 4;
+    const int num_events = 10000;
+    std::vector<std::thread> threads;
+    for (int t=0; t<num_threads; ++t)
+        threads.emplace_back([rank,size,t]()
+        {
+            for (int i=0; i<num_events; ++i) capture::recv(rank+(t+1)*size, t, i, 8u);
+        });
+    std::size_t written = 0u;
+    for (int k=0; k<20; ++k)
+    {
+        capture::send(rank, 0, k, 8u);
+        capture::write(rank, size, "ghex_capture_test");
+        written += capture::read(filename).records.size();
+    }
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(written, 20u);
+    EXPECT_EQ(capture::num_records(), (std::size_t)num_threads*num_events);
+    capture::clear();
+    std::remove(filename.c_str());
+}
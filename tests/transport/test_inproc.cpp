@@ -0,0 +1,150 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+#include <thread>
+#include <vector>
+#include <array>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/transport_layer/inproc/context.hpp>
+#include <ghex/transport_layer/message_buffer.hpp>
+#include <ghex/structured/pattern.hpp>
+#include <ghex/structured/domain_descriptor.hpp>
+#include <ghex/structured/simple_field_wrapper.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::threads_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using communicator_type = typename context_type::communicator_type;
+using msg_type = typename communicator_type::message_type;
+using world_type = gridtools::ghex::tl::inproc::world;
+using factory = gridtools::ghex::tl::context_factory<transport, threading>;
+
+const int num_ranks = 4;
+
+// run f(context) on num_ranks threads, each acting as one rank
+template<typename F>
+void run_ranks(F&& f)
+{
+    world_type world(num_ranks);
+    std::vector<std::thread> threads;
+    for (int r=0; r<num_ranks; ++r)
+        threads.emplace_back([&world,&f,r]()
+        {
+            auto context_ptr = factory::create(1, world, r);
+            f(*context_ptr);
+        });
+    for (auto& t : threads) t.join();
+}
+
+TEST(inproc, send_recv_ordered)
+{
+    run_ranks([](context_type& context)
+    {
+        auto comm = context.get_communicator(context.get_token());
+        const int rank = comm.rank();
+        EXPECT_EQ(comm.size(), num_ranks);
+        const int dst = (rank+1)%num_ranks;
+        const int src = (rank+num_ranks-1)%num_ranks;
+        // two messages with the same source and tag are received in the order they were sent
+        gridtools::ghex::tl::message_buffer<> s1(sizeof(int)), s2(sizeof(int)), r1(sizeof(int)), r2(sizeof(int));
+        *reinterpret_cast<int*>(s1.data()) = rank;
+        *reinterpret_cast<int*>(s2.data()) = rank+100;
+        auto fs1 = comm.send(s1, dst, 7);
+        auto fs2 = comm.send(s2, dst, 7);
+        auto fr1 = comm.recv(r1, src, 7);
+        auto fr2 = comm.recv(r2, src, 7);
+        fr2.wait();
+        fr1.wait();
+        fs1.wait();
+        fs2.wait();
+        EXPECT_EQ(*reinterpret_cast<int*>(r1.data()), src);
+        EXPECT_EQ(*reinterpret_cast<int*>(r2.data()), src+100);
+    });
+}
+
+TEST(inproc, callbacks)
+{
+    run_ranks([](context_type& context)
+    {
+        auto comm = context.get_communicator(context.get_token());
+        const int rank = comm.rank();
+        int sent = 0, received = 0;
+        std::vector<int> sources;
+        // every rank receives one message from every other rank
+        for (int r=0; r<num_ranks; ++r)
+            if (r != rank)
+                comm.recv(msg_type{std::vector<int>(1)}, r, 1, [&](msg_type m, int src, int)
+                {
+                    ++received;
+                    EXPECT_EQ(*reinterpret_cast<int*>(m.data()), src);
+                    sources.push_back(src);
+                });
+        std::vector<int> neighs;
+        for (int r=0; r<num_ranks; ++r)
+            if (r != rank) neighs.push_back(r);
+        comm.send_multi(msg_type{std::vector<int>(1, rank)}, neighs, 1, [&](msg_type, int, int) { ++sent; });
+        while (sent < 1 || received < num_ranks-1) comm.progress();
+        EXPECT_EQ(sources.size(), num_ranks-1u);
+        comm.barrier();
+    });
+}
+
+TEST(inproc, cancel)
+{
+    run_ranks([](context_type& context)
+    {
+        auto comm = context.get_communicator(context.get_token());
+        gridtools::ghex::tl::message_buffer<> r(8);
+        auto fut = comm.recv(r, (comm.rank()+1)%num_ranks, 42);
+        EXPECT_TRUE(fut.cancel());
+        int cancelled = 0;
+        auto req = comm.recv(msg_type{std::vector<int>(2)}, (comm.rank()+1)%num_ranks, 43,
+            [&](msg_type, int, int) { ++cancelled; });
+        EXPECT_TRUE(req.cancel());
+        comm.barrier();
+        EXPECT_EQ(cancelled, 0);
+    });
+}
+
+TEST(inproc, halo_exchange)
+{
+    using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+    run_ranks([](context_type& context)
+    {
+        // domains of n^3 along x, periodic
+        const int n = 8;
+        const int rank = context.rank();
+        const int gx = n*num_ranks;
+        std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+            rank, std::array<int,3>{rank*n,0,0}, std::array<int,3>{rank*n+n-1,n-1,n-1}} };
+        auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+            std::array<int,3>{gx-1,n-1,n-1}, std::array<int,6>{1,1,1,1,1,1}, std::array<bool,3>{true,true,true});
+        auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+        std::vector<double> raw((n+2)*(n+2)*(n+2), -1.0);
+        auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(rank, raw.data(),
+            std::array<int,3>{1,1,1}, std::array<int,3>{n+2,n+2,n+2});
+        for (int z=0; z<n; ++z)
+            for (int y=0; y<n; ++y)
+                for (int x=0; x<n; ++x)
+                    field(x,y,z) = (rank*n+x) + 100*y + 10000*z;
+
+        auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+        co.exchange(pattern(field)).wait();
+        for (int z=0; z<n; ++z)
+            for (int y=0; y<n; ++y)
+            {
+                EXPECT_EQ(field(-1,y,z), (rank*n+gx-1)%gx + 100*y + 10000*z);
+                EXPECT_EQ(field(n,y,z), ((rank+1)*n)%gx + 100*y + 10000*z);
+            }
+        EXPECT_EQ(field(0,-1,-1), rank*n + 100*(n-1) + 10000*(n-1));
+    });
+}
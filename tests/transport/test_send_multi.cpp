@@ -9,6 +9,7 @@
  * 
  */
 #include <ghex/threads/none/primitives.hpp>
+#include <array>
 #include <iostream>
 #include <iomanip>
 
@@ -246,3 +247,50 @@ TEST(transport, send_multi_cb_move) {
     auto status = comm.progress();
     EXPECT_EQ(status.num(), 0);
 }
+
+TEST(transport, send_multi_cb_intrusive) {
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    auto token = context.get_token();
+    auto comm = context.get_communicator(token);
+    comm.barrier();
+
+    rank = context.rank();
+
+    using comm_type      = std::remove_reference_t<decltype(comm)>;
+    using allocator_type = std::allocator<unsigned char>;
+    using smsg_type      = gridtools::ghex::tl::intrusive_shared_message_buffer<allocator_type>;
+    using cb_msg_type    = comm_type::message_type;
+    using rank_type      = comm_type::rank_type;
+    using tag_type       = comm_type::tag_type;
+
+    // the completion record is recycled between the iterations
+    for (int i=0; i<2; ++i) {
+        if (rank == 0) {
+            smsg_type smsg{SIZE};
+            init_msg(smsg);
+            smsg_type observer(smsg);
+
+            std::array<int, 3> dsts = {1,2,3};
+            std::array<int, 8> payload{};
+            int arrived = 0;
+            comm.send_multi(std::move(smsg), dsts, 42,
+                [&arrived,payload](cb_msg_type m, rank_type, tag_type){ arrived += (m.size() == SIZE) + payload[0];});
+
+            while (!arrived) comm.progress();
+
+            EXPECT_EQ(arrived, 1);
+            EXPECT_EQ(smsg.use_count(), 0u);
+            // all references held by the sends are released
+            EXPECT_EQ(observer.use_count(), 1u);
+        } else {
+            smsg_type rmsg{SIZE};
+            comm.recv(rmsg, 0, 42).wait();
+            EXPECT_TRUE(check_msg(rmsg));
+        }
+    }
+
+    auto status = comm.progress();
+    EXPECT_EQ(status.num(), 0);
+}
@@ -13,6 +13,7 @@
 #include <ghex/threads/none/primitives.hpp>
 #include <ghex/transport_layer/message_buffer.hpp>
 #include <ghex/transport_layer/shared_message_buffer.hpp>
+#include <ghex/transport_layer/intrusive_shared_message_buffer.hpp>
 #include <ghex/common/timer.hpp>
 #include <gtest/gtest.h>
 
@@ -86,6 +87,7 @@ TEST(transport, ring_send_recv_ft)
     test_ring_send_recv_ft< message_factory<std::vector<unsigned char>> >(comm, sizeof(int));
     test_ring_send_recv_ft< message_factory<gridtools::ghex::tl::message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_ft< message_factory<gridtools::ghex::tl::shared_message_buffer<>> >(comm, sizeof(int));
+    test_ring_send_recv_ft< message_factory<gridtools::ghex::tl::intrusive_shared_message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_ft< message_factory<msg_type> >(comm, sizeof(int));
 }
 
@@ -147,6 +149,7 @@ TEST(transport, ring_send_recv_cb)
     test_ring_send_recv_cb< message_factory<std::vector<unsigned char>> >(comm, sizeof(int));
     test_ring_send_recv_cb< message_factory<gridtools::ghex::tl::message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb< message_factory<gridtools::ghex::tl::shared_message_buffer<>> >(comm, sizeof(int));
+    test_ring_send_recv_cb< message_factory<gridtools::ghex::tl::intrusive_shared_message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb< message_factory<msg_type> >(comm, sizeof(int));
 }
 
@@ -202,6 +205,7 @@ TEST(transport, ring_send_recv_cb_disown)
     test_ring_send_recv_cb_disown< message_factory<std::vector<unsigned char>> >(comm, sizeof(int));
     test_ring_send_recv_cb_disown< message_factory<gridtools::ghex::tl::message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb_disown< message_factory<gridtools::ghex::tl::shared_message_buffer<>> >(comm, sizeof(int));
+    test_ring_send_recv_cb_disown< message_factory<gridtools::ghex::tl::intrusive_shared_message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb_disown< message_factory<msg_type> >(comm, sizeof(int));
 }
 
@@ -282,6 +286,7 @@ TEST(transport, ring_send_recv_cb_resubmit)
     test_ring_send_recv_cb_resubmit< message_factory<std::vector<unsigned char>> >(comm, sizeof(int));
     test_ring_send_recv_cb_resubmit< message_factory<gridtools::ghex::tl::message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb_resubmit< message_factory<gridtools::ghex::tl::shared_message_buffer<>> >(comm, sizeof(int));
+    test_ring_send_recv_cb_resubmit< message_factory<gridtools::ghex::tl::intrusive_shared_message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb_resubmit< message_factory<msg_type> >(comm, sizeof(int));
 }
 
@@ -341,6 +346,7 @@ TEST(transport, ring_send_recv_cb_resubmit_disown)
     test_ring_send_recv_cb_resubmit_disown< message_factory<std::vector<unsigned char>> >(comm, sizeof(int));
     test_ring_send_recv_cb_resubmit_disown< message_factory<gridtools::ghex::tl::message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb_resubmit_disown< message_factory<gridtools::ghex::tl::shared_message_buffer<>> >(comm, sizeof(int));
+    test_ring_send_recv_cb_resubmit_disown< message_factory<gridtools::ghex::tl::intrusive_shared_message_buffer<>> >(comm, sizeof(int));
     test_ring_send_recv_cb_resubmit_disown< message_factory<msg_type> >(comm, sizeof(int));
 }
 
@@ -0,0 +1,109 @@
+/*
+ * GridTools
+ *
+ * Copyright (c) 2014-2020, ETH Zurich
+ * All rights reserved.
+ *
+ * Please, refer to the LICENSE file in the root directory.
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ */
+
+#include <ghex/structured/pattern.hpp>
+#include <ghex/communication_object_2.hpp>
+#include <ghex/transport_layer/mpi/context.hpp>
+#include <ghex/threads/none/primitives.hpp>
+#include <ghex/common/await_futures.hpp>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using transport = gridtools::ghex::tl::mpi_tag;
+using threading = gridtools::ghex::threads::none::primitives;
+using context_type = gridtools::ghex::tl::context<transport, threading>;
+using domain_descriptor_type = gridtools::ghex::structured::domain_descriptor<int,3>;
+using gridtools::ghex::wait_strategy;
+
+TEST(wait_strategy, exchange)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+
+    // 1D decomposition along x, periodic
+    const int n = 8, h = 1;
+    const int nx = n*context.size();
+    const std::array<int,3> offsets{h,h,h};
+    const std::array<int,3> extents{n+2*h,n+2*h,n+2*h};
+    std::vector<domain_descriptor_type> local_domains{ domain_descriptor_type{
+        context.rank(),
+        std::array<int,3>{context.rank()*n, 0, 0},
+        std::array<int,3>{(context.rank()+1)*n-1, n-1, n-1}} };
+    auto halo_gen = domain_descriptor_type::halo_generator_type(std::array<int,3>{0,0,0},
+        std::array<int,3>{nx-1,n-1,n-1}, std::array<int,6>{h,h,h,h,h,h}, std::array<bool,3>{true,true,true});
+    auto pattern = gridtools::ghex::make_pattern<gridtools::ghex::structured::grid>(context, halo_gen, local_domains);
+
+    auto value = [nx,n](int i, int x, int y, int z)
+    {
+        return i*1.0e6 + (x+nx)%nx + 100.0*((y+n)%n) + 10000.0*((z+n)%n);
+    };
+    std::vector<double> raw(extents[0]*extents[1]*extents[2]);
+    auto field = gridtools::ghex::wrap_field<gridtools::ghex::cpu,2,1,0>(context.rank(), raw.data(), offsets, extents);
+
+    auto co = gridtools::ghex::make_communication_object<decltype(pattern)>(context.get_communicator(context.get_token()));
+    EXPECT_EQ(co.get_wait_strategy(), wait_strategy::spin);
+
+    int i = 0;
+    for (auto ws : {wait_strategy::spin, wait_strategy::backoff, wait_strategy::yield, wait_strategy::waitany,
+                    wait_strategy::waitsome})
+    {
+        co.set_wait_strategy(ws);
+        // unchunked and chunked receives
+        for (std::size_t chunk_size : {std::size_t{0}, std::size_t{64}})
+        {
+            co.set_chunk_size(chunk_size);
+            std::fill(raw.begin(), raw.end(), -1.0);
+            for (int z=0; z<n; ++z)
+                for (int y=0; y<n; ++y)
+                    for (int x=0; x<n; ++x)
+                        field(x,y,z) = value(i, context.rank()*n+x, y, z);
+            co.exchange(pattern(field)).wait();
+            bool passed = true;
+            for (int z=-h; z<n+h; ++z)
+                for (int y=-h; y<n+h; ++y)
+                    for (int x=-h; x<n+h; ++x)
+                        if (field(x,y,z) != value(i, context.rank()*n+x, y, z)) passed = false;
+            EXPECT_TRUE(passed);
+            ++i;
+        }
+    }
+}
+
+TEST(wait_strategy, completed_futures)
+{
+    auto context_ptr = gridtools::ghex::tl::context_factory<transport,threading>::create(1, MPI_COMM_WORLD);
+    auto& context = *context_ptr;
+    auto comm = context.get_communicator(context.get_token());
+    const int rank = context.rank();
+
+    for (auto ws : {wait_strategy::waitany, wait_strategy::waitsome})
+    {
+        std::vector<int> out(4, rank), in_1(4, -1), in_2(4, -1);
+        using future_type = decltype(comm)::future<int>;
+        std::vector<future_type> futures;
+        futures.push_back(future_type{0, comm.recv(in_1, rank, 0).m_handle});
+        futures.push_back(future_type{1, comm.recv(in_2, rank, 1).m_handle});
+        futures.push_back(future_type{2, comm.send(out, rank, 0).m_handle});
+        futures.push_back(future_type{3, comm.send(out, rank, 1).m_handle});
+        // completed before awaiting: the continuation is still called for every future
+        futures[0].wait();
+        futures[2].wait();
+        std::vector<int> completed;
+        gridtools::ghex::await_futures(futures, [&completed](int i) { completed.push_back(i); }, ws);
+        std::sort(completed.begin(), completed.end());
+        EXPECT_EQ(completed, (std::vector<int>{0,1,2,3}));
+        EXPECT_EQ(in_1, out);
+        EXPECT_EQ(in_2, out);
+    }
+}